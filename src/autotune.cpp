@@ -0,0 +1,559 @@
+/*******************************************************************************
+ * SRCNN auto-tuning
+ * ----------------------------------------------------------------------------
+ * Layer kernels are timed on synthetic images of some sizes through work
+ * stealing executor. Each parameter is searched in turn while others stay
+ * at best found, then profile goes to a text file keyed by CPU model.
+*******************************************************************************/
+#ifndef EXPORTLIBSRCNN
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "autotune.h"
+#include "srcnnprof.h"
+#include "srcnnjit.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define AUTOTUNE_RUNS       2       /// timed runs of a candidate, best counts.
+#define AUTOTUNE_DIR        ".srcnn"
+#define AUTOTUNE_FILE       "tune.conf"
+
+typedef struct
+{
+    unsigned                width;
+    unsigned                height;
+    vector<unsigned char>   luma;
+    vector<float>           planebuf;
+    vector<float*>          planes;
+    vector<unsigned char>   out;
+}TuneImage;
+
+// Small to large, so tiles of edges and of inside both count.
+static const unsigned tune_sizes[][2] =
+{
+    { 160, 120 },
+    { 320, 180 },
+    { 416, 240 },
+};
+
+static const unsigned tune_tiles[][2] =
+{
+    {  32,  8 },
+    {  64, 16 },
+    { 128, 16 },
+    {  64, 32 },
+    { 256,  8 },
+};
+
+static string cpu_model;
+static string tune_path;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static string trim( const string& s )
+{
+    size_t p0 = s.find_first_not_of( " \t\r\n" );
+
+    if ( p0 == string::npos )
+        return string();
+
+    size_t p1 = s.find_last_not_of( " \t\r\n" );
+
+    return s.substr( p0, p1 - p0 + 1 );
+}
+
+static void makeImage( TuneImage& ti, unsigned w, unsigned h )
+{
+    size_t px = (size_t)w * h;
+
+    ti.width  = w;
+    ti.height = h;
+    ti.luma.resize( px );
+    ti.out.resize( px );
+    ti.planebuf.resize( px * SRCNN_KERNEL_PLANES );
+    ti.planes.resize( SRCNN_KERNEL_PLANES );
+
+    // edges of some widths, flat areas would favour nothing.
+    unsigned seed = 0x12345678u ^ ( w * 31 + h );
+
+    for ( size_t cnt = 0; cnt < px; cnt++ )
+    {
+        seed = seed * 1103515245u + 12345u;
+        unsigned x = cnt % w;
+        unsigned y = cnt / w;
+        ti.luma[cnt] = (unsigned char)( ( ( x ^ y ) & 0x40 ) + ( ( seed >> 16 ) & 0x7F ) );
+    }
+
+    for ( unsigned cnt = 0; cnt < SRCNN_KERNEL_PLANES; cnt++ )
+    {
+        ti.planes[cnt] = &ti.planebuf[ px * cnt ];
+    }
+}
+
+// Seconds of best run, layers of all images.
+static double timeCandidate( vector<TuneImage>& images, const SRCNNKernelConfig& kc,
+                             const srcnn_executor* exec )
+{
+    SRCNNSetKernelConfig( &kc );
+
+    double best = 0.0;
+
+    // first one warms caches and workers.
+    for ( unsigned run = 0; run <= AUTOTUNE_RUNS; run++ )
+    {
+        uint64_t t0 = ProfNow();
+
+        for ( size_t cnt = 0; cnt < images.size(); cnt++ )
+        {
+            TuneImage& ti = images[cnt];
+
+            SRCNNLayer12( ti.luma.data(), ti.width, ti.width, ti.height,
+                          ti.planes.data(), ti.width, NULL, exec );
+            SRCNNLayer3( ti.planes.data(), ti.width, ti.width, ti.height,
+                         ti.out.data(), ti.width, NULL, exec );
+        }
+
+        double secs = (double)( ProfNow() - t0 ) / 1e9;
+
+        if ( ( run > 0 ) && ( ( best == 0.0 ) || ( secs < best ) ) )
+            best = secs;
+    }
+
+    return best;
+}
+
+static const char* layer1Name( int layer1 )
+{
+    if ( layer1 == SRCNN_LAYER1_IM2COL )
+        return "im2col";
+
+    if ( layer1 == SRCNN_LAYER1_JIT )
+        return "jit";
+
+    return "direct";
+}
+
+static void printCandidate( const SRCNNKernelConfig& kc, unsigned threads,
+                            double secs, double mpx )
+{
+    char mode[32] = {0};
+
+    if ( kc.layer1 == SRCNN_LAYER1_IM2COL )
+        snprintf( mode, sizeof( mode ), "im2col x%u", kc.interleave );
+    else
+    if ( kc.layer1 == SRCNN_LAYER1_JIT )
+        snprintf( mode, sizeof( mode ), "jit" );
+    else
+        snprintf( mode, sizeof( mode ), "direct" );
+
+    printf( "  %-12s tile %3ux%-3u threads %3u : %8.2f ms, %6.3f MP/s\n",
+            mode, kc.tile_w, kc.tile_h, threads, secs * 1000.0,
+            secs > 0.0 ? mpx / secs : 0.0 );
+    fflush( stdout );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const char* autoTuneCPUModel()
+{
+    if ( cpu_model.size() > 0 )
+        return cpu_model.c_str();
+
+    FILE* fp = fopen( "/proc/cpuinfo", "r" );
+
+    if ( fp != NULL )
+    {
+        char line[512] = {0};
+
+        while( fgets( line, sizeof( line ), fp ) != NULL )
+        {
+            if ( strncmp( line, "model name", 10 ) == 0 )
+            {
+                const char* pc = strchr( line, ':' );
+
+                if ( pc != NULL )
+                {
+                    cpu_model = trim( pc + 1 );
+                    break;
+                }
+            }
+        }
+
+        fclose( fp );
+    }
+
+    // brackets would end section name.
+    for ( size_t cnt = 0; cnt < cpu_model.size(); cnt++ )
+    {
+        if ( ( cpu_model[cnt] == '[' ) || ( cpu_model[cnt] == ']' ) )
+            cpu_model[cnt] = ' ';
+    }
+
+    if ( cpu_model.size() == 0 )
+        cpu_model = "unknown";
+
+    return cpu_model.c_str();
+}
+
+const char* autoTuneDefaultPath()
+{
+    if ( tune_path.size() > 0 )
+        return tune_path.c_str();
+
+    const char* home = getenv( "HOME" );
+
+    if ( ( home != NULL ) && ( home[0] != 0 ) )
+    {
+        tune_path  = home;
+        tune_path += "/" AUTOTUNE_DIR "/" AUTOTUNE_FILE;
+    }
+    else
+    {
+        tune_path = AUTOTUNE_FILE;
+    }
+
+    return tune_path.c_str();
+}
+
+bool autoTuneLoad( const char* path, AutoTuneProfile& prof )
+{
+    if ( path == NULL )
+        return false;
+
+    FILE* fp = fopen( path, "r" );
+
+    if ( fp == NULL )
+        return false;
+
+    string model   = autoTuneCPUModel();
+    bool   insect  = false;
+    bool   found   = false;
+    char   line[512] = {0};
+
+    AutoTuneProfile ap;
+    memset( &ap, 0, sizeof( ap ) );
+    ap.kernel.tile_w     = SRCNN_TILE_W;
+    ap.kernel.tile_h     = SRCNN_TILE_H;
+    ap.kernel.layer1     = SRCNN_LAYER1_JIT;
+    ap.kernel.interleave = 8;
+
+    while( fgets( line, sizeof( line ), fp ) != NULL )
+    {
+        string strtmp = trim( line );
+
+        if ( ( strtmp.size() == 0 ) || ( strtmp[0] == '#' ) )
+            continue;
+
+        if ( strtmp[0] == '[' )
+        {
+            size_t pe = strtmp.find( ']' );
+            insect = ( pe != string::npos ) && ( strtmp.substr( 1, pe - 1 ) == model );
+            found  = found || insect;
+            continue;
+        }
+
+        if ( insect == false )
+            continue;
+
+        if ( strtmp.find( "tile=" ) == 0 )
+        {
+            unsigned tw = 0;
+            unsigned th = 0;
+
+            if ( ( sscanf( strtmp.c_str() + 5, "%ux%u", &tw, &th ) == 2 ) &&
+                 ( tw > 0 ) && ( th > 0 ) )
+            {
+                ap.kernel.tile_w = tw;
+                ap.kernel.tile_h = th;
+            }
+        }
+        else
+        if ( strtmp.find( "layer1=" ) == 0 )
+        {
+            string strval = strtmp.substr( 7 );
+
+            if ( strval == "im2col" )
+                ap.kernel.layer1 = SRCNN_LAYER1_IM2COL;
+            else
+            if ( strval == "jit" )
+                ap.kernel.layer1 = SRCNN_LAYER1_JIT;
+            else
+                ap.kernel.layer1 = SRCNN_LAYER1_DIRECT;
+        }
+        else
+        if ( strtmp.find( "interleave=" ) == 0 )
+        {
+            ap.kernel.interleave = atoi( strtmp.c_str() + 11 );
+        }
+        else
+        if ( strtmp.find( "threads=" ) == 0 )
+        {
+            int tmpiv = atoi( strtmp.c_str() + 8 );
+
+            if ( tmpiv > 0 )
+                ap.threads = tmpiv;
+        }
+    }
+
+    fclose( fp );
+
+    if ( found == false )
+        return false;
+
+    // same checks as any config set later.
+    SRCNNKernelConfig saved;
+    SRCNNGetKernelConfig( &saved );
+    SRCNNSetKernelConfig( &ap.kernel );
+    SRCNNGetKernelConfig( &ap.kernel );
+    SRCNNSetKernelConfig( &saved );
+
+    prof = ap;
+
+    return true;
+}
+
+bool autoTuneSave( const char* path, const AutoTuneProfile& prof )
+{
+    if ( path == NULL )
+        return false;
+
+    string model = autoTuneCPUModel();
+    string spath = path;
+
+    // directories of default path may not exist yet.
+    for ( size_t sp = spath.find( '/', 1 ); sp != string::npos; sp = spath.find( '/', sp + 1 ) )
+    {
+        mkdir( spath.substr( 0, sp ).c_str(), 0755 );
+    }
+
+    // keeps other models.
+    vector<string> kept;
+    FILE* fp = fopen( path, "r" );
+
+    if ( fp != NULL )
+    {
+        bool insect = false;
+        char line[512] = {0};
+
+        while( fgets( line, sizeof( line ), fp ) != NULL )
+        {
+            string strtmp = trim( line );
+
+            if ( ( strtmp.size() > 0 ) && ( strtmp[0] == '[' ) )
+            {
+                size_t pe = strtmp.find( ']' );
+                insect = ( pe != string::npos ) && ( strtmp.substr( 1, pe - 1 ) == model );
+            }
+
+            if ( ( insect == false ) && ( strtmp.size() > 0 ) )
+                kept.push_back( strtmp );
+        }
+
+        fclose( fp );
+    }
+
+    // renamed over old one, readers never see a half file.
+    string tmppath = spath + ".tmp";
+
+    fp = fopen( tmppath.c_str(), "w" );
+
+    if ( fp == NULL )
+        return false;
+
+    if ( ( kept.size() == 0 ) || ( kept[0][0] != '#' ) )
+    {
+        fprintf( fp, "# srcnn autotune profiles, one section per CPU model.\n" );
+    }
+
+    for ( size_t cnt = 0; cnt < kept.size(); cnt++ )
+    {
+        if ( ( cnt > 0 ) && ( kept[cnt][0] == '[' ) )
+            fprintf( fp, "\n" );
+
+        fprintf( fp, "%s\n", kept[cnt].c_str() );
+    }
+
+    fprintf( fp, "\n[%s]\n", model.c_str() );
+    fprintf( fp, "tile=%ux%u\n", prof.kernel.tile_w, prof.kernel.tile_h );
+    fprintf( fp, "layer1=%s\n", layer1Name( prof.kernel.layer1 ) );
+    fprintf( fp, "interleave=%u\n", prof.kernel.interleave );
+    fprintf( fp, "threads=%u\n", prof.threads );
+
+    bool written = ( ferror( fp ) == 0 );
+
+    if ( fclose( fp ) != 0 )
+        written = false;
+
+    if ( ( written == false ) || ( rename( tmppath.c_str(), path ) != 0 ) )
+    {
+        unlink( tmppath.c_str() );
+        return false;
+    }
+
+    return true;
+}
+
+bool autoTuneRun( AutoTuneProfile& prof, unsigned maxthreads,
+                  const int* cpus, unsigned cpu_count, bool verbose )
+{
+    if ( maxthreads == 0 )
+    {
+        long ncpu = sysconf( _SC_NPROCESSORS_ONLN );
+        maxthreads = ncpu > 0 ? (unsigned)ncpu : 1;
+    }
+
+    SRCNNKernelConfig saved;
+    SRCNNGetKernelConfig( &saved );
+
+    vector<TuneImage> images( sizeof( tune_sizes ) / sizeof( tune_sizes[0] ) );
+    double mpx = 0.0;
+
+    for ( size_t cnt = 0; cnt < images.size(); cnt++ )
+    {
+        makeImage( images[cnt], tune_sizes[cnt][0], tune_sizes[cnt][1] );
+        mpx += (double)tune_sizes[cnt][0] * tune_sizes[cnt][1] / 1e6;
+    }
+
+    srcnn_executor* exec = srcnn_executor_steal_create_pinned( maxthreads, cpus, cpu_count );
+
+    if ( exec == NULL )
+        return false;
+
+    if ( verbose == true )
+    {
+        printf( "- Auto-tuning on %s, %u thread%s\n",
+                autoTuneCPUModel(), maxthreads, maxthreads > 1 ? "s" : "" );
+        printf( "- Layer I mode :\n" );
+    }
+
+    SRCNNKernelConfig best = { SRCNN_TILE_W, SRCNN_TILE_H, SRCNN_LAYER1_DIRECT, 8 };
+    double            bestsecs = timeCandidate( images, best, exec );
+
+    if ( verbose == true )
+        printCandidate( best, maxthreads, bestsecs, mpx );
+
+    static const unsigned interleaves[] = { 4, 8, 16 };
+
+    for ( unsigned cnt = 0; cnt < 3; cnt++ )
+    {
+        SRCNNKernelConfig kc = best;
+        kc.layer1     = SRCNN_LAYER1_IM2COL;
+        kc.interleave = interleaves[cnt];
+
+        double secs = timeCandidate( images, kc, exec );
+
+        if ( verbose == true )
+            printCandidate( kc, maxthreads, secs, mpx );
+
+        if ( secs < bestsecs )
+        {
+            best     = kc;
+            bestsecs = secs;
+        }
+    }
+
+    // generated kernels, when this CPU has them.
+    if ( SRCNNJitGet() != NULL )
+    {
+        SRCNNKernelConfig kc = best;
+        kc.layer1 = SRCNN_LAYER1_JIT;
+
+        double secs = timeCandidate( images, kc, exec );
+
+        if ( verbose == true )
+            printCandidate( kc, maxthreads, secs, mpx );
+
+        if ( secs < bestsecs )
+        {
+            best     = kc;
+            bestsecs = secs;
+        }
+    }
+
+    if ( verbose == true )
+        printf( "- Tile size :\n" );
+
+    SRCNNKernelConfig modebest = best;
+
+    for ( unsigned cnt = 0; cnt < sizeof( tune_tiles ) / sizeof( tune_tiles[0] ); cnt++ )
+    {
+        SRCNNKernelConfig kc = modebest;
+        kc.tile_w = tune_tiles[cnt][0];
+        kc.tile_h = tune_tiles[cnt][1];
+
+        // mode search ran default tile already.
+        if ( ( kc.tile_w == modebest.tile_w ) && ( kc.tile_h == modebest.tile_h ) )
+            continue;
+
+        double secs = timeCandidate( images, kc, exec );
+
+        if ( verbose == true )
+            printCandidate( kc, maxthreads, secs, mpx );
+
+        if ( secs < bestsecs )
+        {
+            best     = kc;
+            bestsecs = secs;
+        }
+    }
+
+    srcnn_executor_pool_destroy( exec );
+
+    // fewer threads win on SMT and busy or memory bound machines.
+    unsigned bestthreads = maxthreads;
+
+    if ( maxthreads > 1 )
+    {
+        if ( verbose == true )
+            printf( "- Threads :\n" );
+
+        for ( unsigned threads = 1; threads < maxthreads; threads *= 2 )
+        {
+            srcnn_executor* texec = srcnn_executor_steal_create_pinned( threads, cpus, cpu_count );
+
+            if ( texec == NULL )
+                continue;
+
+            double secs = timeCandidate( images, best, texec );
+
+            srcnn_executor_pool_destroy( texec );
+
+            if ( verbose == true )
+                printCandidate( best, threads, secs, mpx );
+
+            if ( secs < bestsecs )
+            {
+                bestthreads = threads;
+                bestsecs    = secs;
+            }
+        }
+    }
+
+    SRCNNSetKernelConfig( &saved );
+
+    prof.kernel  = best;
+    prof.threads = bestthreads;
+
+    if ( verbose == true )
+    {
+        printf( "- Best :\n" );
+        printCandidate( best, bestthreads, bestsecs, mpx );
+    }
+
+    return true;
+}
+
+#endif /// of EXPORTLIBSRCNN
@@ -0,0 +1,41 @@
+#ifndef __AUTOTUNE_H__
+#define __AUTOTUNE_H__
+
+#include <cstddef>
+#include "srcnnkernel.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Auto-tuning of layer kernels on this machine.
+// - Searches layer I mode, im2col interleave, tile size and thread count,
+//   one at a time with others kept at best found ( coordinate descent ).
+// - Profiles are saved per CPU model in a text file, sections as
+//   [model name] with key=value lines, later runs load matching one.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+    SRCNNKernelConfig   kernel;
+    unsigned            threads;    /// 0 for all cores.
+}AutoTuneProfile;
+
+// "model name" of /proc/cpuinfo, or "unknown".
+const char* autoTuneCPUModel();
+
+// ~/.srcnn/tune.conf, or tune.conf when HOME is not set.
+const char* autoTuneDefaultPath();
+
+// Profile of this CPU model, false when file or section is not found.
+bool autoTuneLoad( const char* path, AutoTuneProfile& prof );
+
+// Replaces section of this CPU model, sections of others are kept.
+bool autoTuneSave( const char* path, const AutoTuneProfile& prof );
+
+// Times candidates with threads up to maxthreads, 0 for all cores.
+// Workers are pinned to cpus as srcnn_executor_steal_create_pinned(),
+// cpus may be NULL. Kernel config is restored after, false on failure.
+bool autoTuneRun( AutoTuneProfile& prof, unsigned maxthreads,
+                  const int* cpus, unsigned cpu_count, bool verbose );
+
+#endif /// of __AUTOTUNE_H__
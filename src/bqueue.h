@@ -0,0 +1,110 @@
+#ifndef __BQUEUE_H__
+#define __BQUEUE_H__
+
+#include <cstddef>
+#include <deque>
+#include <pthread.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Bounded blocking queue for pipelined stages.
+// - push() blocks while full, pop() blocks while empty.
+// - close() wakes everyone, pop() drains remained items before failing.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class BoundedQueue
+{
+    public:
+        BoundedQueue( size_t depth = 4 )
+         : _depth( depth > 0 ? depth : 1 ),
+           _closed( false )
+        {
+            pthread_mutex_init( &_mutex, NULL );
+            pthread_cond_init( &_notfull, NULL );
+            pthread_cond_init( &_notempty, NULL );
+        }
+
+        ~BoundedQueue()
+        {
+            pthread_cond_destroy( &_notempty );
+            pthread_cond_destroy( &_notfull );
+            pthread_mutex_destroy( &_mutex );
+        }
+
+    public:
+        bool push( const T& item )
+        {
+            pthread_mutex_lock( &_mutex );
+
+            while( ( _items.size() >= _depth ) && ( _closed == false ) )
+            {
+                pthread_cond_wait( &_notfull, &_mutex );
+            }
+
+            if ( _closed == true )
+            {
+                pthread_mutex_unlock( &_mutex );
+                return false;
+            }
+
+            _items.push_back( item );
+
+            pthread_cond_signal( &_notempty );
+            pthread_mutex_unlock( &_mutex );
+
+            return true;
+        }
+
+        bool pop( T& item )
+        {
+            pthread_mutex_lock( &_mutex );
+
+            while( ( _items.size() == 0 ) && ( _closed == false ) )
+            {
+                pthread_cond_wait( &_notempty, &_mutex );
+            }
+
+            if ( _items.size() == 0 )
+            {
+                pthread_mutex_unlock( &_mutex );
+                return false;
+            }
+
+            item = _items.front();
+            _items.pop_front();
+
+            pthread_cond_signal( &_notfull );
+            pthread_mutex_unlock( &_mutex );
+
+            return true;
+        }
+
+        void close()
+        {
+            pthread_mutex_lock( &_mutex );
+            _closed = true;
+            pthread_cond_broadcast( &_notfull );
+            pthread_cond_broadcast( &_notempty );
+            pthread_mutex_unlock( &_mutex );
+        }
+
+        size_t size()
+        {
+            pthread_mutex_lock( &_mutex );
+            size_t sz = _items.size();
+            pthread_mutex_unlock( &_mutex );
+            return sz;
+        }
+
+    private:
+        pthread_mutex_t _mutex;
+        pthread_cond_t  _notfull;
+        pthread_cond_t  _notempty;
+        std::deque<T>   _items;
+        size_t          _depth;
+        bool            _closed;
+};
+
+#endif /// of __BQUEUE_H__
@@ -0,0 +1,979 @@
+/*******************************************************************************
+ * SRCNN daemon mode
+ * ----------------------------------------------------------------------------
+ * Keeps engine warm in one process and serves many clients over a Unix
+ * domain socket. One epoll event loop does all socket I/O without
+ * blocking, worker threads decode, process and encode requests.
+*******************************************************************************/
+#ifndef EXPORTLIBSRCNN
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "srcnn.h"
+#include "daemon.h"
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "srcnnproto.h"
+#include "bqueue.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+using namespace cv;
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define DAEMON_MAX_EVENTS       64
+#define DAEMON_MAX_PAYLOAD      ( 256u * 1024u * 1024u )
+#define DAEMON_WAIT_MS          500
+#define DAEMON_LISTEN_BACKLOG   64
+#define DAEMON_MAX_FDS          2
+
+typedef enum
+{
+    CONN_READ_HEADER = 0,
+    CONN_READ_PAYLOAD,
+    CONN_PROCESSING,
+    CONN_WRITE_REPLY
+}ConnState;
+
+typedef struct
+{
+    unsigned            id;
+    int                 fd;
+    ConnState           state;
+    bool                closing;    /// close after reply written.
+    srcnn_req_header    req;
+    size_t              inpos;
+    vector<uchar>       payload;
+    vector<uchar>       reply;
+    size_t              outpos;
+    int                 fds[ DAEMON_MAX_FDS ];  /// passed with request header.
+    unsigned            fdcount;
+}DaemonConn;
+
+typedef struct
+{
+    unsigned            connid;
+    srcnn_req_header    req;
+    vector<uchar>       payload;
+    vector<uchar>       reply;
+    int                 fds[ DAEMON_MAX_FDS ];
+    unsigned            fdcount;
+}DaemonJob;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void closeFds( int* fds, unsigned& fdcount )
+{
+    for( unsigned cnt = 0; cnt < fdcount; cnt++ )
+    {
+        ::close( fds[cnt] );
+    }
+
+    fdcount = 0;
+}
+
+#ifndef F_GET_SEALS
+    #define F_GET_SEALS     1034
+#endif
+
+#ifndef F_SEAL_SHRINK
+    #define F_SEAL_SHRINK   0x0002
+#endif
+
+// Client may not shrink fd under mapping ( SIGBUS ), memfd seal is needed.
+static bool sealedShrink( int fd )
+{
+    int seals = fcntl( fd, F_GET_SEALS );
+
+    return ( seals >= 0 ) && ( ( seals & F_SEAL_SHRINK ) != 0 );
+}
+
+/***
+ * FuncName : mapShared
+ * Function : maps size bytes at offset of fd, pages covering them only
+ * Parameter    : fd - sealed memfd
+ *        offset, size - client values, checked against fd size
+ *        writable - output buffer
+ *        base, mapsz - mapping to be unmapped
+ * Output   : uchar*, first byte at offset, NULL when fd is too small
+***/
+static uchar* mapShared( int fd, uint64_t offset, uint64_t size, bool writable,
+                         void*& base, size_t& mapsz )
+{
+    struct stat st;
+
+    base  = NULL;
+    mapsz = 0;
+
+    if ( ( size == 0 ) || ( fstat( fd, &st ) != 0 ) || ( st.st_size < 0 ) )
+        return NULL;
+
+    // never added, client offsets may wrap.
+    uint64_t fsize = (uint64_t)st.st_size;
+
+    if ( ( offset > fsize ) || ( size > fsize - offset ) )
+        return NULL;
+
+    uint64_t page   = (uint64_t)sysconf( _SC_PAGESIZE );
+    uint64_t pgoff  = offset - ( offset % page );
+    uint64_t length = ( offset - pgoff ) + size;
+
+    if ( ( length > (uint64_t)SIZE_MAX ) || ( pgoff > (uint64_t)INT64_MAX ) )
+        return NULL;
+
+    void* ptr = mmap( NULL, (size_t)length,
+                      writable ? ( PROT_READ | PROT_WRITE ) : PROT_READ,
+                      MAP_SHARED, fd, (off_t)pgoff );
+
+    if ( ptr == MAP_FAILED )
+        return NULL;
+
+    base  = ptr;
+    mapsz = (size_t)length;
+
+    return (uchar*)ptr + ( offset - pgoff );
+}
+
+static volatile sig_atomic_t daemon_stop = 0;
+
+static void daemonSignal( int /* sig */ )
+{
+    daemon_stop = 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+class DaemonServer
+{
+    public:
+        DaemonServer( const DaemonConfig& cfg );
+        ~DaemonServer();
+
+    public:
+        int  run();
+
+    private:
+        bool openSocket();
+        void acceptClients();
+        void closeConn( DaemonConn* conn );
+        void readConn( DaemonConn* conn );
+        void writeConn( DaemonConn* conn );
+        void watchConn( DaemonConn* conn, unsigned events );
+        void requestDone( DaemonConn* conn );
+        void replyError( DaemonConn* conn, int status );
+        void collectDone();
+
+    private:
+        static void* workerCall( void* p );
+        void processJob( DaemonJob* job, ImageWorkspace& ws );
+        int  processShared( DaemonJob* job, float mulf, bool isgray,
+                            srcnn_rep_header& rep, ImageWorkspace& ws );
+
+    private:
+        DaemonConfig                _cfg;
+        int                         _fdlisten;
+        int                         _fdepoll;
+        int                         _fdevent;
+        unsigned                    _lastid;
+        map<unsigned, DaemonConn*>  _conns;
+        BoundedQueue<DaemonJob*>    _jobs;
+        vector<DaemonJob*>          _done;
+        pthread_mutex_t             _donelock;
+        vector<pthread_t>           _workers;
+};
+
+DaemonServer::DaemonServer( const DaemonConfig& cfg )
+ : _cfg( cfg ),
+   _fdlisten( -1 ),
+   _fdepoll( -1 ),
+   _fdevent( -1 ),
+   _lastid( 0 ),
+   _jobs( cfg.maxclients )
+{
+    pthread_mutex_init( &_donelock, NULL );
+}
+
+DaemonServer::~DaemonServer()
+{
+    map<unsigned, DaemonConn*>::iterator it;
+    for( it = _conns.begin(); it != _conns.end(); ++it )
+    {
+        closeFds( it->second->fds, it->second->fdcount );
+        ::close( it->second->fd );
+        delete it->second;
+    }
+
+    for( size_t cnt = 0; cnt < _done.size(); cnt++ )
+    {
+        closeFds( _done[cnt]->fds, _done[cnt]->fdcount );
+        delete _done[cnt];
+    }
+
+    if ( _fdlisten >= 0 )
+    {
+        ::close( _fdlisten );
+        unlink( _cfg.sockpath );
+    }
+
+    if ( _fdevent >= 0 )
+        ::close( _fdevent );
+
+    if ( _fdepoll >= 0 )
+        ::close( _fdepoll );
+
+    pthread_mutex_destroy( &_donelock );
+}
+
+bool DaemonServer::openSocket()
+{
+    struct sockaddr_un addr;
+
+    if ( strlen( _cfg.sockpath ) >= sizeof( addr.sun_path ) )
+        return false;
+
+    _fdlisten = socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+    if ( _fdlisten < 0 )
+        return false;
+
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, _cfg.sockpath );
+
+    // stale socket file of previous run.
+    unlink( _cfg.sockpath );
+
+    if ( bind( _fdlisten, (struct sockaddr*)&addr, sizeof( addr ) ) != 0 )
+        return false;
+
+    if ( listen( _fdlisten, DAEMON_LISTEN_BACKLOG ) != 0 )
+        return false;
+
+    _fdepoll = epoll_create1( EPOLL_CLOEXEC );
+    _fdevent = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+    if ( ( _fdepoll < 0 ) || ( _fdevent < 0 ) )
+        return false;
+
+    struct epoll_event ev;
+    memset( &ev, 0, sizeof( ev ) );
+
+    // listen socket and event fd are known by fd, clients by id + 2.
+    ev.events   = EPOLLIN;
+    ev.data.u64 = 0;
+    if ( epoll_ctl( _fdepoll, EPOLL_CTL_ADD, _fdlisten, &ev ) != 0 )
+        return false;
+
+    ev.data.u64 = 1;
+    if ( epoll_ctl( _fdepoll, EPOLL_CTL_ADD, _fdevent, &ev ) != 0 )
+        return false;
+
+    return true;
+}
+
+int DaemonServer::run()
+{
+    if ( openSocket() == false )
+    {
+        if ( _cfg.verbose == true )
+        {
+            printf( "- Daemon socket failure : %s ( %s )\n",
+                    _cfg.sockpath, strerror( errno ) );
+        }
+        return -1;
+    }
+
+    _workers.resize( _cfg.workers );
+
+    for( unsigned cnt = 0; cnt < _cfg.workers; cnt++ )
+    {
+        pthread_create( &_workers[cnt], NULL, workerCall, this );
+    }
+
+    if ( _cfg.verbose == true )
+    {
+        printf( "- Daemon listening : %s, %u worker(s)\n",
+                _cfg.sockpath, _cfg.workers );
+        fflush( stdout );
+    }
+
+    struct epoll_event events[ DAEMON_MAX_EVENTS ];
+
+    while( daemon_stop == 0 )
+    {
+        int evcnt = epoll_wait( _fdepoll, events, DAEMON_MAX_EVENTS, DAEMON_WAIT_MS );
+
+        if ( evcnt < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            break;
+        }
+
+        for( int cnt = 0; cnt < evcnt; cnt++ )
+        {
+            uint64_t key = events[cnt].data.u64;
+
+            if ( key == 0 )
+            {
+                acceptClients();
+                continue;
+            }
+
+            if ( key == 1 )
+            {
+                collectDone();
+                continue;
+            }
+
+            map<unsigned, DaemonConn*>::iterator it = _conns.find( (unsigned)( key - 2 ) );
+            if ( it == _conns.end() )
+                continue;
+
+            DaemonConn* conn = it->second;
+
+            if ( events[cnt].events & ( EPOLLERR | EPOLLHUP ) )
+            {
+                closeConn( conn );
+                continue;
+            }
+
+            if ( events[cnt].events & EPOLLIN )
+            {
+                readConn( conn );
+            }
+            else
+            if ( events[cnt].events & EPOLLOUT )
+            {
+                writeConn( conn );
+            }
+        }
+    }
+
+    _jobs.close();
+
+    for( unsigned cnt = 0; cnt < _workers.size(); cnt++ )
+    {
+        pthread_join( _workers[cnt], NULL );
+    }
+
+    if ( _cfg.verbose == true )
+    {
+        printf( "- Daemon stopped.\n" );
+        fflush( stdout );
+    }
+
+    return 0;
+}
+
+void DaemonServer::acceptClients()
+{
+    while( true )
+    {
+        int fd = accept4( _fdlisten, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC );
+
+        if ( fd < 0 )
+            break;
+
+        if ( _conns.size() >= _cfg.maxclients )
+        {
+            ::close( fd );
+            continue;
+        }
+
+        DaemonConn* conn = new DaemonConn;
+
+        conn->id      = ++_lastid;
+        conn->fd      = fd;
+        conn->state   = CONN_READ_HEADER;
+        conn->closing = false;
+        conn->inpos   = 0;
+        conn->outpos  = 0;
+        conn->fdcount = 0;
+
+        struct epoll_event ev;
+        memset( &ev, 0, sizeof( ev ) );
+        ev.events   = EPOLLIN;
+        ev.data.u64 = (uint64_t)conn->id + 2;
+
+        if ( epoll_ctl( _fdepoll, EPOLL_CTL_ADD, fd, &ev ) != 0 )
+        {
+            ::close( fd );
+            delete conn;
+            continue;
+        }
+
+        _conns[ conn->id ] = conn;
+    }
+}
+
+void DaemonServer::closeConn( DaemonConn* conn )
+{
+    // processing job of this connection will be dropped when done.
+    epoll_ctl( _fdepoll, EPOLL_CTL_DEL, conn->fd, NULL );
+    closeFds( conn->fds, conn->fdcount );
+    ::close( conn->fd );
+    _conns.erase( conn->id );
+    delete conn;
+}
+
+void DaemonServer::watchConn( DaemonConn* conn, unsigned events )
+{
+    struct epoll_event ev;
+    memset( &ev, 0, sizeof( ev ) );
+    ev.events   = events;
+    ev.data.u64 = (uint64_t)conn->id + 2;
+
+    epoll_ctl( _fdepoll, EPOLL_CTL_MOD, conn->fd, &ev );
+}
+
+void DaemonServer::readConn( DaemonConn* conn )
+{
+    while( ( conn->state == CONN_READ_HEADER ) ||
+           ( conn->state == CONN_READ_PAYLOAD ) )
+    {
+        uchar* dst  = NULL;
+        size_t need = 0;
+
+        if ( conn->state == CONN_READ_HEADER )
+        {
+            dst  = (uchar*)&conn->req + conn->inpos;
+            need = sizeof( srcnn_req_header ) - conn->inpos;
+        }
+        else
+        {
+            dst  = conn->payload.data() + conn->inpos;
+            need = conn->payload.size() - conn->inpos;
+        }
+
+        if ( need > 0 )
+        {
+            // descriptors come along with first bytes of request header.
+            union
+            {
+                struct cmsghdr  align;
+                char            buff[ CMSG_SPACE( sizeof( int ) * DAEMON_MAX_FDS ) ];
+            }cmsgbuff;
+
+            struct iovec  iov;
+            struct msghdr msg;
+
+            iov.iov_base = dst;
+            iov.iov_len  = need;
+
+            memset( &msg, 0, sizeof( msg ) );
+            msg.msg_iov     = &iov;
+            msg.msg_iovlen  = 1;
+
+            if ( conn->state == CONN_READ_HEADER )
+            {
+                msg.msg_control    = cmsgbuff.buff;
+                msg.msg_controllen = sizeof( cmsgbuff.buff );
+            }
+
+            ssize_t rsz = ::recvmsg( conn->fd, &msg, MSG_CMSG_CLOEXEC );
+
+            if ( ( rsz > 0 ) && ( msg.msg_controllen > 0 ) )
+            {
+                struct cmsghdr* cmsg = CMSG_FIRSTHDR( &msg );
+
+                for( ; cmsg != NULL; cmsg = CMSG_NXTHDR( &msg, cmsg ) )
+                {
+                    if ( ( cmsg->cmsg_level != SOL_SOCKET ) ||
+                         ( cmsg->cmsg_type != SCM_RIGHTS ) )
+                        continue;
+
+                    unsigned fdcnt = ( cmsg->cmsg_len - CMSG_LEN( 0 ) ) / sizeof( int );
+                    int*     pfds  = (int*)CMSG_DATA( cmsg );
+
+                    for( unsigned cnt = 0; cnt < fdcnt; cnt++ )
+                    {
+                        if ( conn->fdcount < DAEMON_MAX_FDS )
+                        {
+                            conn->fds[ conn->fdcount++ ] = pfds[cnt];
+                        }
+                        else
+                        {
+                            ::close( pfds[cnt] );
+                        }
+                    }
+                }
+            }
+
+            if ( rsz == 0 )
+            {
+                closeConn( conn );
+                return;
+            }
+
+            if ( rsz < 0 )
+            {
+                if ( ( errno != EAGAIN ) && ( errno != EWOULDBLOCK ) && ( errno != EINTR ) )
+                {
+                    closeConn( conn );
+                }
+                return;
+            }
+
+            conn->inpos += rsz;
+
+            if ( (size_t)rsz < need )
+                continue;
+        }
+
+        if ( conn->state == CONN_READ_HEADER )
+        {
+            if ( ( conn->req.magic != SRCNN_PROTO_MAGIC ) ||
+                 ( conn->req.version != SRCNN_PROTO_VERSION ) ||
+                 ( conn->req.payload_size > DAEMON_MAX_PAYLOAD ) )
+            {
+                replyError( conn, SRCNN_REP_EREQUEST );
+                return;
+            }
+
+            conn->payload.resize( conn->req.payload_size );
+            conn->inpos = 0;
+            conn->state = CONN_READ_PAYLOAD;
+        }
+        else
+        {
+            requestDone( conn );
+            return;
+        }
+    }
+}
+
+void DaemonServer::requestDone( DaemonConn* conn )
+{
+    DaemonJob* job = new DaemonJob;
+
+    job->connid  = conn->id;
+    job->req     = conn->req;
+    job->fdcount = conn->fdcount;
+    job->payload.swap( conn->payload );
+
+    for( unsigned cnt = 0; cnt < conn->fdcount; cnt++ )
+    {
+        job->fds[cnt] = conn->fds[cnt];
+    }
+
+    conn->fdcount = 0;
+
+    conn->state = CONN_PROCESSING;
+    conn->inpos = 0;
+
+    // no more reading until reply written, next request waits in socket.
+    watchConn( conn, 0 );
+
+    if ( _jobs.push( job ) == false )
+    {
+        delete job;
+        closeConn( conn );
+    }
+}
+
+void DaemonServer::replyError( DaemonConn* conn, int status )
+{
+    srcnn_rep_header rep;
+    memset( &rep, 0, sizeof( rep ) );
+    rep.magic  = SRCNN_PROTO_MAGIC;
+    rep.status = status;
+
+    conn->reply.resize( sizeof( rep ) );
+    memcpy( conn->reply.data(), &rep, sizeof( rep ) );
+    conn->outpos  = 0;
+    conn->state   = CONN_WRITE_REPLY;
+    conn->closing = true;
+
+    writeConn( conn );
+}
+
+void DaemonServer::writeConn( DaemonConn* conn )
+{
+    while( conn->outpos < conn->reply.size() )
+    {
+        ssize_t wsz = ::send( conn->fd,
+                              conn->reply.data() + conn->outpos,
+                              conn->reply.size() - conn->outpos,
+                              MSG_NOSIGNAL );
+
+        if ( wsz < 0 )
+        {
+            if ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) || ( errno == EINTR ) )
+            {
+                watchConn( conn, EPOLLOUT );
+                return;
+            }
+
+            closeConn( conn );
+            return;
+        }
+
+        conn->outpos += wsz;
+    }
+
+    if ( conn->closing == true )
+    {
+        closeConn( conn );
+        return;
+    }
+
+    vector<uchar>().swap( conn->reply );
+    conn->outpos = 0;
+    conn->state  = CONN_READ_HEADER;
+
+    watchConn( conn, EPOLLIN );
+}
+
+void DaemonServer::collectDone()
+{
+    uint64_t evcnt = 0;
+    if ( ::read( _fdevent, &evcnt, sizeof( evcnt ) ) < 0 )
+    {
+        // nothing signaled, spurious wake up.
+    }
+
+    vector<DaemonJob*> done;
+
+    pthread_mutex_lock( &_donelock );
+    done.swap( _done );
+    pthread_mutex_unlock( &_donelock );
+
+    for( size_t cnt = 0; cnt < done.size(); cnt++ )
+    {
+        DaemonJob* job = done[cnt];
+
+        map<unsigned, DaemonConn*>::iterator it = _conns.find( job->connid );
+        if ( it != _conns.end() )
+        {
+            DaemonConn* conn = it->second;
+
+            conn->reply.swap( job->reply );
+            conn->outpos = 0;
+            conn->state  = CONN_WRITE_REPLY;
+
+            writeConn( conn );
+        }
+
+        delete job;
+    }
+}
+
+void* DaemonServer::workerCall( void* p )
+{
+    DaemonServer*  server = (DaemonServer*)p;
+    DaemonJob*     job    = NULL;
+    ImageWorkspace ws;      /// kept by this worker for every job.
+
+    while( server->_jobs.pop( job ) == true )
+    {
+        server->processJob( job, ws );
+        closeFds( job->fds, job->fdcount );
+
+        pthread_mutex_lock( &server->_donelock );
+        server->_done.push_back( job );
+        pthread_mutex_unlock( &server->_donelock );
+
+        uint64_t one = 1;
+        if ( ::write( server->_fdevent, &one, sizeof( one ) ) < 0 )
+        {
+            // event counter saturated, loop wakes up anyway.
+        }
+    }
+
+    return NULL;
+}
+
+void DaemonServer::processJob( DaemonJob* job, ImageWorkspace& ws )
+{
+    srcnn_rep_header rep;
+    memset( &rep, 0, sizeof( rep ) );
+    rep.magic = SRCNN_PROTO_MAGIC;
+
+    float mulf   = ( job->req.scale > 0.f ) ? job->req.scale : _cfg.scale;
+    bool  isgray = _cfg.grayscale || ( ( job->req.flags & SRCNN_REQF_GRAY ) != 0 );
+    int   rflag  = isgray ? IMREAD_GRAYSCALE : IMREAD_ANYCOLOR;
+
+    Mat           pImgSrc;
+    Mat           pImgOut;
+    vector<uchar> encoded;
+    string        dstpath;
+
+    try
+    {
+        switch( job->req.type )
+        {
+            case SRCNN_REQ_PATH:
+                {
+                    // "source\0output\0"
+                    const char* pstr = (const char*)job->payload.data();
+                    size_t      plen = job->payload.size();
+                    size_t      slen = strnlen( pstr, plen );
+
+                    if ( ( slen == 0 ) || ( slen + 1 >= plen ) )
+                    {
+                        rep.status = SRCNN_REP_EREQUEST;
+                        break;
+                    }
+
+                    dstpath.assign( pstr + slen + 1, strnlen( pstr + slen + 1, plen - slen - 1 ) );
+                    pImgSrc = imread( string( pstr, slen ), rflag );
+                }
+                break;
+
+            case SRCNN_REQ_IMAGE:
+                pImgSrc = imdecode( job->payload, rflag );
+                break;
+
+            case SRCNN_REQ_SHM:
+                rep.status = processShared( job, mulf, isgray, rep, ws );
+                break;
+
+            default:
+                rep.status = SRCNN_REP_EREQUEST;
+                break;
+        }
+
+        if ( ( rep.status == SRCNN_REP_OK ) && ( job->req.type != SRCNN_REQ_SHM ) )
+        {
+            if ( pImgSrc.empty() == true )
+            {
+                rep.status = SRCNN_REP_ELOAD;
+            }
+            else
+            if ( processImage( pImgSrc, pImgOut, mulf, false, &ws ) != 0 )
+            {
+                rep.status = SRCNN_REP_EPROCESS;
+            }
+        }
+
+        if ( ( rep.status == SRCNN_REP_OK ) && ( job->req.type != SRCNN_REQ_SHM ) )
+        {
+            if ( job->req.type == SRCNN_REQ_PATH )
+            {
+                if ( imwrite( dstpath.c_str(), pImgOut ) == false )
+                {
+                    rep.status = SRCNN_REP_ESAVE;
+                }
+            }
+            else
+            {
+                char fmt[ SRCNN_PROTO_FORMAT_LEN + 1 ] = {0};
+                memcpy( fmt, job->req.format, SRCNN_PROTO_FORMAT_LEN );
+
+                if ( fmt[0] != '.' )
+                {
+                    strcpy( fmt, ".png" );
+                }
+
+                if ( imencode( fmt, pImgOut, encoded ) == false )
+                {
+                    rep.status = SRCNN_REP_ESAVE;
+                }
+            }
+        }
+    }
+    catch( ... )
+    {
+        // OpenCV throws for unknown formats and broken streams.
+        if ( rep.status == SRCNN_REP_OK )
+        {
+            rep.status = pImgOut.empty() ? SRCNN_REP_ELOAD : SRCNN_REP_ESAVE;
+        }
+        encoded.clear();
+    }
+
+    if ( ( rep.status == SRCNN_REP_OK ) && ( job->req.type != SRCNN_REQ_SHM ) )
+    {
+        rep.width    = pImgOut.cols;
+        rep.height   = pImgOut.rows;
+        rep.channels = pImgOut.channels();
+    }
+
+    rep.payload_size = encoded.size();
+
+    vector<uchar>().swap( job->payload );
+
+    job->reply.resize( sizeof( rep ) + encoded.size() );
+    memcpy( job->reply.data(), &rep, sizeof( rep ) );
+
+    if ( encoded.size() > 0 )
+    {
+        memcpy( job->reply.data() + sizeof( rep ), encoded.data(), encoded.size() );
+    }
+
+    if ( _cfg.verbose == true )
+    {
+        printf( "- Request %u : type %u, scale %.2f, status %d, %u x %u\n",
+                job->connid, job->req.type, mulf, rep.status, rep.width, rep.height );
+        fflush( stdout );
+    }
+}
+
+int DaemonServer::processShared( DaemonJob* job, float mulf, bool isgray,
+                                 srcnn_rep_header& rep, ImageWorkspace& ws )
+{
+    if ( ( job->fdcount != 2 ) ||
+         ( job->payload.size() != sizeof( srcnn_shm_desc ) ) )
+    {
+        return SRCNN_REP_EREQUEST;
+    }
+
+    srcnn_shm_desc desc;
+    memcpy( &desc, job->payload.data(), sizeof( desc ) );
+
+    // client values, row sizes in 64bit and sizes kept inside Mat limits.
+    if ( ( ( desc.channels != 1 ) && ( desc.channels != 3 ) ) ||
+         ( desc.width == 0 ) || ( desc.height == 0 ) ||
+         ( desc.width > (uint32_t)INT_MAX / desc.channels ) ||
+         ( desc.height > (uint32_t)INT_MAX ) )
+    {
+        return SRCNN_REP_EREQUEST;
+    }
+
+    // Y only output of 3 channel buffers is not defined, never run as color.
+    if ( ( isgray == true ) && ( desc.channels != 1 ) )
+    {
+        return SRCNN_REP_EREQUEST;
+    }
+
+    float    exp_wf = (float)desc.width * mulf;
+    float    exp_hf = (float)desc.height * mulf;
+    unsigned exp_w  = exp_wf < (float)INT_MAX ? (unsigned)exp_wf : 0;
+    unsigned exp_h  = exp_hf < (float)INT_MAX ? (unsigned)exp_hf : 0;
+
+    if ( ( exp_w == 0 ) || ( exp_h == 0 ) ||
+         ( exp_w > (unsigned)INT_MAX / desc.channels ) ||
+         ( desc.dst_width != exp_w ) || ( desc.dst_height != exp_h ) ||
+         ( (uint64_t)desc.src_stride < (uint64_t)desc.width * desc.channels ) ||
+         ( (uint64_t)desc.dst_stride < (uint64_t)desc.dst_width * desc.channels ) )
+    {
+        return SRCNN_REP_EREQUEST;
+    }
+
+    if ( ( sealedShrink( job->fds[0] ) == false ) || ( sealedShrink( job->fds[1] ) == false ) )
+    {
+        return SRCNN_REP_EREQUEST;
+    }
+
+    void*  srcbase  = NULL;
+    void*  dstbase  = NULL;
+    size_t srcmapsz = 0;
+    size_t dstmapsz = 0;
+    uchar* srcmap   = mapShared( job->fds[0], desc.src_offset,
+                                 (uint64_t)desc.src_stride * desc.height,
+                                 false, srcbase, srcmapsz );
+    uchar* dstmap   = mapShared( job->fds[1], desc.dst_offset,
+                                 (uint64_t)desc.dst_stride * desc.dst_height,
+                                 true, dstbase, dstmapsz );
+
+    int reti = SRCNN_REP_OK;
+
+    if ( ( srcmap == NULL ) || ( dstmap == NULL ) )
+    {
+        reti = SRCNN_REP_ELOAD;
+    }
+    else
+    {
+        int mtype = ( desc.channels == 1 ) ? CV_8UC1 : CV_8UC3;
+
+        // Mat headers over client memory, output is written in place.
+        Mat pImgSrc( desc.height, desc.width, mtype, srcmap, desc.src_stride );
+        Mat pImgOut( desc.dst_height, desc.dst_width, mtype, dstmap, desc.dst_stride );
+        uchar* outptr = pImgOut.data;
+
+        if ( processImage( pImgSrc, pImgOut, mulf, false, &ws ) != 0 )
+        {
+            reti = SRCNN_REP_EPROCESS;
+        }
+        else
+        if ( pImgOut.data != outptr )
+        {
+            // engine could not use the header, copy result.
+            Mat pImgDst( desc.dst_height, desc.dst_width, mtype, dstmap, desc.dst_stride );
+            pImgOut.copyTo( pImgDst );
+        }
+
+        rep.width    = desc.dst_width;
+        rep.height   = desc.dst_height;
+        rep.channels = desc.channels;
+    }
+
+    if ( srcbase != NULL )
+        munmap( srcbase, srcmapsz );
+
+    if ( dstbase != NULL )
+        munmap( dstbase, dstmapsz );
+
+    return reti;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int runDaemon( const DaemonConfig& cfg )
+{
+    struct sigaction sa;
+    memset( &sa, 0, sizeof( sa ) );
+    sa.sa_handler = daemonSignal;
+    sigaction( SIGINT, &sa, NULL );
+    sigaction( SIGTERM, &sa, NULL );
+
+    // broken clients must not kill server.
+    signal( SIGPIPE, SIG_IGN );
+
+    DaemonConfig dcfg = cfg;
+
+    if ( dcfg.workers == 0 )
+        dcfg.workers = 1;
+
+    if ( dcfg.maxclients == 0 )
+        dcfg.maxclients = 256;
+
+    /* Warm up engine : page in weights and spin up thread pool once */
+    Mat pImgWarm( 32, 32, CV_8UC3 );
+    Mat pImgWarmOut;
+    pImgWarm.setTo( Scalar( 128, 128, 128 ) );
+    processImage( pImgWarm, pImgWarmOut, dcfg.scale, false );
+
+    DaemonServer server( dcfg );
+
+    return server.run();
+}
+
+#else /// of __linux__
+
+int runDaemon( const DaemonConfig& cfg )
+{
+    if ( cfg.verbose == true )
+    {
+        printf( "- Daemon mode requires Linux ( epoll ).\n" );
+    }
+
+    return -1;
+}
+
+#endif /// of __linux__
+
+#endif /// of EXPORTLIBSRCNN
@@ -0,0 +1,23 @@
+#ifndef __DAEMON_H__
+#define __DAEMON_H__
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// srcnn daemon : epoll driven Unix domain socket server, see srcnnproto.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+    const char* sockpath;
+    unsigned    workers;        /// processing threads.
+    unsigned    maxclients;     /// connections at once.
+    float       scale;          /// default scale when request has none.
+    bool        grayscale;      /// default Y only processing.
+    bool        verbose;
+}DaemonConfig;
+
+// Runs until SIGINT or SIGTERM, returns 0 or negative for failure.
+int runDaemon( const DaemonConfig& cfg );
+
+#endif /// of __DAEMON_H__
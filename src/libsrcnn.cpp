@@ -0,0 +1,1208 @@
+/*******************************************************************************
+ * libsrcnn : embeddable SRCNN engine without OpenCV.
+ * ----------------------------------------------------------------------------
+ * Colour conversion and bicubic resize are done here on raw 8bit planes,
+ * convolutional layers are in srcnnkernel.cpp.
+*******************************************************************************/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include <unistd.h>
+#ifdef __linux__
+    #include <sys/mman.h>
+#endif
+
+#include "libsrcnn.h"
+#include "srcnnkernel.h"
+#include "srcnngraph.h"
+#include "srcnnprof.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Keys cubic, same parameter to OpenCV INTER_CUBIC.
+#define CUBIC_A     -0.75f
+
+// Rows per executor chunk for light per pixel loops.
+#define ROW_GRAIN   16
+
+// Arena blocks are cache line aligned, huge page arena is 2MB aligned.
+#define ARENA_ALIGN         64
+#define HUGEPAGE_SIZE       ( 2 * 1024 * 1024 )
+
+// Rows over layers I, II and III, 4 + 2 of each side.
+#define SRCNN_HALO_ROWS     6
+
+typedef struct
+{
+    int         ofs[4];
+    float       w[4];
+}CubicTap;
+
+// Rows of a strip, absolute in source and output image.
+typedef struct
+{
+    unsigned    sy0;        /// first source row held.
+    unsigned    sy1;        /// not included.
+    unsigned    dy0;        /// first output row made.
+    unsigned    dy1;
+}StripRows;
+
+struct srcnn_context
+{
+    unsigned char*  arena;
+    size_t          arenasz;
+    size_t          arenaused;
+    void*           mapbase;        /// mmap()ed base for huge pages or NUMA.
+    size_t          mapsz;
+    int             hugepages;
+    int             numa;
+    float*          numaplanes;     /// planes placed by tile workers.
+    unsigned        numaw;
+    unsigned        numah;
+    const srcnn_executor*   exec;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+static inline unsigned char clampByte( float v )
+{
+    int iv = (int)lrintf( v );
+
+    if ( iv < 0 )
+        return 0;
+
+    if ( iv > 255 )
+        return 255;
+
+    return (unsigned char)iv;
+}
+
+static inline int clampIndex( int v, int n )
+{
+    if ( v < 0 )
+        return 0;
+
+    if ( v >= n )
+        return n - 1;
+
+    return v;
+}
+
+static inline int cubicOrigin( unsigned d, double ratio, double& fx )
+{
+    fx = ( (double)d + 0.5 ) * ratio - 0.5;
+
+    return (int)floor( fx );
+}
+
+// taps of output [ d0, d1 ) go to taps[ 0 .. d1 - d0 ).
+static void makeCubicTaps( CubicTap* taps, unsigned srcn, unsigned dstn,
+                           unsigned d0, unsigned d1 )
+{
+    double ratio = (double)srcn / (double)dstn;
+
+    for ( unsigned cnt = d0; cnt < d1; cnt++ )
+    {
+        double fx = 0.0;
+        int    sx = cubicOrigin( cnt, ratio, fx );
+        float  t  = (float)( fx - sx );
+
+        CubicTap& tap = taps[ cnt - d0 ];
+
+        tap.w[0] = ( ( CUBIC_A * ( t + 1 ) - 5 * CUBIC_A ) * ( t + 1 ) + 8 * CUBIC_A ) * ( t + 1 ) - 4 * CUBIC_A;
+        tap.w[1] = ( ( CUBIC_A + 2 ) * t - ( CUBIC_A + 3 ) ) * t * t + 1;
+        tap.w[2] = ( ( CUBIC_A + 2 ) * ( 1 - t ) - ( CUBIC_A + 3 ) ) * ( 1 - t ) * ( 1 - t ) + 1;
+        tap.w[3] = 1.f - tap.w[0] - tap.w[1] - tap.w[2];
+
+        for ( int k = 0; k < 4; k++ )
+        {
+            tap.ofs[k] = clampIndex( sx - 1 + k, (int)srcn );
+        }
+    }
+}
+
+// Source rows read by output rows [ d0, d1 ).
+static void cubicSourceRows( unsigned srcn, unsigned dstn, unsigned d0, unsigned d1,
+                             unsigned& s0, unsigned& s1 )
+{
+    double ratio = (double)srcn / (double)dstn;
+    double fx    = 0.0;
+
+    s0 = (unsigned)clampIndex( cubicOrigin( d0, ratio, fx ) - 1, (int)srcn );
+    s1 = (unsigned)clampIndex( cubicOrigin( d1 - 1, ratio, fx ) + 2, (int)srcn ) + 1;
+}
+
+// sh and dh are rows held and made, a strip or whole image.
+static size_t resizeWorkSize( unsigned sh, unsigned dw, unsigned dh )
+{
+    return (size_t)dw * sh * sizeof( float ) + (size_t)( dw + dh ) * sizeof( CubicTap );
+}
+
+// Arguments of row tasks given to executor.
+typedef struct
+{
+    const unsigned char*    src;
+    size_t                  srcstride;
+    unsigned                srcstep;
+    unsigned char*          dst;
+    size_t                  dststride;
+    unsigned                dststep;
+    unsigned                width;
+    float*                  tmp;
+    const CubicTap*         taps;
+    const unsigned char*    planes[3];  /// Y, Cr, Cb.
+    unsigned char*          oplanes[3];
+}RowArgs;
+
+/* horizontal pass, source rows to float */
+static void resizeRowsH( void* arg, size_t begin, size_t end )
+{
+    const RowArgs* ra = (const RowArgs*)arg;
+
+    for ( size_t row = begin; row < end; row++ )
+    {
+        const unsigned char* srow = ra->src + row * ra->srcstride;
+        float*               trow = ra->tmp + row * ra->width;
+        unsigned             step = ra->srcstep;
+
+        for ( unsigned col = 0; col < ra->width; col++ )
+        {
+            const CubicTap& tap = ra->taps[col];
+
+            trow[col] = tap.w[0] * srow[ tap.ofs[0] * step ] +
+                        tap.w[1] * srow[ tap.ofs[1] * step ] +
+                        tap.w[2] * srow[ tap.ofs[2] * step ] +
+                        tap.w[3] * srow[ tap.ofs[3] * step ];
+        }
+    }
+}
+
+/* vertical pass, float rows to output */
+static void resizeRowsV( void* arg, size_t begin, size_t end )
+{
+    const RowArgs* ra = (const RowArgs*)arg;
+    size_t         dw = ra->width;
+
+    for ( size_t row = begin; row < end; row++ )
+    {
+        const CubicTap& tap  = ra->taps[row];
+        const float*    r0   = ra->tmp + (size_t)tap.ofs[0] * dw;
+        const float*    r1   = ra->tmp + (size_t)tap.ofs[1] * dw;
+        const float*    r2   = ra->tmp + (size_t)tap.ofs[2] * dw;
+        const float*    r3   = ra->tmp + (size_t)tap.ofs[3] * dw;
+        unsigned char*  drow = ra->dst + row * ra->dststride;
+
+        for ( unsigned col = 0; col < dw; col++ )
+        {
+            float v = tap.w[0] * r0[col] + tap.w[1] * r1[col] +
+                      tap.w[2] * r2[col] + tap.w[3] * r3[col];
+
+            drow[ col * ra->dststep ] = clampByte( v );
+        }
+    }
+}
+
+/***
+ * FuncName : resizeBicubic
+ * Function : bicubic resize of one 8bit channel, border replicated
+ * Parameter    : src - source, srcstride bytes per row, srcstep bytes per pixel
+ *        sw, sh - size of whole source
+ *        dst - output, dststride bytes per row, dststep bytes per pixel
+ *        dw, dh - size of whole output
+ *        rows - src holds rows from sy0 and dst gets rows from dy0,
+ *               NULL for whole image
+ *        work - resizeWorkSize() bytes of working memory
+ *        exec - executor of rows
+ * Output   : <void>
+***/
+static void resizeBicubic( const unsigned char* src, size_t srcstride, unsigned srcstep,
+                           unsigned sw, unsigned sh,
+                           unsigned char* dst, size_t dststride, unsigned dststep,
+                           unsigned dw, unsigned dh, const StripRows* rows, void* work,
+                           const srcnn_executor* exec )
+{
+    ProfScope prof( "resize" );
+
+    StripRows sr = { 0, sh, 0, dh };
+
+    if ( rows != NULL )
+    {
+        sr = *rows;
+    }
+
+    unsigned  srows = sr.sy1 - sr.sy0;
+    unsigned  drows = sr.dy1 - sr.dy0;
+    float*    tmp   = (float*)work;
+    CubicTap* pxt   = (CubicTap*)( tmp + (size_t)dw * srows );
+    CubicTap* pyt   = pxt + dw;
+
+    makeCubicTaps( pxt, sw, dw, 0, dw );
+    makeCubicTaps( pyt, sh, dh, sr.dy0, sr.dy1 );
+
+    // vertical taps to rows held.
+    for ( unsigned cnt = 0; cnt < drows; cnt++ )
+    {
+        for ( int k = 0; k < 4; k++ )
+        {
+            pyt[cnt].ofs[k] = clampIndex( pyt[cnt].ofs[k] - (int)sr.sy0, (int)srows );
+        }
+    }
+
+    RowArgs ra;
+    memset( &ra, 0, sizeof( ra ) );
+
+    ra.src       = src;
+    ra.srcstride = srcstride;
+    ra.srcstep   = srcstep;
+    ra.dst       = dst;
+    ra.dststride = dststride;
+    ra.dststep   = dststep;
+    ra.width     = dw;
+    ra.tmp       = tmp;
+    ra.taps      = pxt;
+
+    exec->parallel_for( exec->user, srows, ROW_GRAIN, resizeRowsH, &ra );
+
+    ra.taps = pyt;
+
+    exec->parallel_for( exec->user, drows, ROW_GRAIN, resizeRowsV, &ra );
+}
+
+// RGB to Y, Cr, Cb planes, same coefficients to OpenCV.
+static void splitRows( void* arg, size_t begin, size_t end )
+{
+    const RowArgs* ra    = (const RowArgs*)arg;
+    unsigned       w     = ra->width;
+    unsigned       depth = ra->srcstep;
+
+    for ( size_t row = begin; row < end; row++ )
+    {
+        const unsigned char* srow = ra->src + row * ra->srcstride;
+        size_t               que  = row * w;
+
+        for ( unsigned col = 0; col < w; col++ )
+        {
+            float r = srow[ col * depth + 0 ];
+            float g = srow[ col * depth + 1 ];
+            float b = srow[ col * depth + 2 ];
+            float y = 0.299f * r + 0.587f * g + 0.114f * b;
+
+            ra->oplanes[0][ que + col ] = clampByte( y );
+            ra->oplanes[1][ que + col ] = clampByte( ( r - y ) * 0.713f + 128.f );
+            ra->oplanes[2][ que + col ] = clampByte( ( b - y ) * 0.564f + 128.f );
+        }
+    }
+}
+
+static void mergeRows( void* arg, size_t begin, size_t end )
+{
+    const RowArgs* ra    = (const RowArgs*)arg;
+    unsigned       w     = ra->width;
+    unsigned       depth = ra->dststep;
+
+    for ( size_t row = begin; row < end; row++ )
+    {
+        unsigned char* drow = ra->dst + row * ra->dststride;
+        size_t         que  = row * w;
+
+        for ( unsigned col = 0; col < w; col++ )
+        {
+            float y  = ra->planes[0][ que + col ];
+            float cr = (float)ra->planes[1][ que + col ] - 128.f;
+            float cb = (float)ra->planes[2][ que + col ] - 128.f;
+
+            drow[ col * depth + 0 ] = clampByte( y + 1.403f * cr );
+            drow[ col * depth + 1 ] = clampByte( y - 0.714f * cr - 0.344f * cb );
+            drow[ col * depth + 2 ] = clampByte( y + 1.773f * cb );
+        }
+    }
+}
+
+void SRCNNSplitYCrCb( const unsigned char* src, size_t srcstride, unsigned depth,
+                      unsigned w, unsigned h,
+                      unsigned char* py, unsigned char* pcr, unsigned char* pcb,
+                      const srcnn_executor* exec )
+{
+    ProfScope prof( "convert" );
+
+    RowArgs ra;
+    memset( &ra, 0, sizeof( ra ) );
+
+    ra.src        = src;
+    ra.srcstride  = srcstride;
+    ra.srcstep    = depth;
+    ra.width      = w;
+    ra.oplanes[0] = py;
+    ra.oplanes[1] = pcr;
+    ra.oplanes[2] = pcb;
+
+    exec->parallel_for( exec->user, h, ROW_GRAIN, splitRows, &ra );
+}
+
+void SRCNNMergeYCrCb( const unsigned char* py, const unsigned char* pcr, const unsigned char* pcb,
+                      unsigned w, unsigned h,
+                      unsigned char* dst, size_t dststride, unsigned depth,
+                      const srcnn_executor* exec )
+{
+    ProfScope prof( "merge" );
+
+    RowArgs ra;
+    memset( &ra, 0, sizeof( ra ) );
+
+    ra.dst       = dst;
+    ra.dststride = dststride;
+    ra.dststep   = depth;
+    ra.width     = w;
+    ra.planes[0] = py;
+    ra.planes[1] = pcr;
+    ra.planes[2] = pcb;
+
+    exec->parallel_for( exec->user, h, ROW_GRAIN, mergeRows, &ra );
+}
+
+size_t SRCNNResizeWorkSize( unsigned sh, unsigned dw, unsigned dh )
+{
+    return resizeWorkSize( sh, dw, dh );
+}
+
+void SRCNNResizeBicubic( const unsigned char* src, size_t srcstride, unsigned srcstep,
+                         unsigned sw, unsigned sh,
+                         unsigned char* dst, size_t dststride, unsigned dststep,
+                         unsigned dw, unsigned dh, void* work,
+                         const srcnn_executor* exec )
+{
+    resizeBicubic( src, srcstride, srcstep, sw, sh, dst, dststride, dststep,
+                   dw, dh, NULL, work, exec );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static size_t alignSize( size_t sz, size_t align )
+{
+    return ( sz + align - 1 ) / align * align;
+}
+
+static size_t lumaWorkSize( unsigned w, unsigned h )
+{
+    return alignSize( (size_t)w * h * sizeof( float ), ARENA_ALIGN ) * SRCNN_KERNEL_PLANES;
+}
+
+/***
+ * FuncName : buildProcess
+ * Function : graph of whole image process, source and output are external
+ * Parameter    : g - empty graph
+ *        src, dst - may be NULL to plan only
+ * Output   : <void>
+***/
+static void buildProcess( SRCNNGraph& g,
+                          const unsigned char* src, unsigned sw, unsigned sh,
+                          unsigned depth, size_t src_stride,
+                          unsigned char* dst, unsigned dw, unsigned dh, size_t dst_stride )
+{
+    const SRCNNModel* m = SRCNNBuiltinModel();
+
+    int ts = g.external( (void*)src, sw, sh, depth, src_stride );
+    int td = g.external( dst, dw, dh, depth, dst_stride );
+
+    if ( depth == 1 )
+    {
+        // gray is already Y channel, upscale it into output then in place.
+        g.resize( ts, td );
+        g.model( *m, td, td );
+
+        return;
+    }
+
+    int sy  = g.tensor( sw, sh, 1, SRCNN_TENSOR_U8 );
+    int scr = g.tensor( sw, sh, 1, SRCNN_TENSOR_U8 );
+    int scb = g.tensor( sw, sh, 1, SRCNN_TENSOR_U8 );
+    int dy  = g.tensor( dw, dh, 1, SRCNN_TENSOR_U8 );
+    int dcr = g.tensor( dw, dh, 1, SRCNN_TENSOR_U8 );
+    int dcb = g.tensor( dw, dh, 1, SRCNN_TENSOR_U8 );
+
+    g.split( ts, sy, scr, scb );
+    g.resize( sy,  dy );
+    g.resize( scr, dcr );
+    g.resize( scb, dcb );
+    g.model( *m, dy, dy );
+    g.merge( dy, dcr, dcb, td );
+
+    if ( depth == 4 )
+    {
+        // alpha goes straight from source to output channel.
+        g.resize( ts, td, 3, 3 );
+    }
+}
+
+static size_t workspaceSize( unsigned sw, unsigned sh, unsigned depth,
+                             unsigned dw, unsigned dh )
+{
+    SRCNNGraph g;
+
+    buildProcess( g, NULL, sw, sh, depth, 0, NULL, dw, dh, 0 );
+
+    if ( g.plan() == false )
+        return 0;
+
+    return g.arenaSize();
+}
+
+// Output rows [ oy0, oy1 ) read luma rows [ ly0, ly1 ) and source [ sy0, sy1 ).
+static void stripRows( unsigned height, unsigned oh, unsigned oy0, unsigned oy1,
+                       StripRows& lr )
+{
+    lr.dy0 = oy0 > SRCNN_HALO_ROWS ? oy0 - SRCNN_HALO_ROWS : 0;
+    lr.dy1 = oy1 + SRCNN_HALO_ROWS < oh ? oy1 + SRCNN_HALO_ROWS : oh;
+
+    cubicSourceRows( height, oh, lr.dy0, lr.dy1, lr.sy0, lr.sy1 );
+}
+
+static size_t stripWorkSize( unsigned sw, unsigned srows, unsigned depth,
+                             unsigned dw, unsigned lrows, unsigned orows )
+{
+    size_t wsz = alignSize( resizeWorkSize( srows, dw, lrows ), ARENA_ALIGN );
+
+    wsz += alignSize( (size_t)dw * lrows, ARENA_ALIGN );
+
+    if ( depth != 1 )
+    {
+        // Y, Cr, Cb of source rows, Cr and Cb of output rows.
+        wsz += alignSize( (size_t)sw * srows, ARENA_ALIGN ) * 3;
+        wsz += alignSize( (size_t)dw * orows, ARENA_ALIGN ) * 2;
+    }
+
+    return wsz + lumaWorkSize( dw, lrows );
+}
+
+static size_t pageSize()
+{
+    long pgsz = sysconf( _SC_PAGESIZE );
+
+    return pgsz > 0 ? (size_t)pgsz : 4096;
+}
+
+static void arenaFree( srcnn_context* ctx )
+{
+    if ( ctx->mapbase != NULL )
+    {
+#ifdef __linux__
+        munmap( ctx->mapbase, ctx->mapsz );
+#endif
+    }
+    else
+    if ( ctx->arena != NULL )
+    {
+        free( ctx->arena );
+    }
+
+    ctx->arena     = NULL;
+    ctx->arenasz   = 0;
+    ctx->arenaused = 0;
+    ctx->mapbase   = NULL;
+    ctx->mapsz     = 0;
+
+    ctx->numaplanes = NULL;
+}
+
+/***
+ * FuncName : arenaReserve
+ * Function : grows workspace arena of context to hold size bytes
+ * Parameter    : ctx - context
+ *        size - bytes needed
+ *        touch - fault in every page now
+ * Output   : bool, false for memory failure
+***/
+static bool arenaReserve( srcnn_context* ctx, size_t size, bool touch )
+{
+    ctx->arenaused = 0;
+
+    if ( size <= ctx->arenasz )
+        return true;
+
+    arenaFree( ctx );
+
+#ifdef __linux__
+    // NUMA pages are given back by madvise(), needs own mapping too.
+    if ( ( ctx->hugepages > 0 ) || ( ctx->numa > 0 ) )
+    {
+        // 2MB aligned inside a mapping, so khugepaged can back it all.
+        size_t unit  = ( ctx->hugepages > 0 ) ? HUGEPAGE_SIZE : pageSize();
+        size_t asz   = alignSize( size, unit );
+        size_t mapsz = asz + unit;
+        void*  base  = mmap( NULL, mapsz, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+        if ( base != MAP_FAILED )
+        {
+            uintptr_t aligned = alignSize( (uintptr_t)base, unit );
+
+#ifdef MADV_HUGEPAGE
+            if ( ctx->hugepages > 0 )
+            {
+                madvise( (void*)aligned, asz, MADV_HUGEPAGE );
+            }
+#endif
+
+            ctx->mapbase = base;
+            ctx->mapsz   = mapsz;
+            ctx->arena   = (unsigned char*)aligned;
+            ctx->arenasz = asz;
+        }
+    }
+#endif /// of __linux__
+
+    if ( ctx->arena == NULL )
+    {
+        void* ptr = NULL;
+
+        if ( posix_memalign( &ptr, ARENA_ALIGN, size ) != 0 )
+            return false;
+
+        ctx->arena   = (unsigned char*)ptr;
+        ctx->arenasz = size;
+    }
+
+    if ( touch == true )
+    {
+        size_t pgsz = pageSize();
+
+        for ( size_t que = 0; que < ctx->arenasz; que += pgsz )
+        {
+            ctx->arena[ que ] = 0;
+        }
+    }
+
+    return true;
+}
+
+static void* arenaTake( srcnn_context* ctx, size_t size )
+{
+    size_t asz = alignSize( size, ARENA_ALIGN );
+
+    if ( ctx->arenaused + asz > ctx->arenasz )
+        return NULL;
+
+    void* ptr = ctx->arena + ctx->arenaused;
+    ctx->arenaused += asz;
+
+    return ptr;
+}
+
+/***
+ * FuncName : placePlanes
+ * Function : moves layer planes to NUMA node of threads computing tiles
+ * Parameter    : ctx - context in NUMA mode
+ *        planes - planes taken from arena, contiguous
+ *        size - bytes of all planes
+ *        width, height - size of planes
+ * Output   : <void>
+***/
+static void placePlanes( srcnn_context* ctx, float* const* planes, size_t size,
+                         unsigned width, unsigned height )
+{
+    // pages stay where they were touched while tile layout is same.
+    if ( ( ctx->numaplanes == planes[0] ) &&
+         ( ctx->numaw == width ) && ( ctx->numah == height ) )
+        return;
+
+#ifdef __linux__
+    if ( ctx->mapbase != NULL )
+    {
+        // only pages inside planes, others hold live data.
+        size_t    unit = ( ctx->hugepages > 0 ) ? HUGEPAGE_SIZE : pageSize();
+        uintptr_t p0   = alignSize( (uintptr_t)planes[0], unit );
+        uintptr_t p1   = ( (uintptr_t)planes[0] + size ) / unit * unit;
+
+        if ( p1 > p0 )
+        {
+            madvise( (void*)p0, p1 - p0, MADV_DONTNEED );
+        }
+    }
+#endif /// of __linux__
+
+    SRCNNTouchPlanes( planes, width, width, height, ctx->exec );
+
+    ctx->numaplanes = planes[0];
+    ctx->numaw      = width;
+    ctx->numah      = height;
+}
+
+/***
+ * FuncName : processLuma
+ * Function : SRCNN layers on luma taken from arena planes
+ * Parameter    : src - upscaled luma, width x height
+ *        dst - output luma, may be same to src
+ *        p0, p1 - rows of layer II planes to be computed
+ *        o0, o1 - rows of output to be computed
+ * Output   : <void>
+***/
+static void processLuma( srcnn_context* ctx,
+                         const unsigned char* src, unsigned width, unsigned height,
+                         size_t src_stride, unsigned char* dst, size_t dst_stride,
+                         unsigned p0, unsigned p1, unsigned o0, unsigned o1 )
+{
+    size_t planestride = alignSize( (size_t)width * height * sizeof( float ), ARENA_ALIGN );
+    float* planes[ SRCNN_KERNEL_PLANES ];
+
+    for ( unsigned cnt = 0; cnt < SRCNN_KERNEL_PLANES; cnt++ )
+    {
+        planes[cnt] = (float*)arenaTake( ctx, planestride );
+    }
+
+    if ( ctx->numa > 0 )
+    {
+        placePlanes( ctx, planes, planestride * SRCNN_KERNEL_PLANES, width, height );
+    }
+
+    SRCNNRegion prgn = { 0, p0, width, p1 };
+    SRCNNRegion orgn = { 0, o0, width, o1 };
+
+    SRCNNLayer12( src, src_stride, width, height, planes, width, &prgn, ctx->exec );
+    SRCNNLayer3( planes, width, width, height, dst, dst_stride, &orgn, ctx->exec );
+}
+
+int SRCNNGraphRun( srcnn_context* ctx, SRCNNGraph& graph )
+{
+    if ( ctx == NULL )
+        return SRCNN_EPARAM;
+
+    if ( graph.plan() == false )
+        return SRCNN_EPARAM;
+
+    size_t asz = graph.arenaSize();
+
+    if ( arenaReserve( ctx, asz, false ) == false )
+        return SRCNN_EMEMORY;
+
+    graph.bindArena( arenaTake( ctx, asz ) );
+
+    if ( ctx->numa > 0 )
+    {
+        vector<SRCNNTensorView> views;
+        graph.layerPlanes( views );
+
+        for ( size_t cnt = 0; cnt < views.size(); cnt++ )
+        {
+            const SRCNNTensorView& tv = views[cnt];
+            float* planes[ SRCNN_KERNEL_PLANES ];
+
+            for ( unsigned q = 0; q < SRCNN_KERNEL_PLANES; q++ )
+            {
+                planes[q] = (float*)( (unsigned char*)tv.data + q * tv.planestride );
+            }
+
+            placePlanes( ctx, planes, tv.planestride * SRCNN_KERNEL_PLANES,
+                         tv.width, tv.height );
+        }
+    }
+
+    return graph.run( ctx->exec );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+srcnn_context* srcnn_context_create( void )
+{
+    srcnn_context* ctx = new (nothrow) srcnn_context;
+
+    if ( ctx != NULL )
+    {
+        memset( ctx, 0, sizeof( srcnn_context ) );
+        ctx->exec = srcnn_executor_default();
+    }
+
+    return ctx;
+}
+
+void srcnn_context_destroy( srcnn_context* ctx )
+{
+    if ( ctx != NULL )
+    {
+        arenaFree( ctx );
+        delete ctx;
+    }
+}
+
+int srcnn_context_set( srcnn_context* ctx, int param, int value )
+{
+    if ( ctx == NULL )
+        return SRCNN_EPARAM;
+
+    switch( param )
+    {
+        case SRCNN_CTX_HUGEPAGES:
+            if ( ctx->hugepages != value )
+            {
+                // next call reallocates arena in new backing.
+                arenaFree( ctx );
+                ctx->hugepages = value;
+            }
+            return SRCNN_OK;
+
+        case SRCNN_CTX_NUMA:
+            if ( ctx->numa != value )
+            {
+                arenaFree( ctx );
+                ctx->numa = value;
+            }
+            return SRCNN_OK;
+    }
+
+    return SRCNN_EPARAM;
+}
+
+int srcnn_context_reserve( srcnn_context* ctx, unsigned max_width, unsigned max_height,
+                           unsigned depth, float scale )
+{
+    if ( ( ctx == NULL ) || ( ( depth != 1 ) && ( depth != 3 ) && ( depth != 4 ) ) )
+        return SRCNN_EPARAM;
+
+    unsigned ow = 0;
+    unsigned oh = 0;
+
+    int reti = srcnn_output_size( max_width, max_height, scale, &ow, &oh );
+
+    if ( reti != SRCNN_OK )
+        return reti;
+
+    if ( arenaReserve( ctx, workspaceSize( max_width, max_height, depth, ow, oh ), true ) == false )
+        return SRCNN_EMEMORY;
+
+    return SRCNN_OK;
+}
+
+int srcnn_context_set_executor( srcnn_context* ctx, const srcnn_executor* exec )
+{
+    if ( ctx == NULL )
+        return SRCNN_EPARAM;
+
+    if ( exec == NULL )
+    {
+        exec = srcnn_executor_default();
+    }
+
+    if ( exec->parallel_for == NULL )
+        return SRCNN_EPARAM;
+
+    ctx->exec = exec;
+
+    return SRCNN_OK;
+}
+
+size_t srcnn_context_workspace( const srcnn_context* ctx )
+{
+    if ( ctx == NULL )
+        return 0;
+
+    return ctx->arenasz;
+}
+
+void srcnn_context_release( srcnn_context* ctx )
+{
+    if ( ctx != NULL )
+    {
+        arenaFree( ctx );
+    }
+}
+
+int srcnn_estimate( unsigned width, unsigned height, unsigned depth, float scale,
+                    srcnn_memory_plan* plan )
+{
+    if ( ( plan == NULL ) || ( ( depth != 1 ) && ( depth != 3 ) && ( depth != 4 ) ) )
+        return SRCNN_EPARAM;
+
+    unsigned ow = 0;
+    unsigned oh = 0;
+
+    int reti = srcnn_output_size( width, height, scale, &ow, &oh );
+
+    if ( reti != SRCNN_OK )
+        return reti;
+
+    plan->source    = (size_t)width * height * depth;
+    plan->output    = (size_t)ow * oh * depth;
+    plan->workspace = workspaceSize( width, height, depth, ow, oh );
+    plan->peak      = plan->source + plan->output + plan->workspace;
+
+    return SRCNN_OK;
+}
+
+int srcnn_output_size( unsigned width, unsigned height, float scale,
+                       unsigned* out_width, unsigned* out_height )
+{
+    if ( ( width == 0 ) || ( height == 0 ) || ( scale <= 0.f ) )
+        return SRCNN_EPARAM;
+
+    unsigned ow = (unsigned)( (float)width * scale );
+    unsigned oh = (unsigned)( (float)height * scale );
+
+    if ( ( ow == 0 ) || ( oh == 0 ) )
+        return SRCNN_ESCALE;
+
+    if ( out_width != NULL )
+        *out_width = ow;
+
+    if ( out_height != NULL )
+        *out_height = oh;
+
+    return SRCNN_OK;
+}
+
+int srcnn_process_luma_ctx( srcnn_context* ctx,
+                            const unsigned char* src, unsigned width, unsigned height,
+                            size_t src_stride, unsigned char* dst, size_t dst_stride )
+{
+    if ( ( ctx == NULL ) || ( src == NULL ) || ( dst == NULL ) ||
+         ( width == 0 ) || ( height == 0 ) )
+        return SRCNN_EPARAM;
+
+    if ( src_stride == 0 )
+        src_stride = width;
+
+    if ( dst_stride == 0 )
+        dst_stride = width;
+
+    if ( arenaReserve( ctx, lumaWorkSize( width, height ), false ) == false )
+        return SRCNN_EMEMORY;
+
+    processLuma( ctx, src, width, height, src_stride, dst, dst_stride,
+                 0, height, 0, height );
+
+    return SRCNN_OK;
+}
+
+int srcnn_process_ctx( srcnn_context* ctx,
+                       const unsigned char* src, unsigned width, unsigned height,
+                       unsigned depth, size_t src_stride, float scale,
+                       unsigned char* dst, size_t dst_stride )
+{
+    if ( ( ctx == NULL ) || ( src == NULL ) || ( dst == NULL ) )
+        return SRCNN_EPARAM;
+
+    if ( ( depth != 1 ) && ( depth != 3 ) && ( depth != 4 ) )
+        return SRCNN_EPARAM;
+
+    unsigned ow = 0;
+    unsigned oh = 0;
+
+    int reti = srcnn_output_size( width, height, scale, &ow, &oh );
+
+    if ( reti != SRCNN_OK )
+        return reti;
+
+    if ( src_stride == 0 )
+        src_stride = (size_t)width * depth;
+
+    if ( dst_stride == 0 )
+        dst_stride = (size_t)ow * depth;
+
+    SRCNNGraph g;
+
+    buildProcess( g, src, width, height, depth, src_stride, dst, ow, oh, dst_stride );
+
+    return SRCNNGraphRun( ctx, g );
+}
+
+int srcnn_strip_source( unsigned height, float scale,
+                        unsigned out_y0, unsigned out_y1,
+                        unsigned* src_y0, unsigned* src_y1 )
+{
+    if ( ( height == 0 ) || ( scale <= 0.f ) || ( src_y0 == NULL ) || ( src_y1 == NULL ) )
+        return SRCNN_EPARAM;
+
+    // same rounding to srcnn_output_size().
+    unsigned oh = (unsigned)( (float)height * scale );
+
+    if ( oh == 0 )
+        return SRCNN_ESCALE;
+
+    if ( ( out_y0 >= out_y1 ) || ( out_y1 > oh ) )
+        return SRCNN_EPARAM;
+
+    StripRows lr;
+    stripRows( height, oh, out_y0, out_y1, lr );
+
+    *src_y0 = lr.sy0;
+    *src_y1 = lr.sy1;
+
+    return SRCNN_OK;
+}
+
+size_t srcnn_strip_workspace( unsigned width, unsigned height, unsigned depth,
+                              float scale, unsigned out_rows )
+{
+    unsigned ow = 0;
+    unsigned oh = 0;
+
+    if ( srcnn_output_size( width, height, scale, &ow, &oh ) != SRCNN_OK )
+        return 0;
+
+    unsigned lrows = out_rows + SRCNN_HALO_ROWS * 2;
+
+    if ( out_rows > oh )
+        out_rows = oh;
+
+    if ( lrows > oh )
+        lrows = oh;
+
+    // cubic taps span ratio per row and 4 more.
+    double   span  = ceil( (double)( lrows - 1 ) * (double)height / (double)oh );
+    unsigned srows = (unsigned)span + 5;
+
+    if ( srows > height )
+        srows = height;
+
+    return stripWorkSize( width, srows, depth, ow, lrows, out_rows );
+}
+
+// Most source rows of a strip of rows, source buffer holds them at once.
+static unsigned stripWindowRows( unsigned height, float scale, unsigned oh, unsigned rows )
+{
+    unsigned maxrows = 0;
+
+    for ( unsigned y0 = 0; y0 < oh; y0 += rows )
+    {
+        unsigned y1 = y0 + rows < oh ? y0 + rows : oh;
+        unsigned s0 = 0;
+        unsigned s1 = 0;
+
+        srcnn_strip_source( height, scale, y0, y1, &s0, &s1 );
+
+        if ( s1 - s0 > maxrows )
+            maxrows = s1 - s0;
+    }
+
+    return maxrows;
+}
+
+static void stripPlan( unsigned width, unsigned height, unsigned depth, float scale,
+                       unsigned ow, unsigned oh, unsigned rows, srcnn_memory_plan& plan )
+{
+    plan.workspace = srcnn_strip_workspace( width, height, depth, scale, rows );
+    plan.source    = (size_t)stripWindowRows( height, scale, oh, rows ) * width * depth;
+    plan.output    = (size_t)rows * ow * depth;
+    plan.peak      = plan.workspace + plan.source + plan.output;
+}
+
+unsigned srcnn_strip_rows( unsigned width, unsigned height, unsigned depth,
+                           float scale, size_t budget, srcnn_memory_plan* plan )
+{
+    unsigned ow = 0;
+    unsigned oh = 0;
+
+    if ( ( ( depth != 1 ) && ( depth != 3 ) && ( depth != 4 ) ) ||
+         ( srcnn_output_size( width, height, scale, &ow, &oh ) != SRCNN_OK ) )
+        return 0;
+
+    srcnn_memory_plan mp;
+    stripPlan( width, height, depth, scale, ow, oh, 1, mp );
+
+    if ( mp.peak > budget )
+    {
+        if ( plan != NULL )
+            *plan = mp;
+
+        return 0;
+    }
+
+    // memory grows with rows, tallest fitting one by bisection.
+    unsigned lo = 1;
+    unsigned hi = oh;
+
+    while( lo < hi )
+    {
+        unsigned mid = lo + ( hi - lo + 1 ) / 2;
+
+        stripPlan( width, height, depth, scale, ow, oh, mid, mp );
+
+        if ( mp.peak <= budget )
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    if ( plan != NULL )
+    {
+        stripPlan( width, height, depth, scale, ow, oh, lo, *plan );
+    }
+
+    return lo;
+}
+
+int srcnn_process_strip( srcnn_context* ctx,
+                         const unsigned char* src, unsigned width, unsigned height,
+                         unsigned depth, size_t src_stride,
+                         unsigned src_y0, unsigned src_y1, float scale,
+                         unsigned out_y0, unsigned out_y1,
+                         unsigned char* dst, size_t dst_stride )
+{
+    if ( ( ctx == NULL ) || ( src == NULL ) || ( dst == NULL ) )
+        return SRCNN_EPARAM;
+
+    if ( ( depth != 1 ) && ( depth != 3 ) && ( depth != 4 ) )
+        return SRCNN_EPARAM;
+
+    unsigned ow = 0;
+    unsigned oh = 0;
+
+    int reti = srcnn_output_size( width, height, scale, &ow, &oh );
+
+    if ( reti != SRCNN_OK )
+        return reti;
+
+    if ( ( out_y0 >= out_y1 ) || ( out_y1 > oh ) )
+        return SRCNN_EPARAM;
+
+    StripRows lr;
+    stripRows( height, oh, out_y0, out_y1, lr );
+
+    if ( ( src_y0 > lr.sy0 ) || ( src_y1 < lr.sy1 ) )
+        return SRCNN_EPARAM;
+
+    if ( src_stride == 0 )
+        src_stride = (size_t)width * depth;
+
+    if ( dst_stride == 0 )
+        dst_stride = (size_t)ow * depth;
+
+    // rows out of need are left.
+    src += (size_t)( lr.sy0 - src_y0 ) * src_stride;
+
+    unsigned  srows = lr.sy1 - lr.sy0;
+    unsigned  lrows = lr.dy1 - lr.dy0;
+    unsigned  orows = out_y1 - out_y0;
+    StripRows cr    = { lr.sy0, lr.sy1, out_y0, out_y1 };
+
+    // planes of layer II around output rows, rows of luma buffer.
+    unsigned p0 = ( out_y0 > 2 ? out_y0 - 2 : 0 ) - lr.dy0;
+    unsigned p1 = ( out_y1 + 2 < oh ? out_y1 + 2 : oh ) - lr.dy0;
+    unsigned o0 = out_y0 - lr.dy0;
+    unsigned o1 = out_y1 - lr.dy0;
+
+    if ( arenaReserve( ctx, stripWorkSize( width, srows, depth, ow, lrows, orows ), false ) == false )
+        return SRCNN_EMEMORY;
+
+    void*          work = arenaTake( ctx, resizeWorkSize( srows, ow, lrows ) );
+    unsigned char* luma = (unsigned char*)arenaTake( ctx, (size_t)ow * lrows );
+
+    if ( depth == 1 )
+    {
+        resizeBicubic( src, src_stride, 1, width, height,
+                       luma, ow, 1, ow, oh, &lr, work, ctx->exec );
+
+        processLuma( ctx, luma, ow, lrows, ow, luma, ow, p0, p1, o0, o1 );
+
+        for ( unsigned row = 0; row < orows; row++ )
+        {
+            memcpy( dst + row * dst_stride, luma + (size_t)( o0 + row ) * ow, ow );
+        }
+
+        return SRCNN_OK;
+    }
+
+    size_t         srcsz = (size_t)width * srows;
+    size_t         dstsz = (size_t)ow * orows;
+    unsigned char* sy    = (unsigned char*)arenaTake( ctx, srcsz );
+    unsigned char* scr   = (unsigned char*)arenaTake( ctx, srcsz );
+    unsigned char* scb   = (unsigned char*)arenaTake( ctx, srcsz );
+    unsigned char* dcr   = (unsigned char*)arenaTake( ctx, dstsz );
+    unsigned char* dcb   = (unsigned char*)arenaTake( ctx, dstsz );
+
+    SRCNNSplitYCrCb( src, src_stride, depth, width, srows, sy, scr, scb, ctx->exec );
+
+    resizeBicubic( sy,  width, 1, width, height, luma, ow, 1, ow, oh, &lr, work, ctx->exec );
+    resizeBicubic( scr, width, 1, width, height, dcr,  ow, 1, ow, oh, &cr, work, ctx->exec );
+    resizeBicubic( scb, width, 1, width, height, dcb,  ow, 1, ow, oh, &cr, work, ctx->exec );
+
+    processLuma( ctx, luma, ow, lrows, ow, luma, ow, p0, p1, o0, o1 );
+
+    SRCNNMergeYCrCb( luma + (size_t)o0 * ow, dcr, dcb, ow, orows, dst, dst_stride, depth, ctx->exec );
+
+    if ( depth == 4 )
+    {
+        resizeBicubic( src + 3, src_stride, 4, width, height,
+                       dst + 3, dst_stride, 4, ow, oh, &cr, work, ctx->exec );
+    }
+
+    return SRCNN_OK;
+}
+
+int srcnn_process_luma( const unsigned char* src, unsigned width, unsigned height,
+                        size_t src_stride, unsigned char* dst, size_t dst_stride )
+{
+    srcnn_context* ctx = srcnn_context_create();
+
+    if ( ctx == NULL )
+        return SRCNN_EMEMORY;
+
+    int reti = srcnn_process_luma_ctx( ctx, src, width, height, src_stride,
+                                       dst, dst_stride );
+
+    srcnn_context_destroy( ctx );
+
+    return reti;
+}
+
+int srcnn_process( const unsigned char* src, unsigned width, unsigned height,
+                   unsigned depth, size_t src_stride, float scale,
+                   unsigned char* dst, size_t dst_stride )
+{
+    srcnn_context* ctx = srcnn_context_create();
+
+    if ( ctx == NULL )
+        return SRCNN_EMEMORY;
+
+    int reti = srcnn_process_ctx( ctx, src, width, height, depth, src_stride,
+                                  scale, dst, dst_stride );
+
+    srcnn_context_destroy( ctx );
+
+    return reti;
+}
+
+int ProcessSRCNN( const unsigned char* refbuff,
+                  unsigned width, unsigned height, unsigned depth,
+                  float multiply,
+                  unsigned char* &outbuff,
+                  unsigned &outbuffsz )
+{
+    unsigned ow = 0;
+    unsigned oh = 0;
+
+    outbuffsz = 0;
+
+    int reti = srcnn_output_size( width, height, multiply, &ow, &oh );
+
+    if ( reti != SRCNN_OK )
+        return reti;
+
+    size_t outsz = (size_t)ow * oh * depth;
+
+    outbuff = new (nothrow) unsigned char[ outsz ];
+
+    if ( outbuff == NULL )
+        return SRCNN_EMEMORY;
+
+    reti = srcnn_process( refbuff, width, height, depth, 0, multiply, outbuff, 0 );
+
+    if ( reti != SRCNN_OK )
+    {
+        delete[] outbuff;
+        outbuff = NULL;
+
+        return reti;
+    }
+
+    outbuffsz = (unsigned)outsz;
+
+    return SRCNN_OK;
+}
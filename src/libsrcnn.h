@@ -0,0 +1,179 @@
+#ifndef __LIBSRCNN_H__
+#define __LIBSRCNN_H__
+
+/*******************************************************************************
+ * libsrcnn : embeddable SRCNN engine, no OpenCV dependency.
+ * ----------------------------------------------------------------------------
+ * Buffers are 8bit interleaved, depth 1 ( gray ), 3 ( RGB ) or 4 ( RGBA ),
+ * rows may be padded by stride in bytes ( 0 for width * depth ).
+ * Output buffer is owned by caller, its size comes from srcnn_output_size().
+ * Functions return SRCNN_OK ( 0 ) or negative SRCNN_E... codes.
+*******************************************************************************/
+
+#include <stddef.h>
+
+#define LIBSRCNN_VERSION            "0.2.0.0"
+
+#define SRCNN_OK                    0
+#define SRCNN_EPARAM                -1      /* NULL buffer, bad depth or size */
+#define SRCNN_ESCALE                -2      /* scale makes empty image */
+#define SRCNN_EMEMORY               -3      /* working memory allocation */
+
+/* srcnn_context_set() parameters */
+#define SRCNN_CTX_HUGEPAGES         1       /* 1 : workspace on transparent huge pages */
+#define SRCNN_CTX_NUMA              2       /* 1 : layer planes first touched by tile workers */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Executor runs every parallel loop of engine. parallel_for() calls
+   fn( arg, begin, end ) over [ 0, range ) in chunks of about grain, from
+   any threads, and returns when all are done. Host applications may
+   give their own thread pool, so engine never makes threads of its own. */
+typedef void (*srcnn_task_fn)( void* arg, size_t begin, size_t end );
+
+typedef struct
+{
+    void      (*parallel_for)( void* user, size_t range, size_t grain,
+                               srcnn_task_fn fn, void* arg );
+    void*       user;
+}srcnn_executor;
+
+/* Built-in executors, OpenMP one is default when built with OpenMP,
+   otherwise serial. Built-in pool uses pthreads, 0 for all cores. */
+const srcnn_executor* srcnn_executor_openmp( void );
+const srcnn_executor* srcnn_executor_serial( void );
+const srcnn_executor* srcnn_executor_default( void );
+srcnn_executor* srcnn_executor_pool_create( unsigned threads );
+void   srcnn_executor_pool_destroy( srcnn_executor* exec );
+
+/* Work-stealing scheduler, each worker has a deque of chunks and steals
+   from others when empty. Loops from many threads ( images of a batch )
+   share workers at once, callers run queued chunks while waiting.
+   threads counts callers too, 0 for all cores. Destroyed by
+   srcnn_executor_pool_destroy(). */
+srcnn_executor* srcnn_executor_steal_create( unsigned threads );
+
+/* Same to above, n'th worker is pinned to cpus[ n % cpu_count ] ( Linux ).
+   Caller threads are not pinned, 0 threads for cpu_count. */
+srcnn_executor* srcnn_executor_steal_create_pinned( unsigned threads,
+                                                    const int* cpus, unsigned cpu_count );
+
+/* NUMA nodes from sysfs, workers are pinned node by node and steal from
+   same node first. Same to srcnn_executor_steal_create() on one node. */
+srcnn_executor* srcnn_executor_steal_create_numa( unsigned threads );
+
+typedef struct
+{
+    unsigned long long  tasks;      /* chunks run */
+    unsigned long long  steals;     /* chunks taken from other deques */
+    unsigned long long  busy_ns;    /* time inside chunks */
+    unsigned long long  wall_ns;    /* time since create or reset */
+    int                 node;       /* NUMA node of worker, -1 for none */
+}srcnn_worker_stats;
+
+/* Utilization of workers, last entry sums caller threads.
+   Returns count of entries ( workers + 1 ) or SRCNN_EPARAM. */
+int    srcnn_executor_steal_stats( const srcnn_executor* exec,
+                                   srcnn_worker_stats* stats, unsigned max_count );
+void   srcnn_executor_steal_reset( const srcnn_executor* exec );
+
+/* Context owns a workspace arena reused by every call, sized for largest
+   image processed so far or reserved for a maximum size. One context
+   should be used by one thread at a time. */
+typedef struct srcnn_context srcnn_context;
+
+srcnn_context* srcnn_context_create( void );
+void   srcnn_context_destroy( srcnn_context* ctx );
+int    srcnn_context_set( srcnn_context* ctx, int param, int value );
+
+/* Executor for calls of this context, NULL for default.
+   Executor must be alive while context uses it. */
+int    srcnn_context_set_executor( srcnn_context* ctx, const srcnn_executor* exec );
+
+/* Allocates and touches workspace for images up to max size in scale,
+   then calls not over it never allocate. */
+int    srcnn_context_reserve( srcnn_context* ctx, unsigned max_width, unsigned max_height,
+                              unsigned depth, float scale );
+
+/* Workspace bytes currently held, and freeing it. */
+size_t srcnn_context_workspace( const srcnn_context* ctx );
+void   srcnn_context_release( srcnn_context* ctx );
+
+/* Memory plan, computed before anything is allocated. Source and output
+   are buffers of caller, workspace is context arena of the call. */
+typedef struct
+{
+    size_t  source;
+    size_t  output;
+    size_t  workspace;
+    size_t  peak;           /* all above at once */
+}srcnn_memory_plan;
+
+/* Plan of srcnn_process_ctx() on whole image, unpadded rows. */
+int    srcnn_estimate( unsigned width, unsigned height, unsigned depth, float scale,
+                       srcnn_memory_plan* plan );
+
+/* Output size, ( unsigned )( (float)width * scale ) and same for height. */
+int srcnn_output_size( unsigned width, unsigned height, float scale,
+                       unsigned* out_width, unsigned* out_height );
+
+/* Bicubic resize then SRCNN on luma, chroma and alpha stay bicubic. */
+int srcnn_process( const unsigned char* src, unsigned width, unsigned height,
+                   unsigned depth, size_t src_stride, float scale,
+                   unsigned char* dst, size_t dst_stride );
+
+/* SRCNN layers only, src is already upscaled luma, dst is same size.
+   dst may be same to src. */
+int srcnn_process_luma( const unsigned char* src, unsigned width, unsigned height,
+                        size_t src_stride, unsigned char* dst, size_t dst_stride );
+
+/* Same to above, using workspace of context. */
+int srcnn_process_ctx( srcnn_context* ctx,
+                       const unsigned char* src, unsigned width, unsigned height,
+                       unsigned depth, size_t src_stride, float scale,
+                       unsigned char* dst, size_t dst_stride );
+
+int srcnn_process_luma_ctx( srcnn_context* ctx,
+                            const unsigned char* src, unsigned width, unsigned height,
+                            size_t src_stride, unsigned char* dst, size_t dst_stride );
+
+/* Strips : output rows [ out_y0, out_y1 ) of a whole image, for images
+   not fitting in memory. Source rows needed with halo come from
+   srcnn_strip_source(), src holds rows [ src_y0, src_y1 ) covering them
+   and dst gets out_y1 - out_y0 rows. Result is same to those rows of
+   srcnn_process(). */
+int srcnn_strip_source( unsigned height, float scale,
+                        unsigned out_y0, unsigned out_y1,
+                        unsigned* src_y0, unsigned* src_y1 );
+
+/* Workspace bytes of a context for strips of out_rows. */
+size_t srcnn_strip_workspace( unsigned width, unsigned height, unsigned depth,
+                              float scale, unsigned out_rows );
+
+/* Tallest strip of output rows whose workspace, source rows ( with halo )
+   and output rows fit in budget bytes, 0 when a row does not. plan gets
+   memory of strips of returned rows, or of one row for 0, may be NULL. */
+unsigned srcnn_strip_rows( unsigned width, unsigned height, unsigned depth,
+                           float scale, size_t budget, srcnn_memory_plan* plan );
+
+int srcnn_process_strip( srcnn_context* ctx,
+                         const unsigned char* src, unsigned width, unsigned height,
+                         unsigned depth, size_t src_stride,
+                         unsigned src_y0, unsigned src_y1, float scale,
+                         unsigned out_y0, unsigned out_y1,
+                         unsigned char* dst, size_t dst_stride );
+
+#ifdef __cplusplus
+}
+
+/* Allocates outbuff with new[] ( release by delete[] ), outbuffsz in bytes. */
+int ProcessSRCNN( const unsigned char* refbuff,
+                  unsigned width, unsigned height, unsigned depth,
+                  float multiply,
+                  unsigned char* &outbuff,
+                  unsigned &outbuffsz );
+#endif
+
+#endif /* of __LIBSRCNN_H__ */
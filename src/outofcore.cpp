@@ -0,0 +1,300 @@
+/*******************************************************************************
+ * SRCNN out-of-core mode
+ * ----------------------------------------------------------------------------
+ * Source rows are streamed through a sliding window, only rows needed for
+ * a strip of output ( with halo of bicubic and convolution ) stay in
+ * memory. Strip height is chosen to fit working memory in a budget, and
+ * each finished strip goes to output file at once.
+*******************************************************************************/
+#ifndef EXPORTLIBSRCNN
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "outofcore.h"
+#include "tick.h"
+#include "srcnnprof.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+    unsigned    width;
+    unsigned    height;
+    unsigned    depth;      /// depth of processing, may be less than source.
+    unsigned    outwidth;
+    unsigned    outheight;
+    float       scale;
+}StripPlan;
+
+// Color row to Y, same coefficients to libsrcnn.
+static void rowToGray( const unsigned char* src, unsigned width, unsigned depth,
+                       unsigned char* dst )
+{
+    for ( unsigned cnt = 0; cnt < width; cnt++ )
+    {
+        const unsigned char* p = src + cnt * depth;
+
+        float y = 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2];
+
+        dst[cnt] = (unsigned char)( y + 0.5f );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int runOutOfCore( const OutOfCoreConfig& cfg )
+{
+    StripReader* reader = OpenStripReader( cfg.srcpath, cfg.rawinfo );
+
+    if ( reader == NULL )
+    {
+        if ( cfg.verbose == true )
+        {
+            printf( "- load failure : %s\n", cfg.srcpath );
+        }
+
+        return -1;
+    }
+
+    StripImageInfo srcinfo = reader->info();
+    StripPlan      sp;
+
+    sp.width  = srcinfo.width;
+    sp.height = srcinfo.height;
+    sp.depth  = cfg.grayscale == true ? 1 : srcinfo.depth;
+    sp.scale  = cfg.scale;
+
+    if ( srcnn_output_size( sp.width, sp.height, sp.scale,
+                            &sp.outwidth, &sp.outheight ) != SRCNN_OK )
+    {
+        if ( cfg.verbose == true )
+        {
+            printf( "- Image scale error : ratio too small.\n" );
+        }
+
+        delete reader;
+        return -1;
+    }
+
+    size_t budget = cfg.maxmemory;
+
+    if ( budget == 0 )
+        budget = (size_t)OUTOFCORE_DEFAULT_MEMORY * 1024 * 1024;
+
+    srcnn_memory_plan mp;
+
+    unsigned rows = srcnn_strip_rows( sp.width, sp.height, sp.depth, sp.scale, budget, &mp );
+
+    if ( rows == 0 )
+    {
+        if ( cfg.verbose == true )
+        {
+            printf( "- Memory budget too small : %zu MB needed at least.\n",
+                    ( mp.peak >> 20 ) + 1 );
+        }
+
+        delete reader;
+        return -1;
+    }
+
+    size_t   srowsz  = (size_t)sp.width * sp.depth;
+    size_t   orowsz  = (size_t)sp.outwidth * sp.depth;
+    unsigned winrows = (unsigned)( mp.source / srowsz );
+    unsigned strips  = ( sp.outheight + rows - 1 ) / rows;
+
+    if ( cfg.verbose == true )
+    {
+        printf( "- Image load : %s ( %u x %u, %u channel%s )\n",
+                cfg.srcpath, sp.width, sp.height, srcinfo.depth,
+                srcinfo.depth > 1 ? "s" : "" );
+        printf( "- Out-of-core : %u strips of %u rows, %u source rows in window, %zu MB\n",
+                strips, rows, winrows, ( mp.peak >> 20 ) + 1 );
+        fflush( stdout );
+    }
+
+    StripImageInfo dstinfo = { sp.outwidth, sp.outheight, sp.depth };
+    StripWriter*   writer  = OpenStripWriter( cfg.dstpath, dstinfo, cfg.writeopts );
+
+    if ( writer == NULL )
+    {
+        if ( cfg.verbose == true )
+        {
+            printf( "- Write failure : %s\n", cfg.dstpath );
+        }
+
+        delete reader;
+        return -1;
+    }
+
+    srcnn_context* ctx = srcnn_context_create();
+
+    if ( ctx == NULL )
+    {
+        delete writer;
+        delete reader;
+        return -1;
+    }
+
+    srcnn_context_set_executor( ctx, cfg.exec );
+
+    vector<unsigned char> window( (size_t)winrows * srowsz );
+    vector<unsigned char> outbuf( (size_t)rows * orowsz );
+    vector<unsigned char> rowbuf;
+
+    if ( sp.depth != srcinfo.depth )
+        rowbuf.resize( (size_t)sp.width * srcinfo.depth );
+
+    unsigned wy0  = 0;   /// source rows in window, [ wy0, wy1 ).
+    unsigned wy1  = 0;
+    unsigned nextrow = 0;   /// next row of reader.
+    int      reti = 0;
+    unsigned lastpercent = 101;
+
+    unsigned perf_tick0 = tick::getTickCount();
+
+    for ( unsigned strip = 0; ( strip < strips ) && ( reti == 0 ); strip++ )
+    {
+        unsigned y0 = strip * rows;
+        unsigned y1 = y0 + rows < sp.outheight ? y0 + rows : sp.outheight;
+        unsigned s0 = 0;
+        unsigned s1 = 0;
+
+        srcnn_strip_source( sp.height, sp.scale, y0, y1, &s0, &s1 );
+
+        // drops rows above strip, source rows only go down.
+        if ( s0 > wy0 )
+        {
+            unsigned keep = wy1 > s0 ? wy1 - s0 : 0;
+
+            if ( keep > 0 )
+            {
+                memmove( window.data(), &window[ (size_t)( s0 - wy0 ) * srowsz ], keep * srowsz );
+            }
+
+            wy0 = s0;
+            wy1 = s0 + keep;
+        }
+
+        ProfScope prof_decode( "decode", PROF_CAT_STAGE, strip );
+
+        // rows skipped by downscale are read to window and dropped.
+        while( nextrow < s1 )
+        {
+            unsigned       slot = nextrow > wy0 ? nextrow - wy0 : 0;
+            unsigned char* row  = &window[ (size_t)slot * srowsz ];
+            bool           retb;
+
+            if ( rowbuf.size() > 0 )
+            {
+                retb = reader->readRow( rowbuf.data() );
+
+                if ( retb == true )
+                    rowToGray( rowbuf.data(), sp.width, srcinfo.depth, row );
+            }
+            else
+            {
+                retb = reader->readRow( row );
+            }
+
+            if ( retb == false )
+            {
+                if ( cfg.verbose == true )
+                {
+                    printf( "\n- Read failure : %s, row %u\n", cfg.srcpath, nextrow );
+                }
+
+                reti = -1;
+                break;
+            }
+
+            nextrow++;
+        }
+
+        wy1 = s1;
+
+        prof_decode.end();
+
+        if ( reti != 0 )
+            break;
+
+        ProfScope prof_strip( "strip", PROF_CAT_STAGE, strip );
+
+        int preti = srcnn_process_strip( ctx, window.data(), sp.width, sp.height,
+                                         sp.depth, srowsz, wy0, wy1, sp.scale,
+                                         y0, y1, outbuf.data(), orowsz );
+
+        if ( preti != SRCNN_OK )
+        {
+            if ( cfg.verbose == true )
+            {
+                printf( "\n- Processing failure : strip %u, error %d\n", strip, preti );
+            }
+
+            reti = preti;
+            break;
+        }
+
+        prof_strip.end();
+
+        ProfScope prof_encode( "encode", PROF_CAT_STAGE, strip );
+
+        if ( writer->writeRows( outbuf.data(), y1 - y0, orowsz ) == false )
+        {
+            if ( cfg.verbose == true )
+            {
+                printf( "\n- Write failure : %s, row %u\n", cfg.dstpath, y0 );
+            }
+
+            reti = -1;
+            break;
+        }
+
+        prof_encode.end();
+
+        ProfAddPixels( (uint64_t)( y1 - y0 ) * sp.outwidth );
+
+        unsigned percent = (unsigned)( ( (unsigned long long)y1 * 100 ) / sp.outheight );
+
+        if ( ( cfg.verbose == true ) && ( percent != lastpercent ) )
+        {
+            printf( "\r- Processing strips : %u / %u ( %u%% )", strip + 1, strips, percent );
+            fflush( stdout );
+            lastpercent = percent;
+        }
+    }
+
+    unsigned perf_tick1 = tick::getTickCount();
+
+    if ( ( writer->close() == false ) && ( reti == 0 ) )
+    {
+        if ( cfg.verbose == true )
+        {
+            printf( "\n- Write failure : %s\n", cfg.dstpath );
+        }
+
+        reti = -1;
+    }
+
+    if ( ( cfg.verbose == true ) && ( reti == 0 ) )
+    {
+        printf( "\n- Writing result to %s : Ok.\n", cfg.dstpath );
+        printf( "- Performace : %u ms took.\n", perf_tick1 - perf_tick0 );
+        fflush( stdout );
+    }
+
+    srcnn_context_destroy( ctx );
+
+    delete writer;
+    delete reader;
+
+    return reti;
+}
+
+#endif /// of EXPORTLIBSRCNN
@@ -0,0 +1,34 @@
+#ifndef __OUTOFCORE_H__
+#define __OUTOFCORE_H__
+
+#include <cstddef>
+#include "libsrcnn.h"
+#include "stripio.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Out-of-core processing : source is read and output is written by strips
+// of rows, so images larger than memory are processed under a budget.
+// See stripio.h for file formats.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define OUTOFCORE_DEFAULT_MEMORY    1024    /// budget in MB when not given.
+
+typedef struct
+{
+    const char*                 srcpath;
+    const char*                 dstpath;
+    const StripImageInfo*       rawinfo;    /// geometry of raw source, or NULL.
+    float                       scale;
+    bool                        grayscale;  /// color sources go Y only.
+    size_t                      maxmemory;  /// budget in bytes, 0 for default.
+    const srcnn_executor*       exec;       /// NULL for default.
+    bool                        verbose;
+    const StripWriterOptions*   writeopts;  /// NULL for defaults.
+}OutOfCoreConfig;
+
+// Returns 0 or negative for failure.
+int runOutOfCore( const OutOfCoreConfig& cfg );
+
+#endif /// of __OUTOFCORE_H__
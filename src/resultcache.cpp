@@ -0,0 +1,498 @@
+/*******************************************************************************
+ * SRCNN result cache
+ * ----------------------------------------------------------------------------
+ * Output files are kept by key in a directory, named as 32 hex digits.
+ * Hash is XXH64 ( Yann Collet's algorithm, written here to need no
+ * library ) run twice in one pass with two seeds, 128 bits of key.
+*******************************************************************************/
+#ifndef EXPORTLIBSRCNN
+
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "resultcache.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define XXH_PRIME1      0x9E3779B185EBCA87ULL
+#define XXH_PRIME2      0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME3      0x165667B19E3779F9ULL
+#define XXH_PRIME4      0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME5      0x27D4EB2F165667C5ULL
+
+#define KEY_SEED0       0ULL
+#define KEY_SEED1       0x5352434E4E4B4559ULL   /// "SRCNNKEY".
+
+#define COPY_CHUNK      ( 1024 * 1024 )
+#define TEMP_EXPIRE     3600    /// seconds, temporaries of dead processes.
+
+static inline uint64_t rotl64( uint64_t v, int r )
+{
+    return ( v << r ) | ( v >> ( 64 - r ) );
+}
+
+static inline uint64_t read64( const unsigned char* p )
+{
+    uint64_t v;
+    memcpy( &v, p, 8 );
+    return v;
+}
+
+static inline uint32_t read32( const unsigned char* p )
+{
+    uint32_t v;
+    memcpy( &v, p, 4 );
+    return v;
+}
+
+static inline uint64_t xxhRound( uint64_t acc, uint64_t input )
+{
+    acc += input * XXH_PRIME2;
+    acc  = rotl64( acc, 31 );
+    return acc * XXH_PRIME1;
+}
+
+static inline uint64_t xxhMerge( uint64_t acc, uint64_t val )
+{
+    acc ^= xxhRound( 0, val );
+    return acc * XXH_PRIME1 + XXH_PRIME4;
+}
+
+// Streaming XXH64.
+class Xxh64
+{
+    public:
+        Xxh64( uint64_t seed )
+         : seed( seed ),
+           total( 0 ),
+           memsz( 0 )
+        {
+            v[0] = seed + XXH_PRIME1 + XXH_PRIME2;
+            v[1] = seed + XXH_PRIME2;
+            v[2] = seed;
+            v[3] = seed - XXH_PRIME1;
+        }
+
+    public:
+        void update( const unsigned char* p, size_t len )
+        {
+            total += len;
+
+            if ( memsz + len < 32 )
+            {
+                memcpy( mem + memsz, p, len );
+                memsz += len;
+                return;
+            }
+
+            if ( memsz > 0 )
+            {
+                size_t fill = 32 - memsz;
+
+                memcpy( mem + memsz, p, fill );
+                stripe( mem );
+
+                p    += fill;
+                len  -= fill;
+                memsz = 0;
+            }
+
+            for ( ; len >= 32; p += 32, len -= 32 )
+            {
+                stripe( p );
+            }
+
+            memcpy( mem, p, len );
+            memsz = len;
+        }
+
+        uint64_t digest() const
+        {
+            uint64_t h = 0;
+
+            if ( total >= 32 )
+            {
+                h = rotl64( v[0], 1 ) + rotl64( v[1], 7 ) + rotl64( v[2], 12 ) + rotl64( v[3], 18 );
+
+                for ( int cnt = 0; cnt < 4; cnt++ )
+                    h = xxhMerge( h, v[cnt] );
+            }
+            else
+            {
+                h = seed + XXH_PRIME5;
+            }
+
+            h += total;
+
+            const unsigned char* p   = mem;
+            size_t               len = memsz;
+
+            for ( ; len >= 8; p += 8, len -= 8 )
+            {
+                h ^= xxhRound( 0, read64( p ) );
+                h  = rotl64( h, 27 ) * XXH_PRIME1 + XXH_PRIME4;
+            }
+
+            if ( len >= 4 )
+            {
+                h ^= (uint64_t)read32( p ) * XXH_PRIME1;
+                h  = rotl64( h, 23 ) * XXH_PRIME2 + XXH_PRIME3;
+                p   += 4;
+                len -= 4;
+            }
+
+            for ( ; len > 0; p++, len-- )
+            {
+                h ^= (uint64_t)( *p ) * XXH_PRIME5;
+                h  = rotl64( h, 11 ) * XXH_PRIME1;
+            }
+
+            h ^= h >> 33;
+            h *= XXH_PRIME2;
+            h ^= h >> 29;
+            h *= XXH_PRIME3;
+            h ^= h >> 32;
+
+            return h;
+        }
+
+    private:
+        void stripe( const unsigned char* p )
+        {
+            for ( int cnt = 0; cnt < 4; cnt++ )
+                v[cnt] = xxhRound( v[cnt], read64( p + cnt * 8 ) );
+        }
+
+    private:
+        uint64_t        seed;
+        uint64_t        v[4];
+        uint64_t        total;
+        unsigned char   mem[32];
+        size_t          memsz;
+};
+
+// Temporary name next to path, unique in this process and among others.
+static string tempPath( const string& path )
+{
+    static unsigned seq = 0;
+
+    char suffix[64] = {0};
+    snprintf( suffix, sizeof( suffix ), ".tmp.%ld.%u",
+              (long)getpid(), __sync_fetch_and_add( &seq, 1 ) );
+
+    size_t sp = path.rfind( '/' );
+
+    if ( sp == string::npos )
+        return string( "." ) + path + suffix;
+
+    return path.substr( 0, sp + 1 ) + "." + path.substr( sp + 1 ) + suffix;
+}
+
+/***
+ * FuncName : copyFile
+ * Function : copies file to a temporary, then renames it to dst
+ * Parameter    : src, dst - paths
+ * Output   : bool, false leaves dst as it was
+***/
+static bool copyFile( const string& src, const string& dst )
+{
+    FILE* fin = fopen( src.c_str(), "rb" );
+
+    if ( fin == NULL )
+        return false;
+
+    string tmp  = tempPath( dst );
+    FILE*  fout = fopen( tmp.c_str(), "wb" );
+
+    if ( fout == NULL )
+    {
+        fclose( fin );
+        return false;
+    }
+
+    vector<unsigned char> buff( COPY_CHUNK );
+    bool                  retb = true;
+
+    while( retb == true )
+    {
+        size_t rsz = fread( buff.data(), 1, buff.size(), fin );
+
+        if ( rsz == 0 )
+        {
+            retb = ( ferror( fin ) == 0 );
+            break;
+        }
+
+        retb = ( fwrite( buff.data(), 1, rsz, fout ) == rsz );
+    }
+
+    fclose( fin );
+
+    if ( fclose( fout ) != 0 )
+        retb = false;
+
+    if ( ( retb == true ) && ( rename( tmp.c_str(), dst.c_str() ) == 0 ) )
+        return true;
+
+    unlink( tmp.c_str() );
+
+    return false;
+}
+
+static bool isEntryName( const char* name )
+{
+    if ( strlen( name ) != 32 )
+        return false;
+
+    for ( const char* p = name; *p != 0; p++ )
+    {
+        if ( ( ( *p < '0' ) || ( *p > '9' ) ) && ( ( *p < 'a' ) || ( *p > 'f' ) ) )
+            return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ResultCache::ResultCache()
+ : maxbytes( 0 ),
+   total( 0 )
+{
+    pthread_mutex_init( &lock, NULL );
+    memset( &st, 0, sizeof( st ) );
+}
+
+ResultCache::~ResultCache()
+{
+    pthread_mutex_destroy( &lock );
+}
+
+bool ResultCache::open( const char* path, size_t maxsz )
+{
+    if ( ( path == NULL ) || ( path[0] == 0 ) )
+        return false;
+
+    dir = path;
+
+    while( ( dir.size() > 1 ) && ( dir[ dir.size() - 1 ] == '/' ) )
+    {
+        dir.erase( dir.size() - 1 );
+    }
+
+    // parents may not exist yet.
+    for ( size_t sp = dir.find( '/', 1 ); sp != string::npos; sp = dir.find( '/', sp + 1 ) )
+    {
+        mkdir( dir.substr( 0, sp ).c_str(), 0755 );
+    }
+
+    mkdir( dir.c_str(), 0755 );
+
+    struct stat sb;
+
+    if ( ( stat( dir.c_str(), &sb ) != 0 ) || ( S_ISDIR( sb.st_mode ) == 0 ) ||
+         ( access( dir.c_str(), W_OK ) != 0 ) )
+        return false;
+
+    maxbytes = maxsz > 0 ? maxsz : (size_t)RESULTCACHE_DEFAULT_SIZE << 20;
+    total    = scan();
+
+    if ( total > maxbytes )
+    {
+        evict();
+    }
+
+    return true;
+}
+
+void ResultCache::keyOfBuffer( const void* data, size_t size, const string& params,
+                               ResultCacheKey& key )
+{
+    Xxh64 h0( KEY_SEED0 );
+    Xxh64 h1( KEY_SEED1 );
+
+    h0.update( (const unsigned char*)data, size );
+    h1.update( (const unsigned char*)data, size );
+
+    // parameters after a zero byte, never read as part of file.
+    const unsigned char sep = 0;
+
+    h0.update( &sep, 1 );
+    h1.update( &sep, 1 );
+    h0.update( (const unsigned char*)params.c_str(), params.size() );
+    h1.update( (const unsigned char*)params.c_str(), params.size() );
+
+    snprintf( key.hex, sizeof( key.hex ), "%016llx%016llx",
+              (unsigned long long)h0.digest(), (unsigned long long)h1.digest() );
+}
+
+bool ResultCache::fetch( const ResultCacheKey& key, const char* dstpath )
+{
+    string epath = entryPath( key );
+    bool   hit   = copyFile( epath, dstpath );
+
+    if ( hit == true )
+    {
+        // most recently used now.
+        utime( epath.c_str(), NULL );
+    }
+
+    pthread_mutex_lock( &lock );
+
+    if ( hit == true )
+        st.hits++;
+    else
+        st.misses++;
+
+    pthread_mutex_unlock( &lock );
+
+    return hit;
+}
+
+bool ResultCache::store( const ResultCacheKey& key, const char* srcpath )
+{
+    string epath = entryPath( key );
+
+    if ( copyFile( srcpath, epath ) == false )
+        return false;
+
+    struct stat sb;
+    size_t      esz = 0;
+
+    if ( stat( epath.c_str(), &sb ) == 0 )
+    {
+        esz = (size_t)sb.st_size;
+    }
+
+    pthread_mutex_lock( &lock );
+
+    st.stored++;
+    total += esz;
+
+    if ( total > maxbytes )
+    {
+        evict();
+    }
+
+    pthread_mutex_unlock( &lock );
+
+    return true;
+}
+
+void ResultCache::stats( ResultCacheStats& out )
+{
+    pthread_mutex_lock( &lock );
+    out = st;
+    pthread_mutex_unlock( &lock );
+}
+
+string ResultCache::entryPath( const ResultCacheKey& key )
+{
+    return dir + "/" + key.hex;
+}
+
+// Bytes of entries in directory.
+size_t ResultCache::scan()
+{
+    DIR* dp = opendir( dir.c_str() );
+
+    if ( dp == NULL )
+        return 0;
+
+    size_t         sum = 0;
+    struct dirent* ent = NULL;
+
+    while( ( ent = readdir( dp ) ) != NULL )
+    {
+        struct stat sb;
+
+        if ( ( isEntryName( ent->d_name ) == true ) &&
+             ( stat( ( dir + "/" + ent->d_name ).c_str(), &sb ) == 0 ) )
+        {
+            sum += (size_t)sb.st_size;
+        }
+    }
+
+    closedir( dp );
+
+    return sum;
+}
+
+/***
+ * FuncName : evict
+ * Function : removes least recently used entries until under size,
+ *            entries of other processes are counted again from directory
+ * Parameter    : <void>
+ * Output   : <void>
+***/
+void ResultCache::evict()
+{
+    DIR* dp = opendir( dir.c_str() );
+
+    if ( dp == NULL )
+        return;
+
+    vector< pair<time_t, string> > entries;
+    size_t                         sum = 0;
+    time_t                         now = time( NULL );
+    struct dirent*                 ent = NULL;
+
+    while( ( ent = readdir( dp ) ) != NULL )
+    {
+        string      epath = dir + "/" + ent->d_name;
+        struct stat sb;
+
+        if ( stat( epath.c_str(), &sb ) != 0 )
+            continue;
+
+        if ( isEntryName( ent->d_name ) == true )
+        {
+            entries.push_back( make_pair( sb.st_mtime, epath ) );
+            sum += (size_t)sb.st_size;
+        }
+        else
+        if ( ( strncmp( ent->d_name, ".", 1 ) == 0 ) && ( strstr( ent->d_name, ".tmp." ) != NULL ) &&
+             ( now - sb.st_mtime > TEMP_EXPIRE ) )
+        {
+            unlink( epath.c_str() );
+        }
+    }
+
+    closedir( dp );
+
+    sort( entries.begin(), entries.end() );
+
+    for ( size_t cnt = 0; ( cnt < entries.size() ) && ( sum > maxbytes ); cnt++ )
+    {
+        struct stat sb;
+
+        if ( stat( entries[cnt].second.c_str(), &sb ) != 0 )
+            continue;
+
+        if ( unlink( entries[cnt].second.c_str() ) == 0 )
+        {
+            sum -= (size_t)sb.st_size;
+            st.evicted++;
+        }
+    }
+
+    total = sum;
+}
+
+#endif /// of EXPORTLIBSRCNN
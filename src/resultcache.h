@@ -0,0 +1,67 @@
+#ifndef __RESULTCACHE_H__
+#define __RESULTCACHE_H__
+
+#include <cstddef>
+#include <string>
+#include <pthread.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Content-addressed cache of output files in a local directory.
+// - Key is a 128 bit hash ( two XXH64 lanes ) of source file bytes and a
+//   parameter string of everything changing output bytes, so hits skip
+//   decode, SRCNN and encode, output is copied from entry.
+// - Entries are written to temporary names and renamed, readers never
+//   see a partial file, processes may share a directory.
+// - Size is capped, least recently used entries go first. Use time is
+//   file modification time, touched on each hit.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define RESULTCACHE_DEFAULT_SIZE    1024    /// MB when not given.
+
+typedef struct
+{
+    char    hex[33];
+}ResultCacheKey;
+
+typedef struct
+{
+    unsigned    hits;
+    unsigned    misses;
+    unsigned    stored;
+    unsigned    evicted;
+}ResultCacheStats;
+
+class ResultCache
+{
+    public:
+        ResultCache();
+        ~ResultCache();
+
+    public:
+        // Creates directory when missing, maxbytes 0 for default size.
+        bool open( const char* dir, size_t maxbytes );
+        // Key of source bytes, read once and decoded from same buffer.
+        static void keyOfBuffer( const void* data, size_t size,
+                                 const std::string& params, ResultCacheKey& key );
+        // Copies entry to dstpath on hit, false on miss.
+        bool fetch( const ResultCacheKey& key, const char* dstpath );
+        // Copies finished output into cache, then evicts over size.
+        bool store( const ResultCacheKey& key, const char* srcpath );
+        void stats( ResultCacheStats& st );
+
+    private:
+        std::string entryPath( const ResultCacheKey& key );
+        size_t      scan();
+        void        evict();
+
+    private:
+        pthread_mutex_t     lock;
+        std::string         dir;
+        size_t              maxbytes;
+        size_t              total;      /// bytes of entries, approximate.
+        ResultCacheStats    st;
+};
+
+#endif /// of __RESULTCACHE_H__
@@ -17,18 +17,38 @@
 #include <cstring>
 #include <string>
 #include <cstdint>
+#include <cmath>
+#include <cctype>
+#include <algorithm>
+#include <set>
 
 #include <unistd.h>
+#include <dirent.h>
 #include <pthread.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#ifdef __linux__
+    #include <sched.h>
+#endif
 #ifndef NO_OMP
     #include <omp.h>
 #endif
 
 #include "srcnn.h"
 #include "tick.h"
-
-/* pre-calculated convolutional data */
-#include "convdata.h"
+#include "minmax.h"
+#include "bqueue.h"
+#include "daemon.h"
+#include "yuvstream.h"
+#include "outofcore.h"
+#include "autotune.h"
+#include "resultcache.h"
+
+#include "libsrcnn.h"
+#include "srcnnkernel.h"
+#include "srcnngraph.h"
+#include "srcnnnuma.h"
+#include "srcnnprof.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -43,12 +63,58 @@ static unsigned image_height    = 0;
 static bool     opt_verbose     = true;
 static bool     opt_debug       = false;
 static bool     opt_help        = false;
+static bool     opt_grayscale   = false;
+static bool     opt_stream      = false;
+static bool     opt_y4m         = false;
+static bool     opt_temporal    = false;
+static int      opt_tilesize    = 64;
+static bool     opt_batch       = false;
+static unsigned opt_iothreads   = 2;
+static unsigned opt_queuedepth  = 4;
+static unsigned opt_workers     = 1;
+static unsigned opt_inferthreads = 2;
+static int      opt_scheduler   = 0;    /// 0 steal, 1 OpenMP, 2 serial.
+static unsigned opt_threads     = 0;    /// 0 for all cores or affinity list.
+static bool     opt_numa        = false;
+static bool     opt_outofcore   = false;
+static unsigned opt_maxmemory   = 0;    /// MB, 0 for default budget.
+static bool     opt_estimate    = false;
+static size_t   admit_wholemem  = 0;    /// whole image plan over --max-memory.
+static Mat      admit_source;           /// decoded by admission, not again.
+static bool     opt_rawsrc      = false;
+static bool     opt_parallelpng = false;
+static bool     opt_counters    = false;
+static unsigned opt_bench       = 0;    /// timed runs, 0 for no bench.
+static bool     opt_nowrite     = false;
+static bool     opt_json        = false;
+static int      opt_pnglevel    = -1;   /// -1 for OpenCV default.
+static bool     opt_autotune    = false;
+static bool     opt_notune      = false;
+static bool     opt_nojit       = false;
+static unsigned opt_cachesize   = 0;    /// MB, 0 for default size.
 static int      t_exit_code     = 0;
 
+static YUVStreamInfo yuv_rawinfo = { 0, 0, YUVSTREAM_CHROMA_420, 0, 0, 0, 0, 'p', "" };
+static StripImageInfo strip_rawinfo = { 0, 0, 0 };
+
 static string   path_me;
 static string   file_me;
 static string   file_src;
 static string   file_dst;
+static string   opt_batchlist;
+static string   opt_batchdir;
+static string   opt_outdir;
+static string   opt_daemonsock;
+static string   opt_tracefile;
+static string   opt_affinity;
+static string   opt_tunefile;
+static string   opt_cachedir;
+
+// Executor of every SRCNN layer, shared by all images in flight.
+static vector<int>           thread_cpus;   /// --affinity list, workers pinned.
+static const srcnn_executor* engine_exec  = NULL;
+static srcnn_executor*       engine_steal = NULL;
+static ResultCache*          result_cache = NULL;
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -56,277 +122,214 @@ static string   file_dst;
 
 ////////////////////////////////////////////////////////////////////////////////
 
-/* Function Declaration */
-void Convolution99( Mat& src, Mat& dst, \
-                    const float kernel[9][9], float bias);
-
-void Convolution11( vector<Mat>& src, Mat& dst, \
-                    const float kernel[CONV1_FILTERS], float bias);
-
-void Convolution55( vector<Mat>& src, Mat& dst, \
-                    const float kernel[32][5][5], float bias);
-
-void Convolution99x11( Mat& src, vector<Mat>& dst, \
-                       const float kernel99[CONV1_FILTERS][9][9], \
-                       const float bias99[CONV1_FILTERS], \
-                       const float kernel11[CONV2_FILTERS][CONV1_FILTERS], \
-                       const float bias11[CONV2_FILTERS] );
-
-////////////////////////////////////////////////////////////////////////////////
-
-static inline int IntTrim(int a, int b, int c)
-{
-    int buff[3] = {a, c, b};
-    return buff[ (int)(c > a) + (int)(c > b) ];
-}
-
 /***
- * FuncName : Convolution99
- * Function : Complete one cell in the first Convolutional Layer
- * Parameter    : src - the original input image
- *        dst - the output image
- *        kernel - the convolutional kernel
- *        bias - the cell bias
+ * FuncName : Convolution99x11
+ * Function : Complete the first and second Convolutional Layer
+ * Parameter    : src - the upscaled Y image
+ *        dst - layer II planes, SRCNN_KERNEL_PLANES of CV_32F
+ *        roi - region of dst to be computed, NULL for whole image
  * Output   : <void>
 ***/
-void Convolution99(Mat& src, Mat& dst, const float kernel[9][9], float bias)
+void Convolution99x11( Mat& src, vector<Mat>& dst, const Rect* roi = NULL )
 {
-    int width  = dst.cols;
-    int height = dst.rows;
-    int row    = 0;
-    int col    = 0;
-    // macOS clang displays these array not be initialized.
-    int rowf[height + 8];
-    int colf[width + 8];
+    float* planes[ SRCNN_KERNEL_PLANES ];
 
-    /* Expand the src image */
-    #pragma parallel for
-    for (row = 0; row < height + 8; row++)
+    for ( unsigned cnt=0; cnt<SRCNN_KERNEL_PLANES; cnt++ )
     {
-        rowf[row] = IntTrim(0, height - 1, row - 4);
+        planes[cnt] = dst[cnt].ptr<float>();
     }
 
-    #pragma parallel for
-    for (col = 0; col < width + 8; col++)
-    {
-        colf[col] = IntTrim(0, width - 1, col - 4);
-    }
+    SRCNNRegion rgn;
 
-    /* Complete the Convolution Step */
-    #pragma omp parallel for private(col)
-    for (row = 0; row < height; row++)
+    if ( roi != NULL )
     {
-        for (col = 0; col < width; col++)
-        {
-            /* Convolution */
-            float temp = 0.f;
-
-            for (int i = 0; i < 9; i++)
-            {
-                for (int j = 0; j < 9; j++)
-                {
-                    temp += kernel[i][j] * src.at<uint8_t>(rowf[row + i], colf[col + j]);
-                }
-            }
-
-            temp += bias;
-
-            /* Threshold */
-            temp = (temp < 0) ? 0 : temp;
-
-            dst.at<float>(row, col) = temp;
-        }
+        rgn.x0 = roi->x;
+        rgn.y0 = roi->y;
+        rgn.x1 = roi->x + roi->width;
+        rgn.y1 = roi->y + roi->height;
     }
+
+    SRCNNLayer12( src.ptr(), src.step, src.cols, src.rows,
+                  planes, dst[0].step1(), roi != NULL ? &rgn : NULL, engine_exec );
 }
 
 /***
- * FuncName : Convolution11
- * Function : Complete one cell in the second Convolutional Layer
- * Parameter    : src - the first layer data
- *        dst - the output data
- *        kernel - the convolutional kernel
- *        bias - the cell bias
+ * FuncName : Convolution55
+ * Function : Complete the third Convolutional Layer
+ * Parameter    : src - layer II planes
+ *        dst - the output image, CV_8U
+ *        roi - region of dst to be computed, NULL for whole image
  * Output   : <void>
 ***/
-void Convolution11(vector<Mat>& src, Mat& dst, const float kernel[CONV1_FILTERS], float bias)
+void Convolution55( vector<Mat>& src, Mat& dst, const Rect* roi = NULL )
 {
-    int height = dst.rows;
-    int width = dst.cols;
-    int row = 0;
-    int col = 0;
+    const float* planes[ SRCNN_KERNEL_PLANES ];
 
-    #pragma omp parallel for private(col)
-    for (row = 0; row < height; row++)
+    for ( unsigned cnt=0; cnt<SRCNN_KERNEL_PLANES; cnt++ )
     {
-        for (col = 0; col < width; col++)
-        {
-            /* Process with each pixel */
-            float temp = 0.f;
-
-            for (int i = 0; i < CONV1_FILTERS; i++)
-            {
-                temp += src[i].at<float>(row, col) * kernel[i];
-            }
-            temp += bias;
+        planes[cnt] = src[cnt].ptr<float>();
+    }
 
-            /* Threshold */
-            temp = (temp < 0) ? 0 : temp;
+    SRCNNRegion rgn;
 
-            dst.at<float>(row, col) = temp;
-        }
+    if ( roi != NULL )
+    {
+        rgn.x0 = roi->x;
+        rgn.y0 = roi->y;
+        rgn.x1 = roi->x + roi->width;
+        rgn.y1 = roi->y + roi->height;
     }
+
+    SRCNNLayer3( planes, src[0].step1(), dst.cols, dst.rows,
+                 dst.ptr(), dst.step, roi != NULL ? &rgn : NULL, engine_exec );
 }
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
 /***
- * FuncName : Convolution55
- * Function : Complete the cell in the third Convolutional Layer
- * Parameter    : src - the second layer data
- *        dst - the output image
- *        kernel - the convolutional kernel
- *        bias - the cell bias
- * Output   : <void>
+ * FuncName : makeOutputName
+ * Function : output file name for a source
+ * Parameter    : src - source file path
+ *        outdir - output directory, empty for same directory to source
+ * Output   : string, "name_resized.ext" or "outdir/name.ext"
 ***/
-void Convolution55(vector<Mat>& src, Mat& dst, const float kernel[32][5][5], float bias)
+string makeOutputName( const string& src, const string& outdir )
 {
-    int height = dst.rows;
-    int width  = dst.cols;
-    int row    = 0;
-    int col    = 0;
-    // macOS these array not be initalized by zero.
-    int rowf[height + 4];
-    int colf[width + 4];
+    string dir;
+    string name = src;
 
-    /* Expand the src image */
-    #pragma omp parallel for
-    for (row = 0; row < height + 4; row++)
+    size_t possep = src.find_last_of( "/\\" );
+    if ( possep != string::npos )
     {
-        rowf[row] = IntTrim(0, height - 1, row - 2);
+        dir  = src.substr( 0, possep + 1 );
+        name = src.substr( possep + 1 );
     }
 
-    #pragma omp parallel for
-    for (col = 0; col < width + 4; col++)
+    if ( outdir.size() > 0 )
     {
-        colf[col] = IntTrim(0, width - 1, col - 2);
+        string outname = outdir + "/" + name;
+
+        if ( outname != src )
+        {
+            return outname;
+        }
+
+        dir = outdir + "/";
     }
 
-    /* Complete the Convolution Step */
-    #pragma omp parallel for private(col)
-    for (row = 0; row < height; row++)
+    string convname = name;
+    string srcext;
+
+    // changes name without file extention.
+    size_t posdot = name.find_last_of( "." );
+    if ( posdot != string::npos )
     {
-        for (col = 0; col < width; col++)
-        {
-            float temp = 0;
+        convname = name.substr( 0, posdot );
+        srcext   = name.substr( posdot );
+    }
 
-            for (int i = 0; i < CONV2_FILTERS; i++)
-            {
-                double temppixel = 0;
-                for (int m = 0; m < 5; m++)
-                {
-                    for (int n = 0; n < 5; n++)
-                    {
-                        temppixel += \
-                        kernel[i][m][n] * src[i].at<float>(rowf[row + m], colf[col + n]);
-                    }
-                }
+    convname += "_resized";
+    if ( srcext.size() > 0 )
+    {
+        convname += srcext;
+    }
 
-                temp += temppixel;
-            }
+    return dir + convname;
+}
 
-            temp += bias;
+// Writer options of streaming output, by command line.
+static void writerOptions( StripWriterOptions& opts )
+{
+    DefaultStripWriterOptions( opts );
 
-            /* Threshold */
-            temp = IntTrim(0, 255, temp);
+    opts.pnglevel = opt_pnglevel;
 
-            dst.at<unsigned char>(row, col) = (unsigned char)temp;
-        }
+    if ( opt_parallelpng == true )
+    {
+        opts.exec = engine_exec;
     }
 }
 
 /***
- * FuncName : Convolution99x11
- * Function : Complete one cell in the first and second Convolutional Layer
- * Parameter    : src - the original input image
- *        dst - the output image
- *        kernel - the convolutional kernel
- *        bias - the cell bias
- * Output   : <void>
+ * FuncName : writeImage
+ * Function : writes an image, PNG goes by strips deflated in parallel
+ *            when --parallelpng or --pnglevel given, others by OpenCV.
+ * Parameter    : path - output file path
+ *        img - 8bit BGR, BGRA or gray image
+ * Output   : bool, true for success
 ***/
-void Convolution99x11( Mat& src, vector<Mat>& dst, \
-                       const float kernel99[CONV1_FILTERS][9][9], \
-                       const float bias99[CONV1_FILTERS], \
-                       const float kernel11[CONV2_FILTERS][CONV1_FILTERS], \
-                       const float bias11[CONV2_FILTERS] )
+bool writeImage( const string& path, const Mat& img )
 {
-    int row = 0;
-    int col = 0;
-    int height = src.rows;
-    int width = src.cols;
-    float temp[CONV1_FILTERS] = {0.f};
-    // macOS llvm not able to init zero.
-    int rowf[height + 8];
-    int colf[width + 8];
+    string ext = path.size() > 4 ? path.substr( path.size() - 4 ) : "";
 
-    /* Expand the src image */
-    #pragma omp parallel for
-    for (row = 0; row < height + 8; row++)
+    for ( size_t cnt = 0; cnt < ext.size(); cnt++ )
     {
-        rowf[row] = IntTrim(0, height - 1, row - 4);
+        ext[cnt] = tolower( ext[cnt] );
     }
 
-    #pragma omp parallel for
-    for (col = 0; col < width + 8; col++)
+    if ( ( ext != ".png" ) || ( ( opt_parallelpng == false ) && ( opt_pnglevel < 0 ) ) ||
+         ( img.depth() != CV_8U ) )
     {
-        colf[col] = IntTrim(0, width - 1, col - 4);
+        return imwrite( path, img );
     }
 
-    /* Complete the Convolution Step */
-    #pragma omp parallel for private(col,temp) shared(dst)
-    for (row = 0; row < height; row++)
-    {
-        for (col = 0; col < width; col++)
-        {
-            for (int k = 0; k < CONV1_FILTERS; k++)
-            {
-                /* Convolution */
-                temp[k] = 0.0;
+    StripImageInfo     info = { (unsigned)img.cols, (unsigned)img.rows, (unsigned)img.channels() };
+    StripWriterOptions opts;
 
-                for (int i = 0; i < 9; i++)
-                {
-                    for (int j = 0; j < 9; j++)
-                    {
-                        temp[k] += kernel99[k][i][j] * src.at<uint8_t>(rowf[row + i], colf[col + j]);
-                    }
-                }
+    writerOptions( opts );
 
-                temp[k] += bias99[k];
+    StripWriter* writer = OpenStripWriter( path.c_str(), info, &opts );
 
-                /* Threshold */
-                temp[k] = (temp[k] < 0) ? 0 : temp[k];
-            }
+    if ( writer == NULL )
+        return false;
+
+    // BGR rows to RGB, a strip at once.
+    const unsigned stripsz = 64;
+    size_t         rowsz   = (size_t)info.width * info.depth;
+    vector<uchar>  rows( rowsz * stripsz );
+    bool           retb    = true;
+
+    for ( unsigned y0 = 0; ( y0 < info.height ) && ( retb == true ); y0 += stripsz )
+    {
+        unsigned cnt = info.height - y0 < stripsz ? info.height - y0 : stripsz;
+
+        for ( unsigned row = 0; row < cnt; row++ )
+        {
+            const uchar* src = img.ptr( y0 + row );
+            uchar*       dst = &rows[ row * rowsz ];
 
-            /* Process with each pixel */
-            for (int k = 0; k < CONV2_FILTERS; k++)
+            if ( info.depth == 1 )
             {
-                float result = 0.0;
+                memcpy( dst, src, rowsz );
+                continue;
+            }
 
-                for (int i = 0; i < CONV1_FILTERS; i++)
-                {
-                    result += temp[i] * kernel11[k][i];
-                }
-                result += bias11[k];
+            for ( unsigned x = 0; x < info.width; x++ )
+            {
+                const uchar* sp = src + x * info.depth;
+                uchar*       dp = dst + x * info.depth;
 
-                /* Threshold */
-                result = (result < 0) ? 0 : result;
+                dp[0] = sp[2];
+                dp[1] = sp[1];
+                dp[2] = sp[0];
 
-                dst[k].at<float>(row, col) = result;
+                if ( info.depth == 4 )
+                    dp[3] = sp[3];
             }
         }
+
+        retb = writer->writeRows( rows.data(), cnt, rowsz );
     }
-}
 
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
+    if ( writer->close() == false )
+        retb = false;
+
+    delete writer;
+
+    return retb;
+}
 
 bool parseArgs( int argc, char** argv )
 {
@@ -369,6 +372,292 @@ bool parseArgs( int argc, char** argv )
                 }
             }
             else
+            if ( strtmp.find( "--y4m" ) == 0 )
+            {
+                opt_stream = true;
+                opt_y4m    = true;
+            }
+            else
+            if ( strtmp.find( "--yuvfmt=" ) == 0 )
+            {
+                string strval = strtmp.substr( 9 );
+                if ( strval == "444" )
+                {
+                    yuv_rawinfo.chroma = YUVSTREAM_CHROMA_444;
+                }
+                else
+                if ( strval == "mono" )
+                {
+                    yuv_rawinfo.chroma = YUVSTREAM_CHROMA_MONO;
+                }
+                else
+                {
+                    yuv_rawinfo.chroma = YUVSTREAM_CHROMA_420;
+                }
+            }
+            else
+            if ( strtmp.find( "--yuv=" ) == 0 )
+            {
+                string strval = strtmp.substr( 6 );
+                unsigned yw = 0;
+                unsigned yh = 0;
+                if ( sscanf( strval.c_str(), "%ux%u", &yw, &yh ) == 2 )
+                {
+                    yuv_rawinfo.width  = yw;
+                    yuv_rawinfo.height = yh;
+                    opt_stream = true;
+                }
+            }
+            else
+            if ( strtmp.find( "--batch=" ) == 0 )
+            {
+                opt_batchlist = strtmp.substr( 8 );
+                opt_batch     = ( opt_batchlist.size() > 0 );
+            }
+            else
+            if ( strtmp.find( "--batchdir=" ) == 0 )
+            {
+                opt_batchdir = strtmp.substr( 11 );
+                opt_batch    = ( opt_batchdir.size() > 0 );
+            }
+            else
+            if ( strtmp.find( "--outdir=" ) == 0 )
+            {
+                opt_outdir = strtmp.substr( 9 );
+            }
+            else
+            if ( strtmp.find( "--iothreads=" ) == 0 )
+            {
+                string strval = strtmp.substr( 12 );
+                int tmpiv = atoi( strval.c_str() );
+                if ( tmpiv > 0 )
+                {
+                    opt_iothreads = tmpiv;
+                }
+            }
+            else
+            if ( strtmp.find( "--queue=" ) == 0 )
+            {
+                string strval = strtmp.substr( 8 );
+                int tmpiv = atoi( strval.c_str() );
+                if ( tmpiv > 0 )
+                {
+                    opt_queuedepth = tmpiv;
+                }
+            }
+            else
+            if ( strtmp.find( "--threads=" ) == 0 )
+            {
+                string strval = strtmp.substr( 10 );
+                int tmpiv = atoi( strval.c_str() );
+                if ( tmpiv > 0 )
+                {
+                    opt_threads = tmpiv;
+                }
+            }
+            else
+            if ( strtmp.find( "--affinity=" ) == 0 )
+            {
+                opt_affinity = strtmp.substr( 11 );
+            }
+            else
+            if ( strtmp.find( "--numa" ) == 0 )
+            {
+                opt_numa = true;
+            }
+            else
+            if ( strtmp.find( "--outofcore" ) == 0 )
+            {
+                opt_outofcore = true;
+            }
+            else
+            if ( strtmp.find( "--max-memory=" ) == 0 )
+            {
+                string strval = strtmp.substr( 13 );
+                int tmpiv = atoi( strval.c_str() );
+                if ( tmpiv > 0 )
+                {
+                    opt_maxmemory = tmpiv;
+                }
+            }
+            else
+            if ( strtmp.find( "--estimate" ) == 0 )
+            {
+                opt_estimate = true;
+            }
+            else
+            if ( strtmp.find( "--cache=" ) == 0 )
+            {
+                string strval = strtmp.substr( 8 );
+                if ( strval.size() > 0 )
+                {
+                    opt_cachedir = strval;
+                }
+            }
+            else
+            if ( strtmp.find( "--cachesize=" ) == 0 )
+            {
+                string strval = strtmp.substr( 12 );
+                int tmpiv = atoi( strval.c_str() );
+                if ( tmpiv > 0 )
+                {
+                    opt_cachesize = tmpiv;
+                }
+            }
+            else
+            if ( strtmp.find( "--raw=" ) == 0 )
+            {
+                string strval = strtmp.substr( 6 );
+                unsigned rw = 0;
+                unsigned rh = 0;
+                unsigned rc = 0;
+                if ( ( sscanf( strval.c_str(), "%ux%ux%u", &rw, &rh, &rc ) == 3 ) &&
+                     ( ( rc == 1 ) || ( rc == 3 ) || ( rc == 4 ) ) )
+                {
+                    strip_rawinfo.width  = rw;
+                    strip_rawinfo.height = rh;
+                    strip_rawinfo.depth  = rc;
+                    opt_rawsrc    = true;
+                    opt_outofcore = true;
+                }
+            }
+            else
+            if ( strtmp.find( "--parallelpng" ) == 0 )
+            {
+                opt_parallelpng = true;
+            }
+            else
+            if ( strtmp.find( "--pnglevel=" ) == 0 )
+            {
+                string strval = strtmp.substr( 11 );
+                int tmpiv = atoi( strval.c_str() );
+                if ( ( strval.size() > 0 ) && ( tmpiv >= 0 ) && ( tmpiv <= 9 ) )
+                {
+                    opt_pnglevel = tmpiv;
+                }
+            }
+            else
+            if ( strtmp.find( "--trace=" ) == 0 )
+            {
+                string strval = strtmp.substr( 8 );
+                if ( strval.size() > 0 )
+                {
+                    opt_tracefile = strval;
+                }
+            }
+            else
+            if ( strtmp.find( "--bench=" ) == 0 )
+            {
+                string strval = strtmp.substr( 8 );
+                int tmpiv = atoi( strval.c_str() );
+                if ( tmpiv > 0 )
+                {
+                    opt_bench = tmpiv;
+                }
+            }
+            else
+            if ( strtmp.find( "--nowrite" ) == 0 )
+            {
+                opt_nowrite = true;
+            }
+            else
+            if ( strtmp.find( "--json" ) == 0 )
+            {
+                opt_json = true;
+            }
+            else
+            if ( strtmp.find( "--counters" ) == 0 )
+            {
+                opt_counters = true;
+            }
+            else
+            if ( strtmp.find( "--autotune" ) == 0 )
+            {
+                opt_autotune = true;
+            }
+            else
+            if ( strtmp.find( "--tunefile=" ) == 0 )
+            {
+                string strval = strtmp.substr( 11 );
+                if ( strval.size() > 0 )
+                {
+                    opt_tunefile = strval;
+                }
+            }
+            else
+            if ( strtmp.find( "--notune" ) == 0 )
+            {
+                opt_notune = true;
+            }
+            else
+            if ( strtmp.find( "--nojit" ) == 0 )
+            {
+                opt_nojit = true;
+            }
+            else
+            if ( strtmp.find( "--inferthreads=" ) == 0 )
+            {
+                string strval = strtmp.substr( 15 );
+                int tmpiv = atoi( strval.c_str() );
+                if ( tmpiv > 0 )
+                {
+                    opt_inferthreads = tmpiv;
+                }
+            }
+            else
+            if ( strtmp.find( "--scheduler=" ) == 0 )
+            {
+                string strval = strtmp.substr( 12 );
+                if ( strval == "openmp" )
+                {
+                    opt_scheduler = 1;
+                }
+                else
+                if ( strval == "serial" )
+                {
+                    opt_scheduler = 2;
+                }
+                else
+                {
+                    opt_scheduler = 0;
+                }
+            }
+            else
+            if ( strtmp.find( "--daemon=" ) == 0 )
+            {
+                opt_daemonsock = strtmp.substr( 9 );
+            }
+            else
+            if ( strtmp.find( "--workers=" ) == 0 )
+            {
+                string strval = strtmp.substr( 10 );
+                int tmpiv = atoi( strval.c_str() );
+                if ( tmpiv > 0 )
+                {
+                    opt_workers = tmpiv;
+                }
+            }
+            else
+            if ( strtmp.find( "--temporal" ) == 0 )
+            {
+                opt_temporal = true;
+            }
+            else
+            if ( strtmp.find( "--tile=" ) == 0 )
+            {
+                string strval = strtmp.substr( 7 );
+                int tmpiv = atoi( strval.c_str() );
+                if ( tmpiv >= 8 )
+                {
+                    opt_tilesize = tmpiv;
+                }
+            }
+            else
+            if ( strtmp.find( "--gray" ) == 0 )
+            {
+                opt_grayscale = true;
+            }
+            else
             if ( strtmp.find( "--noverbose" ) == 0 )
             {
                 opt_verbose = false;
@@ -393,26 +682,38 @@ bool parseArgs( int argc, char** argv )
 
     if (!opt_help)
     {
-        if ( ( file_src.size() > 0 ) && ( file_dst.size() == 0 ) )
+        // JSON owns stdout.
+        if ( opt_json == true )
         {
-            string convname = file_src;
-            string srcext;
+            opt_verbose = false;
+        }
 
-            // changes name without file extention.
-            size_t posdot = file_src.find_last_of( "." );
-            if ( posdot != string::npos )
+        // Y4M is known by extension when not forced by option.
+        if ( ( opt_stream == false ) && ( file_src.size() > 4 ) )
+        {
+            string srcext = file_src.substr( file_src.size() - 4 );
+            if ( ( srcext == ".y4m" ) || ( srcext == ".Y4M" ) )
             {
-                convname = file_src.substr( 0, posdot );
-                srcext   = file_src.substr( posdot );
+                opt_stream = true;
+                opt_y4m    = true;
             }
+        }
 
-            convname += "_resized";
-            if ( srcext.size() > 0 )
-            {
-                convname += srcext;
-            }
+        // Stream from stdin goes to stdout unless named.
+        if ( ( file_src == "-" ) && ( file_dst.size() == 0 ) )
+        {
+            file_dst = file_src;
+        }
+
+        if ( ( opt_batch == true ) || ( opt_daemonsock.size() > 0 ) ||
+             ( opt_autotune == true ) )
+        {
+            return true;
+        }
 
-            file_dst = convname;
+        if ( ( file_src.size() > 0 ) && ( file_dst.size() == 0 ) )
+        {
+            file_dst = makeOutputName( file_src, opt_outdir );
         }
 
         if ( ( file_src.size() > 0 ) && ( file_dst.size() > 0 ) )
@@ -424,277 +725,2270 @@ bool parseArgs( int argc, char** argv )
     return false;
 }
 
-void printTitle()
+void printTitle( FILE* fp = stdout )
 {
-    printf( "%s : Super-Resolution with deep Convolutional Neural Networks\n",
-            file_me.c_str() );
-    printf( "(C)2018..2023 Raphael Kim, (C)2014 Wang Shu., version %s\n",
-            DEF_STR_VERSION );
-    printf( "Built with OpenCV version %s\n", CV_VERSION );
+    fprintf( fp, "%s : Super-Resolution with deep Convolutional Neural Networks\n",
+             file_me.c_str() );
+    fprintf( fp, "(C)2018..2023 Raphael Kim, (C)2014 Wang Shu., version %s\n",
+             DEF_STR_VERSION );
+    fprintf( fp, "Built with OpenCV version %s\n", CV_VERSION );
 }
 
 void printHelp()
 {
     printf( "\n" );
     printf( "    usage : %s (options) [source file name] ([output file name])\n", file_me.c_str() );
+    printf( "            %s (options) --batch=[list file or -]\n", file_me.c_str() );
+    printf( "            %s (options) --batchdir=[directory]\n", file_me.c_str() );
+    printf( "            %s (options) --daemon=[socket path]\n", file_me.c_str() );
     printf( "\n" );
     printf( "    _options_:\n" );
     printf( "\n" );
     printf( "        --scale=( ratio: 0.1 to .. ) : scaling by ratio.\n" );
+    printf( "        --gray                       : process as 8bit grayscale (Y only).\n" );
+    printf( "        --y4m                        : source and output are Y4M streams.\n" );
+    printf( "        --yuv=(width)x(height)       : source and output are raw planar YUV.\n" );
+    printf( "        --yuvfmt=(420|444|mono)      : raw YUV chroma format, default 420.\n" );
+    printf( "        --temporal                   : stream recomputes changed tiles only.\n" );
+    printf( "        --tile=(size: 8 to ..)       : tile size of temporal mode, default 64.\n" );
+    printf( "        --batch=(file|-)             : process image paths listed in file or stdin.\n" );
+    printf( "        --batchdir=(directory)       : process all images in directory.\n" );
+    printf( "        --outdir=(directory)         : output directory, keeps source names.\n" );
+    printf( "        --iothreads=(count)          : batch decoder and encoder threads, default 2.\n" );
+    printf( "        --queue=(count)              : batch images in flight per stage, default 4.\n" );
+    printf( "        --inferthreads=(count)       : batch images processed at once, default 2.\n" );
+    printf( "        --scheduler=(steal|openmp|serial) : layer tile scheduler, default steal.\n" );
+    printf( "        --threads=(count)            : compute threads of SRCNN, OpenMP and OpenCV.\n" );
+    printf( "        --affinity=(compact|cpu list) : pin workers, list as 0-7,16-23.\n" );
+    printf( "        --numa                       : workers and layer planes per NUMA node.\n" );
+    printf( "        --outofcore                  : stream image by strips, PNM, TIFF or raw.\n" );
+    printf( "        --max-memory=(MB)            : memory limit, over it image goes by strips.\n" );
+    printf( "                                       out-of-core budget, default %u.\n", OUTOFCORE_DEFAULT_MEMORY );
+    printf( "        --estimate                   : print memory plan of source and exit.\n" );
+    printf( "        --raw=(w)x(h)x(channels)     : source is raw 8bit rows, out-of-core.\n" );
+    printf( "        --cache=(directory)          : reuse outputs of same source and options.\n" );
+    printf( "        --cachesize=(MB)             : cache size limit, default %u.\n", RESULTCACHE_DEFAULT_SIZE );
+    printf( "        --parallelpng                : PNG output deflated by strips on workers.\n" );
+    printf( "        --pnglevel=(0-9)             : PNG compression level, default fast as OpenCV.\n" );
+    printf( "        --trace=(file.json)          : write stage and tile timeline as Chrome trace.\n" );
+    printf( "        --bench=(runs)               : run pipeline of an image N times, stage latency.\n" );
+    printf( "        --nowrite                    : bench skips writing output.\n" );
+    printf( "        --json                       : bench or estimate report as JSON on stdout.\n" );
+    printf( "        --counters                   : hardware counters per stage, IPC, GFLOP/s.\n" );
+    printf( "        --autotune                   : tune layer kernels for this CPU, save and exit.\n" );
+    printf( "        --tunefile=(file)            : tuning profiles, default ~/.srcnn/tune.conf.\n" );
+    printf( "        --notune                     : ignore tuning profile, built-in defaults.\n" );
+    printf( "        --nojit                      : compiled layer kernels, no generated code.\n" );
+    printf( "        --daemon=(socket path)       : serve requests on Unix domain socket.\n" );
+    printf( "        --workers=(count)            : daemon processing threads, default 1.\n" );
     printf( "        --noverbose                  : turns off all verbose\n" );
     printf( "        --help                       : this help\n" );
     printf( "\n" );
+    printf( "    Streams ( Y4M, YUV ) may use '-' as stdin or stdout.\n" );
+    printf( "    Out-of-core output is PNM, TIFF, PNG, JPEG or raw by extension.\n" );
+    printf( "\n" );
+}
+
+ImageWorkspace::ImageWorkspace()
+ : ctx( srcnn_context_create() )
+{
+    srcnn_context_set_executor( ctx, engine_exec );
+    srcnn_context_set( ctx, SRCNN_CTX_NUMA, opt_numa ? 1 : 0 );
+}
+
+ImageWorkspace::~ImageWorkspace()
+{
+    srcnn_context_destroy( ctx );
+}
+
+// Mat over 8bit tensor of graph, no copy.
+static Mat tensorMat( const SRCNNTensorView& tv )
+{
+    return Mat( tv.height, tv.width, CV_8UC( tv.channels ), tv.data, tv.stride );
+}
+
+// OpenCV may give output Mat a buffer of its own, result goes back to tensor.
+static bool tensorKeep( const Mat& res, const SRCNNTensorView& tv )
+{
+    Mat dst = tensorMat( tv );
+
+    if ( ( res.empty() == true ) || ( res.size() != dst.size() ) || ( res.type() != dst.type() ) )
+        return false;
+
+    if ( res.data != dst.data )
+    {
+        res.copyTo( dst );
+    }
+
+    return true;
+}
+
+// Graph nodes of OpenCV calls.
+static int nodeToYCrCb( void* /* user */, const SRCNNTensorView* in, unsigned /* nin */,
+                        const SRCNNTensorView* out, unsigned /* nout */ )
+{
+    ProfScope prof( "convert" );
+
+    Mat res = tensorMat( out[0] );
+    cvtColor( tensorMat( in[0] ), res, CV_BGR2YCrCb );
+
+    return tensorKeep( res, out[0] ) == true ? 0 : -2;
+}
+
+static int nodeSplit( void* /* user */, const SRCNNTensorView* in, unsigned /* nin */,
+                      const SRCNNTensorView* out, unsigned nout )
+{
+    ProfScope prof( "convert" );
+
+    vector<Mat> res( nout );
+
+    for ( unsigned cnt = 0; cnt < nout; cnt++ )
+    {
+        res[cnt] = tensorMat( out[cnt] );
+    }
+
+    split( tensorMat( in[0] ), res );
+
+    for ( unsigned cnt = 0; cnt < nout; cnt++ )
+    {
+        if ( tensorKeep( res[cnt], out[cnt] ) == false )
+            return -3;
+    }
+
+    return 0;
+}
+
+static int nodeResize( void* /* user */, const SRCNNTensorView* in, unsigned /* nin */,
+                       const SRCNNTensorView* out, unsigned /* nout */ )
+{
+    ProfScope prof( "resize" );
+
+    Mat res = tensorMat( out[0] );
+    resize( tensorMat( in[0] ), res, res.size(), 0, 0, CV_INTER_CUBIC );
+
+    return tensorKeep( res, out[0] ) == true ? 0 : -2;
+}
+
+static int nodeMerge( void* /* user */, const SRCNNTensorView* in, unsigned nin,
+                      const SRCNNTensorView* out, unsigned /* nout */ )
+{
+    ProfScope prof( "merge" );
+
+    vector<Mat> chs( nin );
+
+    for ( unsigned cnt = 0; cnt < nin; cnt++ )
+    {
+        chs[cnt] = tensorMat( in[cnt] );
+    }
+
+    Mat res = tensorMat( out[0] );
+    merge( chs, res );
+
+    return tensorKeep( res, out[0] ) == true ? 0 : -10;
+}
+
+static int nodeToBGR( void* /* user */, const SRCNNTensorView* in, unsigned /* nin */,
+                      const SRCNNTensorView* out, unsigned /* nout */ )
+{
+    ProfScope prof( "merge" );
+
+    Mat res = tensorMat( out[0] );
+    cvtColor( tensorMat( in[0] ), res, CV_YCrCb2BGR );
+
+    return tensorKeep( res, out[0] ) == true ? 0 : -10;
+}
+
+/***
+ * FuncName : buildImageGraph
+ * Function : graph of processImage(), OpenCV colour and resize nodes
+ *            around SRCNN model
+ * Parameter    : g - empty graph
+ *        src - source pixels, sw x sh gray or BGR(A), step bytes per row
+ *        dst - output pixels, dw x dh gray or BGR, dstep bytes per row
+ *        src and dst may be NULL to plan only
+ * Output   : <void>
+***/
+static void buildImageGraph( SRCNNGraph& g,
+                             uchar* src, unsigned sw, unsigned sh, unsigned channels, size_t step,
+                             uchar* dst, unsigned dw, unsigned dh, size_t dstep )
+{
+    int ts = g.external( src, sw, sh, channels, step );
+    int td = g.external( dst, dw, dh, channels == 1 ? 1 : 3, dstep );
+
+    if ( channels == 1 )
+    {
+        /* Gray image is already Y channel, resize it into output, then
+           layers run in place */
+        g.custom( "resize", nodeResize, NULL, &ts, 1, &td, 1 );
+        g.model( *SRCNNBuiltinModel(), td, td );
+
+        return;
+    }
+
+    int ycrcb = g.tensor( sw, sh, 3, SRCNN_TENSOR_U8, false );
+    int merged = g.tensor( dw, dh, 3, SRCNN_TENSOR_U8, false );
+    int chs[3];
+    int resized[3];
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        chs[i]     = g.tensor( sw, sh, 1, SRCNN_TENSOR_U8 );
+        resized[i] = g.tensor( dw, dh, 1, SRCNN_TENSOR_U8 );
+    }
+
+    /* BGR to YCrCb, then split channels */
+    g.custom( "convert", nodeToYCrCb, NULL, &ts, 1, &ycrcb, 1 );
+    g.custom( "split", nodeSplit, NULL, &ycrcb, 1, chs, 3 );
+
+    /* Resize the Y-Cr-Cb Channel with Bicubic Interpolation,
+       one at a time as OpenCV runs each in its own threads */
+    for ( int i = 0; i < 3; i++ )
+    {
+        g.custom( "resize", nodeResize, NULL, &chs[i], 1, &resized[i], 1 );
+    }
+
+    /* Convolutional layers on Y, in place */
+    g.model( *SRCNNBuiltinModel(), resized[0], resized[0] );
+
+    /* Merge the Y-Cr-Cb Channel into an image, back to BGR */
+    g.custom( "merge", nodeMerge, NULL, resized, 3, &merged, 1 );
+    g.custom( "convert", nodeToBGR, NULL, &merged, 1, &td, 1 );
+}
+
+// Output size is source size times ratio truncated, as processImage().
+static bool outputFits( const Size& sz, float mulf )
+{
+    int w = sz.width;
+    int h = sz.height;
+
+    w *= mulf;
+    h *= mulf;
+
+    return ( w > 0 ) && ( h > 0 );
+}
+
+/***
+ * FuncName : processImage
+ * Function : SRCNN resize an image, gray or BGR
+ * Parameter    : pImgOrigin - source image, 1 or 3 channels
+ *        pImgOut - output image, same channels to source,
+ *                  written in place when already allocated in size
+ *        mulf - scale multiply ratio
+ *        verbose - print each steps
+ *        ws - buffers kept from previous call, NULL for temporary
+ * Output   : int 0 for done / negative for failed
+***/
+int processImage( Mat& pImgOrigin, Mat& pImgOut, float mulf, bool verbose, ImageWorkspace* ws )
+{
+    bool is_gray = ( pImgOrigin.channels() == 1 );
+
+    ImageWorkspace wstmp;
+
+    if ( ws == NULL )
+    {
+        ws = &wstmp;
+    }
+
+    Size newsz = pImgOrigin.size();
+    newsz.width  *= mulf;
+    newsz.height *= mulf;
+
+    if ( ( pImgOrigin.empty() == true ) || ( newsz.width <= 0 ) || ( newsz.height <= 0 ) )
+        return -2;
+
+    pImgOut.create( newsz, is_gray == true ? CV_8U : CV_8UC3 );
+
+    SRCNNGraph     graph;
+    SRCNNGraphPlan gplan;
+
+    buildImageGraph( graph, pImgOrigin.data, pImgOrigin.cols, pImgOrigin.rows,
+                     pImgOrigin.channels(), pImgOrigin.step,
+                     pImgOut.data, pImgOut.cols, pImgOut.rows, pImgOut.step );
+
+    if ( graph.plan( &gplan ) == false )
+        return -2;
+
+    if ( verbose == true )
+    {
+        printf( "- Processing graph of %u nodes, %u fused, %.1f MB ( %.1f MB without reuse ) ... ",
+                gplan.nodes, gplan.fusions,
+                (double)gplan.arena / 1048576.0, (double)gplan.unshared / 1048576.0 );
+        fflush( stdout );
+    }
+
+    int greti = SRCNNGraphRun( ws->ctx, graph );
+
+    if ( greti != SRCNN_OK )
+    {
+        if ( verbose == true )
+        {
+            printf( "Failure.\n" );
+        }
+
+        return greti < 0 ? greti : -2;
+    }
+
+    ProfAddPixels( (uint64_t)pImgOut.cols * pImgOut.rows );
+
+    if ( verbose == true )
+    {
+        printf( "Ok.\n" );
+        fflush( stdout );
+    }
+
+    return 0;
+}
+
+// Whole file, read once for cache key and decoder.
+static bool readSource( const string& path, vector<uchar>& bytes )
+{
+    bytes.clear();
+
+    FILE* fp = fopen( path.c_str(), "rb" );
+
+    if ( fp == NULL )
+        return false;
+
+    bool retb = false;
+
+    if ( ( fseeko( fp, 0, SEEK_END ) == 0 ) )
+    {
+        off_t fsz = ftello( fp );
+
+        if ( ( fsz > 0 ) && ( fseeko( fp, 0, SEEK_SET ) == 0 ) )
+        {
+            bytes.resize( (size_t)fsz );
+            retb = ( fread( bytes.data(), 1, bytes.size(), fp ) == bytes.size() );
+        }
+    }
+
+    fclose( fp );
+
+    if ( retb == false )
+        bytes.clear();
+
+    return retb;
+}
+
+// Grayscale sources are kept as single channel ( ANYCOLOR ),
+// then never need to be expanded to BGR and converted back.
+static Mat decodeSource( const string& path, const vector<uchar>& bytes )
+{
+    int flags = opt_grayscale == true ? IMREAD_GRAYSCALE : IMREAD_ANYCOLOR;
+
+    if ( bytes.size() > 0 )
+        return imdecode( bytes, flags );
+
+    return imread( path.c_str(), flags );
+}
+
+/***
+ * FuncName : cacheKey
+ * Function : reads source and makes result cache key of its bytes and
+ *            everything changing output bytes. Kernel configs ( JIT,
+ *            tuning, threads, NUMA ) are bit exact, so precision is fp32.
+ * Parameter    : src, dst - paths, output format follows dst extension
+ *        bytes - source file, decoded from it on miss
+ *        key - result
+ * Output   : bool, false when cache is off or source is not readable
+***/
+static bool cacheKey( const string& src, const string& dst,
+                      vector<uchar>& bytes, ResultCacheKey& key )
+{
+    if ( ( result_cache == NULL ) || ( src == "-" ) || ( dst == "-" ) )
+        return false;
+
+    if ( readSource( src, bytes ) == false )
+        return false;
+
+    size_t posdot = dst.find_last_of( "./" );
+    string ext    = ( posdot != string::npos ) && ( dst[posdot] == '.' ) ? dst.substr( posdot ) : "";
+
+    for ( size_t cnt = 0; cnt < ext.size(); cnt++ )
+    {
+        ext[cnt] = tolower( ext[cnt] );
+    }
+
+    char params[512] = {0};
+    snprintf( params, sizeof( params ),
+              "srcnn-cache-v1;%s;model=%s;precision=fp32;scale=%.6f;gray=%d;ext=%s;pnglevel=%d;parallelpng=%d",
+              DEF_STR_VERSION, SRCNNBuiltinModel()->name, image_multiply,
+              opt_grayscale ? 1 : 0, ext.c_str(), opt_pnglevel, opt_parallelpng ? 1 : 0 );
+
+    ResultCache::keyOfBuffer( bytes.data(), bytes.size(), params, key );
+
+    return true;
 }
 
 void* pthreadcall( void* p )
 {
-     if ( opt_verbose == true )
+    ProfThreadName( "pipeline" );
+
+     if ( opt_verbose == true )
+    {
+        printTitle();
+        printf( "\n" );
+        printf( "- Scale multiply ratio : %.2f\n", image_multiply );
+        fflush( stdout );
+    }
+
+    ResultCacheKey ckey;
+    vector<uchar>  srcbytes;
+    bool           ckeyed = ( admit_source.empty() == true ) &&
+                            ( cacheKey( file_src, file_dst, srcbytes, ckey ) == true );
+
+    if ( ( ckeyed == true ) && ( result_cache->fetch( ckey, file_dst.c_str() ) == true ) )
+    {
+        if ( opt_verbose == true )
+        {
+            printf( "- Cache hit %s : %s -> %s\n", ckey.hex, file_src.c_str(), file_dst.c_str() );
+        }
+
+        fflush( stdout );
+
+        t_exit_code = 0;
+        pthread_exit( NULL );
+    }
+
+    /* Read the original image */
+    Mat       pImgOrigin;
+    ProfScope prof_decode( "decode" );
+
+    if ( admit_source.empty() == false )
+    {
+        pImgOrigin = admit_source;
+        admit_source.release();
+    }
+    else
+    {
+        pImgOrigin = decodeSource( file_src, srcbytes );
+        vector<uchar>().swap( srcbytes );
+    }
+
+    prof_decode.end();
+
+    if ( pImgOrigin.empty() == false )
+    {
+        if ( opt_verbose == true )
+        {
+            printf( "- Image load : %s\n", file_src.c_str() );
+            fflush( stdout );
+        }
+    }
+    else
+    {
+        if ( opt_verbose == true )
+        {
+            printf( "- load failure : %s\n", file_src.c_str() );
+        }
+
+        t_exit_code = -1;
+        pthread_exit( &t_exit_code );
+    }
+
+    bool is_gray = ( pImgOrigin.channels() == 1 );
+
+    if ( opt_verbose == true )
+    {
+        if ( is_gray == true )
+        {
+            printf( "- Image type : grayscale, processing Y only.\n" );
+        }
+        else
+        {
+            printf( "- Image type : color.\n" );
+        }
+        fflush( stdout );
+    }
+
+    // Test image resize target ...
+    if ( outputFits( pImgOrigin.size(), image_multiply ) == false )
+    {
+        if ( opt_verbose == true )
+        {
+            printf( "- Image scale error : ratio too small.\n" );
+        }
+
+        t_exit_code = -1;
+        pthread_exit( &t_exit_code );
+    }
+
+    unsigned perf_tick0 = tick::getTickCount();
+
+    Mat pImgOut;
+    int reti = processImage( pImgOrigin, pImgOut, image_multiply, opt_verbose );
+
+    unsigned perf_tick1 = tick::getTickCount();
+
+    if ( reti != 0 )
+    {
+        t_exit_code = reti;
+        pthread_exit( &t_exit_code );
+    }
+
+    if ( opt_verbose == true )
+    {
+        printf( "- Writing result to %s : ", file_dst.c_str() );
+        fflush( stdout );
+    }
+
+    ProfScope prof_encode( "encode" );
+
+    bool written = writeImage( file_dst, pImgOut );
+
+    prof_encode.end();
+
+    if ( ( written == true ) && ( ckeyed == true ) )
+    {
+        result_cache->store( ckey, file_dst.c_str() );
+    }
+
+    if ( opt_verbose == true )
+    {
+        printf( "Ok.\n" );
+        printf( "- Performace : %u ms took.\n", perf_tick1 - perf_tick0 );
+    }
+
+    fflush( stdout );
+
+    t_exit_code = 0;
+    pthread_exit( NULL );
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Bench mode : image loaded once, whole pipeline run many times.
+
+#define BENCH_WARMUP_RUNS   1
+
+// Stage times of timed runs, from profiler events.
+typedef struct
+{
+    vector<uint64_t>            run0;       /// window of each run.
+    vector<uint64_t>            run1;
+    vector<string>              names;      /// stages in order seen.
+    vector< vector<double> >    ms;         /// [stage][run].
+}BenchStages;
+
+static void benchCollect( void* user, const char* name, const char* cat,
+                          uint64_t t0, uint64_t t1, int64_t /* arg */ )
+{
+    BenchStages* bs = (BenchStages*)user;
+
+    if ( strcmp( cat, PROF_CAT_STAGE ) != 0 )
+        return;
+
+    vector<uint64_t>::iterator it = upper_bound( bs->run0.begin(), bs->run0.end(), t0 );
+
+    if ( it == bs->run0.begin() )
+        return;
+
+    size_t run = ( it - bs->run0.begin() ) - 1;
+
+    if ( t1 > bs->run1[run] )
+        return;
+
+    size_t idx = 0;
+
+    for ( ; idx < bs->names.size(); idx++ )
+    {
+        if ( bs->names[idx] == name )
+            break;
+    }
+
+    if ( idx == bs->names.size() )
+    {
+        bs->names.push_back( name );
+        bs->ms.push_back( vector<double>( bs->run0.size(), 0.0 ) );
+    }
+
+    bs->ms[idx][run] += (double)( t1 - t0 ) / 1000000.0;
+}
+
+typedef struct
+{
+    double  min;
+    double  median;
+    double  p99;
+}BenchStat;
+
+static BenchStat benchStat( vector<double> v )
+{
+    BenchStat st = { 0.0, 0.0, 0.0 };
+
+    if ( v.size() == 0 )
+        return st;
+
+    sort( v.begin(), v.end() );
+
+    size_t n   = v.size();
+    size_t p99 = ( n * 99 + 99 ) / 100;     /// nearest rank.
+
+    st.min    = v[0];
+    st.median = ( n % 2 == 1 ) ? v[ n / 2 ] : ( v[ n / 2 - 1 ] + v[ n / 2 ] ) * 0.5;
+    st.p99    = v[ p99 - 1 ];
+
+    return st;
+}
+
+static void jsonString( FILE* fp, const string& str )
+{
+    fputc( '"', fp );
+
+    for ( size_t cnt = 0; cnt < str.size(); cnt++ )
+    {
+        unsigned char ch = str[cnt];
+
+        if ( ( ch == '"' ) || ( ch == '\\' ) )
+        {
+            fprintf( fp, "\\%c", ch );
+        }
+        else
+        if ( ch < 0x20 )
+        {
+            fprintf( fp, "\\u%04x", ch );
+        }
+        else
+        {
+            fputc( ch, fp );
+        }
+    }
+
+    fputc( '"', fp );
+}
+
+static void jsonStat( FILE* fp, const BenchStat& st )
+{
+    fprintf( fp, "\"min_ms\":%.3f,\"median_ms\":%.3f,\"p99_ms\":%.3f",
+             st.min, st.median, st.p99 );
+}
+
+void* pthreadbench( void* p )
+{
+    ProfThreadName( "pipeline" );
+
+    if ( opt_verbose == true )
+    {
+        printTitle();
+        printf( "\n" );
+        printf( "- Scale multiply ratio : %.2f\n", image_multiply );
+        fflush( stdout );
+    }
+
+    Mat      pImgOrigin;
+    uint64_t dec_t0 = ProfNow();
+
+    pImgOrigin = decodeSource( file_src, vector<uchar>() );
+
+    double dec_ms = (double)( ProfNow() - dec_t0 ) / 1000000.0;
+
+    if ( pImgOrigin.empty() == true )
+    {
+        if ( opt_verbose == true )
+        {
+            printf( "- load failure : %s\n", file_src.c_str() );
+        }
+
+        t_exit_code = -1;
+        pthread_exit( &t_exit_code );
+    }
+
+    if ( opt_verbose == true )
+    {
+        printf( "- Image load : %s\n", file_src.c_str() );
+        printf( "- Bench : %u runs after %u warmup%s\n",
+                opt_bench, BENCH_WARMUP_RUNS,
+                opt_nowrite == true ? ", no writing" : "" );
+        fflush( stdout );
+    }
+
+    ImageWorkspace ws;
+    BenchStages    bs;
+    Mat            pImgOut;
+
+    for ( unsigned cnt = 0; cnt < BENCH_WARMUP_RUNS + opt_bench; cnt++ )
+    {
+        uint64_t t0 = ProfNow();
+
+        int reti = processImage( pImgOrigin, pImgOut, image_multiply, false, &ws );
+
+        if ( reti != 0 )
+        {
+            if ( opt_verbose == true )
+            {
+                printf( "- Processing failure : %d\n", reti );
+            }
+
+            t_exit_code = reti;
+            pthread_exit( &t_exit_code );
+        }
+
+        if ( opt_nowrite == false )
+        {
+            ProfScope prof_encode( "encode" );
+
+            if ( writeImage( file_dst, pImgOut ) == false )
+            {
+                if ( opt_verbose == true )
+                {
+                    printf( "- Write failure : %s\n", file_dst.c_str() );
+                }
+
+                t_exit_code = -10;
+                pthread_exit( &t_exit_code );
+            }
+        }
+
+        if ( cnt >= BENCH_WARMUP_RUNS )
+        {
+            bs.run0.push_back( t0 );
+            bs.run1.push_back( ProfNow() );
+        }
+    }
+
+    // workers are idle, their events are complete.
+    ProfForEach( benchCollect, &bs );
+
+    vector<double> total;
+
+    for ( size_t cnt = 0; cnt < bs.run0.size(); cnt++ )
+    {
+        total.push_back( (double)( bs.run1[cnt] - bs.run0[cnt] ) / 1000000.0 );
+    }
+
+    BenchStat tst  = benchStat( total );
+    double    opx  = (double)pImgOut.cols * pImgOut.rows;
+    double    mps  = tst.median > 0.0 ? opx / ( tst.median * 1000.0 ) : 0.0;
+    long      rss  = 0;     /// KB.
+
+    struct rusage ru;
+
+    if ( getrusage( RUSAGE_SELF, &ru ) == 0 )
+    {
+#ifdef __APPLE__
+        rss = ru.ru_maxrss / 1024;
+#else
+        rss = ru.ru_maxrss;
+#endif
+    }
+
+    if ( opt_json == true )
+    {
+        printf( "{\"source\":" );
+        jsonString( stdout, file_src );
+        printf( ",\"width\":%d,\"height\":%d,\"channels\":%d,\"scale\":%.4f,"
+                "\"out_width\":%d,\"out_height\":%d,",
+                pImgOrigin.cols, pImgOrigin.rows, pImgOrigin.channels(), image_multiply,
+                pImgOut.cols, pImgOut.rows );
+        printf( "\"runs\":%u,\"warmup\":%u,\"write\":%s,\"decode_ms\":%.3f,\"stages\":[",
+                opt_bench, BENCH_WARMUP_RUNS, opt_nowrite == true ? "false" : "true", dec_ms );
+
+        for ( size_t cnt = 0; cnt < bs.names.size(); cnt++ )
+        {
+            printf( "%s{\"name\":", cnt > 0 ? "," : "" );
+            jsonString( stdout, bs.names[cnt] );
+            printf( "," );
+            jsonStat( stdout, benchStat( bs.ms[cnt] ) );
+            printf( "}" );
+        }
+
+        printf( "],\"total\":{" );
+        jsonStat( stdout, tst );
+        printf( "},\"mpixels_per_sec\":%.3f,\"peak_rss_kb\":%ld}\n", mps, rss );
+    }
+    else
+    {
+        printf( "- Image : %d x %d -> %d x %d, decode %.3f ms\n",
+                pImgOrigin.cols, pImgOrigin.rows, pImgOut.cols, pImgOut.rows, dec_ms );
+        printf( "    %-18s %10s %10s %10s\n", "stage", "min ms", "median ms", "p99 ms" );
+
+        for ( size_t cnt = 0; cnt < bs.names.size(); cnt++ )
+        {
+            BenchStat st = benchStat( bs.ms[cnt] );
+
+            printf( "    %-18s %10.3f %10.3f %10.3f\n",
+                    bs.names[cnt].c_str(), st.min, st.median, st.p99 );
+        }
+
+        printf( "    %-18s %10.3f %10.3f %10.3f\n", "total", tst.min, tst.median, tst.p99 );
+        printf( "- Throughput : %.3f MP/s of output at median\n", mps );
+        printf( "- Peak RSS : %ld KB\n", rss );
+    }
+
+    fflush( stdout );
+
+    t_exit_code = 0;
+    pthread_exit( NULL );
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Temporal dirty-region recomputation for streams.
+
+// Output pixel depends on upscaled Y around by 4 ( 9x9 ) + 2 ( 5x5 ).
+#define SRCNN_HALO_DST      6
+// Layer III reads layer II around by 2 ( 5x5 ).
+#define SRCNN_HALO_CONV3    2
+// Bicubic reads source -1 .. +2 around, plus one for rounding.
+#define BICUBIC_HALO_SRC    3
+
+typedef struct
+{
+    Rect    dst;        /// output tile.
+    Rect    src;        /// source region affecting output tile, with halo.
+    Rect    conv2;      /// layer II region to be computed in this frame.
+    bool    dirty;
+}DirtyTile;
+
+static void sourceRange( int d0, int d1, int srcn, int dstn, int& s0, int& s1 )
+{
+    double ratio = (double)srcn / (double)dstn;
+    int    dh0   = MAX( d0 - SRCNN_HALO_DST, 0 );
+    int    dh1   = MIN( d1 + SRCNN_HALO_DST, dstn );
+
+    s0 = (int)floor( ( (double)dh0 + 0.5 ) * ratio - 0.5 ) - BICUBIC_HALO_SRC;
+    s1 = (int)floor( ( (double)dh1 - 0.5 ) * ratio - 0.5 ) + BICUBIC_HALO_SRC + 1;
+    s0 = MAX( s0, 0 );
+    s1 = MIN( s1, srcn );
+}
+
+static void buildDirtyTiles( Size srcsz, Size dstsz, int tilesz,
+                             vector<DirtyTile>& tiles, int& tiles_x, int& tiles_y )
+{
+    tiles_x = ( dstsz.width + tilesz - 1 ) / tilesz;
+    tiles_y = ( dstsz.height + tilesz - 1 ) / tilesz;
+
+    tiles.resize( tiles_x * tiles_y );
+
+    for ( int ty = 0; ty < tiles_y; ty++ )
+    {
+        for ( int tx = 0; tx < tiles_x; tx++ )
+        {
+            DirtyTile& tile = tiles[ ty * tiles_x + tx ];
+
+            tile.dst.x      = tx * tilesz;
+            tile.dst.y      = ty * tilesz;
+            tile.dst.width  = MIN( tilesz, dstsz.width - tile.dst.x );
+            tile.dst.height = MIN( tilesz, dstsz.height - tile.dst.y );
+
+            int sx0 = 0;
+            int sx1 = 0;
+            int sy0 = 0;
+            int sy1 = 0;
+
+            sourceRange( tile.dst.x, tile.dst.x + tile.dst.width,
+                         srcsz.width, dstsz.width, sx0, sx1 );
+            sourceRange( tile.dst.y, tile.dst.y + tile.dst.height,
+                         srcsz.height, dstsz.height, sy0, sy1 );
+
+            tile.src   = Rect( sx0, sy0, sx1 - sx0, sy1 - sy0 );
+            tile.conv2 = Rect();
+            tile.dirty = true;
+        }
+    }
+}
+
+static bool regionChanged( const Mat& cur, const Mat& prev, const Rect& r )
+{
+    for ( int row = r.y; row < r.y + r.height; row++ )
+    {
+        if ( memcmp( cur.ptr( row ) + r.x, prev.ptr( row ) + r.x, r.width ) != 0 )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+typedef struct
+{
+    DirtyTile*  tiles;
+    const Mat*  cur;
+    const Mat*  prev;
+    bool        first;
+}DirtyArgs;
+
+static void markDirtyTiles( void* arg, size_t begin, size_t end )
+{
+    const DirtyArgs* da = (const DirtyArgs*)arg;
+
+    for ( size_t cnt = begin; cnt < end; cnt++ )
+    {
+        DirtyTile& tile = da->tiles[cnt];
+        tile.dirty = da->first || regionChanged( *da->cur, *da->prev, tile.src );
+    }
+}
+
+/***
+ * FuncName : processLumaTemporal
+ * Function : SRCNN luma of a frame, recomputing only changed tiles
+ * Parameter    : pY, pPrevY - current and previous source luma
+ *        first - no previous frame, every tile is dirty
+ *        pImgY - bicubic upscaled luma
+ *        pImgConv2 - layer II data, kept from previous frame
+ *        pOutY - output luma, kept from previous frame
+ *        tiles - output tiles built by buildDirtyTiles()
+ * Output   : unsigned, count of reused tiles
+***/
+static unsigned processLumaTemporal( Mat& pY, Mat& pPrevY, bool first,
+                                     Mat& pImgY, vector<Mat>& pImgConv2, Mat& pOutY,
+                                     vector<DirtyTile>& tiles, int tiles_x, int tiles_y )
+{
+    resize( pY, pImgY, pImgY.size(), 0, 0, CV_INTER_CUBIC );
+
+    int tcnt     = (int)tiles.size();
+    int dirtycnt = 0;
+
+    DirtyArgs da = { tiles.data(), &pY, &pPrevY, first };
+
+    engine_exec->parallel_for( engine_exec->user, tcnt, 4, markDirtyTiles, &da );
+
+    for ( int cnt = 0; cnt < tcnt; cnt++ )
+    {
+        if ( tiles[cnt].dirty == true )
+        {
+            dirtycnt++;
+        }
+    }
+
+    if ( dirtycnt == tcnt )
+    {
+        Convolution99x11( pImgY, pImgConv2 );
+        Convolution55( pImgConv2, pOutY );
+
+        return 0;
+    }
+
+    if ( dirtycnt == 0 )
+    {
+        return tcnt;
+    }
+
+    // Layer II of each tile is needed where dirty neighbours reach,
+    // tiles never overlap so each layer II pixel is computed once.
+    for ( int ty = 0; ty < tiles_y; ty++ )
+    {
+        for ( int tx = 0; tx < tiles_x; tx++ )
+        {
+            DirtyTile& tile = tiles[ ty * tiles_x + tx ];
+            Rect       need;
+            bool       needed = false;
+
+            for ( int ny = MAX( ty - 1, 0 ); ny <= MIN( ty + 1, tiles_y - 1 ); ny++ )
+            {
+                for ( int nx = MAX( tx - 1, 0 ); nx <= MIN( tx + 1, tiles_x - 1 ); nx++ )
+                {
+                    const DirtyTile& ntile = tiles[ ny * tiles_x + nx ];
+
+                    if ( ntile.dirty == false )
+                        continue;
+
+                    Rect grown( ntile.dst.x - SRCNN_HALO_CONV3,
+                                ntile.dst.y - SRCNN_HALO_CONV3,
+                                ntile.dst.width + SRCNN_HALO_CONV3 * 2,
+                                ntile.dst.height + SRCNN_HALO_CONV3 * 2 );
+
+                    grown &= tile.dst;
+
+                    if ( grown.area() > 0 )
+                    {
+                        need   = needed ? ( need | grown ) : grown;
+                        needed = true;
+                    }
+                }
+            }
+
+            tile.conv2 = needed ? need : Rect();
+        }
+    }
+
+    for ( int cnt = 0; cnt < tcnt; cnt++ )
+    {
+        if ( tiles[cnt].conv2.area() > 0 )
+        {
+            Convolution99x11( pImgY, pImgConv2, &tiles[cnt].conv2 );
+        }
+    }
+
+    for ( int cnt = 0; cnt < tcnt; cnt++ )
+    {
+        if ( tiles[cnt].dirty == true )
+        {
+            Convolution55( pImgConv2, pOutY, &tiles[cnt].dst );
+        }
+    }
+
+    return tcnt - dirtycnt;
+}
+
+void* pthreadvideo( void* p )
+{
+    ProfThreadName( "pipeline" );
+
+    // stdout may carry frames, all messages go to stderr.
+    if ( opt_verbose == true )
+    {
+        printTitle( stderr );
+        fprintf( stderr, "\n" );
+        fprintf( stderr, "- Scale multiply ratio : %.2f\n", image_multiply );
+    }
+
+    YUVStream yuvin;
+    YUVStream yuvout;
+
+    if ( yuvin.openRead( file_src.c_str(), opt_y4m, &yuv_rawinfo ) == false )
+    {
+        if ( opt_verbose == true )
+        {
+            fprintf( stderr, "- stream open failure : %s\n", file_src.c_str() );
+        }
+
+        t_exit_code = -1;
+        pthread_exit( &t_exit_code );
+    }
+
+    YUVStreamInfo ininfo  = yuvin.info();
+    YUVStreamInfo outinfo = ininfo;
+
+    outinfo.width  = (unsigned)( (float)ininfo.width * image_multiply );
+    outinfo.height = (unsigned)( (float)ininfo.height * image_multiply );
+
+    if ( ( outinfo.width == 0 ) || ( outinfo.height == 0 ) )
+    {
+        if ( opt_verbose == true )
+        {
+            fprintf( stderr, "- Image scale error : ratio too small.\n" );
+        }
+
+        t_exit_code = -1;
+        pthread_exit( &t_exit_code );
+    }
+
+    if ( yuvout.openWrite( file_dst.c_str(), opt_y4m, outinfo ) == false )
+    {
+        if ( opt_verbose == true )
+        {
+            fprintf( stderr, "- stream open failure : %s\n", file_dst.c_str() );
+        }
+
+        t_exit_code = -10;
+        pthread_exit( &t_exit_code );
+    }
+
+    if ( opt_verbose == true )
+    {
+        fprintf( stderr, "- Stream : %u x %u -> %u x %u, %s\n",
+                 ininfo.width, ininfo.height,
+                 outinfo.width, outinfo.height,
+                 ininfo.chroma == YUVSTREAM_CHROMA_444 ? "4:4:4" :
+                 ininfo.chroma == YUVSTREAM_CHROMA_420 ? "4:2:0" : "mono" );
+    }
+
+    /* All frame buffers are allocated once and reused for every frame */
+    unsigned    pcnt = YUVStream::planeCount( ininfo );
+    vector<Mat> pFrameIn(3);
+    vector<Mat> pFrameOut(3);
+
+    for ( unsigned cnt=0; cnt<pcnt; cnt++ )
+    {
+        pFrameIn[cnt].create( YUVStream::planeHeight( ininfo, cnt ),
+                              YUVStream::planeWidth( ininfo, cnt ),
+                              CV_8U );
+        pFrameOut[cnt].create( YUVStream::planeHeight( outinfo, cnt ),
+                               YUVStream::planeWidth( outinfo, cnt ),
+                               CV_8U );
+    }
+
+    Mat pImgY;
+    pImgY.create( outinfo.height, outinfo.width, CV_8U );
+
+    vector<Mat> pImgConv2(SRCNN_KERNEL_PLANES);
+    for ( unsigned cnt=0; cnt<SRCNN_KERNEL_PLANES; cnt++)
+    {
+        pImgConv2[cnt].create( pImgY.size(), CV_32F );
+    }
+
+    /* Temporal mode keeps previous source luma to find changed tiles */
+    Mat               pPrevY;
+    vector<DirtyTile> tiles;
+    int               tiles_x     = 0;
+    int               tiles_y     = 0;
+    unsigned          reused_all  = 0;
+    unsigned          tiles_all   = 0;
+
+    if ( opt_temporal == true )
+    {
+        pPrevY.create( pFrameIn[0].size(), CV_8U );
+        buildDirtyTiles( pFrameIn[0].size(), pImgY.size(), opt_tilesize,
+                         tiles, tiles_x, tiles_y );
+    }
+
+    unsigned perf_tick0 = tick::getTickCount();
+    uint64_t prof_t0    = ProfEnabled() == true ? ProfNow() : 0;
+
+    while( yuvin.readFrame( pFrameIn[0].data,
+                            pcnt > 1 ? pFrameIn[1].data : NULL,
+                            pcnt > 1 ? pFrameIn[2].data : NULL ) == true )
+    {
+        unsigned reused = 0;
+
+        // frame read is in loop condition, so recorded by hand.
+        if ( prof_t0 != 0 )
+        {
+            ProfRecord( "decode", PROF_CAT_STAGE, prof_t0, ProfNow(), yuvout.frames() );
+        }
+
+        if ( opt_temporal == true )
+        {
+            /* Unchanged tiles keep previous output in place */
+            reused = processLumaTemporal( pFrameIn[0], pPrevY, yuvout.frames() == 0,
+                                          pImgY, pImgConv2, pFrameOut[0],
+                                          tiles, tiles_x, tiles_y );
+
+            // current source becomes previous, next frame reads into old one.
+            std::swap( pFrameIn[0], pPrevY );
+
+            reused_all += reused;
+            tiles_all  += tiles.size();
+        }
+        else
+        {
+            /* Luma goes bicubic, then SRCNN layers into output plane */
+            resize( pFrameIn[0], pImgY, pImgY.size(), 0, 0, CV_INTER_CUBIC );
+
+            Convolution99x11( pImgY, pImgConv2 );
+            Convolution55( pImgConv2, pFrameOut[0] );
+        }
+
+        /* Chroma only needs fast resize */
+        ProfScope prof_chroma( "resize chroma" );
+
+        for ( unsigned cnt=1; cnt<pcnt; cnt++ )
+        {
+            resize( pFrameIn[cnt], pFrameOut[cnt], pFrameOut[cnt].size(), 0, 0, CV_INTER_LINEAR );
+        }
+
+        prof_chroma.end();
+
+        ProfScope prof_encode( "encode", PROF_CAT_STAGE, yuvout.frames() );
+
+        if ( yuvout.writeFrame( pFrameOut[0].data,
+                                pcnt > 1 ? pFrameOut[1].data : NULL,
+                                pcnt > 1 ? pFrameOut[2].data : NULL ) == false )
+        {
+            if ( opt_verbose == true )
+            {
+                fprintf( stderr, "\n- Writing frame failure : %s\n", file_dst.c_str() );
+            }
+
+            t_exit_code = -10;
+            pthread_exit( &t_exit_code );
+        }
+
+        prof_encode.end();
+
+        ProfAddPixels( (uint64_t)pFrameOut[0].cols * pFrameOut[0].rows );
+
+        if ( opt_verbose == true )
+        {
+            if ( opt_temporal == true )
+            {
+                fprintf( stderr, "- Frame %u : %u / %u tiles reused ( %.1f%% )\n",
+                         yuvout.frames(), reused, (unsigned)tiles.size(),
+                         (float)reused * 100.f / (float)tiles.size() );
+            }
+            else
+            {
+                fprintf( stderr, "\r- Frames processed : %u", yuvout.frames() );
+            }
+        }
+
+        prof_t0 = ProfEnabled() == true ? ProfNow() : 0;
+    }
+
+    unsigned perf_tick1 = tick::getTickCount();
+
+    yuvout.close();
+
+    if ( opt_verbose == true )
+    {
+        unsigned perf_ms = perf_tick1 - perf_tick0;
+
+        if ( opt_temporal == false )
+        {
+            fprintf( stderr, "\n" );
+        }
+        else
+        if ( tiles_all > 0 )
+        {
+            fprintf( stderr, "- Tiles reused : %u / %u ( %.1f%% )\n",
+                     reused_all, tiles_all,
+                     (float)reused_all * 100.f / (float)tiles_all );
+        }
+
+        fprintf( stderr, "- Performace : %u frames, %u ms took", yuvout.frames(), perf_ms );
+        if ( perf_ms > 0 )
+        {
+            fprintf( stderr, " ( %.2f fps )", (float)yuvout.frames() * 1000.f / (float)perf_ms );
+        }
+        fprintf( stderr, ".\n" );
+    }
+
+    t_exit_code = 0;
+    pthread_exit( NULL );
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Batch mode : decode -> infer -> encode stages with bounded queues.
+
+#define BATCH_ELOAD         -1
+#define BATCH_EPROCESS      -2
+#define BATCH_ESCALE        -3      /// output would be empty.
+#define BATCH_EOUTPUT       -4      /// output name taken by earlier source.
+#define BATCH_EWRITE        -10
+
+typedef struct
+{
+    unsigned    index;
+    string      src;
+    string      dst;
+    Mat         img;
+    int         result;         /// 0 or BATCH_E*, processImage() codes.
+    bool        keyed;          /// key is valid, store after encode.
+    bool        cached;         /// output copied from cache, no stages.
+    ResultCacheKey key;
+}BatchJob;
+
+class BatchContext
+{
+    public:
+        BatchContext( size_t depth )
+         : decoded( depth ),
+           processed( depth ),
+           listfp( NULL ),
+           listowned( false ),
+           pathque( 0 ),
+           index( 0 ),
+           decoders( 0 ),
+           inferers( 0 ),
+           done_ok( 0 ),
+           done_fail( 0 )
+        {
+            pthread_mutex_init( &lock, NULL );
+        }
+
+        ~BatchContext()
+        {
+            if ( ( listfp != NULL ) && ( listowned == true ) )
+            {
+                fclose( listfp );
+            }
+
+            pthread_mutex_destroy( &lock );
+        }
+
+    public:
+        // List file and stdin are read line by line while decoding.
+        // Same names of different directories meet in --outdir, first
+        // source in order keeps output, later ones get unique false.
+        bool next( string& path, unsigned& idx, string& dst, bool& unique )
+        {
+            bool retb = false;
+
+            pthread_mutex_lock( &lock );
+
+            if ( listfp != NULL )
+            {
+                char line[4096] = {0};
+
+                while( fgets( line, sizeof( line ), listfp ) != NULL )
+                {
+                    string strline = line;
+                    size_t pos0    = strline.find_first_not_of( " \t\r\n" );
+                    size_t pos1    = strline.find_last_not_of( " \t\r\n" );
+
+                    if ( ( pos0 == string::npos ) || ( strline[pos0] == '#' ) )
+                        continue;
+
+                    path = strline.substr( pos0, pos1 - pos0 + 1 );
+                    retb = true;
+                    break;
+                }
+            }
+            else
+            if ( pathque < paths.size() )
+            {
+                path = paths[ pathque++ ];
+                retb = true;
+            }
+
+            if ( retb == true )
+            {
+                idx    = index++;
+                dst    = makeOutputName( path, opt_outdir );
+                unique = outputs.insert( dst ).second;
+            }
+
+            pthread_mutex_unlock( &lock );
+
+            return retb;
+        }
+
+    public:
+        BoundedQueue<BatchJob>  decoded;
+        BoundedQueue<BatchJob>  processed;
+        pthread_mutex_t         lock;
+        FILE*                   listfp;
+        bool                    listowned;
+        vector<string>          paths;
+        set<string>             outputs;
+        size_t                  pathque;
+        unsigned                index;
+        unsigned                decoders;
+        unsigned                inferers;
+        unsigned                done_ok;
+        unsigned                done_fail;
+};
+
+static bool isImageFileName( const string& name )
+{
+    static const char* exts[] = { ".png", ".jpg", ".jpeg", ".bmp", ".tif", ".tiff",
+                                  ".webp", ".pgm", ".ppm", ".pnm", NULL };
+
+    size_t posdot = name.find_last_of( "." );
+    if ( posdot == string::npos )
+        return false;
+
+    string ext = name.substr( posdot );
+    for ( size_t cnt = 0; cnt < ext.size(); cnt++ )
+    {
+        ext[cnt] = tolower( ext[cnt] );
+    }
+
+    for ( unsigned cnt = 0; exts[cnt] != NULL; cnt++ )
+    {
+        if ( ext == exts[cnt] )
+            return true;
+    }
+
+    return false;
+}
+
+static bool openBatchSource( BatchContext& ctx )
+{
+    if ( opt_batchdir.size() > 0 )
+    {
+        DIR* dir = opendir( opt_batchdir.c_str() );
+        if ( dir == NULL )
+            return false;
+
+        struct dirent* ent = NULL;
+        while( ( ent = readdir( dir ) ) != NULL )
+        {
+            string name = ent->d_name;
+
+            if ( ( name[0] != '.' ) && ( isImageFileName( name ) == true ) )
+            {
+                ctx.paths.push_back( opt_batchdir + "/" + name );
+            }
+        }
+
+        closedir( dir );
+
+        sort( ctx.paths.begin(), ctx.paths.end() );
+
+        return true;
+    }
+
+    if ( opt_batchlist == "-" )
+    {
+        ctx.listfp    = stdin;
+        ctx.listowned = false;
+    }
+    else
+    {
+        ctx.listfp    = fopen( opt_batchlist.c_str(), "r" );
+        ctx.listowned = true;
+    }
+
+    return ( ctx.listfp != NULL );
+}
+
+void* pthreadbatchdecode( void* p )
+{
+    BatchContext* ctx = (BatchContext*)p;
+    BatchJob      job;
+
+    ProfThreadName( "decode" );
+
+    bool          unique = false;
+    vector<uchar> bytes;
+
+    while( ctx->next( job.src, job.index, job.dst, unique ) == true )
+    {
+        ProfScope prof( "decode", PROF_CAT_STAGE, job.index );
+
+        job.keyed  = false;
+        job.cached = false;
+
+        if ( unique == false )
+        {
+            job.result = BATCH_EOUTPUT;
+        }
+        else
+        {
+            job.keyed  = cacheKey( job.src, job.dst, bytes, job.key );
+            job.cached = ( job.keyed == true ) &&
+                         ( result_cache->fetch( job.key, job.dst.c_str() ) == true );
+            job.result = 0;
+        }
+
+        if ( ( job.result == 0 ) && ( job.cached == false ) )
+        {
+            try
+            {
+                job.img = decodeSource( job.src, bytes );
+            }
+            catch( ... )
+            {
+                job.img.release();
+            }
+
+            if ( job.img.empty() == true )
+            {
+                job.result = BATCH_ELOAD;
+            }
+            else
+            if ( outputFits( job.img.size(), image_multiply ) == false )
+            {
+                job.result = BATCH_ESCALE;
+                job.img.release();
+            }
+        }
+
+        prof.end();
+
+        if ( ctx->decoded.push( job ) == false )
+            break;
+
+        job.img.release();
+    }
+
+    // last decoder tells infer stage no more jobs.
+    pthread_mutex_lock( &ctx->lock );
+    ctx->decoders--;
+    if ( ctx->decoders == 0 )
+    {
+        ctx->decoded.close();
+    }
+    pthread_mutex_unlock( &ctx->lock );
+
+    return NULL;
+}
+
+void* pthreadbatchencode( void* p )
+{
+    BatchContext* ctx = (BatchContext*)p;
+    BatchJob      job;
+
+    ProfThreadName( "encode" );
+
+    while( ctx->processed.pop( job ) == true )
+    {
+        ProfScope prof( "encode", PROF_CAT_STAGE, job.index );
+
+        if ( ( job.result == 0 ) && ( job.cached == false ) )
+        {
+            try
+            {
+                if ( writeImage( job.dst, job.img ) == false )
+                {
+                    job.result = BATCH_EWRITE;
+                }
+            }
+            catch( ... )
+            {
+                job.result = BATCH_EWRITE;
+            }
+
+            if ( ( job.result == 0 ) && ( job.keyed == true ) )
+            {
+                result_cache->store( job.key, job.dst.c_str() );
+            }
+        }
+
+        job.img.release();
+        prof.end();
+
+        pthread_mutex_lock( &ctx->lock );
+
+        if ( job.result == 0 )
+        {
+            ctx->done_ok++;
+        }
+        else
+        {
+            ctx->done_fail++;
+        }
+
+        if ( opt_verbose == true )
+        {
+            if ( job.result == 0 )
+            {
+                printf( "- [%u] %s -> %s : %s.\n",
+                        job.index, job.src.c_str(), job.dst.c_str(),
+                        job.cached == true ? "Cached" : "Ok" );
+            }
+            else
+            {
+                printf( "- [%u] %s : Failure ( %d%s ).\n",
+                        job.index, job.src.c_str(), job.result,
+                        job.result == BATCH_ESCALE  ? ", ratio too small" :
+                        job.result == BATCH_EOUTPUT ? ", output name used by other source" : "" );
+            }
+            fflush( stdout );
+        }
+
+        pthread_mutex_unlock( &ctx->lock );
+    }
+
+    return NULL;
+}
+
+/* Infer stage, images of threads share tile scheduler */
+void* pthreadbatchinfer( void* p )
+{
+    BatchContext*  ctx = (BatchContext*)p;
+    BatchJob       job;
+    ImageWorkspace ws;
+
+    ProfThreadName( "infer" );
+
+    while( ctx->decoded.pop( job ) == true )
+    {
+        if ( ( job.result == 0 ) && ( job.cached == false ) )
+        {
+            // one bad image ( OpenCV exception, allocation ) fails alone.
+            try
+            {
+                Mat pImgOut;
+                job.result = processImage( job.img, pImgOut, image_multiply, false, &ws );
+                job.img    = pImgOut;
+            }
+            catch( ... )
+            {
+                job.result = BATCH_EPROCESS;
+                job.img.release();
+            }
+        }
+
+        if ( ctx->processed.push( job ) == false )
+            break;
+
+        job.img.release();
+    }
+
+    pthread_mutex_lock( &ctx->lock );
+    bool last = ( --ctx->inferers == 0 );
+    pthread_mutex_unlock( &ctx->lock );
+
+    if ( last == true )
+    {
+        ctx->processed.close();
+    }
+
+    return NULL;
+}
+
+static void printSchedulerStats()
+{
+    if ( engine_steal == NULL )
+        return;
+
+    vector<srcnn_worker_stats> stats( 256 );
+
+    int cnt = srcnn_executor_steal_stats( engine_steal, stats.data(), stats.size() );
+
+    for ( int wn = 0; wn < cnt && wn < (int)stats.size(); wn++ )
+    {
+        const srcnn_worker_stats& st = stats[wn];
+        double util = 0.0;
+
+        if ( st.wall_ns > 0 )
+        {
+            util = (double)st.busy_ns * 100.0 / (double)st.wall_ns;
+        }
+
+        if ( wn + 1 < cnt )
+        {
+            printf( "- Worker %d : %llu tiles, %llu stolen, %.1f%% busy",
+                    wn, st.tasks, st.steals, util );
+            if ( st.node >= 0 )
+            {
+                printf( ", node %d", st.node );
+            }
+            printf( ".\n" );
+        }
+        else
+        {
+            printf( "- Callers  : %llu tiles, %llu stolen, %.1f%% busy.\n",
+                    st.tasks, st.steals, util );
+        }
+    }
+
+    fflush( stdout );
+}
+
+void* pthreadbatch( void* p )
+{
+    if ( opt_verbose == true )
+    {
+        printTitle();
+        printf( "\n" );
+        printf( "- Scale multiply ratio : %.2f\n", image_multiply );
+        printf( "- Batch I/O threads : %u decoder(s), %u encoder(s), queue %u\n",
+                opt_iothreads, opt_iothreads, opt_queuedepth );
+        printf( "- Batch infer threads : %u, compute threads : %u\n",
+                opt_inferthreads, opt_threads );
+        fflush( stdout );
+    }
+
+    BatchContext ctx( opt_queuedepth );
+
+    if ( openBatchSource( ctx ) == false )
+    {
+        if ( opt_verbose == true )
+        {
+            printf( "- batch source failure : %s\n",
+                    opt_batchdir.size() > 0 ? opt_batchdir.c_str() : opt_batchlist.c_str() );
+        }
+
+        t_exit_code = -1;
+        pthread_exit( &t_exit_code );
+    }
+
+    vector<pthread_t> ptdecs( opt_iothreads );
+    vector<pthread_t> ptencs( opt_iothreads );
+    vector<pthread_t> ptinfs( opt_inferthreads );
+
+    srcnn_executor_steal_reset( engine_steal );
+
+    unsigned perf_tick0 = tick::getTickCount();
+
+    ctx.decoders = opt_iothreads;
+    ctx.inferers = opt_inferthreads;
+
+    for ( unsigned cnt = 0; cnt < opt_iothreads; cnt++ )
+    {
+        pthread_create( &ptdecs[cnt], NULL, pthreadbatchdecode, &ctx );
+        pthread_create( &ptencs[cnt], NULL, pthreadbatchencode, &ctx );
+    }
+
+    /* Infer threads keep tiles of several images in flight,
+       codecs never stall the CNN */
+    for ( unsigned cnt = 0; cnt < opt_inferthreads; cnt++ )
+    {
+        pthread_create( &ptinfs[cnt], NULL, pthreadbatchinfer, &ctx );
+    }
+
+    for ( unsigned cnt = 0; cnt < opt_inferthreads; cnt++ )
+    {
+        pthread_join( ptinfs[cnt], NULL );
+    }
+
+    for ( unsigned cnt = 0; cnt < opt_iothreads; cnt++ )
+    {
+        pthread_join( ptdecs[cnt], NULL );
+        pthread_join( ptencs[cnt], NULL );
+    }
+
+    unsigned perf_tick1 = tick::getTickCount();
+
+    if ( opt_verbose == true )
+    {
+        unsigned perf_ms = perf_tick1 - perf_tick0;
+
+        printf( "- Batch : %u done, %u failed.\n", ctx.done_ok, ctx.done_fail );
+        printf( "- Performace : %u ms took", perf_ms );
+        if ( perf_ms > 0 )
+        {
+            printf( " ( %.2f images/s )",
+                    (float)( ctx.done_ok + ctx.done_fail ) * 1000.f / (float)perf_ms );
+        }
+        printf( ".\n" );
+
+        if ( result_cache != NULL )
+        {
+            ResultCacheStats cst;
+            result_cache->stats( cst );
+
+            printf( "- Cache : %u hit(s), %u miss(es), %u stored, %u evicted.\n",
+                    cst.hits, cst.misses, cst.stored, cst.evicted );
+        }
+
+        fflush( stdout );
+
+        printSchedulerStats();
+    }
+
+    t_exit_code = ( ctx.done_fail > 0 ) ? -1 : 0;
+    pthread_exit( NULL );
+    return NULL;
+}
+
+void* pthreadoutofcore( void* p )
+{
+    ProfThreadName( "pipeline" );
+
+    if ( opt_verbose == true )
+    {
+        printTitle();
+        printf( "\n" );
+        printf( "- Scale multiply ratio : %.2f\n", image_multiply );
+        fflush( stdout );
+    }
+
+    if ( ( opt_verbose == true ) && ( admit_wholemem > 0 ) )
+    {
+        printf( "- Whole image needs %.1f MB, over --max-memory %u MB : going by strips.\n",
+                (double)admit_wholemem / 1048576.0, opt_maxmemory );
+        fflush( stdout );
+    }
+
+    if ( IsStripWriterPath( file_dst.c_str() ) == false )
+    {
+        if ( opt_verbose == true )
+        {
+            printf( "- Out-of-core output must be .pgm, .ppm, .pnm, .tif, .png, .jpg or .raw : %s\n",
+                    file_dst.c_str() );
+        }
+
+        t_exit_code = -1;
+        pthread_exit( &t_exit_code );
+    }
+
+    OutOfCoreConfig    occfg;
+    StripWriterOptions wopts;
+
+    writerOptions( wopts );
+
+    occfg.srcpath   = file_src.c_str();
+    occfg.dstpath   = file_dst.c_str();
+    occfg.rawinfo   = opt_rawsrc == true ? &strip_rawinfo : NULL;
+    occfg.scale     = image_multiply;
+    occfg.grayscale = opt_grayscale;
+    occfg.maxmemory = (size_t)opt_maxmemory * 1024 * 1024;
+    occfg.exec      = engine_exec;
+    occfg.verbose   = opt_verbose;
+    occfg.writeopts = &wopts;
+
+    t_exit_code = runOutOfCore( occfg );
+    pthread_exit( NULL );
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Memory plan of a source, before anything is decoded or allocated.
+
+typedef struct
+{
+    StripImageInfo      info;       /// source as stored.
+    bool                probed;     /// from header, false when decoded.
+    bool                measured;   /// false when file alone is over budget.
+    size_t              filesize;
+    unsigned            channels;   /// decoded for whole image.
+    unsigned            outwidth;
+    unsigned            outheight;
+    srcnn_memory_plan   whole;      /// source and output Mats, graph arena.
+    SRCNNGraphPlan      graph;
+    size_t              budget;     /// bytes, strips are planned under it.
+    bool                streamable; /// source and output go by strips.
+    unsigned            striprows;  /// 0 when a row is over budget.
+    srcnn_memory_plan   strip;
+    bool                outofcore;  /// mode to be run.
+}MemoryEstimate;
+
+static double toMB( size_t bytes )
+{
+    return (double)bytes / 1048576.0;
+}
+
+/***
+ * FuncName : estimateMemory
+ * Function : peak memory of whole image and strip modes of source file,
+ *            geometry from header, workspace from planned graph
+ * Parameter    : me - estimate
+ *        decoded - admission keeps image decoded to measure, may be NULL
+ * Output   : bool, false when source is not readable
+***/
+static bool estimateMemory( MemoryEstimate& me, Mat* decoded = NULL )
+{
+    memset( &me, 0, sizeof( MemoryEstimate ) );
+
+    const StripImageInfo* rawinfo = opt_rawsrc == true ? &strip_rawinfo : NULL;
+
+    me.budget   = (size_t)( opt_maxmemory > 0 ? opt_maxmemory : OUTOFCORE_DEFAULT_MEMORY ) << 20;
+    me.probed   = ProbeImageInfo( file_src.c_str(), rawinfo, me.info );
+    me.measured = true;
+
+    struct stat sb;
+
+    if ( stat( file_src.c_str(), &sb ) == 0 )
+    {
+        me.filesize = (size_t)sb.st_size;
+    }
+
+    if ( me.probed == false )
+    {
+        // decoded pixels are rarely smaller than their file, admission
+        // does not decode over budget just to measure.
+        if ( ( decoded != NULL ) && ( opt_maxmemory > 0 ) && ( me.filesize > me.budget ) )
+        {
+            me.measured  = false;
+            me.outofcore = true;
+            return true;
+        }
+
+        // other formats of OpenCV, decoded to be measured.
+        Mat img = imread( file_src.c_str(),
+                          opt_grayscale == true ? IMREAD_GRAYSCALE : IMREAD_ANYCOLOR );
+
+        if ( img.empty() == true )
+            return false;
+
+        me.info.width  = img.cols;
+        me.info.height = img.rows;
+        me.info.depth  = img.channels();
+
+        if ( decoded != NULL )
+        {
+            *decoded = img;
+        }
+    }
+
+    // ANYCOLOR decodes gray+alpha and colour sources to BGR.
+    me.channels = ( opt_grayscale == true ) || ( me.info.depth == 1 ) ? 1 : 3;
+
+    unsigned w  = me.info.width;
+    unsigned h  = me.info.height;
+
+    if ( srcnn_output_size( w, h, image_multiply, &me.outwidth, &me.outheight ) != SRCNN_OK )
+        return false;
+
+    SRCNNGraph graph;
+
+    buildImageGraph( graph, NULL, w, h, me.channels, (size_t)w * me.channels,
+                     NULL, me.outwidth, me.outheight, (size_t)me.outwidth * me.channels );
+
+    if ( graph.plan( &me.graph ) == false )
+        return false;
+
+    me.whole.source    = (size_t)w * h * me.channels;
+    me.whole.output    = (size_t)me.outwidth * me.outheight * me.channels;
+    me.whole.workspace = me.graph.arena;
+    me.whole.peak      = me.whole.source + me.whole.output + me.whole.workspace;
+
+    StripReader* reader = OpenStripReader( file_src.c_str(), rawinfo );
+
+    me.streamable = ( reader != NULL ) && ( IsStripWriterPath( file_dst.c_str() ) == true );
+
+    delete reader;
+
+    // strips keep depth of source, alpha too.
+    unsigned sdepth = opt_grayscale == true ? 1 : me.info.depth;
+
+    if ( me.streamable == true )
+    {
+        me.striprows = srcnn_strip_rows( w, h, sdepth, image_multiply, me.budget, &me.strip );
+    }
+
+    me.outofcore = ( opt_outofcore == true ) ||
+                   ( ( opt_maxmemory > 0 ) && ( me.whole.peak > me.budget ) );
+
+    return true;
+}
+
+static bool admissible( const MemoryEstimate& me )
+{
+    if ( me.outofcore == false )
+        return true;
+
+    return ( me.streamable == true ) && ( me.striprows > 0 );
+}
+
+static void printEstimate( const MemoryEstimate& me )
+{
+    const char* mode = me.outofcore == false ? "memory" :
+                       admissible( me ) == true ? "outofcore" : "refused";
+
+    if ( opt_json == true )
     {
-        printTitle();
-        printf( "\n" );
-        printf( "- Scale multiply ratio : %.2f\n", image_multiply );
-        fflush( stdout );
+        printf( "{\"source\":" );
+        jsonString( stdout, file_src );
+        printf( ",\"width\":%u,\"height\":%u,\"channels\":%u,\"scale\":%.4f,"
+                "\"out_width\":%u,\"out_height\":%u,\"probed\":%s,",
+                me.info.width, me.info.height, me.info.depth, image_multiply,
+                me.outwidth, me.outheight, me.probed == true ? "true" : "false" );
+        printf( "\"whole\":{\"source\":%zu,\"output\":%zu,\"workspace\":%zu,\"peak\":%zu,"
+                "\"nodes\":%u,\"fusions\":%u,\"unshared\":%zu},",
+                me.whole.source, me.whole.output, me.whole.workspace, me.whole.peak,
+                me.graph.nodes, me.graph.fusions, me.graph.unshared );
+        printf( "\"strips\":{\"streamable\":%s,\"rows\":%u,\"source\":%zu,\"output\":%zu,"
+                "\"workspace\":%zu,\"peak\":%zu},",
+                me.streamable == true ? "true" : "false", me.striprows,
+                me.strip.source, me.strip.output, me.strip.workspace, me.strip.peak );
+        printf( "\"measured\":%s,\"budget\":%zu,\"mode\":\"%s\"}\n",
+                me.measured == true ? "true" : "false", me.budget, mode );
+
+        return;
     }
 
-    /* Read the original image */
-    Mat pImgOrigin;
+    if ( me.measured == false )
+    {
+        printf( "- Memory estimate of %s :\n", file_src.c_str() );
+        printf( "    image     : not measured, file of %.1f MB is over %.0f MB and has no header probe\n",
+                toMB( me.filesize ), toMB( me.budget ) );
+        printf( "    mode      : refused, over --max-memory\n" );
 
-    pImgOrigin = imread( file_src.c_str() );
+        return;
+    }
 
-    if ( pImgOrigin.empty() == false )
+    printf( "- Memory estimate of %s%s :\n", file_src.c_str(),
+            me.probed == true ? "" : " ( decoded to measure )" );
+    printf( "    image     : %u x %u, %u channel%s -> %u x %u\n",
+            me.info.width, me.info.height, me.info.depth, me.info.depth > 1 ? "s" : "",
+            me.outwidth, me.outheight );
+    printf( "    whole     : %.1f MB peak, source %.1f + output %.1f + workspace %.1f MB\n",
+            toMB( me.whole.peak ), toMB( me.whole.source ), toMB( me.whole.output ),
+            toMB( me.whole.workspace ) );
+    printf( "    graph     : %u nodes, %u fused, %.1f MB workspace without reuse\n",
+            me.graph.nodes, me.graph.fusions, toMB( me.graph.unshared ) );
+
+    if ( me.streamable == false )
     {
-        if ( opt_verbose == true )
-        {
-            printf( "- Image load : %s\n", file_src.c_str() );
-            fflush( stdout );
-        }
+        printf( "    strips    : source or output format does not stream\n" );
     }
     else
+    if ( me.striprows == 0 )
     {
-        if ( opt_verbose == true )
-        {
-            printf( "- load failure : %s\n", file_src.c_str() );
-        }
-
-        t_exit_code = -1;
-        pthread_exit( &t_exit_code );
+        printf( "    strips    : %.1f MB for one row, over %.0f MB\n",
+                toMB( me.strip.peak ), toMB( me.budget ) );
+    }
+    else
+    {
+        printf( "    strips    : %u rows, %u strips, %.1f MB peak under %.0f MB\n",
+                me.striprows, ( me.outheight + me.striprows - 1 ) / me.striprows,
+                toMB( me.strip.peak ), toMB( me.budget ) );
     }
 
-    // Test image resize target ...
-    Size testsz = pImgOrigin.size();
-    if ( ( ( (float)testsz.width * image_multiply ) <= 0.f ) ||
-         ( ( (float)testsz.height * image_multiply ) <= 0.f ) )
+    printf( "    mode      : %s\n",
+            me.outofcore == false ? "whole image in memory" :
+            admissible( me ) == true ? "out-of-core by strips" : "refused, over --max-memory" );
+}
+
+void* pthreadestimate( void* p )
+{
+    MemoryEstimate me;
+
+    if ( estimateMemory( me ) == false )
     {
-        if ( opt_verbose == true )
+        if ( opt_json == false )
         {
-            printf( "- Image scale error : ratio too small.\n" );
+            printf( "- load failure : %s\n", file_src.c_str() );
         }
 
         t_exit_code = -1;
         pthread_exit( &t_exit_code );
     }
 
-    // -------------------------------------------------------------
+    printEstimate( me );
+    fflush( stdout );
 
-    if ( opt_verbose == true )
-    {
-        printf( "- Image converting to Y-Cr-Cb : " );
-        fflush( stdout );
-    }
+    t_exit_code = admissible( me ) == true ? 0 : -1;
+    pthread_exit( NULL );
+    return NULL;
+}
 
-    unsigned perf_tick0 = tick::getTickCount();
+/***
+ * FuncName : pthreadadmit
+ * Function : --max-memory admission, whole image when its plan fits,
+ *            otherwise out-of-core by strips, refused when neither does
+ * Parameter    : p - thread argument
+ * Output   : void*
+***/
+void* pthreadadmit( void* p )
+{
+    MemoryEstimate me;
+
+    // unreadable source fails in usual path with its message,
+    // source decoded to be measured goes on without decoding again.
+    if ( ( estimateMemory( me, &admit_source ) == false ) || ( me.outofcore == false ) )
+        return pthreadcall( p );
 
-    /* Convert the image from BGR to YCrCb Space */
-    Mat pImgYCrCb;
-    cvtColor(pImgOrigin, pImgYCrCb, CV_BGR2YCrCb);
+    admit_source.release();
 
-    if ( pImgYCrCb.empty() == false )
+    if ( admissible( me ) == true )
     {
-        if ( opt_verbose == true )
-        {
-            printf( "Ok.\n" );
-            fflush( stdout );
-        }
+        admit_wholemem = me.whole.peak;
+
+        return pthreadoutofcore( p );
     }
-    else
-    {
-        if ( opt_verbose == true )
-        {
-            printf( "Failure.\n" );
-        }
 
-        t_exit_code = -2;
-        pthread_exit( &t_exit_code );
+    if ( opt_verbose == true )
+    {
+        printTitle();
+        printf( "\n" );
+        printEstimate( me );
     }
 
-    // ------------------------------------------------------------
+    t_exit_code = -1;
+    pthread_exit( &t_exit_code );
+    return NULL;
+}
 
+void* pthreaddaemon( void* p )
+{
     if ( opt_verbose == true )
     {
-        printf( "- Splitting channels : " );
+        printTitle();
+        printf( "\n" );
+        printf( "- Default scale multiply ratio : %.2f\n", image_multiply );
         fflush( stdout );
     }
 
-    /* Split the Y-Cr-Cb channel */
-    vector<Mat> pImgYCrCbCh(3);
-    split(pImgYCrCb, pImgYCrCbCh);
+    DaemonConfig dcfg;
+
+    dcfg.sockpath   = opt_daemonsock.c_str();
+    dcfg.workers    = opt_workers;
+    dcfg.maxclients = 256;
+    dcfg.scale      = image_multiply;
+    dcfg.grayscale  = opt_grayscale;
+    dcfg.verbose    = opt_verbose;
+
+    t_exit_code = runDaemon( dcfg );
+    pthread_exit( NULL );
+    return NULL;
+}
+
+// "0-3,8,10-11" to CPU numbers, "compact" for every online CPU in order.
+static bool parseCpuList( const string& list, vector<int>& cpus )
+{
+    cpus.clear();
 
-    if ( pImgYCrCb.empty() == false )
+    if ( list == "compact" )
     {
-        if ( opt_verbose == true )
+        long ncpu = sysconf( _SC_NPROCESSORS_ONLN );
+
+        for ( long cnt = 0; cnt < ncpu; cnt++ )
         {
-            printf( "Ok.\n" );
-            fflush( stdout );
+            cpus.push_back( (int)cnt );
         }
+
+        return ( cpus.size() > 0 );
     }
-    else
+
+    return NUMAParseCpuList( list.c_str(), cpus );
+}
+
+/***
+ * FuncName : setupAffinity
+ * Function : applies --affinity CPU list to process, before tuning and
+ *            threading count their threads from it
+ * Parameter    : <none>
+ * Output   : <void>
+***/
+static void setupAffinity()
+{
+    if ( opt_affinity.size() == 0 )
+        return;
+
+    if ( parseCpuList( opt_affinity, thread_cpus ) == false )
     {
-        if ( opt_verbose == true )
-        {
-            printf( "Failure.\n" );
-            t_exit_code = -3;
-            pthread_exit( &t_exit_code );
-        }
+        fprintf( stderr, "Warning: affinity '%s' ignored.\n", opt_affinity.c_str() );
+        thread_cpus.clear();
+        return;
     }
 
-    // ------------------------------------------------------------
+#ifdef __linux__
+    // threads made after this, OpenCV and I/O ones too, inherit CPU set.
+    cpu_set_t cset;
+    CPU_ZERO( &cset );
 
-    if ( opt_verbose == true )
+    for ( size_t cnt = 0; cnt < thread_cpus.size(); cnt++ )
     {
-        printf( "- Resizing splitted channels with bicublic interpolation : " );
+        if ( ( thread_cpus[cnt] >= 0 ) && ( thread_cpus[cnt] < CPU_SETSIZE ) )
+        {
+            CPU_SET( thread_cpus[cnt], &cset );
+        }
     }
 
-    /* Resize the Y-Cr-Cb Channel with Bicubic Interpolation */
-    vector<Mat> pImg(3);
+    sched_setaffinity( 0, sizeof( cset ), &cset );
+#endif /// of __linux__
+}
 
-    #pragma omp parallel for
-    for (int i = 0; i < 3; i++)
-    {
-        Size newsz = pImgYCrCbCh[i].size();
-        newsz.width  *= image_multiply;
-        newsz.height *= image_multiply;
+// Threads when none given : CPU list, else CPUs allowed to process
+// ( taskset, cgroup cpuset ), else online ones.
+static unsigned defaultThreads()
+{
+    if ( thread_cpus.size() > 0 )
+        return thread_cpus.size();
 
-        resize( pImgYCrCbCh[i],
-                pImg[i],
-                newsz,
-                0,
-                0,
-                CV_INTER_CUBIC );
-    }
+#ifdef __linux__
+    cpu_set_t cset;
+    CPU_ZERO( &cset );
 
-    if ( opt_verbose == true )
-    {
-        printf( "Ok.\n" );
-    }
+    if ( ( sched_getaffinity( 0, sizeof( cset ), &cset ) == 0 ) && ( CPU_COUNT( &cset ) > 0 ) )
+        return (unsigned)CPU_COUNT( &cset );
+#endif /// of __linux__
 
-    // -----------------------------------------------------------
+    long ncpu = sysconf( _SC_NPROCESSORS_ONLN );
 
-    int cnt = 0;
+    return ncpu > 0 ? (unsigned)ncpu : 1;
+}
 
-    /******************* The First Layer *******************/
+/***
+ * FuncName : setupThreading
+ * Function : one thread count for SRCNN, OpenMP and OpenCV, workers are
+ *            pinned to --affinity list
+ * Parameter    : <none>
+ * Output   : <void>
+***/
+static void setupThreading()
+{
+    const vector<int>& cpus = thread_cpus;
 
-    if ( opt_verbose == true )
-    {
-        printf( "- Processing convolutional layer I + II ... " );
-        fflush( stdout );
-    }
+    unsigned threads = opt_threads > 0 ? opt_threads : defaultThreads();
 
-    vector<Mat> pImgConv2(CONV2_FILTERS);
-    #pragma omp parallel for
-    for ( unsigned cnt=0; cnt<CONV2_FILTERS; cnt++)
-    {
-        pImgConv2[cnt].create( pImg[0].size(), CV_32F );
-    }
+    opt_threads = threads;
 
-    Convolution99x11( pImg[0], pImgConv2, weights_conv1_data, biases_conv1, weights_conv2_data, biases_conv2 );
+    // Several batch infer threads or daemon workers call OpenCV nodes at
+    // once, each fanning out on its pool would oversubscribe steal workers.
+    bool cvcallers = ( ( opt_batch == true ) && ( opt_inferthreads > 1 ) ) ||
+                     ( ( opt_daemonsock.size() > 0 ) && ( opt_workers > 1 ) );
 
-    if ( opt_verbose == true )
-    {
-        printf( "completed.\n" );
-        fflush( stdout );
-    }
+    setNumThreads( cvcallers == true ? 1 : (int)threads );
 
-    /******************* The Third Layer *******************/
+#ifndef NO_OMP
+    omp_set_num_threads( (int)threads );
+    omp_set_max_active_levels( 1 );
+#endif
 
-    if ( opt_verbose == true )
+    if ( ( opt_scheduler == 0 ) && ( opt_numa == true ) )
     {
-        printf( "- Processing convolutional layer III ... " );
-        fflush( stdout );
+        // nodes are read after affinity, only allowed CPUs are used.
+        engine_steal = srcnn_executor_steal_create_numa( threads );
+        engine_exec  = engine_steal;
     }
-
-    Mat pImgConv3;
-    pImgConv3.create(pImg[0].size(), CV_8U);
-    Convolution55(pImgConv2, pImgConv3, weights_conv3_data, biases_conv3);
-
-    if ( opt_verbose == true )
+    else
+    if ( opt_scheduler == 0 )
     {
-        printf( "completed.\n");
-        printf( "- Merging images : " );
-        fflush( stdout );
+        engine_steal = srcnn_executor_steal_create_pinned( threads,
+                                                           cpus.size() > 0 ? cpus.data() : NULL,
+                                                           cpus.size() );
+        engine_exec  = engine_steal;
     }
-
-    /* Merge the Y-Cr-Cb Channel into an image */
-    Mat pImgYCrCbOut;
-    pImg[0] = pImgConv3;
-    merge(pImg, pImgYCrCbOut);
-
-    if ( opt_verbose == true )
+    else
+    if ( opt_scheduler == 1 )
     {
-        printf( "Ok.\n" );
-        fflush( stdout );
+        engine_exec = srcnn_executor_openmp();
     }
-
-    // ---------------------------------------------------------
-
-    if ( opt_verbose == true )
+    else
     {
-        printf( "- Converting channel to BGR : " );
-        fflush ( stdout );
+        engine_exec = srcnn_executor_serial();
     }
+}
 
-    /* Convert the image from YCrCb to BGR Space */
-    Mat pImgBGROut;
-    cvtColor(pImgYCrCbOut, pImgBGROut, CV_YCrCb2BGR);
+/***
+ * FuncName : setupTuning
+ * Function : runs auto-tuning, or loads profile of this CPU
+ * Parameter    : <none>
+ * Output   : bool false when tuning ran and program ends
+***/
+static bool setupTuning()
+{
+    string path = opt_tunefile.size() > 0 ? opt_tunefile : string( autoTuneDefaultPath() );
 
-    unsigned perf_tick1 = tick::getTickCount();
+    AutoTuneProfile prof;
 
-    if ( pImgBGROut.empty() == false )
+    if ( opt_autotune == true )
     {
-        if ( opt_verbose == true )
+        unsigned threads = opt_threads > 0 ? opt_threads : defaultThreads();
+
+        if ( autoTuneRun( prof, threads, thread_cpus.size() > 0 ? thread_cpus.data() : NULL,
+                          thread_cpus.size(), true ) == false )
         {
-            printf( "Ok.\n" );
-            printf( "- Writing result to %s : ", file_dst.c_str() );
-            fflush( stdout );
+            printf( "- Auto-tuning failure.\n" );
+            t_exit_code = -1;
         }
-
-        imwrite( file_dst.c_str() , pImgBGROut);
-
-        if ( opt_verbose == true )
+        else
+        if ( autoTuneSave( path.c_str(), prof ) == false )
+        {
+            printf( "- Profile write failure : %s\n", path.c_str() );
+            t_exit_code = -1;
+        }
+        else
         {
-            printf( "Ok.\n" );
+            printf( "- Profile written : %s\n", path.c_str() );
         }
+
+        fflush( stdout );
+        return false;
     }
-    else
+
+    if ( ( opt_notune == false ) && ( autoTuneLoad( path.c_str(), prof ) == true ) )
     {
-        if ( opt_verbose == true )
+        SRCNNSetKernelConfig( &prof.kernel );
+
+        // given threads and CPU lists win over profile.
+        if ( ( opt_threads == 0 ) && ( opt_affinity.size() == 0 ) )
         {
-            printf( "Failure.\n" );
+            opt_threads = prof.threads;
         }
 
-        t_exit_code = -10;
-        pthread_exit( &t_exit_code );
+        if ( opt_verbose == true )
+        {
+            // stdout may carry frames of stream.
+            FILE* fp = opt_stream == true ? stderr : stdout;
+
+            const char* mode = "direct";
+
+            if ( prof.kernel.layer1 == SRCNN_LAYER1_IM2COL )
+            {
+                mode = "im2col";
+            }
+            else
+            if ( prof.kernel.layer1 == SRCNN_LAYER1_JIT )
+            {
+                mode = "jit";
+            }
+
+            fprintf( fp, "- Tuning profile : %s ( tile %ux%u, %s",
+                     path.c_str(), prof.kernel.tile_w, prof.kernel.tile_h, mode );
+
+            if ( prof.kernel.layer1 == SRCNN_LAYER1_IM2COL )
+            {
+                fprintf( fp, " x%u", prof.kernel.interleave );
+            }
+
+            fprintf( fp, ", %u threads )\n", prof.threads );
+        }
     }
 
-    if ( opt_verbose == true )
+    if ( opt_nojit == true )
     {
-        printf( "- Performace : %u ms took.\n", perf_tick1 - perf_tick0 );
-    }
+        SRCNNKernelConfig kc;
+        SRCNNGetKernelConfig( &kc );
 
-    fflush( stdout );
+        if ( kc.layer1 == SRCNN_LAYER1_JIT )
+        {
+            kc.layer1 = SRCNN_LAYER1_DIRECT;
+            SRCNNSetKernelConfig( &kc );
+        }
+    }
 
-    t_exit_code = 0;
-    pthread_exit( NULL );
-    return NULL;
+    return true;
 }
 
 /***
@@ -714,10 +3008,93 @@ int main( int argc, char** argv )
         return 0;
     }
 
+    // enabled before workers start, so they are named and counted.
+    if ( ( opt_tracefile.size() > 0 ) || ( opt_counters == true ) || ( opt_bench > 0 ) )
+    {
+        // bench measures stages, events of every tile in every run would
+        // add to its latencies and peak RSS.
+        if ( ( opt_bench > 0 ) && ( opt_tracefile.size() == 0 ) )
+        {
+            ProfTilesEnable( false );
+        }
+
+        ProfEnable( true );
+
+        if ( opt_counters == true )
+        {
+            ProfCountersEnable();
+        }
+
+        ProfThreadName( "main" );
+    }
+
+    setupAffinity();
+
+    if ( setupTuning() == false )
+    {
+        return t_exit_code;
+    }
+
+    setupThreading();
+
+    // stream, daemon, out-of-core and bench never use it.
+    ResultCache rcache;
+
+    if ( opt_cachedir.size() > 0 )
+    {
+        if ( rcache.open( opt_cachedir.c_str(), (size_t)opt_cachesize << 20 ) == true )
+        {
+            result_cache = &rcache;
+        }
+        else
+        if ( opt_verbose == true )
+        {
+            printf( "- Cache directory failure : %s, running without cache.\n",
+                    opt_cachedir.c_str() );
+        }
+    }
+
     pthread_t ptt;
     int       tid = 0;
 
-    if ( pthread_create( &ptt, NULL, pthreadcall, &tid ) == 0 )
+    void* (*tfunc)( void* ) = pthreadcall;
+
+    if ( opt_daemonsock.size() > 0 )
+    {
+        tfunc = pthreaddaemon;
+    }
+    else
+    if ( opt_batch == true )
+    {
+        tfunc = pthreadbatch;
+    }
+    else
+    if ( opt_stream == true )
+    {
+        tfunc = pthreadvideo;
+    }
+    else
+    if ( opt_estimate == true )
+    {
+        tfunc = pthreadestimate;
+    }
+    else
+    if ( opt_outofcore == true )
+    {
+        tfunc = pthreadoutofcore;
+    }
+    else
+    if ( opt_bench > 0 )
+    {
+        tfunc = pthreadbench;
+    }
+    else
+    if ( opt_maxmemory > 0 )
+    {
+        tfunc = pthreadadmit;
+    }
+
+    if ( pthread_create( &ptt, NULL, tfunc, &tid ) == 0 )
     {
         // Wait for thread ends ..
         pthread_join( ptt, NULL );
@@ -727,6 +3104,33 @@ int main( int argc, char** argv )
         printf( "Error: pthread failure.\n" );
     }
 
+    srcnn_executor_pool_destroy( engine_steal );
+
+    if ( opt_counters == true )
+    {
+        // stdout may carry frames of stream.
+        FILE* fp = opt_stream == true ? stderr : stdout;
+
+        ProfEnable( false );
+        ProfPrintCounters( fp );
+        fflush( fp );
+    }
+
+    if ( opt_tracefile.size() > 0 )
+    {
+        ProfEnable( false );
+
+        if ( ProfWriteTrace( opt_tracefile.c_str() ) == false )
+        {
+            printf( "- Trace write failure : %s\n", opt_tracefile.c_str() );
+        }
+        else
+        if ( opt_verbose == true )
+        {
+            printf( "- Trace written : %s\n", opt_tracefile.c_str() );
+        }
+    }
+
     return t_exit_code;
 }
 #endif /// of EXPORTLIBSRCNN
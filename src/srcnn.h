@@ -8,6 +8,28 @@
 #include <opencv2/imgproc/types_c.h>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include <vector>
+#include "libsrcnn.h"
+
+// Buffers of processImage() kept between calls, one per thread.
+class ImageWorkspace
+{
+    public:
+        ImageWorkspace();
+        ~ImageWorkspace();
+
+    public:
+        srcnn_context*          ctx;        /// graph arena, every buffer.
+
+    private:
+        ImageWorkspace( const ImageWorkspace& );
+        ImageWorkspace& operator=( const ImageWorkspace& );
+};
+
+// SRCNN resize of a gray or BGR image, returns 0 or negative for failure.
+int processImage( cv::Mat& pImgOrigin, cv::Mat& pImgOut, float mulf, bool verbose,
+                  ImageWorkspace* ws = NULL );
+
 #endif /// of EXPORTLIBSRCNN
 
 #endif /// of __SRCNN_H__
\ No newline at end of file
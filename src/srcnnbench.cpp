@@ -0,0 +1,545 @@
+/*******************************************************************************
+ * srcnn-bench : layer level micro-benchmark of SRCNN kernels.
+ * ----------------------------------------------------------------------------
+ * Each kernel runs alone over synthetic images from 256x256 to 8K, after
+ * warmup runs. Median and p95 times are reported with GFLOP/s and achieved
+ * bandwidth, against machine peaks measured here ( STREAM triad and a
+ * multiply-add loop ), as a simple roofline.
+ * Flops and bytes are nominal : arithmetic of kernel and compulsory traffic
+ * of its inputs and outputs, caches not counted.
+*******************************************************************************/
+#ifdef FORBENCHBIN
+
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "libsrcnn.h"
+#include "srcnnkernel.h"
+#include "srcnnprof.h"
+#include "frawscale.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define BENCH_LAYER1_FILTERS    64
+#define BENCH_STREAM_ELEMS      ( 16 * 1024 * 1024 )    /// 128MB per array.
+#define BENCH_PEAK_ITERS        ( 1024 * 1024 )
+
+// Nominal flops per output pixel, multiply-add as two.
+#define FLOPS_LAYER12   ( BENCH_LAYER1_FILTERS * ( 81 * 2 + 1 ) + \
+                          SRCNN_KERNEL_PLANES * ( BENCH_LAYER1_FILTERS * 2 + 1 ) )
+#define FLOPS_LAYER3    ( SRCNN_KERNEL_PLANES * ( 25 * 2 + 1 ) + 1 )
+#define FLOPS_SPLIT     11
+#define FLOPS_MERGE     10
+#define FLOPS_CUBICTAP  2       /// per tap of FRAWResizeEngine, window of 5.
+#define CUBIC_WINDOW    5
+
+typedef struct
+{
+    const char* name;
+    unsigned    width;
+    unsigned    height;
+}BenchSize;
+
+static const BenchSize bench_sizes[] =
+{
+    { "256",  256,  256 },
+    { "512",  512,  512 },
+    { "1K",  1024, 1024 },
+    { "2K",  2048, 2048 },
+    { "4K",  3840, 2160 },
+    { "8K",  7680, 4320 },
+};
+
+static const unsigned bench_sizes_count = sizeof( bench_sizes ) / sizeof( BenchSize );
+
+// Buffers of one image size, every kernel reads and writes here.
+typedef struct
+{
+    unsigned                width;
+    unsigned                height;
+    vector<unsigned char>   rgb;
+    vector<unsigned char>   luma;
+    vector<unsigned char>   chroma[2];
+    vector<unsigned char>   out;
+    vector<float>           planebuf;
+    vector<float*>          planes;
+    vector<float>           half;       /// float luma of half size, resize source.
+    float*                  resized;
+    const srcnn_executor*   exec;
+}BenchData;
+
+typedef void (*BenchRunFn)( BenchData& bd );
+
+typedef struct
+{
+    const char* name;
+    BenchRunFn  run;
+    double      flops;      /// per run.
+    double      bytes;      /// per run.
+}BenchKernel;
+
+typedef struct
+{
+    double      median;     /// seconds.
+    double      p95;
+}BenchTimes;
+
+static unsigned opt_runs    = 7;
+static unsigned opt_warmup  = 2;
+static unsigned opt_threads = 0;
+static string   opt_kernel;
+static string   opt_sizes;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void runSplit( BenchData& bd )
+{
+    SRCNNSplitYCrCb( bd.rgb.data(), (size_t)bd.width * 3, 3, bd.width, bd.height,
+                     bd.luma.data(), bd.chroma[0].data(), bd.chroma[1].data(), bd.exec );
+}
+
+static void runMerge( BenchData& bd )
+{
+    SRCNNMergeYCrCb( bd.luma.data(), bd.chroma[0].data(), bd.chroma[1].data(),
+                     bd.width, bd.height, bd.rgb.data(), (size_t)bd.width * 3, 3, bd.exec );
+}
+
+static void runLayer12( BenchData& bd )
+{
+    SRCNNLayer12( bd.luma.data(), bd.width, bd.width, bd.height,
+                  bd.planes.data(), bd.width, NULL, bd.exec );
+}
+
+static void runLayer3( BenchData& bd )
+{
+    SRCNNLayer3( bd.planes.data(), bd.width, bd.width, bd.height,
+                 bd.out.data(), bd.width, NULL, bd.exec );
+}
+
+static void runResize( BenchData& bd )
+{
+    FRAWBicubicFilter filter;
+    FRAWResizeEngine  engine( &filter );
+
+    engine.scale( bd.half.data(), bd.width / 2, bd.height / 2,
+                  bd.width, bd.height, &bd.resized );
+}
+
+// Kernels of one size, flops and bytes by its geometry.
+static void makeKernels( const BenchData& bd, vector<BenchKernel>& kernels )
+{
+    double px   = (double)bd.width * bd.height;
+    double hpx  = (double)( bd.width / 2 ) * ( bd.height / 2 );
+    double tpx  = (double)bd.width * ( bd.height / 2 );     /// horizontal pass output.
+    double pl   = (double)SRCNN_KERNEL_PLANES * sizeof( float );
+
+    BenchKernel k[] =
+    {
+        { "convert",          runSplit,   px * FLOPS_SPLIT,   px * 6 },
+        { "merge",            runMerge,   px * FLOPS_MERGE,   px * 6 },
+        { "Convolution99x11", runLayer12, px * FLOPS_LAYER12, px * ( 1 + pl ) },
+        { "Convolution55",    runLayer3,  px * FLOPS_LAYER3,  px * ( pl + 1 ) },
+        { "FRAWResize::scale", runResize,
+          ( tpx + px ) * CUBIC_WINDOW * FLOPS_CUBICTAP,
+          ( hpx + tpx * 2 + px ) * sizeof( float ) },
+    };
+
+    kernels.clear();
+
+    for ( unsigned cnt = 0; cnt < sizeof( k ) / sizeof( BenchKernel ); cnt++ )
+    {
+        if ( ( opt_kernel.size() == 0 ) || ( opt_kernel == k[cnt].name ) )
+            kernels.push_back( k[cnt] );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Smooth gradients with noise, kernels have no data dependent branch
+// but ReLU, so content only needs to look like an image.
+static unsigned benchRandom( unsigned& seed )
+{
+    seed = seed * 1103515245u + 12345u;
+    return ( seed >> 16 ) & 0x7FFF;
+}
+
+static bool makeData( BenchData& bd, unsigned w, unsigned h, const srcnn_executor* exec )
+{
+    size_t px = (size_t)w * h;
+
+    bd.width   = w;
+    bd.height  = h;
+    bd.exec    = exec;
+    bd.resized = NULL;
+
+    try
+    {
+        bd.rgb.resize( px * 3 );
+        bd.luma.resize( px );
+        bd.chroma[0].resize( px );
+        bd.chroma[1].resize( px );
+        bd.out.resize( px );
+        bd.planebuf.resize( px * SRCNN_KERNEL_PLANES );
+        bd.planes.resize( SRCNN_KERNEL_PLANES );
+        bd.half.resize( (size_t)( w / 2 ) * ( h / 2 ) );
+    }
+    catch( ... )
+    {
+        return false;
+    }
+
+    unsigned seed = 0x5EED;
+
+    for ( unsigned y = 0; y < h; y++ )
+    {
+        for ( unsigned x = 0; x < w; x++ )
+        {
+            size_t   q = (size_t)y * w + x;
+            unsigned n = benchRandom( seed ) & 31;
+
+            bd.rgb[ q * 3 + 0 ] = (unsigned char)( ( x * 255 / w + n ) & 0xFF );
+            bd.rgb[ q * 3 + 1 ] = (unsigned char)( ( y * 255 / h + n ) & 0xFF );
+            bd.rgb[ q * 3 + 2 ] = (unsigned char)( ( ( x + y ) * 127 / ( w + h ) + n ) & 0xFF );
+        }
+    }
+
+    runSplit( bd );
+
+    for ( unsigned y = 0; y < h / 2; y++ )
+    {
+        for ( unsigned x = 0; x < w / 2; x++ )
+        {
+            bd.half[ (size_t)y * ( w / 2 ) + x ] = bd.luma[ (size_t)y * 2 * w + x * 2 ];
+        }
+    }
+
+    for ( unsigned cnt = 0; cnt < SRCNN_KERNEL_PLANES; cnt++ )
+    {
+        bd.planes[cnt] = &bd.planebuf[ px * cnt ];
+    }
+
+    // layer III reads what layer I+II makes.
+    runLayer12( bd );
+
+    return true;
+}
+
+static void freeData( BenchData& bd )
+{
+    if ( bd.resized != NULL )
+    {
+        delete[] bd.resized;
+        bd.resized = NULL;
+    }
+
+    vector<unsigned char>().swap( bd.rgb );
+    vector<unsigned char>().swap( bd.luma );
+    vector<unsigned char>().swap( bd.chroma[0] );
+    vector<unsigned char>().swap( bd.chroma[1] );
+    vector<unsigned char>().swap( bd.out );
+    vector<float>().swap( bd.planebuf );
+    vector<float*>().swap( bd.planes );
+    vector<float>().swap( bd.half );
+}
+
+static BenchTimes timeKernel( const BenchKernel& k, BenchData& bd )
+{
+    vector<double> secs;
+
+    for ( unsigned cnt = 0; cnt < opt_warmup; cnt++ )
+    {
+        k.run( bd );
+    }
+
+    for ( unsigned cnt = 0; cnt < opt_runs; cnt++ )
+    {
+        uint64_t t0 = ProfNow();
+        k.run( bd );
+        secs.push_back( (double)( ProfNow() - t0 ) * 1e-9 );
+    }
+
+    sort( secs.begin(), secs.end() );
+
+    BenchTimes bt;
+    size_t     n   = secs.size();
+    size_t     p95 = ( n * 95 + 99 ) / 100;     /// nearest rank.
+
+    bt.median = ( n % 2 == 1 ) ? secs[ n / 2 ] : ( secs[ n / 2 - 1 ] + secs[ n / 2 ] ) * 0.5;
+    bt.p95    = secs[ p95 > 0 ? p95 - 1 : 0 ];
+
+    return bt;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+    double*         a;
+    const double*   b;
+    const double*   c;
+    double          s;
+}TriadArgs;
+
+static void triadRows( void* arg, size_t begin, size_t end )
+{
+    TriadArgs* ta = (TriadArgs*)arg;
+
+    for ( size_t cnt = begin; cnt < end; cnt++ )
+    {
+        ta->a[cnt] = ta->b[cnt] + ta->s * ta->c[cnt];
+    }
+}
+
+// STREAM triad through executor, 24 bytes per element as STREAM counts.
+static double measureBandwidth( const srcnn_executor* exec )
+{
+    vector<double> a( BENCH_STREAM_ELEMS, 0.0 );
+    vector<double> b( BENCH_STREAM_ELEMS, 1.0 );
+    vector<double> c( BENCH_STREAM_ELEMS, 2.0 );
+
+    TriadArgs ta = { a.data(), b.data(), c.data(), 3.0 };
+    double    best = 0.0;
+
+    for ( unsigned cnt = 0; cnt < 5; cnt++ )
+    {
+        uint64_t t0 = ProfNow();
+        exec->parallel_for( exec->user, BENCH_STREAM_ELEMS, 64 * 1024, triadRows, &ta );
+        double   sec = (double)( ProfNow() - t0 ) * 1e-9;
+        double   bw  = (double)BENCH_STREAM_ELEMS * 24.0 / sec;
+
+        if ( bw > best )
+            best = bw;
+    }
+
+    return best;
+}
+
+typedef float BenchVec __attribute__(( vector_size( 32 ) ));
+
+static void peakTasks( void* arg, size_t begin, size_t end )
+{
+    float* sink = (float*)arg;
+
+    for ( size_t n = begin; n < end; n++ )
+    {
+        // eight independent chains hide multiply-add latency.
+        BenchVec acc[8];
+        BenchVec mul = { 0.999f, 0.999f, 0.999f, 0.999f, 0.999f, 0.999f, 0.999f, 0.999f };
+        BenchVec add = { 0.001f, 0.001f, 0.001f, 0.001f, 0.001f, 0.001f, 0.001f, 0.001f };
+
+        for ( unsigned cnt = 0; cnt < 8; cnt++ )
+        {
+            BenchVec v = { (float)cnt, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, (float)n };
+            acc[cnt] = v;
+        }
+
+        for ( unsigned it = 0; it < BENCH_PEAK_ITERS; it++ )
+        {
+            for ( unsigned cnt = 0; cnt < 8; cnt++ )
+            {
+                acc[cnt] = acc[cnt] * mul + add;
+            }
+        }
+
+        float s = 0.f;
+
+        for ( unsigned cnt = 0; cnt < 8; cnt++ )
+        {
+            for ( unsigned q = 0; q < 8; q++ )
+                s += acc[cnt][q];
+        }
+
+        sink[n] = s;
+    }
+}
+
+// Multiply-add peak of this build, tasks twice of threads.
+static double measureFlops( const srcnn_executor* exec, unsigned threads )
+{
+    size_t        tasks = (size_t)threads * 2;
+    vector<float> sink( tasks );
+    double        best  = 0.0;
+
+    for ( unsigned cnt = 0; cnt < 3; cnt++ )
+    {
+        uint64_t t0 = ProfNow();
+        exec->parallel_for( exec->user, tasks, 1, peakTasks, sink.data() );
+        double   sec = (double)( ProfNow() - t0 ) * 1e-9;
+        double   fl  = (double)tasks * BENCH_PEAK_ITERS * 8 * 8 * 2 / sec;
+
+        if ( fl > best )
+            best = fl;
+    }
+
+    return best;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static bool sizeSelected( const BenchSize& bs )
+{
+    if ( opt_sizes.size() == 0 )
+        return true;
+
+    string list = "," + opt_sizes + ",";
+
+    return list.find( string( "," ) + bs.name + "," ) != string::npos;
+}
+
+static void printHelp( const char* me )
+{
+    printf( "    usage : %s (options)\n", me );
+    printf( "\n" );
+    printf( "    _options_:\n" );
+    printf( "\n" );
+    printf( "        --runs=(count)               : timed runs per kernel, default 7.\n" );
+    printf( "        --warmup=(count)             : untimed runs before, default 2.\n" );
+    printf( "        --threads=(count)            : executor threads, default all cores.\n" );
+    printf( "        --kernel=(name)              : one kernel only, as named in report.\n" );
+    printf( "        --sizes=(256,512,1K,2K,4K,8K) : image sizes, default all.\n" );
+    printf( "        --help                       : this help\n" );
+    printf( "\n" );
+    printf( "    8K layers need about 4.5GB of memory.\n" );
+    printf( "\n" );
+}
+
+static bool parseArgs( int argc, char** argv )
+{
+    for ( int cnt = 1; cnt < argc; cnt++ )
+    {
+        string strtmp = argv[cnt];
+
+        if ( strtmp.find( "--runs=" ) == 0 )
+        {
+            int tmpiv = atoi( strtmp.substr( 7 ).c_str() );
+            if ( tmpiv > 0 )
+                opt_runs = tmpiv;
+        }
+        else
+        if ( strtmp.find( "--warmup=" ) == 0 )
+        {
+            int tmpiv = atoi( strtmp.substr( 9 ).c_str() );
+            if ( tmpiv >= 0 )
+                opt_warmup = tmpiv;
+        }
+        else
+        if ( strtmp.find( "--threads=" ) == 0 )
+        {
+            int tmpiv = atoi( strtmp.substr( 10 ).c_str() );
+            if ( tmpiv > 0 )
+                opt_threads = tmpiv;
+        }
+        else
+        if ( strtmp.find( "--kernel=" ) == 0 )
+        {
+            opt_kernel = strtmp.substr( 9 );
+        }
+        else
+        if ( strtmp.find( "--sizes=" ) == 0 )
+        {
+            opt_sizes = strtmp.substr( 8 );
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main( int argc, char** argv )
+{
+    if ( parseArgs( argc, argv ) == false )
+    {
+        printHelp( argv[0] );
+        return 0;
+    }
+
+    unsigned threads = opt_threads;
+
+    if ( threads == 0 )
+    {
+        long ncpu = sysconf( _SC_NPROCESSORS_ONLN );
+        threads = ncpu > 0 ? (unsigned)ncpu : 1;
+    }
+
+    srcnn_executor* exec = srcnn_executor_steal_create( threads );
+
+    if ( exec == NULL )
+    {
+        printf( "Error: executor failure.\n" );
+        return -1;
+    }
+
+    printf( "SRCNN layer benchmark, libsrcnn %s\n", LIBSRCNN_VERSION );
+    printf( "- Threads : %u, runs : %u after %u warmup\n", threads, opt_runs, opt_warmup );
+    fflush( stdout );
+
+    double peak_bw = measureBandwidth( exec );
+    double peak_fl = measureFlops( exec, threads );
+
+    printf( "- Machine peak : %.2f GB/s ( STREAM triad ), %.2f GFLOP/s ( multiply-add )\n",
+            peak_bw * 1e-9, peak_fl * 1e-9 );
+    printf( "- Ridge point : %.2f flop/byte\n", peak_fl / peak_bw );
+    printf( "\n" );
+    printf( "%-18s %-5s %10s %10s %9s %9s %8s %9s %6s\n",
+            "kernel", "size", "median ms", "p95 ms", "GFLOP/s", "GB/s", "flop/B",
+            "roof %", "bound" );
+    fflush( stdout );
+
+    for ( unsigned sc = 0; sc < bench_sizes_count; sc++ )
+    {
+        const BenchSize& bs = bench_sizes[sc];
+
+        if ( sizeSelected( bs ) == false )
+            continue;
+
+        BenchData bd;
+
+        if ( makeData( bd, bs.width, bs.height, exec ) == false )
+        {
+            printf( "%-18s %-5s skipped, out of memory.\n", "-", bs.name );
+            freeData( bd );
+            continue;
+        }
+
+        vector<BenchKernel> kernels;
+        makeKernels( bd, kernels );
+
+        for ( unsigned kc = 0; kc < kernels.size(); kc++ )
+        {
+            const BenchKernel& k  = kernels[kc];
+            BenchTimes         bt = timeKernel( k, bd );
+
+            double gfl  = k.flops / bt.median;
+            double gbs  = k.bytes / bt.median;
+            double ai   = k.flops / k.bytes;
+            double roof = min( peak_fl, ai * peak_bw );     /// attainable.
+
+            printf( "%-18s %-5s %10.3f %10.3f %9.2f %9.2f %8.2f %8.1f%% %6s\n",
+                    k.name, bs.name, bt.median * 1e3, bt.p95 * 1e3,
+                    gfl * 1e-9, gbs * 1e-9, ai, gfl / roof * 100.0,
+                    ai * peak_bw < peak_fl ? "memory" : "compute" );
+            fflush( stdout );
+        }
+
+        freeData( bd );
+    }
+
+    srcnn_executor_pool_destroy( exec );
+
+    return 0;
+}
+
+#endif /// of FORBENCHBIN
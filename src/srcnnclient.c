@@ -0,0 +1,422 @@
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "srcnnclient.h"
+
+#ifndef F_ADD_SEALS
+    #define F_ADD_SEALS     1033
+#endif
+
+#ifndef F_SEAL_SHRINK
+    #define F_SEAL_SHRINK   0x0002
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+static int writeAll( int fd, const void* data, size_t size )
+{
+    const char* ptr = (const char*)data;
+
+    while( size > 0 )
+    {
+        ssize_t wsz = send( fd, ptr, size, MSG_NOSIGNAL );
+
+        if ( wsz < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            return SRCNN_CLIENT_EIO;
+        }
+
+        ptr  += wsz;
+        size -= (size_t)wsz;
+    }
+
+    return SRCNN_REP_OK;
+}
+
+static int readAll( int fd, void* data, size_t size )
+{
+    char* ptr = (char*)data;
+
+    while( size > 0 )
+    {
+        ssize_t rsz = recv( fd, ptr, size, 0 );
+
+        if ( rsz < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            return SRCNN_CLIENT_EIO;
+        }
+
+        if ( rsz == 0 )
+            return SRCNN_CLIENT_EIO;
+
+        ptr  += rsz;
+        size -= (size_t)rsz;
+    }
+
+    return SRCNN_REP_OK;
+}
+
+static void makeHeader( srcnn_req_header* req, unsigned type, float scale,
+                        unsigned flags, size_t payloadsz, const char* format )
+{
+    memset( req, 0, sizeof( srcnn_req_header ) );
+
+    req->magic        = SRCNN_PROTO_MAGIC;
+    req->version      = SRCNN_PROTO_VERSION;
+    req->type         = (uint16_t)type;
+    req->scale        = scale;
+    req->flags        = flags;
+    req->payload_size = (uint32_t)payloadsz;
+
+    if ( format != NULL )
+    {
+        strncpy( req->format, format, SRCNN_PROTO_FORMAT_LEN - 1 );
+    }
+}
+
+// Reads reply header and drops or returns payload.
+static int readReply( int fd, srcnn_rep_header* rep, void** out, size_t* outsz )
+{
+    int reti = readAll( fd, rep, sizeof( srcnn_rep_header ) );
+
+    if ( reti != SRCNN_REP_OK )
+        return reti;
+
+    if ( rep->magic != SRCNN_PROTO_MAGIC )
+        return SRCNN_CLIENT_EIO;
+
+    void* payload = NULL;
+
+    if ( rep->payload_size > 0 )
+    {
+        payload = malloc( rep->payload_size );
+
+        if ( payload == NULL )
+            return SRCNN_CLIENT_EIO;
+
+        reti = readAll( fd, payload, rep->payload_size );
+
+        if ( reti != SRCNN_REP_OK )
+        {
+            free( payload );
+            return reti;
+        }
+    }
+
+    if ( out != NULL )
+    {
+        *out = payload;
+
+        if ( outsz != NULL )
+        {
+            *outsz = rep->payload_size;
+        }
+    }
+    else
+    {
+        free( payload );
+    }
+
+    return rep->status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int srcnn_client_connect( srcnn_client* cli, const char* sockpath )
+{
+    struct sockaddr_un addr;
+
+    if ( ( cli == NULL ) || ( sockpath == NULL ) )
+        return SRCNN_CLIENT_EIO;
+
+    cli->fd = -1;
+
+    if ( strlen( sockpath ) >= sizeof( addr.sun_path ) )
+        return SRCNN_CLIENT_EIO;
+
+    int fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+
+    if ( fd < 0 )
+        return SRCNN_CLIENT_EIO;
+
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, sockpath );
+
+    if ( connect( fd, (struct sockaddr*)&addr, sizeof( addr ) ) != 0 )
+    {
+        close( fd );
+        return SRCNN_CLIENT_EIO;
+    }
+
+    cli->fd = fd;
+
+    return SRCNN_REP_OK;
+}
+
+void srcnn_client_close( srcnn_client* cli )
+{
+    if ( ( cli != NULL ) && ( cli->fd >= 0 ) )
+    {
+        close( cli->fd );
+        cli->fd = -1;
+    }
+}
+
+unsigned srcnn_client_output_size( unsigned size, float scale )
+{
+    // must be same expression to daemon's.
+    return (unsigned)( (float)size * scale );
+}
+
+int srcnn_client_process_path( srcnn_client* cli, const char* src,
+                               const char* dst, float scale, unsigned flags )
+{
+    if ( ( cli == NULL ) || ( src == NULL ) || ( dst == NULL ) )
+        return SRCNN_REP_EREQUEST;
+
+    size_t srclen = strlen( src ) + 1;
+    size_t dstlen = strlen( dst ) + 1;
+    char*  payload = (char*)malloc( srclen + dstlen );
+
+    if ( payload == NULL )
+        return SRCNN_CLIENT_EIO;
+
+    memcpy( payload, src, srclen );
+    memcpy( payload + srclen, dst, dstlen );
+
+    srcnn_req_header req;
+    srcnn_rep_header rep;
+
+    makeHeader( &req, SRCNN_REQ_PATH, scale, flags, srclen + dstlen, NULL );
+
+    int reti = writeAll( cli->fd, &req, sizeof( req ) );
+
+    if ( reti == SRCNN_REP_OK )
+    {
+        reti = writeAll( cli->fd, payload, srclen + dstlen );
+    }
+
+    free( payload );
+
+    if ( reti != SRCNN_REP_OK )
+        return reti;
+
+    return readReply( cli->fd, &rep, NULL, NULL );
+}
+
+int srcnn_client_process_image( srcnn_client* cli,
+                                const void* data, size_t datasz,
+                                const char* format, float scale, unsigned flags,
+                                void** out, size_t* outsz,
+                                srcnn_rep_header* rep )
+{
+    if ( ( cli == NULL ) || ( data == NULL ) || ( datasz == 0 ) )
+        return SRCNN_REP_EREQUEST;
+
+    srcnn_req_header req;
+    srcnn_rep_header reptmp;
+
+    if ( rep == NULL )
+    {
+        rep = &reptmp;
+    }
+
+    makeHeader( &req, SRCNN_REQ_IMAGE, scale, flags, datasz, format );
+
+    int reti = writeAll( cli->fd, &req, sizeof( req ) );
+
+    if ( reti == SRCNN_REP_OK )
+    {
+        reti = writeAll( cli->fd, data, datasz );
+    }
+
+    if ( reti != SRCNN_REP_OK )
+        return reti;
+
+    return readReply( cli->fd, rep, out, outsz );
+}
+
+int srcnn_client_process_shm( srcnn_client* cli,
+                              const srcnn_shm* src, const srcnn_shm* dst,
+                              srcnn_shm_desc* desc, float scale, unsigned flags )
+{
+    if ( ( cli == NULL ) || ( src == NULL ) || ( dst == NULL ) ||
+         ( desc == NULL ) || ( scale <= 0.f ) )
+        return SRCNN_REP_EREQUEST;
+
+    if ( desc->dst_width == 0 )
+    {
+        desc->dst_width = srcnn_client_output_size( desc->width, scale );
+    }
+
+    if ( desc->dst_height == 0 )
+    {
+        desc->dst_height = srcnn_client_output_size( desc->height, scale );
+    }
+
+    if ( desc->src_stride == 0 )
+    {
+        desc->src_stride = desc->width * desc->channels;
+    }
+
+    if ( desc->dst_stride == 0 )
+    {
+        desc->dst_stride = desc->dst_width * desc->channels;
+    }
+
+    srcnn_req_header req;
+    srcnn_rep_header rep;
+
+    makeHeader( &req, SRCNN_REQ_SHM, scale, flags, sizeof( srcnn_shm_desc ), NULL );
+
+    // both descriptors ride on request header.
+    union
+    {
+        struct cmsghdr  align;
+        char            buff[ CMSG_SPACE( sizeof( int ) * 2 ) ];
+    }cmsgbuff;
+
+    struct iovec    iov;
+    struct msghdr   msg;
+    struct cmsghdr* cmsg;
+    int             fds[2] = { -1, -1 };
+    unsigned        fdcnt  = 0;
+
+    if ( src->fd >= 0 )
+        fds[ fdcnt++ ] = src->fd;
+
+    if ( dst->fd >= 0 )
+        fds[ fdcnt++ ] = dst->fd;
+
+    memset( &cmsgbuff, 0, sizeof( cmsgbuff ) );
+    memset( &msg, 0, sizeof( msg ) );
+
+    iov.iov_base       = &req;
+    iov.iov_len        = sizeof( req );
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+
+    // daemon refuses request without both, leave that decision to it.
+    if ( fdcnt > 0 )
+    {
+        msg.msg_control    = cmsgbuff.buff;
+        msg.msg_controllen = CMSG_SPACE( sizeof( int ) * fdcnt );
+
+        cmsg             = CMSG_FIRSTHDR( &msg );
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type  = SCM_RIGHTS;
+        cmsg->cmsg_len   = CMSG_LEN( sizeof( int ) * fdcnt );
+        memcpy( CMSG_DATA( cmsg ), fds, sizeof( int ) * fdcnt );
+    }
+
+    ssize_t wsz = -1;
+
+    do
+    {
+        wsz = sendmsg( cli->fd, &msg, MSG_NOSIGNAL );
+    }
+    while( ( wsz < 0 ) && ( errno == EINTR ) );
+
+    if ( wsz < 0 )
+        return SRCNN_CLIENT_EIO;
+
+    int reti = SRCNN_REP_OK;
+
+    // remained header bytes, descriptors already delivered.
+    if ( (size_t)wsz < sizeof( req ) )
+    {
+        reti = writeAll( cli->fd, (char*)&req + wsz, sizeof( req ) - (size_t)wsz );
+    }
+
+    if ( reti == SRCNN_REP_OK )
+    {
+        reti = writeAll( cli->fd, desc, sizeof( srcnn_shm_desc ) );
+    }
+
+    if ( reti != SRCNN_REP_OK )
+        return reti;
+
+    return readReply( cli->fd, &rep, NULL, NULL );
+}
+
+int srcnn_shm_create( srcnn_shm* shm, size_t size )
+{
+    if ( ( shm == NULL ) || ( size == 0 ) )
+        return SRCNN_CLIENT_ESHM;
+
+    shm->fd   = -1;
+    shm->ptr  = NULL;
+    shm->size = 0;
+
+    int fd = -1;
+
+#ifdef SYS_memfd_create
+    fd = (int)syscall( SYS_memfd_create, "srcnn-shm",
+                       3U /* MFD_CLOEXEC | MFD_ALLOW_SEALING */ );
+#endif
+
+    if ( fd < 0 )
+        return SRCNN_CLIENT_ESHM;
+
+    // daemon refuses buffers which could shrink under its mapping.
+    if ( ( ftruncate( fd, (off_t)size ) != 0 ) ||
+         ( fcntl( fd, F_ADD_SEALS, F_SEAL_SHRINK ) != 0 ) )
+    {
+        close( fd );
+        return SRCNN_CLIENT_ESHM;
+    }
+
+    void* ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+    if ( ptr == MAP_FAILED )
+    {
+        close( fd );
+        return SRCNN_CLIENT_ESHM;
+    }
+
+    shm->fd   = fd;
+    shm->ptr  = ptr;
+    shm->size = size;
+
+    return SRCNN_REP_OK;
+}
+
+void srcnn_shm_destroy( srcnn_shm* shm )
+{
+    if ( shm == NULL )
+        return;
+
+    if ( shm->ptr != NULL )
+    {
+        munmap( shm->ptr, shm->size );
+        shm->ptr = NULL;
+    }
+
+    if ( shm->fd >= 0 )
+    {
+        close( shm->fd );
+        shm->fd = -1;
+    }
+
+    shm->size = 0;
+}
@@ -0,0 +1,67 @@
+#ifndef __SRCNNCLIENT_H__
+#define __SRCNNCLIENT_H__
+
+/*******************************************************************************
+ * srcnn daemon client library, plain C.
+ * ----------------------------------------------------------------------------
+ * Talks to "srcnn --daemon=path" over Unix domain socket, see srcnnproto.h.
+ * All calls are blocking, one connection should be used by one thread.
+ * Functions return SRCNN_REP_OK ( 0 ) or negative SRCNN_REP_ status,
+ * SRCNN_CLIENT_EIO for socket failures.
+*******************************************************************************/
+
+#include <stddef.h>
+#include "srcnnproto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SRCNN_CLIENT_EIO            -100        /* socket send or receive */
+#define SRCNN_CLIENT_ESHM           -101        /* shared memory create or map */
+
+typedef struct
+{
+    int         fd;
+}srcnn_client;
+
+/* Shared memory buffer, fd can be sent to daemon. */
+typedef struct
+{
+    int         fd;
+    void*       ptr;
+    size_t      size;
+}srcnn_shm;
+
+int  srcnn_client_connect( srcnn_client* cli, const char* sockpath );
+void srcnn_client_close( srcnn_client* cli );
+
+/* Output size of daemon for width or height in given scale. */
+unsigned srcnn_client_output_size( unsigned size, float scale );
+
+/* Daemon reads src and writes dst by itself. */
+int  srcnn_client_process_path( srcnn_client* cli, const char* src,
+                                const char* dst, float scale, unsigned flags );
+
+/* Encoded image in, encoded image out. *out is malloc()ed, free() it. */
+int  srcnn_client_process_image( srcnn_client* cli,
+                                 const void* data, size_t datasz,
+                                 const char* format, float scale, unsigned flags,
+                                 void** out, size_t* outsz,
+                                 srcnn_rep_header* rep );
+
+/* Zero copy, daemon maps both buffers and writes output pixels in place.
+   desc->dst_width and dst_height are filled when 0. */
+int  srcnn_client_process_shm( srcnn_client* cli,
+                               const srcnn_shm* src, const srcnn_shm* dst,
+                               srcnn_shm_desc* desc, float scale, unsigned flags );
+
+/* memfd buffer sealed against shrinking, mapped read and write. */
+int  srcnn_shm_create( srcnn_shm* shm, size_t size );
+void srcnn_shm_destroy( srcnn_shm* shm );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* of __SRCNNCLIENT_H__ */
@@ -0,0 +1,298 @@
+/*******************************************************************************
+ * srcnn-shmtest : shared memory request test client for srcnn daemon.
+ * ----------------------------------------------------------------------------
+ * usage : srcnn-shmtest [socket path] [scale] [width] [height]
+ *
+ * Makes a synthetic BGR and gray image in memfd, processes it through
+ * SRCNN_REQ_SHM, then processes same pixels as PPM/PGM file through
+ * SRCNN_REQ_PATH and checks both outputs are identical.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "srcnnclient.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void makeImage( unsigned char* ptr, unsigned w, unsigned h,
+                       unsigned ch, unsigned stride )
+{
+    for( unsigned y = 0; y < h; y++ )
+    {
+        unsigned char* row = ptr + (size_t)y * stride;
+
+        for( unsigned x = 0; x < w; x++ )
+        {
+            // edges and gradients, something for CNN to work on.
+            unsigned v = ( ( x / 8 + y / 8 ) & 1 ) ? 200 : 40;
+            v += ( x * 31 + y * 17 ) % 48;
+
+            for( unsigned c = 0; c < ch; c++ )
+            {
+                row[ x * ch + c ] = (unsigned char)( ( v + c * 29 ) & 0xFF );
+            }
+        }
+    }
+}
+
+static int writePNM( const char* path, const unsigned char* ptr,
+                     unsigned w, unsigned h, unsigned ch, unsigned stride )
+{
+    FILE* fp = fopen( path, "wb" );
+
+    if ( fp == NULL )
+        return -1;
+
+    fprintf( fp, "P%c\n%u %u\n255\n", ch == 1 ? '5' : '6', w, h );
+
+    for( unsigned y = 0; y < h; y++ )
+    {
+        const unsigned char* row = ptr + (size_t)y * stride;
+
+        if ( ch == 3 )
+        {
+            // PNM is RGB, memory is BGR.
+            for( unsigned x = 0; x < w; x++ )
+            {
+                fputc( row[ x * 3 + 2 ], fp );
+                fputc( row[ x * 3 + 1 ], fp );
+                fputc( row[ x * 3 + 0 ], fp );
+            }
+        }
+        else
+        {
+            fwrite( row, 1, w, fp );
+        }
+    }
+
+    fclose( fp );
+
+    return 0;
+}
+
+static unsigned char* readPNM( const char* path, unsigned* w, unsigned* h, unsigned* ch )
+{
+    FILE* fp = fopen( path, "rb" );
+
+    if ( fp == NULL )
+        return NULL;
+
+    char     magic[3] = {0};
+    unsigned maxv     = 0;
+
+    if ( ( fscanf( fp, "%2s %u %u %u", magic, w, h, &maxv ) != 4 ) ||
+         ( magic[0] != 'P' ) || ( maxv != 255 ) )
+    {
+        fclose( fp );
+        return NULL;
+    }
+
+    fgetc( fp );
+
+    *ch = ( magic[1] == '5' ) ? 1 : 3;
+
+    size_t         sz  = (size_t)(*w) * (*h) * (*ch);
+    unsigned char* buf = (unsigned char*)malloc( sz );
+
+    if ( ( buf == NULL ) || ( fread( buf, 1, sz, fp ) != sz ) )
+    {
+        free( buf );
+        fclose( fp );
+        return NULL;
+    }
+
+    fclose( fp );
+
+    if ( *ch == 3 )
+    {
+        for( size_t cnt = 0; cnt < sz; cnt += 3 )
+        {
+            unsigned char t = buf[cnt];
+            buf[cnt]     = buf[cnt + 2];
+            buf[cnt + 2] = t;
+        }
+    }
+
+    return buf;
+}
+
+static int testOne( srcnn_client* cli, float scale, unsigned w, unsigned h, unsigned ch )
+{
+    unsigned srcstride = w * ch + 16;   /// padded rows on purpose.
+    unsigned dw        = srcnn_client_output_size( w, scale );
+    unsigned dh        = srcnn_client_output_size( h, scale );
+    unsigned dststride = dw * ch;
+    unsigned offset    = 4096;          /// pixels not at start of fd.
+
+    srcnn_shm src;
+    srcnn_shm dst;
+
+    if ( srcnn_shm_create( &src, (size_t)srcstride * h ) != 0 )
+    {
+        printf( "- shared memory create failure.\n" );
+        return -1;
+    }
+
+    if ( srcnn_shm_create( &dst, offset + (size_t)dststride * dh ) != 0 )
+    {
+        printf( "- shared memory create failure.\n" );
+        srcnn_shm_destroy( &src );
+        return -1;
+    }
+
+    makeImage( (unsigned char*)src.ptr, w, h, ch, srcstride );
+
+    srcnn_shm_desc desc;
+    memset( &desc, 0, sizeof( desc ) );
+
+    desc.width      = w;
+    desc.height     = h;
+    desc.channels   = ch;
+    desc.src_stride = srcstride;
+    desc.dst_offset = offset;
+
+    unsigned flags = ( ch == 1 ) ? SRCNN_REQF_GRAY : 0;
+    int      reti  = srcnn_client_process_shm( cli, &src, &dst, &desc, scale, flags );
+
+    printf( "- %ux%u, %u channel(s), x%.2f : shm status %d, ", w, h, ch, scale, reti );
+
+    if ( reti == 0 )
+    {
+        char     srcpath[64];
+        char     dstpath[64];
+        unsigned rw  = 0;
+        unsigned rh  = 0;
+        unsigned rch = 0;
+
+        snprintf( srcpath, sizeof( srcpath ), "/tmp/srcnn-shmtest-%d-src.%s",
+                  (int)getpid(), ch == 1 ? "pgm" : "ppm" );
+        snprintf( dstpath, sizeof( dstpath ), "/tmp/srcnn-shmtest-%d-dst.%s",
+                  (int)getpid(), ch == 1 ? "pgm" : "ppm" );
+
+        writePNM( srcpath, (unsigned char*)src.ptr, w, h, ch, srcstride );
+
+        reti = srcnn_client_process_path( cli, srcpath, dstpath, scale, flags );
+
+        printf( "path status %d, ", reti );
+
+        unsigned char* ref = NULL;
+
+        if ( reti == 0 )
+        {
+            ref = readPNM( dstpath, &rw, &rh, &rch );
+        }
+
+        if ( ( ref == NULL ) || ( rw != dw ) || ( rh != dh ) || ( rch != ch ) )
+        {
+            reti = -1;
+        }
+        else
+        {
+            unsigned diffs = 0;
+
+            for( unsigned y = 0; y < dh; y++ )
+            {
+                const unsigned char* row = (unsigned char*)dst.ptr + offset
+                                           + (size_t)y * dststride;
+
+                if ( memcmp( row, ref + (size_t)y * dw * ch, (size_t)dw * ch ) != 0 )
+                {
+                    diffs++;
+                }
+            }
+
+            printf( "%u different row(s), ", diffs );
+
+            if ( diffs > 0 )
+            {
+                reti = -1;
+            }
+        }
+
+        free( ref );
+        unlink( srcpath );
+        unlink( dstpath );
+    }
+
+    printf( "%s\n", reti == 0 ? "Ok." : "Failure." );
+
+    srcnn_shm_destroy( &dst );
+    srcnn_shm_destroy( &src );
+
+    return reti;
+}
+
+int main( int argc, char** argv )
+{
+    const char* sockpath = "/tmp/srcnn.sock";
+    float       scale    = 2.0f;
+    unsigned    w        = 96;
+    unsigned    h        = 64;
+
+    if ( argc > 1 )
+        sockpath = argv[1];
+
+    if ( argc > 2 )
+        scale = (float)atof( argv[2] );
+
+    if ( argc > 3 )
+        w = (unsigned)atoi( argv[3] );
+
+    if ( argc > 4 )
+        h = (unsigned)atoi( argv[4] );
+
+    srcnn_client cli;
+
+    if ( srcnn_client_connect( &cli, sockpath ) != 0 )
+    {
+        printf( "Cannot connect to %s\n", sockpath );
+        return -1;
+    }
+
+    int fails = 0;
+
+    if ( testOne( &cli, scale, w, h, 3 ) != 0 )
+        fails++;
+
+    if ( testOne( &cli, scale, w, h, 1 ) != 0 )
+        fails++;
+
+    // malformed : no descriptors given.
+    {
+        srcnn_shm_desc desc;
+        memset( &desc, 0, sizeof( desc ) );
+
+        desc.width    = w;
+        desc.height   = h;
+        desc.channels = 3;
+
+        srcnn_shm none;
+        none.fd   = -1;
+        none.ptr  = NULL;
+        none.size = 0;
+
+        srcnn_client_close( &cli );
+
+        if ( srcnn_client_connect( &cli, sockpath ) == 0 )
+        {
+            int reti = srcnn_client_process_shm( &cli, &none, &none, &desc, scale, 0 );
+
+            printf( "- request without descriptors : status %d, %s\n",
+                    reti, reti == SRCNN_REP_EREQUEST ? "Ok." : "Failure." );
+
+            if ( reti != SRCNN_REP_EREQUEST )
+                fails++;
+        }
+        else
+        {
+            fails++;
+        }
+    }
+
+    srcnn_client_close( &cli );
+
+    return fails;
+}
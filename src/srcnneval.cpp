@@ -0,0 +1,644 @@
+/*******************************************************************************
+ * srcnn-eval : quality and throughput of engine modes on ground truth.
+ * ----------------------------------------------------------------------------
+ * Same to Pictures/Resize.m, each ground truth image is made low resolution
+ * by bicubic ( FRAWResizeEngine ), then every mode scales it back. PSNR and
+ * SSIM on luma are reported next to megapixels per second, and modes not
+ * beaten on both are marked as Pareto front to pick production tier.
+*******************************************************************************/
+#ifdef FOREVALBIN
+
+#include <unistd.h>
+#include <dirent.h>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <png.h>
+#include <jpeglib.h>
+
+#include "libsrcnn.h"
+#include "srcnnprof.h"
+#include "frawscale.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define SSIM_WINDOW     11
+#define SSIM_SIGMA      1.5
+#define SSIM_C1         ( ( 0.01 * 255 ) * ( 0.01 * 255 ) )
+#define SSIM_C2         ( ( 0.03 * 255 ) * ( 0.03 * 255 ) )
+
+typedef struct
+{
+    const srcnn_executor*   exec;
+    srcnn_context*          ctx;
+}EvalContext;
+
+// lr is lw x lh, hr gets ow x oh. Returns 0 or negative for failure.
+typedef int (*EvalModeFn)( EvalContext& ec,
+                           const unsigned char* lr, unsigned lw, unsigned lh, float scale,
+                           unsigned char* hr, unsigned ow, unsigned oh );
+
+typedef struct
+{
+    const char* name;
+    EvalModeFn  run;
+    const char* about;
+}EvalMode;
+
+typedef struct
+{
+    double      psnr;       /// sum over images.
+    double      ssim;
+    double      mpixels;
+    double      seconds;
+    unsigned    images;
+    bool        failed;
+}EvalResult;
+
+static float    opt_scale   = 2.0f;
+static unsigned opt_threads = 0;
+static int      opt_shave   = -1;   /// -1 for ceil( scale ).
+static string   opt_modes;
+static string   opt_dir;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned char roundByte( float v )
+{
+    v += 0.5f;
+    return (unsigned char)( v < 0.f ? 0.f : ( v > 255.f ? 255.f : v ) );
+}
+
+// FRAW bicubic of 8bit luma, rounded back.
+static bool frawBicubic( const unsigned char* src, unsigned sw, unsigned sh,
+                         unsigned char* dst, unsigned dw, unsigned dh )
+{
+    vector<float> fsrc( (size_t)sw * sh );
+
+    for ( size_t cnt = 0; cnt < fsrc.size(); cnt++ )
+    {
+        fsrc[cnt] = src[cnt];
+    }
+
+    FRAWBicubicFilter filter;
+    FRAWResizeEngine  engine( &filter );
+    float*            fdst = NULL;
+
+    if ( engine.scale( fsrc.data(), sw, sh, dw, dh, &fdst ) == 0 )
+        return false;
+
+    for ( size_t cnt = 0; cnt < (size_t)dw * dh; cnt++ )
+    {
+        dst[cnt] = roundByte( fdst[cnt] );
+    }
+
+    delete[] fdst;
+
+    return true;
+}
+
+static int runBicubic( EvalContext& /* ec */,
+                       const unsigned char* lr, unsigned lw, unsigned lh, float /* scale */,
+                       unsigned char* hr, unsigned ow, unsigned oh )
+{
+    return frawBicubic( lr, lw, lh, hr, ow, oh ) == true ? 0 : -1;
+}
+
+static int runExact( EvalContext& ec,
+                     const unsigned char* lr, unsigned lw, unsigned lh, float scale,
+                     unsigned char* hr, unsigned ow, unsigned /* oh */ )
+{
+    return srcnn_process_ctx( ec.ctx, lr, lw, lh, 1, lw, scale, hr, ow );
+}
+
+// Modes of engine, new speed or quality tiers go here.
+static const EvalMode eval_modes[] =
+{
+    { "bicubic", runBicubic, "FRAW bicubic only, lower bound" },
+    { "exact",   runExact,   "libsrcnn float layers" },
+};
+
+static const unsigned eval_modes_count = sizeof( eval_modes ) / sizeof( EvalMode );
+
+////////////////////////////////////////////////////////////////////////////////
+
+static double evalPSNR( const unsigned char* a, const unsigned char* b,
+                        unsigned w, unsigned h, unsigned shave )
+{
+    double   se = 0.0;
+    size_t   n  = 0;
+
+    for ( unsigned y = shave; y + shave < h; y++ )
+    {
+        for ( unsigned x = shave; x + shave < w; x++ )
+        {
+            double d = (double)a[ (size_t)y * w + x ] - (double)b[ (size_t)y * w + x ];
+            se += d * d;
+            n++;
+        }
+    }
+
+    if ( n == 0 )
+        return 0.0;
+
+    if ( se == 0.0 )
+        return 100.0;   /// same image, capped as MATLAB tools do.
+
+    return 10.0 * log10( 255.0 * 255.0 / ( se / (double)n ) );
+}
+
+// SSIM of Wang et al., 11x11 gaussian of 1.5, mean over valid windows.
+static double evalSSIM( const unsigned char* a, const unsigned char* b,
+                        unsigned w, unsigned h, unsigned shave )
+{
+    if ( ( w <= shave * 2 + SSIM_WINDOW ) || ( h <= shave * 2 + SSIM_WINDOW ) )
+        return 0.0;
+
+    double g[ SSIM_WINDOW ];
+    double gsum = 0.0;
+
+    for ( int cnt = 0; cnt < SSIM_WINDOW; cnt++ )
+    {
+        double d = cnt - SSIM_WINDOW / 2;
+        g[cnt] = exp( -( d * d ) / ( 2.0 * SSIM_SIGMA * SSIM_SIGMA ) );
+        gsum  += g[cnt];
+    }
+
+    for ( int cnt = 0; cnt < SSIM_WINDOW; cnt++ )
+    {
+        g[cnt] /= gsum;
+    }
+
+    unsigned cw = w - shave * 2;
+    unsigned ch = h - shave * 2;
+
+    // separable blur of a, b, a*a, b*b, a*b, rows first.
+    vector<double> rows( (size_t)cw * ch * 5, 0.0 );
+    unsigned       rw = cw - SSIM_WINDOW + 1;
+
+    for ( unsigned y = 0; y < ch; y++ )
+    {
+        const unsigned char* pa = a + (size_t)( y + shave ) * w + shave;
+        const unsigned char* pb = b + (size_t)( y + shave ) * w + shave;
+
+        for ( unsigned x = 0; x < rw; x++ )
+        {
+            double s[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+
+            for ( int k = 0; k < SSIM_WINDOW; k++ )
+            {
+                double va = pa[ x + k ];
+                double vb = pb[ x + k ];
+
+                s[0] += g[k] * va;
+                s[1] += g[k] * vb;
+                s[2] += g[k] * va * va;
+                s[3] += g[k] * vb * vb;
+                s[4] += g[k] * va * vb;
+            }
+
+            for ( int q = 0; q < 5; q++ )
+                rows[ ( (size_t)y * rw + x ) * 5 + q ] = s[q];
+        }
+    }
+
+    double   total = 0.0;
+    unsigned rh    = ch - SSIM_WINDOW + 1;
+
+    for ( unsigned y = 0; y < rh; y++ )
+    {
+        for ( unsigned x = 0; x < rw; x++ )
+        {
+            double s[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+
+            for ( int k = 0; k < SSIM_WINDOW; k++ )
+            {
+                const double* r = &rows[ ( (size_t)( y + k ) * rw + x ) * 5 ];
+
+                for ( int q = 0; q < 5; q++ )
+                    s[q] += g[k] * r[q];
+            }
+
+            double ma  = s[0];
+            double mb  = s[1];
+            double va  = s[2] - ma * ma;
+            double vb  = s[3] - mb * mb;
+            double cab = s[4] - ma * mb;
+
+            total += ( ( 2 * ma * mb + SSIM_C1 ) * ( 2 * cab + SSIM_C2 ) ) /
+                     ( ( ma * ma + mb * mb + SSIM_C1 ) * ( va + vb + SSIM_C2 ) );
+        }
+    }
+
+    return total / ( (double)rw * rh );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Y of RGB, same coefficients to libsrcnn.
+static void rgbToLuma( const unsigned char* rgb, size_t px, vector<unsigned char>& luma )
+{
+    luma.resize( px );
+
+    for ( size_t cnt = 0; cnt < px; cnt++ )
+    {
+        const unsigned char* p = rgb + cnt * 3;
+        luma[cnt] = roundByte( 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2] );
+    }
+}
+
+static bool loadPNG( const char* path, vector<unsigned char>& luma, unsigned& w, unsigned& h )
+{
+    png_image pimg;
+
+    memset( &pimg, 0, sizeof( pimg ) );
+    pimg.version = PNG_IMAGE_VERSION;
+
+    if ( png_image_begin_read_from_file( &pimg, path ) == 0 )
+        return false;
+
+    pimg.format = PNG_FORMAT_RGB;
+
+    vector<unsigned char> rgb( PNG_IMAGE_SIZE( pimg ) );
+
+    if ( png_image_finish_read( &pimg, NULL, rgb.data(), 0, NULL ) == 0 )
+    {
+        png_image_free( &pimg );
+        return false;
+    }
+
+    w = pimg.width;
+    h = pimg.height;
+
+    rgbToLuma( rgb.data(), (size_t)w * h, luma );
+
+    return true;
+}
+
+typedef struct
+{
+    struct jpeg_error_mgr   pub;
+    jmp_buf                 jump;
+}EvalJPEGError;
+
+static void jpegErrorExit( j_common_ptr cinfo )
+{
+    EvalJPEGError* err = (EvalJPEGError*)cinfo->err;
+    longjmp( err->jump, 1 );
+}
+
+static bool loadJPEG( const char* path, vector<unsigned char>& luma, unsigned& w, unsigned& h )
+{
+    FILE* fp = fopen( path, "rb" );
+
+    if ( fp == NULL )
+        return false;
+
+    struct jpeg_decompress_struct cinfo;
+    EvalJPEGError                 jerr;
+    vector<unsigned char>         rgb;
+
+    cinfo.err = jpeg_std_error( &jerr.pub );
+    jerr.pub.error_exit = jpegErrorExit;
+
+    if ( setjmp( jerr.jump ) != 0 )
+    {
+        jpeg_destroy_decompress( &cinfo );
+        fclose( fp );
+        return false;
+    }
+
+    jpeg_create_decompress( &cinfo );
+    jpeg_stdio_src( &cinfo, fp );
+    jpeg_read_header( &cinfo, TRUE );
+
+    cinfo.out_color_space = JCS_RGB;
+
+    jpeg_start_decompress( &cinfo );
+
+    rgb.resize( (size_t)cinfo.output_width * cinfo.output_height * 3 );
+
+    while( cinfo.output_scanline < cinfo.output_height )
+    {
+        JSAMPROW row = &rgb[ (size_t)cinfo.output_scanline * cinfo.output_width * 3 ];
+        jpeg_read_scanlines( &cinfo, &row, 1 );
+    }
+
+    w = cinfo.output_width;
+    h = cinfo.output_height;
+
+    jpeg_finish_decompress( &cinfo );
+    jpeg_destroy_decompress( &cinfo );
+    fclose( fp );
+
+    rgbToLuma( rgb.data(), (size_t)w * h, luma );
+
+    return true;
+}
+
+static string lowerExt( const string& name )
+{
+    size_t dot = name.rfind( '.' );
+
+    if ( dot == string::npos )
+        return "";
+
+    string ext = name.substr( dot );
+
+    for ( size_t cnt = 0; cnt < ext.size(); cnt++ )
+        ext[cnt] = tolower( ext[cnt] );
+
+    return ext;
+}
+
+static void listImages( const string& dir, vector<string>& files )
+{
+    DIR* dp = opendir( dir.c_str() );
+
+    if ( dp == NULL )
+        return;
+
+    struct dirent* de = NULL;
+
+    while( ( de = readdir( dp ) ) != NULL )
+    {
+        string ext = lowerExt( de->d_name );
+
+        if ( ( ext == ".png" ) || ( ext == ".jpg" ) || ( ext == ".jpeg" ) )
+        {
+            files.push_back( dir + "/" + de->d_name );
+        }
+    }
+
+    closedir( dp );
+
+    sort( files.begin(), files.end() );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static bool modeSelected( const EvalMode& em )
+{
+    if ( opt_modes.size() == 0 )
+        return true;
+
+    string list = "," + opt_modes + ",";
+
+    return list.find( string( "," ) + em.name + "," ) != string::npos;
+}
+
+static void printHelp( const char* me )
+{
+    printf( "    usage : %s (options) [ground truth directory]\n", me );
+    printf( "\n" );
+    printf( "    _options_:\n" );
+    printf( "\n" );
+    printf( "        --scale=( ratio: 1.1 to .. ) : down and up scaling ratio, default 2.\n" );
+    printf( "        --threads=(count)            : executor threads, default all cores.\n" );
+    printf( "        --modes=(name,..)            : modes to run, default all.\n" );
+    printf( "        --shave=(pixels)             : border left out of scores, default scale.\n" );
+    printf( "        --help                       : this help\n" );
+    printf( "\n" );
+    printf( "    modes :\n" );
+
+    for ( unsigned cnt = 0; cnt < eval_modes_count; cnt++ )
+    {
+        printf( "        %-28s : %s\n", eval_modes[cnt].name, eval_modes[cnt].about );
+    }
+
+    printf( "\n" );
+}
+
+static bool parseArgs( int argc, char** argv )
+{
+    for ( int cnt = 1; cnt < argc; cnt++ )
+    {
+        string strtmp = argv[cnt];
+
+        if ( strtmp.find( "--scale=" ) == 0 )
+        {
+            float tmpfv = atof( strtmp.substr( 8 ).c_str() );
+            if ( tmpfv > 1.0f )
+                opt_scale = tmpfv;
+        }
+        else
+        if ( strtmp.find( "--threads=" ) == 0 )
+        {
+            int tmpiv = atoi( strtmp.substr( 10 ).c_str() );
+            if ( tmpiv > 0 )
+                opt_threads = tmpiv;
+        }
+        else
+        if ( strtmp.find( "--modes=" ) == 0 )
+        {
+            opt_modes = strtmp.substr( 8 );
+        }
+        else
+        if ( strtmp.find( "--shave=" ) == 0 )
+        {
+            opt_shave = atoi( strtmp.substr( 8 ).c_str() );
+        }
+        else
+        if ( strtmp.find( "--" ) == 0 )
+        {
+            return false;
+        }
+        else
+        if ( opt_dir.size() == 0 )
+        {
+            opt_dir = strtmp;
+        }
+    }
+
+    return ( opt_dir.size() > 0 );
+}
+
+int main( int argc, char** argv )
+{
+    if ( parseArgs( argc, argv ) == false )
+    {
+        printHelp( argv[0] );
+        return 0;
+    }
+
+    vector<string> files;
+    listImages( opt_dir, files );
+
+    if ( files.size() == 0 )
+    {
+        printf( "Error: no PNG or JPEG in %s\n", opt_dir.c_str() );
+        return 1;
+    }
+
+    srcnn_executor* exec = srcnn_executor_steal_create( opt_threads );
+    EvalContext     ec;
+
+    ec.exec = exec;
+    ec.ctx  = srcnn_context_create();
+
+    if ( ( exec == NULL ) || ( ec.ctx == NULL ) )
+    {
+        printf( "Error: engine failure.\n" );
+        return 1;
+    }
+
+    srcnn_context_set_executor( ec.ctx, exec );
+
+    unsigned shave = opt_shave >= 0 ? (unsigned)opt_shave : (unsigned)ceil( opt_scale );
+
+    vector<EvalResult> results( eval_modes_count );
+    memset( results.data(), 0, sizeof( EvalResult ) * results.size() );
+
+    printf( "SRCNN evaluation, %u image%s, scale %.2f, shave %u\n",
+            (unsigned)files.size(), files.size() > 1 ? "s" : "", opt_scale, shave );
+    printf( "\n" );
+    printf( "%-32s %-12s %9s %8s %10s\n", "image", "mode", "PSNR dB", "SSIM", "MP/s" );
+    fflush( stdout );
+
+    for ( unsigned fc = 0; fc < files.size(); fc++ )
+    {
+        vector<unsigned char> gt;
+        unsigned              gw = 0;
+        unsigned              gh = 0;
+        string                ext = lowerExt( files[fc] );
+        bool                  loaded;
+
+        if ( ext == ".png" )
+            loaded = loadPNG( files[fc].c_str(), gt, gw, gh );
+        else
+            loaded = loadJPEG( files[fc].c_str(), gt, gw, gh );
+
+        if ( loaded == false )
+        {
+            printf( "%-32s load failure.\n", files[fc].c_str() );
+            continue;
+        }
+
+        // low resolution as Resize.m, then scored where output meets ground truth.
+        unsigned lw = (unsigned)( (float)gw / opt_scale );
+        unsigned lh = (unsigned)( (float)gh / opt_scale );
+        unsigned ow = 0;
+        unsigned oh = 0;
+
+        if ( ( lw < 2 ) || ( lh < 2 ) ||
+             ( srcnn_output_size( lw, lh, opt_scale, &ow, &oh ) != SRCNN_OK ) )
+        {
+            printf( "%-32s too small.\n", files[fc].c_str() );
+            continue;
+        }
+
+        vector<unsigned char> lr( (size_t)lw * lh );
+
+        frawBicubic( gt.data(), gw, gh, lr.data(), lw, lh );
+
+        unsigned cw = min( gw, ow );
+        unsigned ch = min( gh, oh );
+
+        vector<unsigned char> gtc( (size_t)cw * ch );
+        vector<unsigned char> hr( (size_t)ow * oh );
+        vector<unsigned char> hrc( (size_t)cw * ch );
+
+        for ( unsigned y = 0; y < ch; y++ )
+        {
+            memcpy( &gtc[ (size_t)y * cw ], &gt[ (size_t)y * gw ], cw );
+        }
+
+        for ( unsigned mc = 0; mc < eval_modes_count; mc++ )
+        {
+            const EvalMode& em = eval_modes[mc];
+
+            if ( modeSelected( em ) == false )
+                continue;
+
+            uint64_t t0   = ProfNow();
+            int      reti = em.run( ec, lr.data(), lw, lh, opt_scale, hr.data(), ow, oh );
+            double   sec  = (double)( ProfNow() - t0 ) * 1e-9;
+
+            if ( reti != 0 )
+            {
+                printf( "%-32s %-12s failure ( %d ).\n", files[fc].c_str(), em.name, reti );
+                results[mc].failed = true;
+                continue;
+            }
+
+            for ( unsigned y = 0; y < ch; y++ )
+            {
+                memcpy( &hrc[ (size_t)y * cw ], &hr[ (size_t)y * ow ], cw );
+            }
+
+            double psnr = evalPSNR( gtc.data(), hrc.data(), cw, ch, shave );
+            double ssim = evalSSIM( gtc.data(), hrc.data(), cw, ch, shave );
+            double mpx  = (double)ow * oh * 1e-6;
+
+            results[mc].psnr    += psnr;
+            results[mc].ssim    += ssim;
+            results[mc].mpixels += mpx;
+            results[mc].seconds += sec;
+            results[mc].images++;
+
+            printf( "%-32s %-12s %9.3f %8.4f %10.3f\n",
+                    files[fc].c_str(), em.name, psnr, ssim, sec > 0.0 ? mpx / sec : 0.0 );
+            fflush( stdout );
+        }
+    }
+
+    // front : no other mode is as good or better on PSNR and speed, better on one.
+    printf( "\n" );
+    printf( "%-12s %6s %9s %8s %10s  %s\n", "mode", "images", "PSNR dB", "SSIM", "MP/s", "Pareto" );
+
+    for ( unsigned mc = 0; mc < eval_modes_count; mc++ )
+    {
+        const EvalResult& er = results[mc];
+
+        if ( er.images == 0 )
+            continue;
+
+        double psnr = er.psnr / er.images;
+        double mps  = er.seconds > 0.0 ? er.mpixels / er.seconds : 0.0;
+        bool   front = true;
+
+        for ( unsigned qc = 0; qc < eval_modes_count; qc++ )
+        {
+            const EvalResult& eq = results[qc];
+
+            if ( ( qc == mc ) || ( eq.images == 0 ) )
+                continue;
+
+            double qpsnr = eq.psnr / eq.images;
+            double qmps  = eq.seconds > 0.0 ? eq.mpixels / eq.seconds : 0.0;
+
+            if ( ( qpsnr >= psnr ) && ( qmps >= mps ) && ( ( qpsnr > psnr ) || ( qmps > mps ) ) )
+            {
+                front = false;
+                break;
+            }
+        }
+
+        printf( "%-12s %6u %9.3f %8.4f %10.3f  %s\n",
+                eval_modes[mc].name, er.images, psnr, er.ssim / er.images, mps,
+                front == true ? "*" : "" );
+    }
+
+    srcnn_context_destroy( ec.ctx );
+    srcnn_executor_pool_destroy( exec );
+
+    for ( unsigned mc = 0; mc < eval_modes_count; mc++ )
+    {
+        if ( results[mc].failed == true )
+            return 1;
+    }
+
+    return 0;
+}
+
+#endif /// of FOREVALBIN
@@ -0,0 +1,888 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+#include <deque>
+#include <ctime>
+
+#include <unistd.h>
+#include <pthread.h>
+#ifdef __linux__
+    #include <sched.h>
+#endif
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+
+#include "libsrcnn.h"
+#include "srcnnnuma.h"
+#include "srcnnprof.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Built-in executors of libsrcnn.
+// - serial : runs everything on caller thread.
+// - OpenMP : one parallel region per loop, serial when already in a region.
+// - pool   : pthread workers and caller share chunks of a loop.
+// - steal  : work-stealing workers with own deques, chunks of loops from
+//            any threads may be in flight at once.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+    srcnn_task_fn       fn;
+    void*               arg;
+    size_t              range;
+    size_t              grain;
+    size_t              chunks;
+    volatile size_t     next;       /// next chunk to be taken.
+    volatile size_t     done;       /// chunks completed.
+    unsigned            active;     /// workers inside this job.
+}PoolJob;
+
+class ExecPool
+{
+    public:
+        ExecPool( unsigned threads );
+        ~ExecPool();
+
+    public:
+        void run( size_t range, size_t grain, srcnn_task_fn fn, void* arg );
+
+    private:
+        static void* workerCall( void* p );
+        static void  drain( PoolJob* job );
+
+    private:
+        pthread_mutex_t     _lock;
+        pthread_mutex_t     _runlock;   /// one loop at a time.
+        pthread_cond_t      _wake;
+        pthread_cond_t      _done;
+        vector<pthread_t>   _workers;
+        PoolJob*            _job;
+        bool                _quit;
+};
+
+// set in pool workers, loops from inside a worker run serially.
+static __thread ExecPool* tls_pool = NULL;
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+    srcnn_task_fn       fn;
+    void*               arg;
+    volatile size_t     remain;     /// chunks not completed.
+}StealJob;
+
+typedef struct
+{
+    StealJob*           job;
+    size_t              begin;
+    size_t              end;
+}StealTask;
+
+typedef struct
+{
+    pthread_mutex_t         lock;
+    deque<StealTask>        tasks;  /// owner takes back, thieves take front.
+    srcnn_worker_stats      stats;
+}StealQueue;
+
+class ExecSteal
+{
+    public:
+        ExecSteal( unsigned threads, const int* cpus = NULL, unsigned cpucount = 0,
+                   const int* nodes = NULL );
+        ~ExecSteal();
+
+    public:
+        void     run( size_t range, size_t grain, srcnn_task_fn fn, void* arg );
+        unsigned stats( srcnn_worker_stats* out, unsigned maxcount );
+        void     resetStats();
+
+    private:
+        static void* workerCall( void* p );
+        bool take( int self, StealTask& task, bool& stolen );
+        void execute( int self, const StealTask& task, bool stolen );
+        void account( int self, size_t tasks, bool stolen, unsigned long long ns );
+
+    private:
+        pthread_mutex_t         _lock;
+        pthread_cond_t          _wake;
+        pthread_cond_t          _done;
+        vector<pthread_t>       _workers;
+        vector<StealQueue*>     _queues;    /// one per worker, last for callers.
+        vector< vector<int> >   _victims;   /// steal order, same node first.
+        volatile size_t         _queued;    /// tasks in all deques.
+        unsigned long long      _started;   /// ns of stats reset.
+        bool                    _quit;
+};
+
+typedef struct
+{
+    ExecSteal*  steal;
+    int         index;
+    int         cpu;        /// pinned CPU, -1 for none.
+}StealWorkerArg;
+
+// worker index in its scheduler, -1 for other threads.
+static __thread ExecSteal* tls_steal       = NULL;
+static __thread int        tls_steal_index = -1;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static inline size_t loadCount( volatile size_t* p )
+{
+    return __atomic_load_n( p, __ATOMIC_ACQUIRE );
+}
+
+static unsigned long long nowNs()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned threadCount( unsigned threads )
+{
+    if ( threads == 0 )
+    {
+        long ncpu = sysconf( _SC_NPROCESSORS_ONLN );
+        threads = ncpu > 0 ? (unsigned)ncpu : 1;
+    }
+
+    return threads;
+}
+
+static void pinThread( int cpu )
+{
+#ifdef __linux__
+    if ( ( cpu >= 0 ) && ( cpu < CPU_SETSIZE ) )
+    {
+        cpu_set_t cset;
+
+        CPU_ZERO( &cset );
+        CPU_SET( cpu, &cset );
+
+        pthread_setaffinity_np( pthread_self(), sizeof( cset ), &cset );
+    }
+#endif /// of __linux__
+}
+
+static size_t chunkCount( size_t range, size_t& grain )
+{
+    if ( grain == 0 )
+        grain = 1;
+
+    return ( range + grain - 1 ) / grain;
+}
+
+static void serialFor( void* /* user */, size_t range, size_t /* grain */,
+                       srcnn_task_fn fn, void* arg )
+{
+    if ( range > 0 )
+    {
+        fn( arg, 0, range );
+    }
+}
+
+static void openmpFor( void* user, size_t range, size_t grain,
+                       srcnn_task_fn fn, void* arg )
+{
+#ifdef _OPENMP
+    long chunks = (long)chunkCount( range, grain );
+
+    if ( ( omp_in_parallel() == 0 ) && ( chunks > 1 ) )
+    {
+        #pragma omp parallel for schedule(dynamic)
+        for ( long cnt = 0; cnt < chunks; cnt++ )
+        {
+            size_t begin = (size_t)cnt * grain;
+            size_t end   = begin + grain;
+
+            fn( arg, begin, end < range ? end : range );
+        }
+
+        return;
+    }
+#endif /// of _OPENMP
+
+    serialFor( user, range, grain, fn, arg );
+}
+
+static void poolFor( void* user, size_t range, size_t grain,
+                     srcnn_task_fn fn, void* arg )
+{
+    ExecPool* pool = (ExecPool*)user;
+
+    if ( ( pool == NULL ) || ( tls_pool == pool ) )
+    {
+        serialFor( user, range, grain, fn, arg );
+        return;
+    }
+
+    pool->run( range, grain, fn, arg );
+}
+
+static void stealFor( void* user, size_t range, size_t grain,
+                      srcnn_task_fn fn, void* arg )
+{
+    ExecSteal* steal = (ExecSteal*)user;
+
+    if ( steal == NULL )
+    {
+        serialFor( user, range, grain, fn, arg );
+        return;
+    }
+
+    steal->run( range, grain, fn, arg );
+}
+
+static const srcnn_executor exec_serial = { serialFor, NULL };
+static const srcnn_executor exec_openmp = { openmpFor, NULL };
+
+////////////////////////////////////////////////////////////////////////////////
+
+ExecPool::ExecPool( unsigned threads )
+ : _job( NULL ),
+   _quit( false )
+{
+    pthread_mutex_init( &_lock, NULL );
+    pthread_mutex_init( &_runlock, NULL );
+    pthread_cond_init( &_wake, NULL );
+    pthread_cond_init( &_done, NULL );
+
+    threads = threadCount( threads );
+
+    // caller thread works too.
+    for ( unsigned cnt = 1; cnt < threads; cnt++ )
+    {
+        pthread_t pt;
+
+        if ( pthread_create( &pt, NULL, workerCall, this ) == 0 )
+        {
+            _workers.push_back( pt );
+        }
+    }
+}
+
+ExecPool::~ExecPool()
+{
+    pthread_mutex_lock( &_lock );
+    _quit = true;
+    pthread_cond_broadcast( &_wake );
+    pthread_mutex_unlock( &_lock );
+
+    for ( size_t cnt = 0; cnt < _workers.size(); cnt++ )
+    {
+        pthread_join( _workers[cnt], NULL );
+    }
+
+    pthread_cond_destroy( &_done );
+    pthread_cond_destroy( &_wake );
+    pthread_mutex_destroy( &_runlock );
+    pthread_mutex_destroy( &_lock );
+}
+
+void ExecPool::drain( PoolJob* job )
+{
+    while( true )
+    {
+        size_t chunk = __sync_fetch_and_add( &job->next, 1 );
+
+        if ( chunk >= job->chunks )
+            break;
+
+        size_t begin = chunk * job->grain;
+        size_t end   = begin + job->grain;
+
+        job->fn( job->arg, begin, end < job->range ? end : job->range );
+
+        __sync_add_and_fetch( &job->done, 1 );
+    }
+}
+
+void ExecPool::run( size_t range, size_t grain, srcnn_task_fn fn, void* arg )
+{
+    PoolJob job;
+
+    job.fn     = fn;
+    job.arg    = arg;
+    job.range  = range;
+    job.chunks = chunkCount( range, grain );
+    job.grain  = grain;
+    job.next   = 0;
+    job.done   = 0;
+    job.active = 0;
+
+    if ( ( job.chunks <= 1 ) || ( _workers.size() == 0 ) )
+    {
+        serialFor( NULL, range, grain, fn, arg );
+        return;
+    }
+
+    pthread_mutex_lock( &_runlock );
+
+    pthread_mutex_lock( &_lock );
+    _job = &job;
+    pthread_cond_broadcast( &_wake );
+    pthread_mutex_unlock( &_lock );
+
+    drain( &job );
+
+    // job lives on this stack, no worker may be left inside.
+    pthread_mutex_lock( &_lock );
+    while( ( loadCount( &job.done ) < job.chunks ) || ( job.active > 0 ) )
+    {
+        pthread_cond_wait( &_done, &_lock );
+    }
+    _job = NULL;
+    pthread_mutex_unlock( &_lock );
+
+    pthread_mutex_unlock( &_runlock );
+}
+
+void* ExecPool::workerCall( void* p )
+{
+    ExecPool* pool = (ExecPool*)p;
+
+    tls_pool = pool;
+
+    ProfThreadName( "pool worker" );
+
+    pthread_mutex_lock( &pool->_lock );
+
+    while( pool->_quit == false )
+    {
+        PoolJob* job = pool->_job;
+
+        if ( ( job == NULL ) || ( loadCount( &job->next ) >= job->chunks ) )
+        {
+            pthread_cond_wait( &pool->_wake, &pool->_lock );
+            continue;
+        }
+
+        job->active++;
+        pthread_mutex_unlock( &pool->_lock );
+
+        drain( job );
+
+        pthread_mutex_lock( &pool->_lock );
+        job->active--;
+
+        if ( ( job->active == 0 ) && ( loadCount( &job->done ) >= job->chunks ) )
+        {
+            pthread_cond_broadcast( &pool->_done );
+        }
+    }
+
+    pthread_mutex_unlock( &pool->_lock );
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ExecSteal::ExecSteal( unsigned threads, const int* cpus, unsigned cpucount,
+                      const int* nodes )
+ : _queued( 0 ),
+   _started( nowNs() ),
+   _quit( false )
+{
+    pthread_mutex_init( &_lock, NULL );
+    pthread_cond_init( &_wake, NULL );
+    pthread_cond_init( &_done, NULL );
+
+    if ( ( threads == 0 ) && ( cpus != NULL ) && ( cpucount > 0 ) )
+    {
+        threads = cpucount;
+    }
+
+    threads = threadCount( threads );
+
+    // callers help while waiting, so one thread less.
+    unsigned nworkers = threads > 1 ? threads - 1 : 0;
+
+    for ( unsigned cnt = 0; cnt <= nworkers; cnt++ )
+    {
+        StealQueue* q = new StealQueue;
+
+        pthread_mutex_init( &q->lock, NULL );
+        memset( &q->stats, 0, sizeof( srcnn_worker_stats ) );
+
+        q->stats.node = ( ( nodes != NULL ) && ( cnt < nworkers ) ) ? nodes[ cnt % cpucount ] : -1;
+
+        _queues.push_back( q );
+    }
+
+    // others of same node first, then remote ones, each from next index.
+    _victims.resize( nworkers + 1 );
+
+    for ( unsigned self = 0; self <= nworkers; self++ )
+    {
+        int selfnode = _queues[self]->stats.node;
+
+        for ( int pass = 0; pass < 2; pass++ )
+        {
+            for ( unsigned cnt = 1; cnt <= nworkers; cnt++ )
+            {
+                unsigned victim = ( self + cnt ) % ( nworkers + 1 );
+
+                if ( victim >= nworkers )
+                    continue;
+
+                bool local = ( _queues[victim]->stats.node == selfnode );
+
+                if ( local == ( pass == 0 ) )
+                {
+                    _victims[self].push_back( (int)victim );
+                }
+            }
+        }
+    }
+
+    for ( unsigned cnt = 0; cnt < nworkers; cnt++ )
+    {
+        StealWorkerArg* wa = new StealWorkerArg;
+        pthread_t       pt;
+
+        wa->steal = this;
+        wa->index = (int)cnt;
+        wa->cpu   = ( ( cpus != NULL ) && ( cpucount > 0 ) ) ? cpus[ cnt % cpucount ] : -1;
+
+        if ( pthread_create( &pt, NULL, workerCall, wa ) == 0 )
+        {
+            _workers.push_back( pt );
+        }
+        else
+        {
+            delete wa;
+        }
+    }
+}
+
+ExecSteal::~ExecSteal()
+{
+    pthread_mutex_lock( &_lock );
+    _quit = true;
+    pthread_cond_broadcast( &_wake );
+    pthread_mutex_unlock( &_lock );
+
+    for ( size_t cnt = 0; cnt < _workers.size(); cnt++ )
+    {
+        pthread_join( _workers[cnt], NULL );
+    }
+
+    for ( size_t cnt = 0; cnt < _queues.size(); cnt++ )
+    {
+        pthread_mutex_destroy( &_queues[cnt]->lock );
+        delete _queues[cnt];
+    }
+
+    pthread_cond_destroy( &_done );
+    pthread_cond_destroy( &_wake );
+    pthread_mutex_destroy( &_lock );
+}
+
+static void pushTasks( StealQueue* q, StealJob* job, size_t c0, size_t c1,
+                       size_t grain, size_t range )
+{
+    pthread_mutex_lock( &q->lock );
+
+    for ( size_t cnt = c0; cnt < c1; cnt++ )
+    {
+        StealTask task;
+
+        task.job   = job;
+        task.begin = cnt * grain;
+        task.end   = task.begin + grain < range ? task.begin + grain : range;
+
+        q->tasks.push_back( task );
+    }
+
+    pthread_mutex_unlock( &q->lock );
+}
+
+// Own deque from back first, then steals front of others.
+bool ExecSteal::take( int self, StealTask& task, bool& stolen )
+{
+    const vector<int>& victims = _victims[ self >= 0 ? self : _queues.size() - 1 ];
+
+    if ( self >= 0 )
+    {
+        StealQueue* q = _queues[self];
+
+        pthread_mutex_lock( &q->lock );
+        bool found = ( q->tasks.empty() == false );
+        if ( found == true )
+        {
+            task = q->tasks.back();
+            q->tasks.pop_back();
+        }
+        pthread_mutex_unlock( &q->lock );
+
+        if ( found == true )
+        {
+            __atomic_sub_fetch( &_queued, 1, __ATOMIC_ACQ_REL );
+            stolen = false;
+            return true;
+        }
+    }
+
+    for ( size_t cnt = 0; cnt < victims.size(); cnt++ )
+    {
+        StealQueue* q = _queues[ victims[cnt] ];
+
+        pthread_mutex_lock( &q->lock );
+        bool found = ( q->tasks.empty() == false );
+        if ( found == true )
+        {
+            task = q->tasks.front();
+            q->tasks.pop_front();
+        }
+        pthread_mutex_unlock( &q->lock );
+
+        if ( found == true )
+        {
+            __atomic_sub_fetch( &_queued, 1, __ATOMIC_ACQ_REL );
+            stolen = true;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ExecSteal::account( int self, size_t tasks, bool stolen, unsigned long long ns )
+{
+    srcnn_worker_stats* st = &_queues[ self >= 0 ? self : _queues.size() - 1 ]->stats;
+
+    __atomic_add_fetch( &st->tasks, tasks, __ATOMIC_RELAXED );
+    __atomic_add_fetch( &st->busy_ns, ns, __ATOMIC_RELAXED );
+
+    if ( stolen == true )
+    {
+        __atomic_add_fetch( &st->steals, tasks, __ATOMIC_RELAXED );
+    }
+}
+
+void ExecSteal::execute( int self, const StealTask& task, bool stolen )
+{
+    unsigned long long t0 = nowNs();
+
+    task.job->fn( task.job->arg, task.begin, task.end );
+
+    account( self, 1, stolen, nowNs() - t0 );
+
+    // job is on stack of its caller, never touched after last chunk.
+    if ( __atomic_sub_fetch( &task.job->remain, 1, __ATOMIC_ACQ_REL ) == 0 )
+    {
+        pthread_mutex_lock( &_lock );
+        pthread_cond_broadcast( &_done );
+        pthread_mutex_unlock( &_lock );
+    }
+}
+
+void ExecSteal::run( size_t range, size_t grain, srcnn_task_fn fn, void* arg )
+{
+    size_t chunks   = chunkCount( range, grain );
+    size_t nworkers = _queues.size() - 1;
+    int    self     = ( tls_steal == this ) ? tls_steal_index : -1;
+
+    if ( ( chunks <= 1 ) || ( nworkers == 0 ) )
+    {
+        unsigned long long t0 = nowNs();
+
+        serialFor( NULL, range, grain, fn, arg );
+
+        account( self, chunks, false, nowNs() - t0 );
+        return;
+    }
+
+    StealJob job;
+
+    job.fn     = fn;
+    job.arg    = arg;
+    job.remain = chunks;
+
+    // worker keeps nested loop in its own deque for others to steal,
+    // other threads deal contiguous blocks to every worker.
+    if ( self >= 0 )
+    {
+        pushTasks( _queues[self], &job, 0, chunks, grain, range );
+    }
+    else
+    {
+        for ( size_t qn = 0; qn < nworkers; qn++ )
+        {
+            pushTasks( _queues[qn], &job,
+                       chunks * qn / nworkers, chunks * ( qn + 1 ) / nworkers,
+                       grain, range );
+        }
+    }
+
+    pthread_mutex_lock( &_lock );
+    __atomic_add_fetch( &_queued, chunks, __ATOMIC_ACQ_REL );
+    pthread_cond_broadcast( &_wake );
+    pthread_mutex_unlock( &_lock );
+
+    // helps with any queued task, this or other loops, until own loop ends.
+    while( loadCount( &job.remain ) > 0 )
+    {
+        StealTask task;
+        bool      stolen = false;
+
+        if ( take( self, task, stolen ) == true )
+        {
+            execute( self, task, stolen );
+            continue;
+        }
+
+        // rest of chunks are running on other threads.
+        pthread_mutex_lock( &_lock );
+        while( ( loadCount( &job.remain ) > 0 ) && ( loadCount( &_queued ) == 0 ) )
+        {
+            pthread_cond_wait( &_done, &_lock );
+        }
+        pthread_mutex_unlock( &_lock );
+    }
+}
+
+void* ExecSteal::workerCall( void* p )
+{
+    StealWorkerArg* wa    = (StealWorkerArg*)p;
+    ExecSteal*      steal = wa->steal;
+    int             self  = wa->index;
+
+    pinThread( wa->cpu );
+
+    delete wa;
+
+    tls_steal       = steal;
+    tls_steal_index = self;
+
+    ProfThreadName( "steal worker" );
+
+    while( true )
+    {
+        StealTask task;
+        bool      stolen = false;
+
+        if ( steal->take( self, task, stolen ) == true )
+        {
+            steal->execute( self, task, stolen );
+            continue;
+        }
+
+        pthread_mutex_lock( &steal->_lock );
+        while( ( steal->_quit == false ) && ( loadCount( &steal->_queued ) == 0 ) )
+        {
+            pthread_cond_wait( &steal->_wake, &steal->_lock );
+        }
+        bool quit = steal->_quit;
+        pthread_mutex_unlock( &steal->_lock );
+
+        if ( quit == true )
+            break;
+    }
+
+    return NULL;
+}
+
+unsigned ExecSteal::stats( srcnn_worker_stats* out, unsigned maxcount )
+{
+    unsigned long long wall = nowNs() - __atomic_load_n( &_started, __ATOMIC_RELAXED );
+    unsigned           cnt  = 0;
+
+    for ( ; ( cnt < maxcount ) && ( cnt < _queues.size() ); cnt++ )
+    {
+        const srcnn_worker_stats* st = &_queues[cnt]->stats;
+
+        out[cnt].tasks   = __atomic_load_n( &st->tasks, __ATOMIC_RELAXED );
+        out[cnt].steals  = __atomic_load_n( &st->steals, __ATOMIC_RELAXED );
+        out[cnt].busy_ns = __atomic_load_n( &st->busy_ns, __ATOMIC_RELAXED );
+        out[cnt].wall_ns = wall;
+        out[cnt].node    = st->node;
+    }
+
+    return (unsigned)_queues.size();
+}
+
+void ExecSteal::resetStats()
+{
+    for ( size_t cnt = 0; cnt < _queues.size(); cnt++ )
+    {
+        srcnn_worker_stats* st = &_queues[cnt]->stats;
+
+        __atomic_store_n( &st->tasks, 0, __ATOMIC_RELAXED );
+        __atomic_store_n( &st->steals, 0, __ATOMIC_RELAXED );
+        __atomic_store_n( &st->busy_ns, 0, __ATOMIC_RELAXED );
+    }
+
+    __atomic_store_n( &_started, nowNs(), __ATOMIC_RELAXED );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const srcnn_executor* srcnn_executor_openmp( void )
+{
+    return &exec_openmp;
+}
+
+const srcnn_executor* srcnn_executor_serial( void )
+{
+    return &exec_serial;
+}
+
+const srcnn_executor* srcnn_executor_default( void )
+{
+#ifdef _OPENMP
+    return &exec_openmp;
+#else
+    return &exec_serial;
+#endif
+}
+
+srcnn_executor* srcnn_executor_pool_create( unsigned threads )
+{
+    srcnn_executor* exec = new (nothrow) srcnn_executor;
+
+    if ( exec == NULL )
+        return NULL;
+
+    ExecPool* pool = new (nothrow) ExecPool( threads );
+
+    if ( pool == NULL )
+    {
+        delete exec;
+        return NULL;
+    }
+
+    exec->parallel_for = poolFor;
+    exec->user         = pool;
+
+    return exec;
+}
+
+static srcnn_executor* stealCreate( unsigned threads, const int* cpus, unsigned cpu_count,
+                                    const int* nodes )
+{
+    srcnn_executor* exec = new (nothrow) srcnn_executor;
+
+    if ( exec == NULL )
+        return NULL;
+
+    ExecSteal* steal = new (nothrow) ExecSteal( threads, cpus, cpu_count, nodes );
+
+    if ( steal == NULL )
+    {
+        delete exec;
+        return NULL;
+    }
+
+    exec->parallel_for = stealFor;
+    exec->user         = steal;
+
+    return exec;
+}
+
+srcnn_executor* srcnn_executor_steal_create( unsigned threads )
+{
+    return srcnn_executor_steal_create_pinned( threads, NULL, 0 );
+}
+
+srcnn_executor* srcnn_executor_steal_create_pinned( unsigned threads,
+                                                    const int* cpus, unsigned cpu_count )
+{
+    return stealCreate( threads, cpus, cpu_count, NULL );
+}
+
+srcnn_executor* srcnn_executor_steal_create_numa( unsigned threads )
+{
+    vector<NUMANode> nodes;
+
+    if ( NUMADetect( nodes ) < 2 )
+    {
+        return stealCreate( threads, NULL, 0, NULL );
+    }
+
+    unsigned allcpus = 0;
+
+    for ( size_t cnt = 0; cnt < nodes.size(); cnt++ )
+    {
+        allcpus += nodes[cnt].cpus.size();
+    }
+
+    if ( threads == 0 )
+    {
+        threads = allcpus;
+    }
+
+    // workers fill nodes in turn, contiguous indices share a node,
+    // so neighbour tile blocks dealt to them stay on one node.
+    unsigned    nworkers = threads > 1 ? threads - 1 : 1;
+    vector<int> cpus( nworkers );
+    vector<int> nodeids( nworkers );
+
+    for ( unsigned cnt = 0; cnt < nworkers; cnt++ )
+    {
+        size_t          nn    = (size_t)cnt * nodes.size() / nworkers;
+        size_t          first = ( nn * nworkers + nodes.size() - 1 ) / nodes.size();
+        const NUMANode& node  = nodes[nn];
+
+        cpus[cnt]    = node.cpus[ ( cnt - first ) % node.cpus.size() ];
+        nodeids[cnt] = node.node;
+    }
+
+    return stealCreate( threads, cpus.data(), nworkers, nodeids.data() );
+}
+
+int srcnn_executor_steal_stats( const srcnn_executor* exec,
+                                srcnn_worker_stats* stats, unsigned max_count )
+{
+    if ( ( exec == NULL ) || ( exec->parallel_for != stealFor ) )
+        return SRCNN_EPARAM;
+
+    ExecSteal* steal = (ExecSteal*)exec->user;
+
+    if ( ( stats == NULL ) || ( max_count == 0 ) )
+    {
+        return (int)steal->stats( NULL, 0 );
+    }
+
+    return (int)steal->stats( stats, max_count );
+}
+
+void srcnn_executor_steal_reset( const srcnn_executor* exec )
+{
+    if ( ( exec != NULL ) && ( exec->parallel_for == stealFor ) )
+    {
+        ( (ExecSteal*)exec->user )->resetStats();
+    }
+}
+
+void srcnn_executor_pool_destroy( srcnn_executor* exec )
+{
+    if ( exec != NULL )
+    {
+        if ( exec->parallel_for == poolFor )
+        {
+            delete (ExecPool*)exec->user;
+        }
+        else
+        if ( exec->parallel_for == stealFor )
+        {
+            delete (ExecSteal*)exec->user;
+        }
+
+        delete exec;
+    }
+}
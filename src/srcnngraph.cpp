@@ -0,0 +1,892 @@
+/*******************************************************************************
+ * srcnngraph : graph executor and memory planner of image operations.
+ * ----------------------------------------------------------------------------
+ * Nodes run in order they were added, so a tensor lives from the node
+ * writing it first to the node reading it last. plan() places tensors of
+ * larger size first at lowest offset not used by a tensor alive at same
+ * time, external tensors take no arena.
+*******************************************************************************/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include "srcnngraph.h"
+#include "srcnnkernel.h"
+#include "srcnnprof.h"
+
+/* pre-calculated convolutional data */
+#include "convdata.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define GRAPH_ALIGN     64
+
+// Rows per executor chunk of generic convolution.
+#define CONV_GRAIN      4
+
+enum
+{
+    OP_SPLIT = 0,
+    OP_MERGE,
+    OP_RESIZE,
+    OP_CONV,
+    OP_RELU,
+    OP_LAYER12,         /// fused 9x9 + ReLU + 1x1 + ReLU of built-in model.
+    OP_LAYER3,
+    OP_CUSTOM,
+};
+
+struct SRCNNGraph::Tensor
+{
+    unsigned    width;
+    unsigned    height;
+    unsigned    channels;
+    int         type;
+    bool        planar;
+    bool        external;
+    void*       data;
+    size_t      stride;
+    size_t      planestride;
+    size_t      bytes;          /// arena bytes, 0 for external.
+    size_t      offset;
+    int         first;          /// node writing first, -1 for unused.
+    int         last;           /// node reading last.
+};
+
+struct SRCNNGraph::Node
+{
+    int             op;
+    bool            dead;       /// fused into other node.
+    int             in[ SRCNN_GRAPH_MAXIO ];
+    unsigned        nin;
+    int             out[ SRCNN_GRAPH_MAXIO ];
+    unsigned        nout;
+    int             scratch;    /// tensor alive in this node only, or -1.
+    unsigned        srcch;
+    unsigned        dstch;
+    SRCNNConvLayer  conv;
+    const char*     name;
+    SRCNNGraphFn    fn;
+    void*           user;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+static const SRCNNConvLayer builtin_layers[3] =
+{
+    { 9, 1, CONV1_FILTERS, &weights_conv1_data[0][0][0], biases_conv1, true },
+    { 1, CONV1_FILTERS, CONV2_FILTERS, &weights_conv2_data[0][0], biases_conv2, true },
+    { 5, CONV2_FILTERS, 1, &weights_conv3_data[0][0][0], &biases_conv3, false },
+};
+
+static const SRCNNModel builtin_model = { "srcnn-915", 3, builtin_layers };
+
+const SRCNNModel* SRCNNBuiltinModel()
+{
+    return &builtin_model;
+}
+
+static size_t alignSize( size_t sz, size_t align )
+{
+    return ( sz + align - 1 ) / align * align;
+}
+
+static size_t elemSize( int type )
+{
+    return type == SRCNN_TENSOR_F32 ? sizeof( float ) : 1;
+}
+
+// Same weights and biases to a layer of built-in model.
+static bool sameLayer( const SRCNNConvLayer& l, unsigned idx )
+{
+    const SRCNNConvLayer& b = builtin_layers[idx];
+
+    if ( ( l.ksize != b.ksize ) || ( l.cin != b.cin ) || ( l.cout != b.cout ) )
+        return false;
+
+    size_t wcnt = (size_t)b.cout * b.cin * b.ksize * b.ksize;
+
+    if ( ( l.weights != b.weights ) &&
+         ( memcmp( l.weights, b.weights, wcnt * sizeof( float ) ) != 0 ) )
+        return false;
+
+    if ( ( l.biases != b.biases ) &&
+         ( memcmp( l.biases, b.biases, b.cout * sizeof( float ) ) != 0 ) )
+        return false;
+
+    return true;
+}
+
+static inline int clampIndex( int v, int n )
+{
+    if ( v < 0 )
+        return 0;
+
+    if ( v >= n )
+        return n - 1;
+
+    return v;
+}
+
+// Element address of channel c at column x of row pointer.
+static inline const unsigned char* elemAt( const SRCNNTensorView& tv, const unsigned char* row,
+                                           unsigned x, unsigned c )
+{
+    size_t esz = elemSize( tv.type );
+
+    if ( tv.planestride > 0 )
+        return row + c * tv.planestride + x * esz;
+
+    return row + ( (size_t)x * tv.channels + c ) * esz;
+}
+
+static inline float loadElem( const SRCNNTensorView& tv, const unsigned char* p )
+{
+    if ( tv.type == SRCNN_TENSOR_F32 )
+        return *(const float*)p;
+
+    return (float)*p;
+}
+
+typedef struct
+{
+    const SRCNNConvLayer*   layer;
+    SRCNNTensorView         in;
+    SRCNNTensorView         out;
+    const int*              colf;   /// replicated border columns.
+}ConvArgs;
+
+/* generic direct convolution, rows of output */
+static void convRows( void* arg, size_t begin, size_t end )
+{
+    const ConvArgs*       ca = (const ConvArgs*)arg;
+    const SRCNNConvLayer* l  = ca->layer;
+    int                   r  = (int)l->ksize / 2;
+    unsigned              k  = l->ksize;
+
+    vector<const unsigned char*> rows( k );
+
+    for ( size_t row = begin; row < end; row++ )
+    {
+        for ( unsigned m = 0; m < k; m++ )
+        {
+            int sy = clampIndex( (int)row + (int)m - r, (int)ca->in.height );
+
+            rows[m] = (const unsigned char*)ca->in.data + (size_t)sy * ca->in.stride;
+        }
+
+        unsigned char* drow = (unsigned char*)ca->out.data + row * ca->out.stride;
+
+        for ( unsigned col = 0; col < ca->out.width; col++ )
+        {
+            for ( unsigned co = 0; co < l->cout; co++ )
+            {
+                const float* w   = l->weights + (size_t)co * l->cin * k * k;
+                float        sum = 0.f;
+
+                for ( unsigned ci = 0; ci < l->cin; ci++ )
+                {
+                    for ( unsigned m = 0; m < k; m++ )
+                    {
+                        for ( unsigned n = 0; n < k; n++ )
+                        {
+                            const unsigned char* p = elemAt( ca->in, rows[m],
+                                                             ca->colf[ col + n ], ci );
+
+                            sum += *w++ * loadElem( ca->in, p );
+                        }
+                    }
+                }
+
+                sum += l->biases[co];
+
+                if ( ( l->relu == true ) && ( sum < 0.f ) )
+                    sum = 0.f;
+
+                unsigned char* d = (unsigned char*)elemAt( ca->out, drow, col, co );
+
+                if ( ca->out.type == SRCNN_TENSOR_F32 )
+                {
+                    *(float*)d = sum;
+                }
+                else
+                {
+                    // truncated as layer III does.
+                    int iv = (int)sum;
+                    *d = (unsigned char)( iv < 0 ? 0 : ( iv > 255 ? 255 : iv ) );
+                }
+            }
+        }
+    }
+}
+
+static void reluRows( void* arg, size_t begin, size_t end )
+{
+    const ConvArgs* ca = (const ConvArgs*)arg;
+
+    for ( size_t row = begin; row < end; row++ )
+    {
+        const unsigned char* srow = (const unsigned char*)ca->in.data + row * ca->in.stride;
+        unsigned char*       drow = (unsigned char*)ca->out.data + row * ca->out.stride;
+
+        for ( unsigned c = 0; c < ca->in.channels; c++ )
+        {
+            for ( unsigned col = 0; col < ca->in.width; col++ )
+            {
+                const unsigned char* s = elemAt( ca->in, srow, col, c );
+                unsigned char*       d = (unsigned char*)elemAt( ca->out, drow, col, c );
+
+                if ( ca->out.type == SRCNN_TENSOR_F32 )
+                {
+                    float v = loadElem( ca->in, s );
+                    *(float*)d = v < 0.f ? 0.f : v;
+                }
+                else
+                {
+                    // 8bit is never negative.
+                    *d = (unsigned char)loadElem( ca->in, s );
+                }
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SRCNNGraph::SRCNNGraph()
+ : fusions( 0 ),
+   fusing( true ),
+   arenasz( 0 ),
+   unsharedsz( 0 ),
+   planned( false )
+{
+}
+
+SRCNNGraph::~SRCNNGraph()
+{
+    for ( size_t cnt = 0; cnt < tensors.size(); cnt++ )
+        delete tensors[cnt];
+
+    for ( size_t cnt = 0; cnt < nodes.size(); cnt++ )
+        delete nodes[cnt];
+}
+
+int SRCNNGraph::tensor( unsigned w, unsigned h, unsigned channels, int type, bool planar )
+{
+    Tensor* t = new Tensor;
+    memset( t, 0, sizeof( Tensor ) );
+
+    size_t esz = elemSize( type );
+
+    t->width    = w;
+    t->height   = h;
+    t->channels = channels;
+    t->type     = type;
+    t->planar   = ( planar == true ) || ( channels == 1 );
+    t->first    = -1;
+    t->last     = -1;
+
+    if ( t->planar == true )
+    {
+        t->stride      = (size_t)w * esz;
+        t->planestride = alignSize( t->stride * h, GRAPH_ALIGN );
+        t->bytes       = t->planestride * channels;
+    }
+    else
+    {
+        t->stride = (size_t)w * channels * esz;
+        t->bytes  = alignSize( t->stride * h, GRAPH_ALIGN );
+    }
+
+    tensors.push_back( t );
+
+    return (int)tensors.size() - 1;
+}
+
+int SRCNNGraph::external( void* data, unsigned w, unsigned h, unsigned channels, size_t stride )
+{
+    int id = tensor( w, h, channels, SRCNN_TENSOR_U8, false );
+
+    Tensor* t = tensors[id];
+
+    t->external = true;
+    t->bytes    = 0;
+    t->planestride = 0;
+
+    bind( id, data, stride );
+
+    return id;
+}
+
+void SRCNNGraph::bind( int id, void* data, size_t stride )
+{
+    Tensor* t = tensors[id];
+
+    t->data = data;
+
+    if ( stride > 0 )
+    {
+        t->stride = stride;
+    }
+}
+
+int SRCNNGraph::addNode( int op, const int* in, unsigned nin, const int* out, unsigned nout )
+{
+    Node* n = new Node;
+    memset( n, 0, sizeof( Node ) );
+
+    n->op      = op;
+    n->nin     = nin  < SRCNN_GRAPH_MAXIO ? nin  : SRCNN_GRAPH_MAXIO;
+    n->nout    = nout < SRCNN_GRAPH_MAXIO ? nout : SRCNN_GRAPH_MAXIO;
+    n->scratch = -1;
+
+    for ( unsigned cnt = 0; cnt < n->nin; cnt++ )
+        n->in[cnt] = in[cnt];
+
+    for ( unsigned cnt = 0; cnt < n->nout; cnt++ )
+        n->out[cnt] = out[cnt];
+
+    nodes.push_back( n );
+
+    return (int)nodes.size() - 1;
+}
+
+void SRCNNGraph::split( int src, int y, int cr, int cb )
+{
+    int out[3] = { y, cr, cb };
+
+    addNode( OP_SPLIT, &src, 1, out, 3 );
+}
+
+void SRCNNGraph::merge( int y, int cr, int cb, int dst )
+{
+    int in[3] = { y, cr, cb };
+
+    addNode( OP_MERGE, in, 3, &dst, 1 );
+}
+
+void SRCNNGraph::resize( int src, int dst, unsigned ch, unsigned dstch )
+{
+    int     id = addNode( OP_RESIZE, &src, 1, &dst, 1 );
+    Node*   n  = nodes[id];
+    Tensor* ts = tensors[src];
+    Tensor* td = tensors[dst];
+
+    n->srcch = ch;
+    n->dstch = dstch;
+
+    size_t wsz = SRCNNResizeWorkSize( ts->height, td->width, td->height );
+
+    n->scratch = tensor( (unsigned)wsz, 1, 1, SRCNN_TENSOR_U8 );
+}
+
+void SRCNNGraph::conv( const SRCNNConvLayer& layer, int src, int dst )
+{
+    int id = addNode( OP_CONV, &src, 1, &dst, 1 );
+
+    nodes[id]->conv = layer;
+}
+
+void SRCNNGraph::relu( int src, int dst )
+{
+    addNode( OP_RELU, &src, 1, &dst, 1 );
+}
+
+void SRCNNGraph::model( const SRCNNModel& m, int src, int dst )
+{
+    const Tensor* ts = tensors[src];
+
+    int cur = src;
+
+    for ( unsigned cnt = 0; cnt < m.count; cnt++ )
+    {
+        SRCNNConvLayer l   = m.layers[cnt];
+        bool           act = l.relu;
+
+        // ReLU is a node of its own, plan() fuses it back.
+        l.relu = false;
+
+        int next = dst;
+
+        if ( ( cnt + 1 < m.count ) || ( act == true ) )
+        {
+            next = tensor( ts->width, ts->height, l.cout, SRCNN_TENSOR_F32 );
+        }
+
+        conv( l, cur, next );
+        cur = next;
+
+        if ( act == true )
+        {
+            next = cnt + 1 < m.count ?
+                   tensor( ts->width, ts->height, l.cout, SRCNN_TENSOR_F32 ) : dst;
+
+            relu( cur, next );
+            cur = next;
+        }
+    }
+}
+
+void SRCNNGraph::custom( const char* name, SRCNNGraphFn fn, void* user,
+                         const int* in, unsigned nin, const int* out, unsigned nout )
+{
+    int   id = addNode( OP_CUSTOM, in, nin, out, nout );
+    Node* n  = nodes[id];
+
+    n->name = name;
+    n->fn   = fn;
+    n->user = user;
+}
+
+/***
+ * FuncName : fuse
+ * Function : fuses conv + ReLU, then layers of built-in model to kernels
+ * Parameter    : <void>
+ * Output   : <void>
+***/
+void SRCNNGraph::fuse()
+{
+    vector<unsigned> readers( tensors.size(), 0 );
+
+    for ( size_t cnt = 0; cnt < nodes.size(); cnt++ )
+    {
+        for ( unsigned q = 0; q < nodes[cnt]->nin; q++ )
+            readers[ nodes[cnt]->in[q] ]++;
+    }
+
+    // conv to ReLU, when conv output is read by ReLU only.
+    for ( size_t cnt = 0; cnt + 1 < nodes.size(); cnt++ )
+    {
+        Node* c = nodes[cnt];
+        Node* r = nodes[cnt + 1];
+
+        if ( ( c->op != OP_CONV ) || ( r->op != OP_RELU ) || ( r->in[0] != c->out[0] ) )
+            continue;
+
+        if ( ( tensors[ c->out[0] ]->external == true ) || ( readers[ c->out[0] ] != 1 ) )
+            continue;
+
+        c->conv.relu = true;
+        c->out[0]    = r->out[0];
+        r->dead      = true;
+        fusions++;
+    }
+
+    vector<Node*> live;
+
+    for ( size_t cnt = 0; cnt < nodes.size(); cnt++ )
+    {
+        if ( nodes[cnt]->dead == false )
+            live.push_back( nodes[cnt] );
+    }
+
+    // 9x9 and 1x1 of built-in model, both with ReLU, to float planes.
+    for ( size_t cnt = 0; cnt + 1 < live.size(); cnt++ )
+    {
+        Node* c1 = live[cnt];
+        Node* c2 = live[cnt + 1];
+
+        if ( ( c1->op != OP_CONV ) || ( c2->op != OP_CONV ) || ( c2->in[0] != c1->out[0] ) )
+            continue;
+
+        if ( ( c1->conv.relu == false ) || ( c2->conv.relu == false ) ||
+             ( sameLayer( c1->conv, 0 ) == false ) || ( sameLayer( c2->conv, 1 ) == false ) )
+            continue;
+
+        const Tensor* ts = tensors[ c1->in[0] ];
+        const Tensor* tm = tensors[ c1->out[0] ];
+        const Tensor* td = tensors[ c2->out[0] ];
+
+        if ( ( ts->type != SRCNN_TENSOR_U8 ) || ( ts->channels != 1 ) ||
+             ( tm->external == true ) || ( readers[ c1->out[0] ] != 1 ) ||
+             ( td->external == true ) || ( td->type != SRCNN_TENSOR_F32 ) ||
+             ( td->planar == false ) )
+            continue;
+
+        c1->op     = OP_LAYER12;
+        c1->out[0] = c2->out[0];
+        c2->dead   = true;
+        fusions++;
+        cnt++;
+    }
+
+    // 5x5 of built-in model, float planes to 8bit.
+    for ( size_t cnt = 0; cnt < live.size(); cnt++ )
+    {
+        Node* c = live[cnt];
+
+        if ( ( c->dead == true ) || ( c->op != OP_CONV ) || ( c->conv.relu == true ) ||
+             ( sameLayer( c->conv, 2 ) == false ) )
+            continue;
+
+        const Tensor* ts = tensors[ c->in[0] ];
+        const Tensor* td = tensors[ c->out[0] ];
+
+        if ( ( ts->type != SRCNN_TENSOR_F32 ) || ( ts->planar == false ) ||
+             ( ts->external == true ) || ( td->type != SRCNN_TENSOR_U8 ) )
+            continue;
+
+        c->op = OP_LAYER3;
+    }
+}
+
+/***
+ * FuncName : lifetimes
+ * Function : first and last node using each tensor
+ * Parameter    : <void>
+ * Output   : bool, false when a tensor is read before written
+***/
+bool SRCNNGraph::lifetimes()
+{
+    for ( size_t cnt = 0; cnt < tensors.size(); cnt++ )
+    {
+        tensors[cnt]->first = -1;
+        tensors[cnt]->last  = -1;
+    }
+
+    int idx = 0;
+
+    for ( size_t cnt = 0; cnt < nodes.size(); cnt++ )
+    {
+        const Node* n = nodes[cnt];
+
+        if ( n->dead == true )
+            continue;
+
+        for ( unsigned q = 0; q < n->nin; q++ )
+        {
+            Tensor* t = tensors[ n->in[q] ];
+
+            if ( ( t->external == false ) && ( t->first < 0 ) )
+                return false;
+
+            t->last = idx;
+        }
+
+        for ( unsigned q = 0; q < n->nout; q++ )
+        {
+            Tensor* t = tensors[ n->out[q] ];
+
+            if ( t->first < 0 )
+                t->first = idx;
+
+            t->last = max( t->last, idx );
+        }
+
+        if ( n->scratch >= 0 )
+        {
+            tensors[ n->scratch ]->first = idx;
+            tensors[ n->scratch ]->last  = idx;
+        }
+
+        idx++;
+    }
+
+    return true;
+}
+
+static bool largerFirst( const pair<size_t, int>& a, const pair<size_t, int>& b )
+{
+    if ( a.first != b.first )
+        return a.first > b.first;
+
+    return a.second < b.second;
+}
+
+/***
+ * FuncName : place
+ * Function : offsets of tensors in arena, greedy by size
+ * Parameter    : <void>
+ * Output   : <void>
+***/
+void SRCNNGraph::place()
+{
+    vector< pair<size_t, int> > order;
+
+    unsharedsz = 0;
+    arenasz    = 0;
+
+    for ( size_t cnt = 0; cnt < tensors.size(); cnt++ )
+    {
+        const Tensor* t = tensors[cnt];
+
+        if ( ( t->external == true ) || ( t->first < 0 ) )
+            continue;
+
+        order.push_back( make_pair( t->bytes, (int)cnt ) );
+        unsharedsz += t->bytes;
+    }
+
+    sort( order.begin(), order.end(), largerFirst );
+
+    vector<const Tensor*> placed;
+
+    for ( size_t cnt = 0; cnt < order.size(); cnt++ )
+    {
+        Tensor* t = tensors[ order[cnt].second ];
+
+        // ranges of placed tensors alive together with this one.
+        vector< pair<size_t, size_t> > busy;
+
+        for ( size_t q = 0; q < placed.size(); q++ )
+        {
+            const Tensor* p = placed[q];
+
+            if ( ( p->last < t->first ) || ( t->last < p->first ) )
+                continue;
+
+            busy.push_back( make_pair( p->offset, p->offset + p->bytes ) );
+        }
+
+        sort( busy.begin(), busy.end() );
+
+        size_t ofs = 0;
+
+        for ( size_t q = 0; q < busy.size(); q++ )
+        {
+            if ( ofs + t->bytes <= busy[q].first )
+                break;
+
+            ofs = max( ofs, busy[q].second );
+        }
+
+        t->offset = ofs;
+        arenasz   = max( arenasz, ofs + t->bytes );
+
+        placed.push_back( t );
+    }
+}
+
+void SRCNNGraph::fusion( bool enable )
+{
+    fusing = enable;
+}
+
+bool SRCNNGraph::plan( SRCNNGraphPlan* info )
+{
+    if ( planned == false )
+    {
+        if ( fusing == true )
+        {
+            fuse();
+        }
+
+        if ( lifetimes() == false )
+            return false;
+
+        place();
+
+        planned = true;
+    }
+
+    if ( info != NULL )
+    {
+        info->nodes    = 0;
+        info->fusions  = fusions;
+        info->arena    = arenasz;
+        info->unshared = unsharedsz;
+
+        for ( size_t cnt = 0; cnt < nodes.size(); cnt++ )
+        {
+            if ( nodes[cnt]->dead == false )
+                info->nodes++;
+        }
+    }
+
+    return true;
+}
+
+size_t SRCNNGraph::arenaSize() const
+{
+    return arenasz;
+}
+
+void SRCNNGraph::bindArena( void* arena )
+{
+    for ( size_t cnt = 0; cnt < tensors.size(); cnt++ )
+    {
+        Tensor* t = tensors[cnt];
+
+        if ( ( t->external == true ) || ( t->first < 0 ) )
+            continue;
+
+        t->data = (unsigned char*)arena + t->offset;
+    }
+}
+
+void SRCNNGraph::layerPlanes( vector<SRCNNTensorView>& views ) const
+{
+    views.clear();
+
+    for ( size_t cnt = 0; cnt < nodes.size(); cnt++ )
+    {
+        if ( ( nodes[cnt]->dead == false ) && ( nodes[cnt]->op == OP_LAYER12 ) )
+            views.push_back( view( nodes[cnt]->out[0] ) );
+    }
+}
+
+SRCNNTensorView SRCNNGraph::view( int id ) const
+{
+    const Tensor*   t = tensors[id];
+    SRCNNTensorView tv;
+
+    tv.data        = t->data;
+    tv.width       = t->width;
+    tv.height      = t->height;
+    tv.channels    = t->channels;
+    tv.type        = t->type;
+    tv.stride      = t->stride;
+    tv.planestride = t->planar == true ? t->planestride : 0;
+
+    return tv;
+}
+
+/***
+ * FuncName : run
+ * Function : runs planned nodes in order
+ * Parameter    : exec - executor of every node
+ * Output   : int, SRCNN_OK or failure of a node
+***/
+int SRCNNGraph::run( const srcnn_executor* exec )
+{
+    if ( planned == false )
+        return SRCNN_EPARAM;
+
+    if ( exec == NULL )
+    {
+        exec = srcnn_executor_default();
+    }
+
+    for ( size_t cnt = 0; cnt < nodes.size(); cnt++ )
+    {
+        const Node* n = nodes[cnt];
+
+        if ( n->dead == true )
+            continue;
+
+        SRCNNTensorView in[ SRCNN_GRAPH_MAXIO ];
+        SRCNNTensorView out[ SRCNN_GRAPH_MAXIO ];
+
+        for ( unsigned q = 0; q < n->nin; q++ )
+            in[q] = view( n->in[q] );
+
+        for ( unsigned q = 0; q < n->nout; q++ )
+            out[q] = view( n->out[q] );
+
+        switch( n->op )
+        {
+            case OP_SPLIT:
+                SRCNNSplitYCrCb( (const unsigned char*)in[0].data, in[0].stride, in[0].channels,
+                                 in[0].width, in[0].height,
+                                 (unsigned char*)out[0].data, (unsigned char*)out[1].data,
+                                 (unsigned char*)out[2].data, exec );
+                break;
+
+            case OP_MERGE:
+                SRCNNMergeYCrCb( (const unsigned char*)in[0].data, (const unsigned char*)in[1].data,
+                                 (const unsigned char*)in[2].data, out[0].width, out[0].height,
+                                 (unsigned char*)out[0].data, out[0].stride, out[0].channels,
+                                 exec );
+                break;
+
+            case OP_RESIZE:
+                {
+                    const unsigned char* src = (const unsigned char*)in[0].data;
+                    unsigned char*       dst = (unsigned char*)out[0].data;
+                    unsigned             ss  = 1;
+                    unsigned             ds  = 1;
+
+                    if ( in[0].planestride > 0 )
+                        src += n->srcch * in[0].planestride;
+                    else
+                    {
+                        src += n->srcch;
+                        ss   = in[0].channels;
+                    }
+
+                    if ( out[0].planestride > 0 )
+                        dst += n->dstch * out[0].planestride;
+                    else
+                    {
+                        dst += n->dstch;
+                        ds   = out[0].channels;
+                    }
+
+                    SRCNNResizeBicubic( src, in[0].stride, ss, in[0].width, in[0].height,
+                                        dst, out[0].stride, ds, out[0].width, out[0].height,
+                                        tensors[ n->scratch ]->data, exec );
+                }
+                break;
+
+            case OP_LAYER12:
+            case OP_LAYER3:
+                {
+                    const SRCNNTensorView& pv = n->op == OP_LAYER12 ? out[0] : in[0];
+                    float* planes[ SRCNN_KERNEL_PLANES ];
+
+                    for ( unsigned q = 0; q < SRCNN_KERNEL_PLANES; q++ )
+                        planes[q] = (float*)( (unsigned char*)pv.data + q * pv.planestride );
+
+                    if ( n->op == OP_LAYER12 )
+                    {
+                        SRCNNLayer12( (const unsigned char*)in[0].data, in[0].stride,
+                                      pv.width, pv.height, planes, pv.stride / sizeof( float ),
+                                      NULL, exec );
+                    }
+                    else
+                    {
+                        SRCNNLayer3( planes, pv.stride / sizeof( float ), pv.width, pv.height,
+                                     (unsigned char*)out[0].data, out[0].stride, NULL, exec );
+                    }
+                }
+                break;
+
+            case OP_CONV:
+            case OP_RELU:
+                {
+                    ProfScope prof( n->op == OP_CONV ? "conv" : "relu" );
+
+                    ConvArgs    ca;
+                    vector<int> colf;
+
+                    ca.layer = &n->conv;
+                    ca.in    = in[0];
+                    ca.out   = out[0];
+                    ca.colf  = NULL;
+
+                    if ( n->op == OP_CONV )
+                    {
+                        int r = (int)n->conv.ksize / 2;
+
+                        colf.resize( out[0].width + n->conv.ksize );
+
+                        for ( size_t q = 0; q < colf.size(); q++ )
+                            colf[q] = clampIndex( (int)q - r, (int)in[0].width );
+
+                        ca.colf = &colf[0];
+                    }
+
+                    exec->parallel_for( exec->user, out[0].height, CONV_GRAIN,
+                                        n->op == OP_CONV ? convRows : reluRows, &ca );
+                }
+                break;
+
+            case OP_CUSTOM:
+                {
+                    int reti = n->fn( n->user, in, n->nin, out, n->nout );
+
+                    if ( reti < 0 )
+                        return reti;
+                }
+                break;
+        }
+    }
+
+    return SRCNN_OK;
+}
@@ -0,0 +1,139 @@
+#ifndef __SRCNNGRAPH_H__
+#define __SRCNNGRAPH_H__
+
+#include <cstddef>
+#include <vector>
+#include "libsrcnn.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Graph of image operations run in order on one workspace arena.
+// - Tensors are 8bit or float images, planar ( a plane per channel ) or
+//   interleaved, external ones are bound by caller ( source and output ).
+// - plan() fuses nodes, then places every tensor in arena from its first
+//   writer to its last reader, tensors never alive at once share memory.
+// - Convolutions of a model run generic direct code, built-in SRCNN layers
+//   are recognized and fused to kernels of srcnnkernel.h.
+// - Custom nodes plug in other code, OpenCV of CLI for example.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define SRCNN_TENSOR_U8         0
+#define SRCNN_TENSOR_F32        1
+
+#define SRCNN_GRAPH_MAXIO       4       /// inputs or outputs of a custom node.
+
+typedef struct
+{
+    void*       data;
+    unsigned    width;
+    unsigned    height;
+    unsigned    channels;
+    int         type;           /// SRCNN_TENSOR_*.
+    size_t      stride;         /// bytes per row.
+    size_t      planestride;    /// bytes per plane, 0 for interleaved.
+}SRCNNTensorView;
+
+// Returns 0 or negative for failure, which stops graph.
+typedef int (*SRCNNGraphFn)( void* user,
+                             const SRCNNTensorView* in, unsigned nin,
+                             const SRCNNTensorView* out, unsigned nout );
+
+// weights as [cout][cin][ksize][ksize], stride 1, borders replicated.
+typedef struct
+{
+    unsigned        ksize;
+    unsigned        cin;
+    unsigned        cout;
+    const float*    weights;
+    const float*    biases;
+    bool            relu;
+}SRCNNConvLayer;
+
+typedef struct
+{
+    const char*             name;
+    unsigned                count;
+    const SRCNNConvLayer*   layers;
+}SRCNNModel;
+
+// 9-5-5 ( 9x9, 1x1, 5x5 ) model of convdata.h.
+const SRCNNModel* SRCNNBuiltinModel();
+
+typedef struct
+{
+    unsigned    nodes;          /// run after fusions.
+    unsigned    fusions;
+    size_t      arena;          /// bytes of planned arena.
+    size_t      unshared;       /// bytes when every tensor had its own.
+}SRCNNGraphPlan;
+
+class SRCNNGraph
+{
+    public:
+        SRCNNGraph();
+        ~SRCNNGraph();
+
+    public:
+        // Tensors, returns id. Interleaved when planar is false.
+        int  tensor( unsigned w, unsigned h, unsigned channels, int type,
+                     bool planar = true );
+        int  external( void* data, unsigned w, unsigned h, unsigned channels,
+                       size_t stride );
+        void bind( int id, void* data, size_t stride );
+
+        // Nodes, in order of run.
+        // Split and merge are RGB(A) to Y, Cr, Cb 8bit planes and back.
+        void split( int src, int y, int cr, int cb );
+        void merge( int y, int cr, int cb, int dst );
+        // Bicubic 8bit, channel ch of src to channel dstch of dst.
+        void resize( int src, int dst, unsigned ch = 0, unsigned dstch = 0 );
+        void conv( const SRCNNConvLayer& layer, int src, int dst );
+        void relu( int src, int dst );
+        // Layers of model from 8bit src to 8bit dst, may be same tensor.
+        void model( const SRCNNModel& m, int src, int dst );
+        void custom( const char* name, SRCNNGraphFn fn, void* user,
+                     const int* in, unsigned nin, const int* out, unsigned nout );
+
+    public:
+        // Fusions are on by default, off runs nodes as added ( verify ).
+        void fusion( bool enable );
+        // Fuses and places tensors, false for bad graph. Once per graph.
+        bool plan( SRCNNGraphPlan* info = NULL );
+        size_t arenaSize() const;
+        // arena of arenaSize() bytes, 64 bytes aligned.
+        void bindArena( void* arena );
+        // Float planes of fused layer I+II outputs, for NUMA placement.
+        void layerPlanes( std::vector<SRCNNTensorView>& views ) const;
+        SRCNNTensorView view( int id ) const;
+        int  run( const srcnn_executor* exec );
+
+    private:
+        struct Tensor;
+        struct Node;
+
+        int  addNode( int op, const int* in, unsigned nin, const int* out, unsigned nout );
+        void fuse();
+        bool lifetimes();
+        void place();
+
+    private:
+        std::vector<Tensor*>    tensors;
+        std::vector<Node*>      nodes;
+        unsigned                fusions;
+        bool                    fusing;
+        size_t                  arenasz;
+        size_t                  unsharedsz;
+        bool                    planned;
+
+    private:
+        SRCNNGraph( const SRCNNGraph& );
+        SRCNNGraph& operator=( const SRCNNGraph& );
+};
+
+// Plans graph into workspace arena of context and runs it by executor of
+// context. Layer planes are placed per NUMA node as SRCNN_CTX_NUMA says.
+// Returns SRCNN_OK, SRCNN_E... codes or return value of failed custom node.
+int SRCNNGraphRun( srcnn_context* ctx, SRCNNGraph& graph );
+
+#endif /// of __SRCNNGRAPH_H__
@@ -0,0 +1,642 @@
+/*******************************************************************************
+ * SRCNN JIT micro-kernels
+ * ----------------------------------------------------------------------------
+ * Machine code of layer I+II and layer III blocks is written at first use
+ * by a minimal x86-64 assembler ( only SSE2 forms engine needs ). Weights
+ * are broadcast to 4 lanes in a constant pool, filters go in register
+ * blocks of 8 with a loop over live taps, taps whose weights are all zero
+ * are not in the list and zero filters get no code.
+*******************************************************************************/
+#include <stdint.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if ( defined(__x86_64__) || defined(__amd64__) ) && !defined(_WIN32)
+    #define SRCNNJIT_X64
+    #include <pthread.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+#include "srcnnjit.h"
+
+/* pre-calculated convolutional data */
+#include "convdata.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef SRCNNJIT_X64
+
+#define JIT_BLOCK           8       /// filters in xmm0 .. xmm7 at once.
+#define JIT_VEC             16      /// bytes of a 4 lane vector.
+
+enum
+{
+    RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+#define SSE_MOVUPS          0x10
+#define SSE_MOVUPS_ST       0x11
+#define SSE_MOVHLPS         0x12
+#define SSE_MOVLHPS         0x16
+#define SSE_MOVAPS          0x28
+#define SSE_MOVAPS_ST       0x29
+#define SSE_ANDNPS          0x55
+#define SSE_XORPS           0x57
+#define SSE_ADDPS           0x58
+#define SSE_MULPS           0x59
+#define SSE_CVTPS2PD        0x5A
+#define SSE_CVTDQ2PS        0x5B
+#define SSE_PUNPCKLBW       0x60
+#define SSE_PUNPCKLWD       0x61
+#define SSE_MOVD            0x6E
+#define SSE_CMPPS           0xC2
+
+#define CMP_LT              1
+
+////////////////////////////////////////////////////////////////////////////////
+
+class JitAsm
+{
+    public:
+        vector<unsigned char>   code;
+
+    public:
+        // prefix is 0 or 0x66, op follows 0x0F. index < 0 for none.
+        void sseMem( unsigned prefix, unsigned op, int xmm, int base, int32_t disp,
+                     int index = -1 )
+        {
+            if ( prefix != 0 )
+                byte( prefix );
+
+            rex( false, xmm, index, base );
+            byte( 0x0F );
+            byte( op );
+            modrmMem( xmm, base, index, disp );
+        }
+
+        void sseReg( unsigned prefix, unsigned op, int dst, int src )
+        {
+            if ( prefix != 0 )
+                byte( prefix );
+
+            rex( false, dst, -1, src );
+            byte( 0x0F );
+            byte( op );
+            byte( 0xC0 | ( ( dst & 7 ) << 3 ) | ( src & 7 ) );
+        }
+
+        void cmpps( int dst, int src, unsigned pred )
+        {
+            sseReg( 0, SSE_CMPPS, dst, src );
+            byte( pred );
+        }
+
+        void movImm64( int reg, const void* ptr )
+        {
+            uint64_t v = (uint64_t)(uintptr_t)ptr;
+
+            byte( 0x48 | ( ( reg & 8 ) ? 1 : 0 ) );
+            byte( 0xB8 + ( reg & 7 ) );
+
+            for ( unsigned cnt = 0; cnt < 8; cnt++ )
+                byte( (unsigned)( v >> ( cnt * 8 ) ) & 0xFF );
+        }
+
+        void movImm32( int reg, uint32_t v )
+        {
+            if ( reg & 8 )
+                byte( 0x41 );
+
+            byte( 0xB8 + ( reg & 7 ) );
+            dword( v );
+        }
+
+        // reg = qword [ base + disp ]
+        void movLoad( int reg, int base, int32_t disp )
+        {
+            rex( true, reg, -1, base );
+            byte( 0x8B );
+            modrmMem( reg, base, -1, disp );
+        }
+
+        // reg = sign extended dword [ base + disp ]
+        void movsxdLoad( int reg, int base, int32_t disp )
+        {
+            rex( true, reg, -1, base );
+            byte( 0x63 );
+            modrmMem( reg, base, -1, disp );
+        }
+
+        void movReg( int dst, int src )
+        {
+            rex( true, dst, -1, src );
+            byte( 0x8B );
+            byte( 0xC0 | ( ( dst & 7 ) << 3 ) | ( src & 7 ) );
+        }
+
+        void addReg( int dst, int src )
+        {
+            rex( true, dst, -1, src );
+            byte( 0x03 );
+            byte( 0xC0 | ( ( dst & 7 ) << 3 ) | ( src & 7 ) );
+        }
+
+        void addImm( int reg, int32_t v )
+        {
+            rex( true, 0, -1, reg );
+            byte( 0x81 );
+            byte( 0xC0 | ( reg & 7 ) );
+            dword( (uint32_t)v );
+        }
+
+        void dec32( int reg )
+        {
+            if ( reg & 8 )
+                byte( 0x41 );
+
+            byte( 0xFF );
+            byte( 0xC8 | ( reg & 7 ) );
+        }
+
+        // jnz back to position of code.
+        void jnz( size_t target )
+        {
+            byte( 0x0F );
+            byte( 0x85 );
+
+            int32_t rel = (int32_t)( (int64_t)target - (int64_t)( code.size() + 4 ) );
+            dword( (uint32_t)rel );
+        }
+
+        void ret()
+        {
+            byte( 0xC3 );
+        }
+
+    private:
+        void byte( unsigned b )
+        {
+            code.push_back( (unsigned char)b );
+        }
+
+        void dword( uint32_t v )
+        {
+            for ( unsigned cnt = 0; cnt < 4; cnt++ )
+                byte( ( v >> ( cnt * 8 ) ) & 0xFF );
+        }
+
+        void rex( bool w, int reg, int index, int base )
+        {
+            unsigned r = 0x40;
+
+            if ( w == true )
+                r |= 8;
+
+            if ( reg & 8 )
+                r |= 4;
+
+            if ( ( index >= 0 ) && ( index & 8 ) )
+                r |= 2;
+
+            if ( base & 8 )
+                r |= 1;
+
+            if ( r != 0x40 )
+                byte( r );
+        }
+
+        // [ base + index + disp ], index scaled by 1.
+        void modrmMem( int reg, int base, int index, int32_t disp )
+        {
+            bool     d8  = ( disp >= -128 ) && ( disp <= 127 );
+            unsigned mod = d8 == true ? 1 : 2;
+
+            if ( ( index >= 0 ) || ( ( base & 7 ) == RSP ) )
+            {
+                byte( ( mod << 6 ) | ( ( reg & 7 ) << 3 ) | 4 );
+                byte( ( ( index >= 0 ? index & 7 : 4 ) << 3 ) | ( base & 7 ) );
+            }
+            else
+            {
+                byte( ( mod << 6 ) | ( ( reg & 7 ) << 3 ) | ( base & 7 ) );
+            }
+
+            if ( d8 == true )
+                byte( (unsigned)disp & 0xFF );
+            else
+                dword( (uint32_t)disp );
+        }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Constant pool, built before code so code may hold its addresses.
+class JitPool
+{
+    public:
+        vector<unsigned char>   data;
+
+    public:
+        size_t vec4( float v )
+        {
+            size_t ofs = data.size();
+
+            for ( unsigned cnt = 0; cnt < SRCNN_JIT_LANES; cnt++ )
+                append( &v, sizeof( float ) );
+
+            return ofs;
+        }
+
+        size_t int32( int32_t v )
+        {
+            size_t ofs = data.size();
+            append( &v, sizeof( int32_t ) );
+            return ofs;
+        }
+
+        void align()
+        {
+            while( data.size() % JIT_VEC )
+                data.push_back( 0 );
+        }
+
+    private:
+        void append( const void* p, size_t sz )
+        {
+            const unsigned char* pb = (const unsigned char*)p;
+            data.insert( data.end(), pb, pb + sz );
+        }
+};
+
+// Filter block of 8 over a list of live taps.
+typedef struct
+{
+    size_t      taps;       /// pool offset of int32 byte offsets in work.
+    size_t      weights;    /// pool offset, 8 vectors per live tap.
+    size_t      biases;     /// pool offset, 8 vectors.
+    unsigned    ntaps;
+    unsigned    live;       /// mask of filters with any non zero weight.
+}JitBlock;
+
+typedef struct
+{
+    JitBlock    l1[ CONV1_FILTERS / JIT_BLOCK ];
+    JitBlock    l2[ CONV2_FILTERS / JIT_BLOCK ];
+    size_t      l3rows;     /// pool offset of int32 byte offsets of row pointers.
+    size_t      l3weights;  /// pool offset, 25 vectors per live filter.
+    unsigned    l3live;
+    unsigned    macs;       /// multiply-adds per pixel in code.
+}JitPlan;
+
+static SRCNNJitKernels  jit_kernels;
+static bool             jit_ready = false;
+static pthread_once_t   jit_once  = PTHREAD_ONCE_INIT;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// w( f, t ) is weight of filter f at tap t, taps are at work + tapofs( t ).
+template<typename WFn, typename OFn>
+static void planBlock( JitPool& pool, JitBlock& jb, unsigned f0, unsigned taps,
+                       WFn w, OFn tapofs, const float* biases, unsigned& macs )
+{
+    memset( &jb, 0, sizeof( jb ) );
+
+    vector<unsigned> live;
+
+    for ( unsigned t = 0; t < taps; t++ )
+    {
+        bool any = false;
+
+        for ( unsigned f = 0; f < JIT_BLOCK; f++ )
+        {
+            if ( w( f0 + f, t ) != 0.f )
+            {
+                any      = true;
+                jb.live |= 1u << f;
+            }
+        }
+
+        if ( any == true )
+            live.push_back( t );
+    }
+
+    jb.ntaps = live.size();
+    jb.taps  = pool.data.size();
+
+    for ( unsigned cnt = 0; cnt < live.size(); cnt++ )
+        pool.int32( tapofs( live[cnt] ) );
+
+    pool.align();
+    jb.weights = pool.data.size();
+
+    for ( unsigned cnt = 0; cnt < live.size(); cnt++ )
+    {
+        for ( unsigned f = 0; f < JIT_BLOCK; f++ )
+            pool.vec4( w( f0 + f, live[cnt] ) );
+    }
+
+    jb.biases = pool.data.size();
+
+    for ( unsigned f = 0; f < JIT_BLOCK; f++ )
+    {
+        pool.vec4( biases[ f0 + f ] );
+
+        if ( jb.live & ( 1u << f ) )
+            macs += jb.ntaps;
+    }
+}
+
+static float weightL1( unsigned f, unsigned t )
+{
+    return weights_conv1_data[f][t / 9][t % 9];
+}
+
+static float weightL2( unsigned f, unsigned t )
+{
+    return weights_conv2_data[f][t];
+}
+
+static int32_t tapL1( unsigned t )
+{
+    return (int32_t)( t * JIT_VEC );
+}
+
+static int32_t tapL2( unsigned t )
+{
+    return (int32_t)( ( 81 + t ) * JIT_VEC );
+}
+
+static void makePlan( JitPool& pool, JitPlan& jp )
+{
+    memset( &jp, 0, sizeof( jp ) );
+
+    for ( unsigned b = 0; b < CONV1_FILTERS / JIT_BLOCK; b++ )
+    {
+        planBlock( pool, jp.l1[b], b * JIT_BLOCK, 81, weightL1, tapL1,
+                   biases_conv1, jp.macs );
+    }
+
+    for ( unsigned b = 0; b < CONV2_FILTERS / JIT_BLOCK; b++ )
+    {
+        planBlock( pool, jp.l2[b], b * JIT_BLOCK, CONV1_FILTERS, weightL2, tapL2,
+                   biases_conv2, jp.macs );
+    }
+
+    vector<unsigned> live;
+
+    for ( unsigned i = 0; i < CONV2_FILTERS; i++ )
+    {
+        bool any = false;
+
+        for ( unsigned t = 0; t < 25; t++ )
+        {
+            if ( weights_conv3_data[i][t / 5][t % 5] != 0.f )
+                any = true;
+        }
+
+        if ( any == true )
+            live.push_back( i );
+    }
+
+    jp.l3live = live.size();
+    jp.l3rows = pool.data.size();
+
+    for ( unsigned cnt = 0; cnt < live.size(); cnt++ )
+        pool.int32( (int32_t)( live[cnt] * 5 * sizeof( void* ) ) );
+
+    pool.align();
+    jp.l3weights = pool.data.size();
+
+    for ( unsigned cnt = 0; cnt < live.size(); cnt++ )
+    {
+        for ( unsigned t = 0; t < 25; t++ )
+            pool.vec4( weights_conv3_data[ live[cnt] ][t / 5][t % 5] );
+    }
+
+    jp.macs += jp.l3live * 25;
+}
+
+/***
+ * FuncName : emitBlock
+ * Function : 8 filters over live taps, bias and threshold to dst
+ * Note     : xmm0..7 sums, xmm8 tap, xmm9 product, xmm10 zero.
+ *            Sums start at zero and add w * x tap by tap as compiled
+ *            kernels, a left out zero product would not change them.
+***/
+static void emitBlock( JitAsm& a, const unsigned char* pool, const JitBlock& jb,
+                       int src, int dst, int32_t dstofs )
+{
+    for ( int f = 0; f < JIT_BLOCK; f++ )
+        a.sseReg( 0, SSE_XORPS, f, f );
+
+    if ( jb.ntaps > 0 )
+    {
+        a.movImm64( R9,  pool + jb.taps );
+        a.movImm64( R10, pool + jb.weights );
+        a.movImm32( RCX, jb.ntaps );
+
+        size_t loop = a.code.size();
+
+        a.movsxdLoad( RAX, R9, 0 );
+        a.sseMem( 0, SSE_MOVAPS, 8, src, 0, RAX );
+
+        for ( int f = 0; f < JIT_BLOCK; f++ )
+        {
+            if ( ( jb.live & ( 1u << f ) ) == 0 )
+                continue;
+
+            a.sseReg( 0, SSE_MOVAPS, 9, 8 );
+            a.sseMem( 0, SSE_MULPS, 9, R10, f * JIT_VEC );
+            a.sseReg( 0, SSE_ADDPS, f, 9 );
+        }
+
+        a.addImm( R9, sizeof( int32_t ) );
+        a.addImm( R10, JIT_BLOCK * JIT_VEC );
+        a.dec32( RCX );
+        a.jnz( loop );
+    }
+
+    a.movImm64( RAX, pool + jb.biases );
+
+    for ( int f = 0; f < JIT_BLOCK; f++ )
+    {
+        // ( v < 0 ) ? 0 : v, keeps sign of zero as compiled one.
+        a.sseMem( 0, SSE_ADDPS, f, RAX, f * JIT_VEC );
+        a.sseReg( 0, SSE_MOVAPS, 9, f );
+        a.cmpps( 9, 10, CMP_LT );
+        a.sseReg( 0, SSE_ANDNPS, 9, f );
+        a.sseMem( 0, SSE_MOVAPS_ST, 9, dst, dstofs + f * JIT_VEC );
+    }
+}
+
+// ( rows = rdi, work = rsi, out = rdx )
+static void emitLayer12( JitAsm& a, const unsigned char* pool, const JitPlan& jp )
+{
+    a.sseReg( 0, SSE_XORPS, 10, 10 );
+
+    /* Patches, bytes to 4 lanes of float */
+    for ( int i = 0; i < 9; i++ )
+    {
+        a.movLoad( RAX, RDI, i * (int)sizeof( void* ) );
+
+        for ( int j = 0; j < 9; j++ )
+        {
+            a.sseMem( 0x66, SSE_MOVD, 0, RAX, j );
+            a.sseReg( 0x66, SSE_PUNPCKLBW, 0, 10 );
+            a.sseReg( 0x66, SSE_PUNPCKLWD, 0, 10 );
+            a.sseReg( 0, SSE_CVTDQ2PS, 0, 0 );
+            a.sseMem( 0, SSE_MOVAPS_ST, 0, RSI, ( i * 9 + j ) * JIT_VEC );
+        }
+    }
+
+    for ( unsigned b = 0; b < CONV1_FILTERS / JIT_BLOCK; b++ )
+        emitBlock( a, pool, jp.l1[b], RSI, RSI, ( 81 + b * JIT_BLOCK ) * JIT_VEC );
+
+    for ( unsigned b = 0; b < CONV2_FILTERS / JIT_BLOCK; b++ )
+        emitBlock( a, pool, jp.l2[b], RSI, RDX, b * JIT_BLOCK * JIT_VEC );
+
+    a.ret();
+}
+
+// ( rows = rdi, out = rsi ), sums of a filter in double as compiled one.
+static void emitLayer3( JitAsm& a, const unsigned char* pool, const JitPlan& jp )
+{
+    a.sseReg( 0, SSE_XORPS, 4, 4 );
+
+    if ( jp.l3live > 0 )
+    {
+        a.movImm64( R9,  pool + jp.l3rows );
+        a.movImm64( R10, pool + jp.l3weights );
+        a.movImm32( RCX, jp.l3live );
+
+        size_t loop = a.code.size();
+
+        a.movsxdLoad( RAX, R9, 0 );
+        a.movReg( R11, RDI );
+        a.addReg( R11, RAX );
+        a.sseReg( 0x66, SSE_XORPS, 0, 0 );     /// xorpd
+        a.sseReg( 0x66, SSE_XORPS, 1, 1 );
+
+        for ( int m = 0; m < 5; m++ )
+        {
+            a.movLoad( RAX, R11, m * (int)sizeof( void* ) );
+
+            for ( int n = 0; n < 5; n++ )
+            {
+                a.sseMem( 0, SSE_MOVUPS, 2, RAX, n * (int)sizeof( float ) );
+                a.sseMem( 0, SSE_MULPS, 2, R10, ( m * 5 + n ) * JIT_VEC );
+                a.sseReg( 0, SSE_CVTPS2PD, 3, 2 );
+                a.sseReg( 0, SSE_MOVHLPS, 2, 2 );
+                a.sseReg( 0, SSE_CVTPS2PD, 2, 2 );
+                a.sseReg( 0x66, SSE_ADDPS, 0, 3 );      /// addpd
+                a.sseReg( 0x66, SSE_ADDPS, 1, 2 );
+            }
+        }
+
+        // temp += temppixel, in double and rounded back.
+        a.sseReg( 0, SSE_CVTPS2PD, 5, 4 );
+        a.sseReg( 0, SSE_MOVHLPS, 6, 4 );
+        a.sseReg( 0, SSE_CVTPS2PD, 6, 6 );
+        a.sseReg( 0x66, SSE_ADDPS, 5, 0 );
+        a.sseReg( 0x66, SSE_ADDPS, 6, 1 );
+        a.sseReg( 0x66, SSE_CVTPS2PD, 4, 5 );   /// cvtpd2ps
+        a.sseReg( 0x66, SSE_CVTPS2PD, 7, 6 );
+        a.sseReg( 0, SSE_MOVLHPS, 4, 7 );
+
+        a.addImm( R9, sizeof( int32_t ) );
+        a.addImm( R10, 25 * JIT_VEC );
+        a.dec32( RCX );
+        a.jnz( loop );
+    }
+
+    a.sseMem( 0, SSE_MOVAPS_ST, 4, RSI, 0 );
+    a.ret();
+}
+
+static void jitInit()
+{
+    memset( &jit_kernels, 0, sizeof( jit_kernels ) );
+
+    const char* env = getenv( "SRCNN_NOJIT" );
+
+    if ( ( env != NULL ) && ( env[0] != 0 ) && ( strcmp( env, "0" ) != 0 ) )
+        return;
+
+    JitPool pool;
+    JitPlan plan;
+
+    makePlan( pool, plan );
+
+    void* pbuf = NULL;
+
+    if ( posix_memalign( &pbuf, 64, pool.data.size() ) != 0 )
+        return;
+
+    memcpy( pbuf, pool.data.data(), pool.data.size() );
+
+    const unsigned char* pp = (const unsigned char*)pbuf;
+
+    JitAsm a12;
+    JitAsm a3;
+
+    emitLayer12( a12, pp, plan );
+    emitLayer3( a3, pp, plan );
+
+    long   pgsz = sysconf( _SC_PAGESIZE );
+    size_t ofs3 = ( a12.code.size() + 63 ) & ~(size_t)63;
+    size_t clen = ofs3 + a3.code.size();
+    size_t mlen = ( clen + pgsz - 1 ) & ~(size_t)( pgsz - 1 );
+
+    void* mem = mmap( NULL, mlen, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+    if ( mem == MAP_FAILED )
+    {
+        free( pbuf );
+        return;
+    }
+
+    memcpy( mem, a12.code.data(), a12.code.size() );
+    memcpy( (unsigned char*)mem + ofs3, a3.code.data(), a3.code.size() );
+
+    // never writable and executable at once.
+    if ( mprotect( mem, mlen, PROT_READ | PROT_EXEC ) != 0 )
+    {
+        munmap( mem, mlen );
+        free( pbuf );
+        return;
+    }
+
+    jit_kernels.layer12  = (SRCNNJitLayer12Fn)mem;
+    jit_kernels.layer3   = (SRCNNJitLayer3Fn)( (unsigned char*)mem + ofs3 );
+    jit_kernels.codesize = clen;
+    jit_kernels.poolsize = pool.data.size();
+    jit_kernels.pruned   = CONV1_FILTERS * 81 + CONV2_FILTERS * CONV1_FILTERS
+                           + CONV2_FILTERS * 25 - plan.macs;
+
+    jit_ready = true;
+}
+
+const SRCNNJitKernels* SRCNNJitGet()
+{
+    pthread_once( &jit_once, jitInit );
+
+    return jit_ready == true ? &jit_kernels : NULL;
+}
+
+#else
+
+const SRCNNJitKernels* SRCNNJitGet()
+{
+    return NULL;
+}
+
+#endif /// of SRCNNJIT_X64
@@ -0,0 +1,43 @@
+#ifndef __SRCNNJIT_H__
+#define __SRCNNJIT_H__
+
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Generated micro-kernels of SRCNN layers, x86-64 SSE2 machine code.
+// - Made once at first use by a small built-in assembler, no dependency.
+// - Weights of convdata.h go to an aligned constant pool, taps and filters
+//   of zero weights are left out of code, so pruned models run faster.
+// - A block is 4 pixels side by side, each lane sums in same order as
+//   compiled kernels of srcnnkernel.cpp, so results are bit exact.
+// - Not available on other CPUs, or when SRCNN_NOJIT is set in environment,
+//   then layers run compiled kernels.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define SRCNN_JIT_LANES         4
+#define SRCNN_JIT_WORK12        ( ( 81 + 64 ) * SRCNN_JIT_LANES )  /// floats.
+
+// rows : 9 pointers to source bytes of column - 4, 12 bytes readable each.
+// work : SRCNN_JIT_WORK12 floats, out : 32 x 4 floats, both 16 byte aligned.
+typedef void (*SRCNNJitLayer12Fn)( const unsigned char* const* rows,
+                                   float* work, float* out );
+
+// rows : 32 x 5 pointers to plane floats of column - 2, 8 floats readable
+// each. out : 4 sums before bias, 16 byte aligned.
+typedef void (*SRCNNJitLayer3Fn)( const float* const* rows, float* out );
+
+typedef struct
+{
+    SRCNNJitLayer12Fn   layer12;
+    SRCNNJitLayer3Fn    layer3;
+    size_t              codesize;   /// bytes of machine code.
+    size_t              poolsize;   /// bytes of constant pool.
+    unsigned            pruned;     /// multiply-adds left out per pixel.
+}SRCNNJitKernels;
+
+// Thread safe, made once. NULL when not available.
+const SRCNNJitKernels* SRCNNJitGet();
+
+#endif /// of __SRCNNJIT_H__
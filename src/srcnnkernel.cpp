@@ -0,0 +1,687 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "srcnnkernel.h"
+#include "srcnnprof.h"
+#include "srcnnjit.h"
+
+/* pre-calculated convolutional data */
+#include "convdata.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static inline int IntTrim(int a, int b, int c)
+{
+    int buff[3] = {a, c, b};
+    return buff[ (int)(c > a) + (int)(c > b) ];
+}
+
+// Replicated border index table, tbl[ n + pad * 2 ] maps -pad .. n+pad.
+static void makeBorderTable( vector<int>& tbl, int n, int pad )
+{
+    tbl.resize( n + pad * 2 );
+
+    for ( int cnt = 0; cnt < n + pad * 2; cnt++ )
+    {
+        tbl[cnt] = IntTrim( 0, n - 1, cnt - pad );
+    }
+}
+
+typedef struct
+{
+    const unsigned char*    src;
+    size_t                  srcstride;
+    float* const*           planes;
+    const float* const*     cplanes;
+    size_t                  planestride;
+    unsigned char*          dst;
+    size_t                  dststride;
+    const int*              rowf;
+    const int*              colf;
+    SRCNNRegion             rgn;
+    unsigned                tiles_x;    /// tiles in a row of region.
+    unsigned                width;
+    SRCNNKernelConfig       cfg;
+    const SRCNNJitKernels*  jit;        /// NULL for compiled kernels.
+}LayerArgs;
+
+// generated kernels when available, else direct ones.
+static const SRCNNKernelConfig kernel_default = { SRCNN_TILE_W, SRCNN_TILE_H, SRCNN_LAYER1_JIT, 8 };
+static SRCNNKernelConfig       kernel_config  = kernel_default;
+
+static void wholeRegion( SRCNNRegion& rgn, unsigned width, unsigned height,
+                         const SRCNNRegion* region )
+{
+    if ( region != NULL )
+    {
+        rgn = *region;
+
+        if ( rgn.x1 > width )
+            rgn.x1 = width;
+
+        if ( rgn.y1 > height )
+            rgn.y1 = height;
+    }
+    else
+    {
+        rgn.x0 = 0;
+        rgn.y0 = 0;
+        rgn.x1 = width;
+        rgn.y1 = height;
+    }
+}
+
+static void tileCount( LayerArgs& la, const SRCNNRegion& rgn, size_t& tiles )
+{
+    la.cfg = kernel_config;
+    la.jit = la.cfg.layer1 == SRCNN_LAYER1_JIT ? SRCNNJitGet() : NULL;
+
+    unsigned tiles_y = ( rgn.y1 - rgn.y0 + la.cfg.tile_h - 1 ) / la.cfg.tile_h;
+
+    la.rgn     = rgn;
+    la.tiles_x = ( rgn.x1 - rgn.x0 + la.cfg.tile_w - 1 ) / la.cfg.tile_w;
+
+    tiles = (size_t)la.tiles_x * tiles_y;
+}
+
+// Region of n'th tile, clipped to layer region.
+static void tileRegion( const LayerArgs* la, size_t n, SRCNNRegion& tile )
+{
+    unsigned tx = (unsigned)( n % la->tiles_x );
+    unsigned ty = (unsigned)( n / la->tiles_x );
+
+    tile.x0 = la->rgn.x0 + tx * la->cfg.tile_w;
+    tile.y0 = la->rgn.y0 + ty * la->cfg.tile_h;
+    tile.x1 = tile.x0 + la->cfg.tile_w;
+    tile.y1 = tile.y0 + la->cfg.tile_h;
+
+    if ( tile.x1 > la->rgn.x1 )
+        tile.x1 = la->rgn.x1;
+
+    if ( tile.y1 > la->rgn.y1 )
+        tile.y1 = la->rgn.y1;
+}
+
+/***
+ * FuncName : layer12Tile
+ * Function : Complete the first and second Convolutional Layer of a tile
+ * Parameter    : la - LayerArgs
+ *        tile - region to be computed
+ * Output   : <void>
+***/
+static void layer12Tile( const LayerArgs* la, const SRCNNRegion& tile )
+{
+    float temp[CONV1_FILTERS] = {0.f};
+
+    /* Complete the Convolution Step */
+    for (int row = (int)tile.y0; row < (int)tile.y1; row++)
+    {
+        for (int col = (int)tile.x0; col < (int)tile.x1; col++)
+        {
+            for (int k = 0; k < CONV1_FILTERS; k++)
+            {
+                /* Convolution */
+                temp[k] = 0.0;
+
+                for (int i = 0; i < 9; i++)
+                {
+                    const unsigned char* srow = la->src + (size_t)la->rowf[row + i] * la->srcstride;
+
+                    for (int j = 0; j < 9; j++)
+                    {
+                        temp[k] += weights_conv1_data[k][i][j] * srow[ la->colf[col + j] ];
+                    }
+                }
+
+                temp[k] += biases_conv1[k];
+
+                /* Threshold */
+                temp[k] = (temp[k] < 0) ? 0 : temp[k];
+            }
+
+            /* Process with each pixel */
+            for (int k = 0; k < CONV2_FILTERS; k++)
+            {
+                float result = 0.0;
+
+                for (int i = 0; i < CONV1_FILTERS; i++)
+                {
+                    result += temp[i] * weights_conv2_data[k][i];
+                }
+                result += biases_conv2[k];
+
+                /* Threshold */
+                result = (result < 0) ? 0 : result;
+
+                la->planes[k][ (size_t)row * la->planestride + col ] = result;
+            }
+        }
+    }
+}
+
+/***
+ * FuncName : layer12TileIm2col
+ * Function : First and second layer over im2col patches of IW pixels
+ * Parameter    : la - LayerArgs
+ *        tile - region to be computed
+ * Output   : <void>
+ * Note     : each lane sums in same order to layer12Tile, results are
+ *            same while pixel loops go vector.
+***/
+template<unsigned IW>
+static void layer12TileIm2col( const LayerArgs* la, const SRCNNRegion& tile )
+{
+    float patch[81][IW];
+    float temp[CONV1_FILTERS][IW];
+    float acc[IW];
+
+    const float* w1 = &weights_conv1_data[0][0][0];
+
+    for (int row = (int)tile.y0; row < (int)tile.y1; row++)
+    {
+        const unsigned char* srows[9];
+
+        for (int i = 0; i < 9; i++)
+        {
+            srows[i] = la->src + (size_t)la->rowf[row + i] * la->srcstride;
+        }
+
+        for (int col = (int)tile.x0; col < (int)tile.x1; col += IW)
+        {
+            unsigned n = (unsigned)( (int)tile.x1 - col );
+
+            if ( n > IW )
+                n = IW;
+
+            /* Patches, tap by tap, pixels side by side */
+            for (int i = 0; i < 9; i++)
+            {
+                for (int j = 0; j < 9; j++)
+                {
+                    float* pp = patch[ i * 9 + j ];
+
+                    for (unsigned p = 0; p < n; p++)
+                    {
+                        pp[p] = srows[i][ la->colf[col + (int)p + j] ];
+                    }
+
+                    for (unsigned p = n; p < IW; p++)
+                    {
+                        pp[p] = 0.f;
+                    }
+                }
+            }
+
+            for (int k = 0; k < CONV1_FILTERS; k++)
+            {
+                const float* wk = w1 + k * 81;
+
+                for (unsigned p = 0; p < IW; p++)
+                    acc[p] = 0.f;
+
+                for (int t = 0; t < 81; t++)
+                {
+                    float w = wk[t];
+
+                    for (unsigned p = 0; p < IW; p++)
+                        acc[p] += w * patch[t][p];
+                }
+
+                for (unsigned p = 0; p < IW; p++)
+                {
+                    float v = acc[p] + biases_conv1[k];
+                    temp[k][p] = (v < 0) ? 0 : v;
+                }
+            }
+
+            for (int k = 0; k < CONV2_FILTERS; k++)
+            {
+                for (unsigned p = 0; p < IW; p++)
+                    acc[p] = 0.f;
+
+                for (int i = 0; i < CONV1_FILTERS; i++)
+                {
+                    float w = weights_conv2_data[k][i];
+
+                    for (unsigned p = 0; p < IW; p++)
+                        acc[p] += temp[i][p] * w;
+                }
+
+                float* prow = la->planes[k] + (size_t)row * la->planestride + col;
+
+                for (unsigned p = 0; p < n; p++)
+                {
+                    float v = acc[p] + biases_conv2[k];
+                    prow[p] = (v < 0) ? 0 : v;
+                }
+            }
+        }
+    }
+}
+
+/***
+ * FuncName : layer12TileJit
+ * Function : First and second layer by generated code, 4 pixels a block
+ * Parameter    : la - LayerArgs
+ *        tile - region to be computed
+ * Output   : <void>
+ * Note     : blocks reaching borders read replicated columns from a copy.
+***/
+static void layer12TileJit( const LayerArgs* la, const SRCNNRegion& tile )
+{
+    float __attribute__ ((aligned (16))) work[ SRCNN_JIT_WORK12 ];
+    float __attribute__ ((aligned (16))) out[ CONV2_FILTERS * SRCNN_JIT_LANES ];
+    unsigned char edge[9][12];
+
+    const unsigned char* srows[9];
+    const unsigned char* rows[9];
+
+    int width = (int)la->width;
+
+    for (int row = (int)tile.y0; row < (int)tile.y1; row++)
+    {
+        for (int i = 0; i < 9; i++)
+        {
+            srows[i] = la->src + (size_t)la->rowf[row + i] * la->srcstride;
+        }
+
+        for (int col = (int)tile.x0; col < (int)tile.x1; col += SRCNN_JIT_LANES)
+        {
+            int n = (int)tile.x1 - col;
+
+            if ( n > SRCNN_JIT_LANES )
+                n = SRCNN_JIT_LANES;
+
+            if ( ( col >= 4 ) && ( col + 8 <= width ) )
+            {
+                for (int i = 0; i < 9; i++)
+                    rows[i] = srows[i] + col - 4;
+            }
+            else
+            {
+                for (int i = 0; i < 9; i++)
+                {
+                    for (int q = 0; q < 12; q++)
+                        edge[i][q] = srows[i][ IntTrim( 0, width - 1, col + q - 4 ) ];
+
+                    rows[i] = edge[i];
+                }
+            }
+
+            la->jit->layer12( rows, work, out );
+
+            for (int k = 0; k < CONV2_FILTERS; k++)
+            {
+                float* prow = la->planes[k] + (size_t)row * la->planestride + col;
+
+                for (int p = 0; p < n; p++)
+                {
+                    prow[p] = out[ k * SRCNN_JIT_LANES + p ];
+                }
+            }
+        }
+    }
+}
+
+/***
+ * FuncName : layer3Tile
+ * Function : Complete the third Convolutional Layer of a tile
+ * Parameter    : la - LayerArgs
+ *        tile - region to be computed
+ * Output   : <void>
+***/
+static void layer3Tile( const LayerArgs* la, const SRCNNRegion& tile )
+{
+    /* Complete the Convolution Step */
+    for (int row = (int)tile.y0; row < (int)tile.y1; row++)
+    {
+        unsigned char* drow = la->dst + (size_t)row * la->dststride;
+
+        for (int col = (int)tile.x0; col < (int)tile.x1; col++)
+        {
+            float temp = 0;
+
+            for (int i = 0; i < CONV2_FILTERS; i++)
+            {
+                double temppixel = 0;
+                for (int m = 0; m < 5; m++)
+                {
+                    const float* prow = la->cplanes[i] + (size_t)la->rowf[row + m] * la->planestride;
+
+                    for (int n = 0; n < 5; n++)
+                    {
+                        temppixel += weights_conv3_data[i][m][n] * prow[ la->colf[col + n] ];
+                    }
+                }
+
+                temp += temppixel;
+            }
+
+            temp += biases_conv3;
+
+            /* Threshold */
+            temp = IntTrim(0, 255, temp);
+
+            drow[col] = (unsigned char)temp;
+        }
+    }
+}
+
+/***
+ * FuncName : layer3TileJit
+ * Function : Third layer by generated code, 4 pixels a block
+ * Parameter    : la - LayerArgs
+ *        tile - region to be computed
+ * Output   : <void>
+***/
+static void layer3TileJit( const LayerArgs* la, const SRCNNRegion& tile )
+{
+    const int rcnt = CONV2_FILTERS * 5;
+
+    float __attribute__ ((aligned (16))) out[ SRCNN_JIT_LANES ];
+    float edge[ rcnt ][8];
+
+    const float* prows[ rcnt ];
+    const float* rows[ rcnt ];
+
+    int width = (int)la->width;
+
+    for (int row = (int)tile.y0; row < (int)tile.y1; row++)
+    {
+        unsigned char* drow = la->dst + (size_t)row * la->dststride;
+
+        for (int i = 0; i < CONV2_FILTERS; i++)
+        {
+            for (int m = 0; m < 5; m++)
+            {
+                prows[ i * 5 + m ] = la->cplanes[i] + (size_t)la->rowf[row + m] * la->planestride;
+            }
+        }
+
+        for (int col = (int)tile.x0; col < (int)tile.x1; col += SRCNN_JIT_LANES)
+        {
+            int n = (int)tile.x1 - col;
+
+            if ( n > SRCNN_JIT_LANES )
+                n = SRCNN_JIT_LANES;
+
+            if ( ( col >= 2 ) && ( col + 6 <= width ) )
+            {
+                for (int r = 0; r < rcnt; r++)
+                    rows[r] = prows[r] + col - 2;
+            }
+            else
+            {
+                for (int r = 0; r < rcnt; r++)
+                {
+                    for (int q = 0; q < 8; q++)
+                        edge[r][q] = prows[r][ IntTrim( 0, width - 1, col + q - 2 ) ];
+
+                    rows[r] = edge[r];
+                }
+            }
+
+            la->jit->layer3( rows, out );
+
+            for (int p = 0; p < n; p++)
+            {
+                float temp = out[p];
+
+                temp += biases_conv3;
+
+                /* Threshold */
+                temp = IntTrim(0, 255, temp);
+
+                drow[col + p] = (unsigned char)temp;
+            }
+        }
+    }
+}
+
+// Executor tasks, begin and end are tile indices.
+static void touchTiles( void* arg, size_t begin, size_t end )
+{
+    const LayerArgs* la = (const LayerArgs*)arg;
+
+    for ( size_t n = begin; n < end; n++ )
+    {
+        SRCNNRegion tile;
+        tileRegion( la, n, tile );
+
+        for ( unsigned k = 0; k < SRCNN_KERNEL_PLANES; k++ )
+        {
+            for ( unsigned row = tile.y0; row < tile.y1; row++ )
+            {
+                memset( la->planes[k] + (size_t)row * la->planestride + tile.x0, 0,
+                        ( tile.x1 - tile.x0 ) * sizeof( float ) );
+            }
+        }
+    }
+}
+
+static void layer12Tiles( void* arg, size_t begin, size_t end )
+{
+    const LayerArgs* la = (const LayerArgs*)arg;
+
+    for ( size_t n = begin; n < end; n++ )
+    {
+        ProfScope   prof( "layer I+II tile", PROF_CAT_TILE, (int64_t)n );
+        SRCNNRegion tile;
+        tileRegion( la, n, tile );
+
+        if ( la->jit != NULL )
+        {
+            layer12TileJit( la, tile );
+        }
+        else
+        if ( la->cfg.layer1 == SRCNN_LAYER1_IM2COL )
+        {
+            switch( la->cfg.interleave )
+            {
+                case 4:
+                    layer12TileIm2col<4>( la, tile );
+                    break;
+
+                case 16:
+                    layer12TileIm2col<16>( la, tile );
+                    break;
+
+                default:
+                    layer12TileIm2col<8>( la, tile );
+                    break;
+            }
+        }
+        else
+        {
+            layer12Tile( la, tile );
+        }
+    }
+}
+
+static void layer3Tiles( void* arg, size_t begin, size_t end )
+{
+    const LayerArgs* la = (const LayerArgs*)arg;
+
+    for ( size_t n = begin; n < end; n++ )
+    {
+        ProfScope   prof( "layer III tile", PROF_CAT_TILE, (int64_t)n );
+        SRCNNRegion tile;
+        tileRegion( la, n, tile );
+
+        if ( la->jit != NULL )
+            layer3TileJit( la, tile );
+        else
+            layer3Tile( la, tile );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SRCNNSetKernelConfig( const SRCNNKernelConfig* cfg )
+{
+    SRCNNKernelConfig kc = kernel_default;
+
+    if ( cfg != NULL )
+    {
+        kc = *cfg;
+
+        if ( kc.tile_w == 0 )
+            kc.tile_w = SRCNN_TILE_W;
+
+        if ( kc.tile_h == 0 )
+            kc.tile_h = SRCNN_TILE_H;
+
+        if ( ( kc.interleave != 4 ) && ( kc.interleave != 16 ) )
+            kc.interleave = 8;
+
+        if ( ( kc.layer1 != SRCNN_LAYER1_IM2COL ) && ( kc.layer1 != SRCNN_LAYER1_JIT ) )
+            kc.layer1 = SRCNN_LAYER1_DIRECT;
+    }
+
+    kernel_config = kc;
+}
+
+void SRCNNGetKernelConfig( SRCNNKernelConfig* cfg )
+{
+    if ( cfg != NULL )
+        *cfg = kernel_config;
+}
+
+/***
+ * FuncName : SRCNNLayer12
+ * Function : Complete the first and second Convolutional Layer
+ * Parameter    : src - upscaled luma, srcstride bytes per row
+ *        width, height - size of luma and planes
+ *        planes - layer II output planes, planestride floats per row
+ *        region - region to be computed, NULL for whole image
+ *        exec - executor of rows, NULL for default
+ * Output   : <void>
+***/
+void SRCNNLayer12( const unsigned char* src, size_t srcstride,
+                   unsigned width, unsigned height,
+                   float* const* planes, size_t planestride,
+                   const SRCNNRegion* region,
+                   const srcnn_executor* exec )
+{
+    if ( ( src == NULL ) || ( planes == NULL ) || ( width == 0 ) || ( height == 0 ) )
+        return;
+
+    SRCNNRegion rgn;
+    wholeRegion( rgn, width, height, region );
+
+    if ( ( rgn.x0 >= rgn.x1 ) || ( rgn.y0 >= rgn.y1 ) )
+        return;
+
+    if ( exec == NULL )
+        exec = srcnn_executor_default();
+
+    ProfScope prof( "layer I+II" );
+
+    vector<int> rowf;
+    vector<int> colf;
+
+    /* Expand the src image */
+    makeBorderTable( rowf, height, 4 );
+    makeBorderTable( colf, width, 4 );
+
+    LayerArgs la;
+    memset( &la, 0, sizeof( la ) );
+
+    la.src         = src;
+    la.srcstride   = srcstride;
+    la.planes      = planes;
+    la.planestride = planestride;
+    la.rowf        = rowf.data();
+    la.colf        = colf.data();
+    la.width       = width;
+
+    size_t tiles = 0;
+    tileCount( la, rgn, tiles );
+
+    exec->parallel_for( exec->user, tiles, 1, layer12Tiles, &la );
+}
+
+/***
+ * FuncName : SRCNNLayer3
+ * Function : Complete the third Convolutional Layer
+ * Parameter    : planes - layer II data, planestride floats per row
+ *        width, height - size of planes and output
+ *        dst - output luma, dststride bytes per row
+ *        region - region to be computed, NULL for whole image
+ *        exec - executor of rows, NULL for default
+ * Output   : <void>
+***/
+void SRCNNLayer3( const float* const* planes, size_t planestride,
+                  unsigned width, unsigned height,
+                  unsigned char* dst, size_t dststride,
+                  const SRCNNRegion* region,
+                  const srcnn_executor* exec )
+{
+    if ( ( planes == NULL ) || ( dst == NULL ) || ( width == 0 ) || ( height == 0 ) )
+        return;
+
+    SRCNNRegion rgn;
+    wholeRegion( rgn, width, height, region );
+
+    if ( ( rgn.x0 >= rgn.x1 ) || ( rgn.y0 >= rgn.y1 ) )
+        return;
+
+    if ( exec == NULL )
+        exec = srcnn_executor_default();
+
+    ProfScope prof( "layer III" );
+
+    vector<int> rowf;
+    vector<int> colf;
+
+    /* Expand the src image */
+    makeBorderTable( rowf, height, 2 );
+    makeBorderTable( colf, width, 2 );
+
+    LayerArgs la;
+    memset( &la, 0, sizeof( la ) );
+
+    la.cplanes     = planes;
+    la.planestride = planestride;
+    la.dst         = dst;
+    la.dststride   = dststride;
+    la.rowf        = rowf.data();
+    la.colf        = colf.data();
+    la.width       = width;
+
+    size_t tiles = 0;
+    tileCount( la, rgn, tiles );
+
+    exec->parallel_for( exec->user, tiles, 1, layer3Tiles, &la );
+}
+
+void SRCNNTouchPlanes( float* const* planes, size_t planestride,
+                       unsigned width, unsigned height,
+                       const srcnn_executor* exec )
+{
+    if ( ( planes == NULL ) || ( width == 0 ) || ( height == 0 ) )
+        return;
+
+    if ( exec == NULL )
+        exec = srcnn_executor_default();
+
+    SRCNNRegion rgn;
+    wholeRegion( rgn, width, height, NULL );
+
+    LayerArgs la;
+    memset( &la, 0, sizeof( la ) );
+
+    la.planes      = planes;
+    la.planestride = planestride;
+
+    size_t tiles = 0;
+    tileCount( la, rgn, tiles );
+
+    exec->parallel_for( exec->user, tiles, 1, touchTiles, &la );
+}
@@ -0,0 +1,90 @@
+#ifndef __SRCNNKERNEL_H__
+#define __SRCNNKERNEL_H__
+
+#include <cstddef>
+#include "libsrcnn.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// SRCNN convolutional layers on raw buffers, no OpenCV.
+// - Layer I ( 9x9, 64 filters ) and II ( 1x1, 32 filters ) fused per pixel.
+// - Layer III ( 5x5 ) reduces 32 float planes to 8bit luma.
+// - Borders are replicated, only given region of output is computed.
+// - Region is split to 2-D tiles run through executor, one task per tile,
+//   NULL for srcnn_executor_default().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define SRCNN_KERNEL_PLANES     32      /// count of layer II planes.
+#define SRCNN_TILE_W            64      /// default executor tile size in pixels.
+#define SRCNN_TILE_H            16
+
+#define SRCNN_LAYER1_DIRECT     0       /// pixel by pixel, 64 filters of 9x9.
+#define SRCNN_LAYER1_IM2COL     1       /// filters over im2col patches of pixels.
+#define SRCNN_LAYER1_JIT        2       /// generated code, layer III too, default.
+
+typedef struct
+{
+    unsigned    tile_w;
+    unsigned    tile_h;
+    int         layer1;         /// SRCNN_LAYER1_*.
+    unsigned    interleave;     /// pixels of an im2col patch, 4, 8 or 16.
+}SRCNNKernelConfig;
+
+typedef struct
+{
+    unsigned    x0;
+    unsigned    y0;
+    unsigned    x1;     /// not included.
+    unsigned    y1;     /// not included.
+}SRCNNRegion;
+
+// src is upscaled luma, planes are SRCNN_KERNEL_PLANES of width x height,
+// srcstride in bytes and planestride in floats.
+void SRCNNLayer12( const unsigned char* src, size_t srcstride,
+                   unsigned width, unsigned height,
+                   float* const* planes, size_t planestride,
+                   const SRCNNRegion* region = NULL,
+                   const srcnn_executor* exec = NULL );
+
+void SRCNNLayer3( const float* const* planes, size_t planestride,
+                  unsigned width, unsigned height,
+                  unsigned char* dst, size_t dststride,
+                  const SRCNNRegion* region = NULL,
+                  const srcnn_executor* exec = NULL );
+
+// Process wide, read once by each layer call, so set it before layers run.
+// Every config gives same results. NULL restores defaults. JIT falls back
+// to direct kernels where code can not be generated ( see srcnnjit.h ).
+void SRCNNSetKernelConfig( const SRCNNKernelConfig* cfg );
+void SRCNNGetKernelConfig( SRCNNKernelConfig* cfg );
+
+// Zeroes planes tile by tile through executor, same tiles to layers, so
+// pages are first touched by threads computing them later.
+void SRCNNTouchPlanes( float* const* planes, size_t planestride,
+                       unsigned width, unsigned height,
+                       const srcnn_executor* exec = NULL );
+
+// Colour conversion of libsrcnn.cpp, same coefficients to OpenCV YCrCb.
+// Exposed for benchmarks, exec must not be NULL.
+void SRCNNSplitYCrCb( const unsigned char* src, size_t srcstride, unsigned depth,
+                      unsigned w, unsigned h,
+                      unsigned char* py, unsigned char* pcr, unsigned char* pcb,
+                      const srcnn_executor* exec );
+
+void SRCNNMergeYCrCb( const unsigned char* py, const unsigned char* pcr, const unsigned char* pcb,
+                      unsigned w, unsigned h,
+                      unsigned char* dst, size_t dststride, unsigned depth,
+                      const srcnn_executor* exec );
+
+// Bicubic resize of libsrcnn.cpp on one 8bit channel, steps are bytes per
+// pixel. work holds SRCNNResizeWorkSize() bytes, exec must not be NULL.
+size_t SRCNNResizeWorkSize( unsigned sh, unsigned dw, unsigned dh );
+
+void SRCNNResizeBicubic( const unsigned char* src, size_t srcstride, unsigned srcstep,
+                         unsigned sw, unsigned sh,
+                         unsigned char* dst, size_t dststride, unsigned dststep,
+                         unsigned dw, unsigned dh, void* work,
+                         const srcnn_executor* exec );
+
+#endif /// of __SRCNNKERNEL_H__
@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include <unistd.h>
+#include <dirent.h>
+#ifdef __linux__
+    #include <sched.h>
+#endif
+
+#include "srcnnnuma.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define SYSFS_NODE_PATH     "/sys/devices/system/node"
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool NUMAParseCpuList( const char* list, vector<int>& cpus )
+{
+    cpus.clear();
+
+    if ( list == NULL )
+        return false;
+
+    const char* ptr = list;
+
+    while( *ptr != 0 )
+    {
+        char* endp = NULL;
+        long  c0   = strtol( ptr, &endp, 10 );
+        long  c1   = c0;
+
+        if ( ( endp == ptr ) || ( c0 < 0 ) )
+            return false;
+
+        ptr = endp;
+
+        if ( *ptr == '-' )
+        {
+            ptr++;
+            c1 = strtol( ptr, &endp, 10 );
+
+            if ( ( endp == ptr ) || ( c1 < c0 ) )
+                return false;
+
+            ptr = endp;
+        }
+
+        for ( long cnt = c0; cnt <= c1; cnt++ )
+        {
+            cpus.push_back( (int)cnt );
+        }
+
+        // sysfs lists end with new line.
+        while( ( *ptr == ',' ) || ( *ptr == '\n' ) || ( *ptr == ' ' ) )
+        {
+            ptr++;
+        }
+    }
+
+    return ( cpus.size() > 0 );
+}
+
+static bool nodeLess( const NUMANode& a, const NUMANode& b )
+{
+    return a.node < b.node;
+}
+
+unsigned NUMADetect( vector<NUMANode>& nodes )
+{
+    nodes.clear();
+
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO( &allowed );
+
+    bool hasmask = ( sched_getaffinity( 0, sizeof( allowed ), &allowed ) == 0 );
+
+    DIR* dir = opendir( SYSFS_NODE_PATH );
+
+    if ( dir == NULL )
+        return 0;
+
+    struct dirent* ent = NULL;
+
+    while( ( ent = readdir( dir ) ) != NULL )
+    {
+        int nodeid = -1;
+
+        if ( ( strncmp( ent->d_name, "node", 4 ) != 0 ) ||
+             ( sscanf( ent->d_name + 4, "%d", &nodeid ) != 1 ) )
+            continue;
+
+        char path[512] = {0};
+        snprintf( path, sizeof( path ), SYSFS_NODE_PATH "/%s/cpulist", ent->d_name );
+
+        FILE* fp = fopen( path, "r" );
+        if ( fp == NULL )
+            continue;
+
+        char line[4096] = {0};
+        bool readok     = ( fgets( line, sizeof( line ), fp ) != NULL );
+        fclose( fp );
+
+        NUMANode    nn;
+        vector<int> cpus;
+
+        nn.node = nodeid;
+
+        if ( ( readok == false ) || ( NUMAParseCpuList( line, cpus ) == false ) )
+            continue;
+
+        for ( size_t cnt = 0; cnt < cpus.size(); cnt++ )
+        {
+            if ( ( hasmask == false ) ||
+                 ( ( cpus[cnt] < CPU_SETSIZE ) && CPU_ISSET( cpus[cnt], &allowed ) ) )
+            {
+                nn.cpus.push_back( cpus[cnt] );
+            }
+        }
+
+        // memory only nodes and nodes out of affinity.
+        if ( nn.cpus.size() > 0 )
+        {
+            nodes.push_back( nn );
+        }
+    }
+
+    closedir( dir );
+
+    sort( nodes.begin(), nodes.end(), nodeLess );
+#endif /// of __linux__
+
+    return (unsigned)nodes.size();
+}
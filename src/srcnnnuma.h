@@ -0,0 +1,26 @@
+#ifndef __SRCNNNUMA_H__
+#define __SRCNNNUMA_H__
+
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// NUMA topology from sysfs ( /sys/devices/system/node ), no libnuma.
+// - Nodes without usable CPU are left out.
+// - Non-Linux systems are reported as one node.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+    int                 node;       /// sysfs node number.
+    std::vector<int>    cpus;       /// CPUs allowed to this process.
+}NUMANode;
+
+// "0-3,8,10-11" to CPU numbers, false for bad list.
+bool NUMAParseCpuList( const char* list, std::vector<int>& cpus );
+
+// Nodes in order, returns count of nodes, 0 when not known.
+unsigned NUMADetect( std::vector<NUMANode>& nodes );
+
+#endif /// of __SRCNNNUMA_H__
@@ -0,0 +1,554 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <ctime>
+
+#ifdef __linux__
+    #include <unistd.h>
+    #include <sys/syscall.h>
+    #include <linux/perf_event.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <cpuid.h>
+#endif
+
+#include "srcnnprof.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define PROF_BLOCK_EVENTS   4096
+#define PROF_NAME_MAX       32
+#define PROF_STAGES_MAX     32
+#define PROF_LINE_BYTES     64      /// bytes moved by each LLC miss.
+
+typedef struct
+{
+    const char*     name;
+    const char*     cat;
+    uint64_t        t0;
+    uint64_t        t1;
+    int64_t         arg;
+}ProfEvent;
+
+typedef struct ProfBlock
+{
+    ProfEvent           events[ PROF_BLOCK_EVENTS ];
+    unsigned            count;
+    struct ProfBlock*   next;
+}ProfBlock;
+
+// Scope name summed with counters, per thread.
+typedef struct
+{
+    const char*     name;
+    uint64_t        calls;
+    uint64_t        ns;
+    uint64_t        counts[ PROF_CNT_MAX ];
+}ProfStage;
+
+typedef struct ProfThread
+{
+    unsigned            tid;
+    const char*         name;
+    ProfBlock*          head;
+    ProfBlock*          tail;
+    int                 fds[ PROF_CNT_MAX ];
+    ProfStage           stages[ PROF_STAGES_MAX ];
+    unsigned            nstages;
+    struct ProfThread*  next;
+}ProfThread;
+
+static int              prof_enabled = 0;
+static uint64_t         prof_origin  = 0;
+static unsigned         prof_tidseq  = 0;
+static int              prof_counters = 0;
+static int              prof_tiles   = 1;
+static unsigned         prof_cntmask = 0;       /// counters opened at enable.
+static uint64_t         prof_pixels  = 0;
+static ProfThread*      prof_threads = NULL;    /// pushed by CAS, never removed.
+static __thread ProfThread* prof_self = NULL;
+
+////////////////////////////////////////////////////////////////////////////////
+
+uint64_t ProfNow()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void ProfEnable( bool enable )
+{
+    if ( ( enable == true ) && ( prof_origin == 0 ) )
+        prof_origin = ProfNow();
+
+    __atomic_store_n( &prof_enabled, enable ? 1 : 0, __ATOMIC_RELEASE );
+}
+
+bool ProfEnabled()
+{
+    return __atomic_load_n( &prof_enabled, __ATOMIC_RELAXED ) != 0;
+}
+
+void ProfTilesEnable( bool enable )
+{
+    __atomic_store_n( &prof_tiles, enable ? 1 : 0, __ATOMIC_RELEASE );
+}
+
+bool ProfCategoryEnabled( const char* cat )
+{
+    if ( ProfEnabled() == false )
+        return false;
+
+    if ( ( __atomic_load_n( &prof_tiles, __ATOMIC_RELAXED ) == 0 ) &&
+         ( cat != NULL ) && ( strcmp( cat, PROF_CAT_TILE ) == 0 ) )
+        return false;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef __linux__
+
+static bool profIntelCPU()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax = 0;
+    unsigned ebx = 0;
+    unsigned ecx = 0;
+    unsigned edx = 0;
+
+    if ( __get_cpuid( 0, &eax, &ebx, &ecx, &edx ) == 0 )
+        return false;
+
+    // "GenuineIntel"
+    return ( ebx == 0x756e6547 ) && ( edx == 0x49656e69 ) && ( ecx == 0x6c65746e );
+#else
+    return false;
+#endif
+}
+
+// Counter of calling thread only, user space, any CPU.
+static int profOpenCounter( unsigned cnt )
+{
+    struct perf_event_attr attr;
+
+    memset( &attr, 0, sizeof( attr ) );
+
+    attr.size           = sizeof( attr );
+    attr.disabled       = 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch( cnt )
+    {
+        case PROF_CNT_CYCLES:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+
+        case PROF_CNT_INSTR:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+
+        case PROF_CNT_LLCMISS:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+
+        // FP_ARITH_INST_RETIRED ( 0xC7 ), single precision umasks,
+        // no generic event for FP, so Intel only.
+        case PROF_CNT_FPSCALAR:
+        case PROF_CNT_FP128:
+        case PROF_CNT_FP256:
+            {
+                if ( profIntelCPU() == false )
+                    return -1;
+
+                static const unsigned umasks[] = { 0x02, 0x08, 0x20 };
+
+                attr.type   = PERF_TYPE_RAW;
+                attr.config = ( umasks[ cnt - PROF_CNT_FPSCALAR ] << 8 ) | 0xC7;
+            }
+            break;
+
+        default:
+            return -1;
+    }
+
+    return (int)syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+
+static uint64_t profReadCounter( int fd )
+{
+    uint64_t vals[3] = { 0, 0, 0 };   /// value, enabled, running.
+
+    if ( read( fd, vals, sizeof( vals ) ) != (ssize_t)sizeof( vals ) )
+        return 0;
+
+    // scaled when multiplexed with other events.
+    if ( ( vals[2] > 0 ) && ( vals[2] < vals[1] ) )
+        return (uint64_t)( (double)vals[0] * (double)vals[1] / (double)vals[2] );
+
+    return vals[0];
+}
+
+#endif /// of __linux__
+
+// Buffer of calling thread, made and published at first use.
+static ProfThread* profSelf()
+{
+    if ( prof_self != NULL )
+        return prof_self;
+
+    ProfThread* pt = new (std::nothrow) ProfThread;
+
+    if ( pt == NULL )
+        return NULL;
+
+    pt->tid  = __atomic_add_fetch( &prof_tidseq, 1, __ATOMIC_RELAXED );
+    pt->name = NULL;
+    pt->head = NULL;
+    pt->tail = NULL;
+    pt->nstages = 0;
+
+    for ( unsigned cnt = 0; cnt < PROF_CNT_MAX; cnt++ )
+    {
+        pt->fds[cnt] = -1;
+
+#ifdef __linux__
+        if ( ( prof_cntmask & ( 1u << cnt ) ) != 0 )
+            pt->fds[cnt] = profOpenCounter( cnt );
+#endif
+    }
+
+    pt->next = __atomic_load_n( &prof_threads, __ATOMIC_RELAXED );
+
+    while( __atomic_compare_exchange_n( &prof_threads, &pt->next, pt, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED ) == false )
+    {
+    }
+
+    prof_self = pt;
+
+    return pt;
+}
+
+void ProfThreadName( const char* name )
+{
+    if ( ProfEnabled() == false )
+        return;
+
+    ProfThread* pt = profSelf();
+
+    if ( pt != NULL )
+        pt->name = name;
+}
+
+// Sums counted scope to its name, names are mostly same literal.
+static void profStage( ProfThread* pt, const char* name, uint64_t ns, const uint64_t* c0 )
+{
+    uint64_t c1[ PROF_CNT_MAX ];
+
+    ProfCountersRead( c1 );
+
+    ProfStage* st = NULL;
+
+    for ( unsigned cnt = 0; cnt < pt->nstages; cnt++ )
+    {
+        if ( ( pt->stages[cnt].name == name ) || ( strcmp( pt->stages[cnt].name, name ) == 0 ) )
+        {
+            st = &pt->stages[cnt];
+            break;
+        }
+    }
+
+    if ( st == NULL )
+    {
+        if ( pt->nstages == PROF_STAGES_MAX )
+            return;
+
+        st = &pt->stages[ pt->nstages++ ];
+        memset( st, 0, sizeof( ProfStage ) );
+        st->name = name;
+    }
+
+    st->calls++;
+    st->ns += ns;
+
+    for ( unsigned cnt = 0; cnt < PROF_CNT_MAX; cnt++ )
+    {
+        if ( c1[cnt] > c0[cnt] )
+            st->counts[cnt] += c1[cnt] - c0[cnt];
+    }
+}
+
+void ProfRecord( const char* name, const char* cat, uint64_t t0, uint64_t t1, int64_t arg,
+                 const uint64_t* c0 )
+{
+    ProfThread* pt = profSelf();
+
+    if ( pt == NULL )
+        return;
+
+    if ( c0 != NULL )
+        profStage( pt, name, t1 - t0, c0 );
+
+    ProfBlock* blk = pt->tail;
+
+    if ( ( blk == NULL ) || ( blk->count == PROF_BLOCK_EVENTS ) )
+    {
+        blk = new (std::nothrow) ProfBlock;
+
+        if ( blk == NULL )
+            return;
+
+        blk->count = 0;
+        blk->next  = NULL;
+
+        if ( pt->tail != NULL )
+            pt->tail->next = blk;
+        else
+            pt->head = blk;
+
+        pt->tail = blk;
+    }
+
+    ProfEvent& ev = blk->events[ blk->count ];
+
+    ev.name = name;
+    ev.cat  = cat;
+    ev.t0   = t0;
+    ev.t1   = t1;
+    ev.arg  = arg;
+
+    blk->count++;
+}
+
+bool ProfCountersEnable()
+{
+#ifdef __linux__
+    unsigned mask = 0;
+
+    // probes each counter on calling thread, others open the same set.
+    for ( unsigned cnt = 0; cnt < PROF_CNT_MAX; cnt++ )
+    {
+        int fd = profOpenCounter( cnt );
+
+        if ( fd >= 0 )
+        {
+            mask |= 1u << cnt;
+            close( fd );
+        }
+    }
+
+    prof_cntmask = mask;
+#endif
+    // timers are summed per scope even without counters.
+    __atomic_store_n( &prof_counters, 1, __ATOMIC_RELEASE );
+
+    return prof_cntmask != 0;
+}
+
+bool ProfCountersEnabled()
+{
+    return __atomic_load_n( &prof_counters, __ATOMIC_RELAXED ) != 0;
+}
+
+void ProfCountersRead( uint64_t* values )
+{
+    ProfThread* pt = profSelf();
+
+    for ( unsigned cnt = 0; cnt < PROF_CNT_MAX; cnt++ )
+    {
+        values[cnt] = 0;
+
+#ifdef __linux__
+        if ( ( pt != NULL ) && ( pt->fds[cnt] >= 0 ) )
+            values[cnt] = profReadCounter( pt->fds[cnt] );
+#endif
+    }
+}
+
+void ProfAddPixels( uint64_t pixels )
+{
+    __atomic_add_fetch( &prof_pixels, pixels, __ATOMIC_RELAXED );
+}
+
+void ProfPrintCounters( FILE* fp )
+{
+    ProfStage sums[ PROF_STAGES_MAX ];
+    unsigned  nsums = 0;
+
+    // threads summed per name, in order of first thread seen.
+    for ( ProfThread* pt = __atomic_load_n( &prof_threads, __ATOMIC_ACQUIRE );
+          pt != NULL; pt = pt->next )
+    {
+        for ( unsigned cnt = 0; cnt < pt->nstages; cnt++ )
+        {
+            const ProfStage& st  = pt->stages[cnt];
+            ProfStage*       sum = NULL;
+
+            for ( unsigned qc = 0; qc < nsums; qc++ )
+            {
+                if ( strcmp( sums[qc].name, st.name ) == 0 )
+                {
+                    sum = &sums[qc];
+                    break;
+                }
+            }
+
+            if ( sum == NULL )
+            {
+                if ( nsums == PROF_STAGES_MAX )
+                    continue;
+
+                sum = &sums[ nsums++ ];
+                memset( sum, 0, sizeof( ProfStage ) );
+                sum->name = st.name;
+            }
+
+            sum->calls += st.calls;
+            sum->ns    += st.ns;
+
+            for ( unsigned qc = 0; qc < PROF_CNT_MAX; qc++ )
+                sum->counts[qc] += st.counts[qc];
+        }
+    }
+
+    bool has_ipc = ( prof_cntmask & ( ( 1u << PROF_CNT_CYCLES ) | ( 1u << PROF_CNT_INSTR ) ) )
+                   == ( ( 1u << PROF_CNT_CYCLES ) | ( 1u << PROF_CNT_INSTR ) );
+    bool has_fp  = ( prof_cntmask >> PROF_CNT_FPSCALAR ) == 7;
+    bool has_llc = ( prof_cntmask & ( 1u << PROF_CNT_LLCMISS ) ) != 0;
+
+    fprintf( fp, "- Stage counters : %llu output pixels%s\n",
+             (unsigned long long)prof_pixels,
+             prof_cntmask == 0 ? ", perf events not permitted, timers only" : "" );
+    fprintf( fp, "    %-18s %8s %12s %7s %9s %12s %9s\n",
+             "stage", "calls", "thread ms", "IPC", "GFLOP/s", "LLC misses", "B/pixel" );
+
+    for ( unsigned cnt = 0; cnt < nsums; cnt++ )
+    {
+        const ProfStage& st = sums[cnt];
+        char             ipc[16]  = "-";
+        char             gfl[16]  = "-";
+        char             llc[24]  = "-";
+        char             bpp[16]  = "-";
+
+        if ( ( has_ipc == true ) && ( st.counts[ PROF_CNT_CYCLES ] > 0 ) )
+        {
+            snprintf( ipc, 16, "%.2f",
+                      (double)st.counts[ PROF_CNT_INSTR ] / (double)st.counts[ PROF_CNT_CYCLES ] );
+        }
+
+        // FMA counts twice in FP_ARITH, so these are flops.
+        if ( ( has_fp == true ) && ( st.ns > 0 ) )
+        {
+            double flops = (double)st.counts[ PROF_CNT_FPSCALAR ]
+                         + (double)st.counts[ PROF_CNT_FP128 ] * 4.0
+                         + (double)st.counts[ PROF_CNT_FP256 ] * 8.0;
+
+            snprintf( gfl, 16, "%.2f", flops / (double)st.ns );
+        }
+
+        if ( has_llc == true )
+        {
+            snprintf( llc, 24, "%llu", (unsigned long long)st.counts[ PROF_CNT_LLCMISS ] );
+
+            if ( prof_pixels > 0 )
+            {
+                snprintf( bpp, 16, "%.3f",
+                          (double)st.counts[ PROF_CNT_LLCMISS ] * PROF_LINE_BYTES
+                          / (double)prof_pixels );
+            }
+        }
+
+        fprintf( fp, "    %-18s %8llu %12.3f %7s %9s %12s %9s\n",
+                 st.name, (unsigned long long)st.calls, (double)st.ns / 1000000.0,
+                 ipc, gfl, llc, bpp );
+    }
+
+    fprintf( fp, "    thread ms of tiles is summed over workers, stages count their own thread.\n" );
+}
+
+void ProfForEach( ProfEventFn fn, void* user )
+{
+    for ( ProfThread* pt = __atomic_load_n( &prof_threads, __ATOMIC_ACQUIRE );
+          pt != NULL; pt = pt->next )
+    {
+        for ( ProfBlock* blk = pt->head; blk != NULL; blk = blk->next )
+        {
+            for ( unsigned cnt = 0; cnt < blk->count; cnt++ )
+            {
+                const ProfEvent& ev = blk->events[cnt];
+
+                fn( user, ev.name, ev.cat, ev.t0, ev.t1, ev.arg );
+            }
+        }
+    }
+}
+
+// Microseconds from origin, trace-event unit, ns kept as fraction.
+static void profTime( FILE* fp, uint64_t ns )
+{
+    fprintf( fp, "%llu.%03llu",
+             (unsigned long long)( ns / 1000 ), (unsigned long long)( ns % 1000 ) );
+}
+
+bool ProfWriteTrace( const char* path )
+{
+    FILE* fp = fopen( path, "w" );
+
+    if ( fp == NULL )
+        return false;
+
+    fprintf( fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" );
+
+    bool        first = true;
+    ProfThread* pt    = __atomic_load_n( &prof_threads, __ATOMIC_ACQUIRE );
+
+    for ( ; pt != NULL; pt = pt->next )
+    {
+        char tname[ PROF_NAME_MAX ];
+
+        if ( pt->name != NULL )
+            snprintf( tname, PROF_NAME_MAX, "%s", pt->name );
+        else
+            snprintf( tname, PROF_NAME_MAX, "thread %u", pt->tid );
+
+        fprintf( fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                     "\"args\":{\"name\":\"%s\"}}",
+                 first ? "" : ",\n", pt->tid, tname );
+        first = false;
+
+        for ( ProfBlock* blk = pt->head; blk != NULL; blk = blk->next )
+        {
+            for ( unsigned cnt = 0; cnt < blk->count; cnt++ )
+            {
+                const ProfEvent& ev = blk->events[cnt];
+                uint64_t         t0 = ev.t0 > prof_origin ? ev.t0 - prof_origin : 0;
+
+                fprintf( fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":",
+                         ev.name, ev.cat, pt->tid );
+                profTime( fp, t0 );
+                fprintf( fp, ",\"dur\":" );
+                profTime( fp, ev.t1 - ev.t0 );
+
+                if ( ev.arg >= 0 )
+                    fprintf( fp, ",\"args\":{\"n\":%lld}", (long long)ev.arg );
+
+                fprintf( fp, "}" );
+            }
+        }
+    }
+
+    fprintf( fp, "\n]}\n" );
+
+    return fclose( fp ) == 0;
+}
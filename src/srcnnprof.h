@@ -0,0 +1,111 @@
+#ifndef __SRCNNPROF_H__
+#define __SRCNNPROF_H__
+
+#include <stdint.h>
+#include <cstdio>
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Lightweight profiler of pipeline stages and tiles.
+// - Monotonic clock in nanoseconds.
+// - Each thread records to its own chunked buffer, no locks on recording.
+// - Dumped as Chrome trace events ( chrome://tracing, Perfetto ).
+// - Scopes cost one relaxed load when profiler is off.
+// - Optional hardware counters per thread ( Linux perf events ), summed
+//   per scope name and reported as IPC, GFLOP/s and bytes per pixel.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define PROF_CAT_STAGE      "stage"
+#define PROF_CAT_TILE       "tile"
+
+#define PROF_CNT_CYCLES     0
+#define PROF_CNT_INSTR      1
+#define PROF_CNT_LLCMISS    2
+#define PROF_CNT_FPSCALAR   3   /// single precision, Intel FP_ARITH events.
+#define PROF_CNT_FP128      4
+#define PROF_CNT_FP256      5
+#define PROF_CNT_MAX        6
+
+uint64_t ProfNow();
+void     ProfEnable( bool enable );
+bool     ProfEnabled();
+
+// Tile events are on by default, bench without trace leaves them out.
+void     ProfTilesEnable( bool enable );
+// Recording of category now, PROF_CAT_TILE follows ProfTilesEnable().
+bool     ProfCategoryEnabled( const char* cat );
+
+// Name of calling thread in trace, name must stay alive.
+void     ProfThreadName( const char* name );
+
+// name and cat must be string literals or live until trace is written.
+// c0 is counters at t0, then scope is summed with counters also.
+void     ProfRecord( const char* name, const char* cat,
+                     uint64_t t0, uint64_t t1, int64_t arg = -1,
+                     const uint64_t* c0 = NULL );
+
+// Opens counters of each recording thread, false when perf events are
+// not permitted ( containers, perf_event_paranoid ), timers still work.
+bool     ProfCountersEnable();
+bool     ProfCountersEnabled();
+
+// Counters of calling thread, PROF_CNT_MAX values, 0 when not opened.
+void     ProfCountersRead( uint64_t* values );
+
+// Output pixels processed, base of bytes per pixel.
+void     ProfAddPixels( uint64_t pixels );
+
+// Per scope summary, recording threads must be done.
+void     ProfPrintCounters( FILE* fp );
+
+// Writes every recorded event, recording threads must be done.
+bool     ProfWriteTrace( const char* path );
+
+// Walks every recorded event, recording threads must be done.
+typedef void (*ProfEventFn)( void* user, const char* name, const char* cat,
+                             uint64_t t0, uint64_t t1, int64_t arg );
+
+void     ProfForEach( ProfEventFn fn, void* user );
+
+class ProfScope
+{
+    public:
+        ProfScope( const char* name, const char* cat = PROF_CAT_STAGE, int64_t arg = -1 )
+         : _name( name ), _cat( cat ), _arg( arg ), _counted( false ),
+           _t0( ProfCategoryEnabled( cat ) == true ? ProfNow() : 0 )
+        {
+            if ( ( _t0 != 0 ) && ( ProfCountersEnabled() == true ) )
+            {
+                ProfCountersRead( _c0 );
+                _counted = true;
+            }
+        }
+
+        ~ProfScope()
+        {
+            end();
+        }
+
+    public:
+        // Ends scope before its block does.
+        void end()
+        {
+            if ( _t0 != 0 )
+            {
+                ProfRecord( _name, _cat, _t0, ProfNow(), _arg,
+                            _counted == true ? _c0 : NULL );
+                _t0 = 0;
+            }
+        }
+
+    private:
+        const char*     _name;
+        const char*     _cat;
+        int64_t         _arg;
+        bool            _counted;
+        uint64_t        _t0;
+        uint64_t        _c0[ PROF_CNT_MAX ];
+};
+
+#endif /// of __SRCNNPROF_H__
@@ -0,0 +1,85 @@
+#ifndef __SRCNNPROTO_H__
+#define __SRCNNPROTO_H__
+
+#include <stdint.h>
+
+/*******************************************************************************
+ * srcnn daemon protocol over Unix domain socket.
+ * ----------------------------------------------------------------------------
+ * Client sends a request header followed by payload_size bytes, server
+ * replies a reply header followed by payload_size bytes. A connection may
+ * carry many requests, one after another.
+ *
+ * Request types :
+ *   SRCNN_REQ_PATH  - payload is "source path\0output path\0",
+ *                     server reads and writes files itself.
+ *   SRCNN_REQ_IMAGE - payload is encoded image ( PNG, JPEG, ... ),
+ *                     reply payload is encoded result in 'format'.
+ *   SRCNN_REQ_SHM   - payload is srcnn_shm_desc, request header is sent
+ *                     with two file descriptors ( SCM_RIGHTS ) of shared
+ *                     memory, source pixels then output pixels. Server
+ *                     maps both and reads, writes pixels in place.
+ *
+ * All fields are host byte order, client and server share one machine.
+*******************************************************************************/
+
+#define SRCNN_PROTO_MAGIC           0x4E435253  /* "SRCN" */
+#define SRCNN_PROTO_VERSION         1
+
+#define SRCNN_REQ_PATH              1
+#define SRCNN_REQ_IMAGE             2
+#define SRCNN_REQ_SHM               3
+
+/* request flags */
+#define SRCNN_REQF_GRAY             0x00000001  /* force Y only processing */
+
+/* reply status */
+#define SRCNN_REP_OK                0
+#define SRCNN_REP_ELOAD             -1          /* source load or decode */
+#define SRCNN_REP_EPROCESS          -2          /* SRCNN processing */
+#define SRCNN_REP_ESAVE             -10         /* output write or encode */
+#define SRCNN_REP_EREQUEST          -20         /* malformed request */
+
+#define SRCNN_PROTO_FORMAT_LEN      8
+
+typedef struct
+{
+    uint32_t    magic;
+    uint16_t    version;
+    uint16_t    type;
+    float       scale;          /* 0 for server default */
+    uint32_t    flags;
+    uint32_t    payload_size;
+    char        format[ SRCNN_PROTO_FORMAT_LEN ];  /* ".png", ".jpg" for image */
+}srcnn_req_header;
+
+/* Shared memory pixels, 8bit gray ( 1 ) or BGR ( 3 ) interleaved.
+   Output size must be ( unsigned )( (float)width * scale ), same for height.
+   Width times channels must fit in INT_MAX, SRCNN_REQF_GRAY ( or a gray
+   daemon ) needs 1 channel, both fds must be memfds with F_SEAL_SHRINK,
+   other requests get SRCNN_REP_EREQUEST. */
+typedef struct
+{
+    uint32_t    width;
+    uint32_t    height;
+    uint32_t    channels;
+    uint32_t    src_stride;     /* bytes per source row */
+    uint64_t    src_offset;     /* bytes from start of source fd */
+    uint32_t    dst_width;
+    uint32_t    dst_height;
+    uint32_t    dst_stride;     /* bytes per output row */
+    uint32_t    reserved;
+    uint64_t    dst_offset;     /* bytes from start of output fd */
+}srcnn_shm_desc;
+
+typedef struct
+{
+    uint32_t    magic;
+    int32_t     status;
+    uint32_t    width;
+    uint32_t    height;
+    uint32_t    channels;
+    uint32_t    payload_size;
+}srcnn_rep_header;
+
+#endif /* of __SRCNNPROTO_H__ */
@@ -0,0 +1,307 @@
+/*******************************************************************************
+ * SRCNN frozen reference
+ * ----------------------------------------------------------------------------
+ * Scalar SRCNN layers and FRAW resampling as first written, kept apart from
+ * the engine so optimized kernels always have something to be measured to.
+*******************************************************************************/
+#include <cmath>
+#include <vector>
+
+#include "srcnnref.h"
+
+/* pre-calculated convolutional data */
+#include "convdata.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static inline int refClamp( int v, int n )
+{
+    return v < 0 ? 0 : ( v >= n ? n - 1 : v );
+}
+
+void SRCNNRefLayer12( const unsigned char* src, unsigned width, unsigned height,
+                      float* const* planes )
+{
+    float temp[CONV1_FILTERS];
+
+    for ( int row = 0; row < (int)height; row++ )
+    {
+        for ( int col = 0; col < (int)width; col++ )
+        {
+            for ( int k = 0; k < CONV1_FILTERS; k++ )
+            {
+                temp[k] = 0.0;
+
+                for ( int i = 0; i < 9; i++ )
+                {
+                    const unsigned char* srow = src + (size_t)refClamp( row + i - 4, height ) * width;
+
+                    for ( int j = 0; j < 9; j++ )
+                    {
+                        temp[k] += weights_conv1_data[k][i][j] * srow[ refClamp( col + j - 4, width ) ];
+                    }
+                }
+
+                temp[k] += biases_conv1[k];
+                temp[k] = ( temp[k] < 0 ) ? 0 : temp[k];
+            }
+
+            for ( int k = 0; k < CONV2_FILTERS; k++ )
+            {
+                float result = 0.0;
+
+                for ( int i = 0; i < CONV1_FILTERS; i++ )
+                {
+                    result += temp[i] * weights_conv2_data[k][i];
+                }
+
+                result += biases_conv2[k];
+                result = ( result < 0 ) ? 0 : result;
+
+                planes[k][ (size_t)row * width + col ] = result;
+            }
+        }
+    }
+}
+
+void SRCNNRefLayer3( const float* const* planes, unsigned width, unsigned height,
+                     unsigned char* dst )
+{
+    for ( int row = 0; row < (int)height; row++ )
+    {
+        for ( int col = 0; col < (int)width; col++ )
+        {
+            float temp = 0;
+
+            for ( int i = 0; i < CONV2_FILTERS; i++ )
+            {
+                double temppixel = 0;
+
+                for ( int m = 0; m < 5; m++ )
+                {
+                    const float* prow = planes[i] + (size_t)refClamp( row + m - 2, height ) * width;
+
+                    for ( int n = 0; n < 5; n++ )
+                    {
+                        temppixel += weights_conv3_data[i][m][n] * prow[ refClamp( col + n - 2, width ) ];
+                    }
+                }
+
+                temp += temppixel;
+            }
+
+            temp += biases_conv3;
+
+            // truncated to int, then clamped, as layer III always did.
+            int tv = (int)temp;
+
+            dst[ (size_t)row * width + col ] = (unsigned char)( tv < 0 ? 0 : ( tv > 255 ? 255 : tv ) );
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+    int             left;
+    int             right;
+    vector<double>  w;
+}RefTaps;
+
+static double refFilter( int filter, double v )
+{
+    v = fabs( v );
+
+    if ( filter == SRCNNREF_FILTER_BOX )
+        return v <= 0.5 ? 1.0 : 0.0;
+
+    if ( filter == SRCNNREF_FILTER_BILINEAR )
+        return v < 1.0 ? 1.0 - v : 0.0;
+
+    const double b = 1.0 / 3.0;
+    const double c = 1.0 / 3.0;
+
+    if ( v < 1 )
+        return ( ( 6 - 2 * b ) / 6 ) +
+               v * v * ( ( ( -18 + 12 * b + 6 * c ) / 6 ) + v * ( ( 12 - 9 * b - 6 * c ) / 6 ) );
+
+    if ( v < 2 )
+        return ( ( 8 * b + 24 * c ) / 6 ) +
+               v * ( ( ( -12 * b - 48 * c ) / 6 ) +
+               v * ( ( ( 6 * b + 30 * c ) / 6 ) + v * ( ( -b - 6 * c ) / 6 ) ) );
+
+    return 0;
+}
+
+static double refFilterWidth( int filter )
+{
+    if ( filter == SRCNNREF_FILTER_BOX )
+        return 0.5;
+
+    if ( filter == SRCNNREF_FILTER_BILINEAR )
+        return 1.0;
+
+    return 2.0;
+}
+
+static void refTaps( int filter, unsigned dstn, unsigned srcn, vector<RefTaps>& taps )
+{
+    double scale  = (double)dstn / (double)srcn;
+    double width  = refFilterWidth( filter );
+    double fscale = 1.0;
+
+    if ( scale < 1.0 )
+    {
+        width  = width / scale;
+        fscale = scale;
+    }
+
+    int    window = 2 * (int)ceil( width ) + 1;
+    double offset = ( 0.5 / scale ) - 0.5;
+
+    taps.resize( dstn );
+
+    for ( unsigned u = 0; u < dstn; u++ )
+    {
+        RefTaps& t      = taps[u];
+        double   center = (double)u / scale + offset;
+
+        t.left  = max( 0, (int)floor( center - width ) );
+        t.right = min( (int)ceil( center + width ), (int)srcn - 1 );
+
+        // FRAW compares to srcn - 1 / 2, which is srcn in integers.
+        if ( t.right - t.left + 1 > window )
+        {
+            if ( t.left < (int)srcn )
+                t.left++;
+            else
+                t.right--;
+        }
+
+        t.w.assign( t.right - t.left + 1, 0.0 );
+
+        double total = 0.0;
+
+        for ( int s = t.left; s <= t.right; s++ )
+        {
+            double w = fscale * refFilter( filter, fscale * ( center - (double)s ) );
+
+            t.w[ s - t.left ] = w;
+            total += w;
+        }
+
+        if ( ( total > 0 ) && ( total != 1 ) )
+        {
+            for ( int s = t.left; s <= t.right; s++ )
+            {
+                t.w[ s - t.left ] /= total;
+            }
+
+            // trailing zero weights are dropped.
+            int s = t.right - t.left;
+
+            while( t.w[s] == 0 )
+            {
+                t.right--;
+                s--;
+
+                if ( t.right == t.left )
+                    break;
+            }
+        }
+    }
+}
+
+// Rows of height from src_width to dst_width.
+static void refHorizontal( const float* src, unsigned height, unsigned src_width,
+                           float* dst, unsigned dst_width, int filter )
+{
+    vector<RefTaps> taps;
+    refTaps( filter, dst_width, src_width, taps );
+
+    for ( unsigned y = 0; y < height; y++ )
+    {
+        for ( unsigned x = 0; x < dst_width; x++ )
+        {
+            const RefTaps& t    = taps[x];
+            double         gray = 0.0;
+
+            for ( int i = 0; i <= t.right - t.left; i++ )
+            {
+                gray += t.w[i] * (double)src[ (size_t)y * src_width + t.left + i ];
+            }
+
+            dst[ (size_t)y * dst_width + x ] = (float)gray;
+        }
+    }
+}
+
+// Columns of width from src_height to dst_height.
+static void refVertical( const float* src, unsigned width, unsigned src_height,
+                         float* dst, unsigned dst_height, int filter )
+{
+    vector<RefTaps> taps;
+    refTaps( filter, dst_height, src_height, taps );
+
+    for ( unsigned x = 0; x < width; x++ )
+    {
+        for ( unsigned y = 0; y < dst_height; y++ )
+        {
+            const RefTaps& t    = taps[y];
+            double         gray = 0.0;
+
+            for ( int i = 0; i <= t.right - t.left; i++ )
+            {
+                gray += t.w[i] * (double)src[ (size_t)( t.left + i ) * width + x ];
+            }
+
+            dst[ (size_t)y * width + x ] = (float)gray;
+        }
+    }
+}
+
+void SRCNNRefResize( const float* src, unsigned src_width, unsigned src_height,
+                     float* dst, unsigned dst_width, unsigned dst_height, int filter )
+{
+    vector<float> tmp;
+
+    // narrowing goes horizontal first, widening vertical first, as FRAW.
+    if ( dst_width <= src_width )
+    {
+        const float* hsrc = src;
+
+        if ( src_width != dst_width )
+        {
+            tmp.resize( (size_t)dst_width * src_height );
+            refHorizontal( src, src_height, src_width, tmp.data(), dst_width, filter );
+            hsrc = tmp.data();
+        }
+
+        if ( src_height != dst_height )
+        {
+            refVertical( hsrc, dst_width, src_height, dst, dst_height, filter );
+        }
+        else
+        {
+            copy( hsrc, hsrc + (size_t)dst_width * dst_height, dst );
+        }
+    }
+    else
+    {
+        const float* vsrc = src;
+
+        if ( src_height != dst_height )
+        {
+            tmp.resize( (size_t)src_width * dst_height );
+            refVertical( src, src_width, src_height, tmp.data(), dst_height, filter );
+            vsrc = tmp.data();
+        }
+
+        refHorizontal( vsrc, dst_height, src_width, dst, dst_width, filter );
+    }
+}
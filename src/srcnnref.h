@@ -0,0 +1,30 @@
+#ifndef __SRCNNREF_H__
+#define __SRCNNREF_H__
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Frozen scalar reference of SRCNN layers and FRAW resize filters.
+// - Plain loops in original operation order, whole image, no tiles.
+// - Never optimized : every engine variant is checked against these by
+//   srcnn-verify, so changes here need a reason besides speed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define SRCNNREF_FILTER_BOX         0
+#define SRCNNREF_FILTER_BILINEAR    1
+#define SRCNNREF_FILTER_BICUBIC     2   /// Mitchell, B = C = 1/3.
+
+// Layer I ( 9x9 ) and II ( 1x1 ), 32 planes of width x height, borders
+// replicated, rows are not padded.
+void SRCNNRefLayer12( const unsigned char* src, unsigned width, unsigned height,
+                      float* const* planes );
+
+// Layer III ( 5x5 ) of 32 planes to 8bit.
+void SRCNNRefLayer3( const float* const* planes, unsigned width, unsigned height,
+                     unsigned char* dst );
+
+// Same to FRAWResizeEngine::scale() of the filter, dst is dst_width x dst_height.
+void SRCNNRefResize( const float* src, unsigned src_width, unsigned src_height,
+                     float* dst, unsigned dst_width, unsigned dst_height, int filter );
+
+#endif /// of __SRCNNREF_H__
@@ -0,0 +1,499 @@
+/*******************************************************************************
+ * srcnn-verify : differential test of engine variants to frozen reference.
+ * ----------------------------------------------------------------------------
+ * Every variant of SRCNN layers and FRAW resize runs on random and real
+ * images, each layer from reference input, so errors do not pile up.
+ * Max absolute error and PSNR are reported per layer, exit code is 1 when
+ * any variant is over its tolerance.
+*******************************************************************************/
+#ifdef FORVERIFYBIN
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <png.h>
+
+#include "libsrcnn.h"
+#include "srcnnkernel.h"
+#include "srcnngraph.h"
+#include "srcnnref.h"
+#include "frawscale.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Float reordering stays far under these, a wrong tap or border does not.
+#define TOL_LAYER12_MAXABS      1e-2    /// planes run 0 to some hundreds.
+#define TOL_LAYER3_MAXABS       1.0     /// one 8bit level, truncation flips.
+#define TOL_RESIZE_MAXABS       1e-3
+
+typedef struct
+{
+    string                  name;
+    unsigned                width;
+    unsigned                height;
+    vector<unsigned char>   luma;
+}VerifyImage;
+
+typedef struct
+{
+    const char*             name;
+    const srcnn_executor*   exec;
+    bool                    regions;    /// computed by uneven regions.
+    const SRCNNKernelConfig* kernel;    /// NULL for defaults.
+}LayerVariant;
+
+typedef struct
+{
+    double      maxabs;
+    double      psnr;       /// HUGE_VAL when same.
+}VerifyError;
+
+static unsigned verify_failures = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static VerifyError compareFloat( const float* ref, const float* out, size_t n, double peak )
+{
+    VerifyError ve = { 0.0, HUGE_VAL };
+    double      se = 0.0;
+
+    for ( size_t cnt = 0; cnt < n; cnt++ )
+    {
+        double d = fabs( (double)ref[cnt] - (double)out[cnt] );
+
+        if ( ( d > ve.maxabs ) || ( d != d ) )
+            ve.maxabs = d;
+
+        se += d * d;
+    }
+
+    if ( ( se > 0.0 ) && ( n > 0 ) && ( peak > 0.0 ) )
+        ve.psnr = 10.0 * log10( peak * peak / ( se / (double)n ) );
+
+    return ve;
+}
+
+static VerifyError compareByte( const unsigned char* ref, const unsigned char* out, size_t n )
+{
+    VerifyError ve = { 0.0, HUGE_VAL };
+    double      se = 0.0;
+
+    for ( size_t cnt = 0; cnt < n; cnt++ )
+    {
+        double d = fabs( (double)ref[cnt] - (double)out[cnt] );
+
+        if ( d > ve.maxabs )
+            ve.maxabs = d;
+
+        se += d * d;
+    }
+
+    if ( ( se > 0.0 ) && ( n > 0 ) )
+        ve.psnr = 10.0 * log10( 255.0 * 255.0 / ( se / (double)n ) );
+
+    return ve;
+}
+
+static void report( const VerifyImage& img, const char* layer, const char* variant,
+                    const VerifyError& ve, double tol )
+{
+    bool ok = ( ve.maxabs <= tol );
+    char psnr[32];
+
+    if ( ve.psnr == HUGE_VAL )
+        snprintf( psnr, 32, "inf" );
+    else
+        snprintf( psnr, 32, "%.2f", ve.psnr );
+
+    printf( "%-26s %-12s %-18s %12.6f %9s  %s\n",
+            img.name.c_str(), layer, variant, ve.maxabs, psnr, ok ? "ok" : "FAIL" );
+    fflush( stdout );
+
+    if ( ok == false )
+        verify_failures++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Regions of uneven size over image, borders of region meet inside tiles.
+static void unevenRegions( unsigned w, unsigned h, vector<SRCNNRegion>& rgns )
+{
+    unsigned xs[4] = { 0, w / 3 + 5, ( w * 2 ) / 3 + 1, w };
+    unsigned ys[4] = { 0, h / 4 + 3, ( h * 3 ) / 5 + 7, h };
+
+    rgns.clear();
+
+    for ( unsigned ry = 0; ry < 3; ry++ )
+    {
+        for ( unsigned rx = 0; rx < 3; rx++ )
+        {
+            SRCNNRegion r;
+
+            r.x0 = xs[rx] < w ? xs[rx] : w;
+            r.x1 = xs[rx + 1] < w ? xs[rx + 1] : w;
+            r.y0 = ys[ry] < h ? ys[ry] : h;
+            r.y1 = ys[ry + 1] < h ? ys[ry + 1] : h;
+
+            if ( ( r.x1 > r.x0 ) && ( r.y1 > r.y0 ) )
+                rgns.push_back( r );
+        }
+    }
+}
+
+static void makePlanes( vector<float>& buf, vector<float*>& planes, size_t px )
+{
+    buf.assign( px * SRCNN_KERNEL_PLANES, -1.f );
+    planes.resize( SRCNN_KERNEL_PLANES );
+
+    for ( unsigned cnt = 0; cnt < SRCNN_KERNEL_PLANES; cnt++ )
+    {
+        planes[cnt] = &buf[ px * cnt ];
+    }
+}
+
+static void verifyLayers( const VerifyImage& img, const vector<LayerVariant>& variants )
+{
+    unsigned w  = img.width;
+    unsigned h  = img.height;
+    size_t   px = (size_t)w * h;
+
+    vector<float>         refbuf;
+    vector<float*>        refplanes;
+    vector<unsigned char> refout( px );
+
+    makePlanes( refbuf, refplanes, px );
+
+    SRCNNRefLayer12( img.luma.data(), w, h, refplanes.data() );
+    SRCNNRefLayer3( refplanes.data(), w, h, refout.data() );
+
+    double peak = 0.0;
+
+    for ( size_t cnt = 0; cnt < refbuf.size(); cnt++ )
+    {
+        if ( refbuf[cnt] > peak )
+            peak = refbuf[cnt];
+    }
+
+    vector<SRCNNRegion> rgns;
+    unevenRegions( w, h, rgns );
+
+    for ( unsigned vc = 0; vc < variants.size(); vc++ )
+    {
+        const LayerVariant& lv = variants[vc];
+
+        vector<float>         buf;
+        vector<float*>        planes;
+        vector<unsigned char> out( px, 0 );
+
+        makePlanes( buf, planes, px );
+
+        SRCNNSetKernelConfig( lv.kernel );
+
+        if ( lv.regions == true )
+        {
+            for ( unsigned rc = 0; rc < rgns.size(); rc++ )
+            {
+                SRCNNLayer12( img.luma.data(), w, w, h, planes.data(), w, &rgns[rc], lv.exec );
+            }
+        }
+        else
+        {
+            SRCNNLayer12( img.luma.data(), w, w, h, planes.data(), w, NULL, lv.exec );
+        }
+
+        report( img, "layer I+II", lv.name,
+                compareFloat( refbuf.data(), buf.data(), buf.size(), peak ),
+                TOL_LAYER12_MAXABS );
+
+        // layer III reads reference planes, only its own error counts.
+        if ( lv.regions == true )
+        {
+            for ( unsigned rc = 0; rc < rgns.size(); rc++ )
+            {
+                SRCNNLayer3( refplanes.data(), w, w, h, out.data(), w, &rgns[rc], lv.exec );
+            }
+        }
+        else
+        {
+            SRCNNLayer3( refplanes.data(), w, w, h, out.data(), w, NULL, lv.exec );
+        }
+
+        report( img, "layer III", lv.name,
+                compareByte( refout.data(), out.data(), px ), TOL_LAYER3_MAXABS );
+    }
+
+    SRCNNSetKernelConfig( NULL );
+}
+
+// Built-in model through graph executor, fused kernels and generic nodes.
+static void verifyGraph( const VerifyImage& img )
+{
+    unsigned w  = img.width;
+    unsigned h  = img.height;
+    size_t   px = (size_t)w * h;
+
+    vector<float>         refbuf;
+    vector<float*>        refplanes;
+    vector<unsigned char> refout( px );
+
+    makePlanes( refbuf, refplanes, px );
+
+    SRCNNRefLayer12( img.luma.data(), w, h, refplanes.data() );
+    SRCNNRefLayer3( refplanes.data(), w, h, refout.data() );
+
+    for ( int fused = 1; fused >= 0; fused-- )
+    {
+        vector<unsigned char> out( px, 0 );
+
+        SRCNNGraph g;
+
+        int ts = g.external( (void*)img.luma.data(), w, h, 1, w );
+        int td = g.external( out.data(), w, h, 1, w );
+
+        g.model( *SRCNNBuiltinModel(), ts, td );
+        g.fusion( fused == 1 );
+
+        void* arena = NULL;
+
+        if ( ( g.plan() == false ) ||
+             ( posix_memalign( &arena, 64, g.arenaSize() + 64 ) != 0 ) )
+        {
+            printf( "Error: graph of %s cannot be planned.\n", img.name.c_str() );
+            verify_failures++;
+            continue;
+        }
+
+        g.bindArena( arena );
+        g.run( srcnn_executor_default() );
+
+        report( img, "graph", fused == 1 ? "fused" : "generic nodes",
+                compareByte( refout.data(), out.data(), px ), TOL_LAYER3_MAXABS );
+
+        free( arena );
+    }
+}
+
+static void verifyResize( const VerifyImage& img )
+{
+    static const struct
+    {
+        const char* name;
+        int         filter;
+    }filters[] =
+    {
+        { "FRAW box",      SRCNNREF_FILTER_BOX },
+        { "FRAW bilinear", SRCNNREF_FILTER_BILINEAR },
+        { "FRAW bicubic",  SRCNNREF_FILTER_BICUBIC },
+    };
+
+    // up as SRCNN input, down as Pictures/Resize.m makes LR images.
+    static const float ratios[] = { 2.0f, 1.f / 1.5f, 0.37f };
+
+    unsigned      w = img.width;
+    unsigned      h = img.height;
+    vector<float> src( (size_t)w * h );
+
+    for ( size_t cnt = 0; cnt < src.size(); cnt++ )
+    {
+        src[cnt] = img.luma[cnt];
+    }
+
+    for ( unsigned fc = 0; fc < sizeof( filters ) / sizeof( filters[0] ); fc++ )
+    {
+        for ( unsigned rc = 0; rc < sizeof( ratios ) / sizeof( float ); rc++ )
+        {
+            unsigned dw = (unsigned)( w * ratios[rc] );
+            unsigned dh = (unsigned)( h * ratios[rc] );
+
+            if ( ( dw < 2 ) || ( dh < 2 ) )
+                continue;
+
+            vector<float> ref( (size_t)dw * dh );
+            SRCNNRefResize( src.data(), w, h, ref.data(), dw, dh, filters[fc].filter );
+
+            FRAWBoxFilter      fbox;
+            FRAWBilinearFilter fbil;
+            FRAWBicubicFilter  fbic;
+            FRAWGenericFilter* pf = &fbic;
+
+            if ( filters[fc].filter == SRCNNREF_FILTER_BOX )
+                pf = &fbox;
+            else
+            if ( filters[fc].filter == SRCNNREF_FILTER_BILINEAR )
+                pf = &fbil;
+
+            FRAWResizeEngine engine( pf );
+            float*           out = NULL;
+
+            char layer[32];
+            snprintf( layer, 32, "resize %.2fx", ratios[rc] );
+
+            if ( engine.scale( src.data(), w, h, dw, dh, &out ) == 0 )
+            {
+                VerifyError ve = { HUGE_VAL, 0.0 };
+                report( img, layer, filters[fc].name, ve, TOL_RESIZE_MAXABS );
+            }
+            else
+            {
+                report( img, layer, filters[fc].name,
+                        compareFloat( ref.data(), out, ref.size(), 255.0 ),
+                        TOL_RESIZE_MAXABS );
+            }
+
+            if ( out != NULL )
+                delete[] out;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned verifyRandom( unsigned& seed )
+{
+    seed = seed * 1103515245u + 12345u;
+    return ( seed >> 16 ) & 0x7FFF;
+}
+
+// Noise is worst case for reordering, gradient with noise looks like image.
+static void makeRandom( VerifyImage& img, unsigned w, unsigned h, unsigned seed, bool noise )
+{
+    char name[64];
+    snprintf( name, 64, "%s %ux%u", noise ? "noise" : "gradient", w, h );
+
+    img.name   = name;
+    img.width  = w;
+    img.height = h;
+    img.luma.resize( (size_t)w * h );
+
+    for ( unsigned y = 0; y < h; y++ )
+    {
+        for ( unsigned x = 0; x < w; x++ )
+        {
+            unsigned r = verifyRandom( seed );
+            unsigned v = noise ? ( r & 0xFF ) : ( ( x + y ) * 255 / ( w + h ) + ( r & 15 ) );
+
+            img.luma[ (size_t)y * w + x ] = (unsigned char)( v > 255 ? 255 : v );
+        }
+    }
+}
+
+static bool loadPNG( VerifyImage& img, const char* path )
+{
+    png_image pimg;
+
+    memset( &pimg, 0, sizeof( pimg ) );
+    pimg.version = PNG_IMAGE_VERSION;
+
+    if ( png_image_begin_read_from_file( &pimg, path ) == 0 )
+        return false;
+
+    pimg.format = PNG_FORMAT_GRAY;
+
+    img.name   = path;
+    img.width  = pimg.width;
+    img.height = pimg.height;
+    img.luma.resize( PNG_IMAGE_SIZE( pimg ) );
+
+    if ( png_image_finish_read( &pimg, NULL, img.luma.data(), 0, NULL ) == 0 )
+    {
+        png_image_free( &pimg );
+        return false;
+    }
+
+    return true;
+}
+
+int main( int argc, char** argv )
+{
+    vector<VerifyImage> images( 3 );
+
+    makeRandom( images[0], 67, 45, 0x1234, true );
+    makeRandom( images[1], 130, 97, 0xBEEF, true );
+    makeRandom( images[2], 203, 61, 0x5EED, false );
+
+    for ( int cnt = 1; cnt < argc; cnt++ )
+    {
+        VerifyImage img;
+
+        if ( loadPNG( img, argv[cnt] ) == false )
+        {
+            printf( "Error: cannot load %s, PNG only.\n", argv[cnt] );
+            return 1;
+        }
+
+        images.push_back( img );
+    }
+
+    srcnn_executor* pool  = srcnn_executor_pool_create( 0 );
+    srcnn_executor* steal = srcnn_executor_steal_create( 0 );
+
+    vector<LayerVariant> variants;
+
+    // default kernels are generated code where JIT runs, direct ones are
+    // its fallback ( --nojit, other CPUs ) and checked by themselves.
+    static const SRCNNKernelConfig kc_direct   = { 64, 16, SRCNN_LAYER1_DIRECT, 8 };
+    static const SRCNNKernelConfig kc_im2col4  = { 64, 16, SRCNN_LAYER1_IM2COL, 4 };
+    static const SRCNNKernelConfig kc_im2col8  = { 64, 16, SRCNN_LAYER1_IM2COL, 8 };
+    static const SRCNNKernelConfig kc_im2col16 = { 64, 16, SRCNN_LAYER1_IM2COL, 16 };
+    static const SRCNNKernelConfig kc_tile     = { 24, 7, SRCNN_LAYER1_IM2COL, 16 };
+    static const SRCNNKernelConfig kc_jit      = { 64, 16, SRCNN_LAYER1_JIT, 8 };
+    static const SRCNNKernelConfig kc_jittile  = { 13, 5, SRCNN_LAYER1_JIT, 8 };
+
+    LayerVariant lvs[] =
+    {
+        { "serial",          srcnn_executor_serial(), false, NULL },
+        { "openmp",          srcnn_executor_openmp(), false, NULL },
+        { "pool",            pool,                    false, NULL },
+        { "steal",           steal,                   false, NULL },
+        { "steal regions",   steal,                   true,  NULL },
+        { "direct serial",   srcnn_executor_serial(), false, &kc_direct },
+        { "direct openmp",   srcnn_executor_openmp(), false, &kc_direct },
+        { "direct regions",  steal,                   true,  &kc_direct },
+        { "im2col x4",       steal,                   false, &kc_im2col4 },
+        { "im2col x8",       steal,                   false, &kc_im2col8 },
+        { "im2col x16",      steal,                   true,  &kc_im2col16 },
+        { "im2col 24x7 x16", steal,                   true,  &kc_tile },
+        { "jit",             steal,                   false, &kc_jit },
+        { "jit 13x5 regions", steal,                  true,  &kc_jittile },
+    };
+
+    for ( unsigned cnt = 0; cnt < sizeof( lvs ) / sizeof( LayerVariant ); cnt++ )
+    {
+        if ( lvs[cnt].exec != NULL )
+            variants.push_back( lvs[cnt] );
+    }
+
+    printf( "%-26s %-12s %-18s %12s %9s  %s\n",
+            "image", "layer", "variant", "max abs", "PSNR dB", "result" );
+
+    for ( unsigned cnt = 0; cnt < images.size(); cnt++ )
+    {
+        verifyLayers( images[cnt], variants );
+        verifyGraph( images[cnt] );
+        verifyResize( images[cnt] );
+    }
+
+    srcnn_executor_pool_destroy( steal );
+    srcnn_executor_pool_destroy( pool );
+
+    if ( verify_failures > 0 )
+    {
+        printf( "- %u check%s over tolerance.\n", verify_failures,
+                verify_failures > 1 ? "s" : "" );
+        return 1;
+    }
+
+    printf( "- All checks within tolerance.\n" );
+
+    return 0;
+}
+
+#endif /// of FORVERIFYBIN
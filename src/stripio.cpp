@@ -0,0 +1,2069 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <zlib.h>
+#include <png.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+
+#include "stripio.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef _WIN32
+    #define fseek64     _fseeki64
+    #define ftell64     _ftelli64
+#else
+    #define fseek64     fseeko
+    #define ftell64     ftello
+#endif
+
+#define PNM_MAX_TOKEN           32
+
+#define TIFF_CLASSIC            42
+#define TIFF_BIGTIFF            43
+
+#define TIFF_TYPE_BYTE          1
+#define TIFF_TYPE_ASCII         2
+#define TIFF_TYPE_SHORT         3
+#define TIFF_TYPE_LONG          4
+#define TIFF_TYPE_RATIONAL      5
+#define TIFF_TYPE_LONG8         16
+
+#define TIFF_TAG_WIDTH          256
+#define TIFF_TAG_HEIGHT         257
+#define TIFF_TAG_BITS           258
+#define TIFF_TAG_COMPRESSION    259
+#define TIFF_TAG_PHOTOMETRIC    262
+#define TIFF_TAG_STRIPOFFSETS   273
+#define TIFF_TAG_SAMPLES        277
+#define TIFF_TAG_ROWSPERSTRIP   278
+#define TIFF_TAG_STRIPBYTES     279
+#define TIFF_TAG_XRESOLUTION    282
+#define TIFF_TAG_YRESOLUTION    283
+#define TIFF_TAG_PLANAR         284
+#define TIFF_TAG_RESUNIT        296
+#define TIFF_TAG_PREDICTOR      317
+#define TIFF_TAG_TILEWIDTH      322
+#define TIFF_TAG_TILELENGTH     323
+#define TIFF_TAG_TILEOFFSETS    324
+#define TIFF_TAG_TILEBYTES      325
+#define TIFF_TAG_EXTRASAMPLES   338
+
+#define TIFF_COMP_NONE          1
+#define TIFF_COMP_LZW           5
+#define TIFF_COMP_DEFLATE       8
+#define TIFF_COMP_PACKBITS      32773
+#define TIFF_COMP_ADOBEDEFLATE  32946
+
+#define TIFF_WRITE_STRIP_BYTES  ( 256u * 1024u )
+#define TIFF_CLASSIC_LIMIT      0xF0000000ull   /// data over this goes BigTIFF.
+
+////////////////////////////////////////////////////////////////////////////////
+
+StripReader::StripReader()
+ : _fp( NULL ),
+   _rows( 0 )
+{
+    memset( &_info, 0, sizeof( _info ) );
+}
+
+StripReader::~StripReader()
+{
+    if ( _fp != NULL )
+    {
+        fclose( _fp );
+    }
+}
+
+StripWriter::StripWriter()
+ : _fp( NULL ),
+   _rows( 0 )
+{
+    memset( &_info, 0, sizeof( _info ) );
+}
+
+StripWriter::~StripWriter()
+{
+    if ( _fp != NULL )
+    {
+        fclose( _fp );
+    }
+}
+
+bool StripWriter::close()
+{
+    if ( _fp == NULL )
+        return false;
+
+    bool retb = ( fflush( _fp ) == 0 ) && ( _rows == _info.height );
+
+    if ( fclose( _fp ) != 0 )
+        retb = false;
+
+    _fp = NULL;
+
+    return retb;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PNM and raw
+
+// Skips white spaces and comments, reads a token of digits.
+static bool pnmToken( FILE* fp, unsigned& val )
+{
+    int ch = fgetc( fp );
+
+    while( true )
+    {
+        if ( ch == '#' )
+        {
+            while( ( ch != '\n' ) && ( ch != EOF ) )
+                ch = fgetc( fp );
+        }
+        else
+        if ( isspace( ch ) == 0 )
+            break;
+
+        ch = fgetc( fp );
+    }
+
+    char     buff[PNM_MAX_TOKEN] = {0};
+    unsigned que = 0;
+
+    while( ( ch != EOF ) && ( isdigit( ch ) != 0 ) && ( que < PNM_MAX_TOKEN - 1 ) )
+    {
+        buff[ que++ ] = (char)ch;
+        ch = fgetc( fp );
+    }
+
+    // one white space ends header after maxval.
+    if ( ( que == 0 ) || ( isspace( ch ) == 0 ) )
+        return false;
+
+    val = (unsigned)strtoul( buff, NULL, 10 );
+
+    return true;
+}
+
+class PNMReader : public StripReader
+{
+    public:
+        bool open( FILE* fp, unsigned depth )
+        {
+            unsigned maxval = 0;
+
+            _fp = fp;
+
+            if ( ( pnmToken( fp, _info.width ) == false ) ||
+                 ( pnmToken( fp, _info.height ) == false ) ||
+                 ( pnmToken( fp, maxval ) == false ) )
+                return false;
+
+            if ( ( maxval == 0 ) || ( maxval > 255 ) )
+                return false;
+
+            _info.depth = depth;
+
+            return ( _info.width > 0 ) && ( _info.height > 0 );
+        }
+
+        bool readRow( unsigned char* row )
+        {
+            if ( _rows >= _info.height )
+                return false;
+
+            size_t rowsz = (size_t)_info.width * _info.depth;
+
+            if ( fread( row, 1, rowsz, _fp ) != rowsz )
+                return false;
+
+            _rows++;
+
+            return true;
+        }
+};
+
+class RawReader : public StripReader
+{
+    public:
+        bool open( FILE* fp, const StripImageInfo& info )
+        {
+            _fp   = fp;
+            _info = info;
+
+            return true;
+        }
+
+        bool readRow( unsigned char* row )
+        {
+            if ( _rows >= _info.height )
+                return false;
+
+            size_t rowsz = (size_t)_info.width * _info.depth;
+
+            if ( fread( row, 1, rowsz, _fp ) != rowsz )
+                return false;
+
+            _rows++;
+
+            return true;
+        }
+};
+
+// Raw rows, or PNM with its header, alpha is dropped for PNM.
+class PNMWriter : public StripWriter
+{
+    public:
+        bool open( const char* path, const StripImageInfo& info, bool pnm )
+        {
+            _info = info;
+
+            _fp = fopen( path, "wb" );
+
+            if ( _fp == NULL )
+                return false;
+
+            if ( pnm == true )
+            {
+                if ( fprintf( _fp, "P%c\n%u %u\n255\n",
+                              info.depth == 1 ? '5' : '6',
+                              info.width, info.height ) < 0 )
+                    return false;
+
+                if ( info.depth == 4 )
+                    _line.resize( (size_t)info.width * 3 );
+            }
+
+            return true;
+        }
+
+        bool writeRows( const unsigned char* rows, unsigned count, size_t stride )
+        {
+            size_t rowsz = (size_t)_info.width * _info.depth;
+
+            if ( stride == 0 )
+                stride = rowsz;
+
+            if ( _rows + count > _info.height )
+                return false;
+
+            for ( unsigned cnt = 0; cnt < count; cnt++ )
+            {
+                const unsigned char* row = rows + cnt * stride;
+
+                if ( _line.size() > 0 )
+                {
+                    for ( unsigned x = 0; x < _info.width; x++ )
+                    {
+                        memcpy( &_line[ x * 3 ], row + x * 4, 3 );
+                    }
+
+                    if ( fwrite( _line.data(), 1, _line.size(), _fp ) != _line.size() )
+                        return false;
+                }
+                else
+                if ( fwrite( row, 1, rowsz, _fp ) != rowsz )
+                    return false;
+
+                _rows++;
+            }
+
+            return true;
+        }
+
+    private:
+        vector<unsigned char>   _line;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// TIFF decoders, dst is filled up to dstsz, short data leaves zeroes.
+
+static bool decodePackBits( const unsigned char* src, size_t srcsz,
+                            unsigned char* dst, size_t dstsz )
+{
+    size_t sq = 0;
+    size_t dq = 0;
+
+    while( ( sq < srcsz ) && ( dq < dstsz ) )
+    {
+        int n = (signed char)src[ sq++ ];
+
+        if ( n >= 0 )
+        {
+            size_t len = n + 1;
+
+            if ( ( sq + len > srcsz ) || ( dq + len > dstsz ) )
+                return false;
+
+            memcpy( dst + dq, src + sq, len );
+            sq += len;
+            dq += len;
+        }
+        else
+        if ( n != -128 )
+        {
+            size_t len = 1 - n;
+
+            if ( ( sq >= srcsz ) || ( dq + len > dstsz ) )
+                return false;
+
+            memset( dst + dq, src[ sq++ ], len );
+            dq += len;
+        }
+    }
+
+    return true;
+}
+
+// TIFF 6 LZW, MSB first codes with early change of code width.
+static bool decodeLZW( const unsigned char* src, size_t srcsz,
+                       unsigned char* dst, size_t dstsz )
+{
+    const unsigned CLEAR = 256;
+    const unsigned EOI   = 257;
+    const unsigned MAXC  = 4096;
+
+    vector<unsigned short> prefix( MAXC );
+    vector<unsigned char>  suffix( MAXC );
+    vector<unsigned char>  stack( MAXC );
+
+    for ( unsigned cnt = 0; cnt < 256; cnt++ )
+    {
+        prefix[cnt] = 0;
+        suffix[cnt] = (unsigned char)cnt;
+    }
+
+    unsigned nextc = 258;
+    unsigned width = 9;
+    unsigned oldc  = MAXC;
+    uint32_t bits  = 0;
+    unsigned nbits = 0;
+    size_t   sq    = 0;
+    size_t   dq    = 0;
+
+    while( dq < dstsz )
+    {
+        while( ( nbits < width ) && ( sq < srcsz ) )
+        {
+            bits = ( bits << 8 ) | src[ sq++ ];
+            nbits += 8;
+        }
+
+        if ( nbits < width )
+            break;
+
+        unsigned code = ( bits >> ( nbits - width ) ) & ( ( 1u << width ) - 1 );
+        nbits -= width;
+
+        if ( code == EOI )
+            break;
+
+        if ( code == CLEAR )
+        {
+            nextc = 258;
+            width = 9;
+            oldc  = MAXC;
+            continue;
+        }
+
+        unsigned strc = code;
+        unsigned tail = 0;
+
+        if ( oldc == MAXC )
+        {
+            if ( code > 255 )
+                return false;
+        }
+        else
+        if ( code >= nextc )
+        {
+            // KwKwK, string of old code and its own first byte.
+            if ( code != nextc )
+                return false;
+
+            strc = oldc;
+            tail = 1;
+        }
+
+        unsigned sp = 0;
+
+        for ( unsigned c = strc; ; c = prefix[c] )
+        {
+            stack[ sp++ ] = suffix[c];
+
+            if ( c < 256 )
+                break;
+        }
+
+        unsigned char fch = stack[ sp - 1 ];
+
+        while( ( sp > 0 ) && ( dq < dstsz ) )
+            dst[ dq++ ] = stack[ --sp ];
+
+        if ( ( tail > 0 ) && ( dq < dstsz ) )
+            dst[ dq++ ] = fch;
+
+        if ( ( oldc != MAXC ) && ( nextc < MAXC ) )
+        {
+            prefix[ nextc ] = (unsigned short)oldc;
+            suffix[ nextc ] = fch;
+            nextc++;
+
+            if ( ( nextc + 1 >= ( 1u << width ) ) && ( width < 12 ) )
+                width++;
+        }
+
+        oldc = code;
+    }
+
+    return true;
+}
+
+static bool decodeDeflate( const unsigned char* src, size_t srcsz,
+                           unsigned char* dst, size_t dstsz )
+{
+    z_stream zs;
+    memset( &zs, 0, sizeof( zs ) );
+
+    if ( inflateInit( &zs ) != Z_OK )
+        return false;
+
+    zs.next_in   = (Bytef*)src;
+    zs.avail_in  = (uInt)srcsz;
+    zs.next_out  = dst;
+    zs.avail_out = (uInt)dstsz;
+
+    int reti = inflate( &zs, Z_FINISH );
+
+    inflateEnd( &zs );
+
+    // some writers leave no end of stream, full output is enough.
+    return ( reti == Z_STREAM_END ) || ( zs.avail_out == 0 );
+}
+
+// Horizontal predictor, rows of cols pixels with spp samples.
+static void undoPredictor( unsigned char* buff, unsigned cols, unsigned rows,
+                           unsigned spp )
+{
+    size_t rowsz = (size_t)cols * spp;
+
+    for ( unsigned row = 0; row < rows; row++ )
+    {
+        unsigned char* p = buff + row * rowsz;
+
+        for ( size_t cnt = spp; cnt < rowsz; cnt++ )
+        {
+            p[cnt] = (unsigned char)( p[cnt] + p[ cnt - spp ] );
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// TIFF reader, first IFD only, chunky 8bit.
+
+class TIFFReader : public StripReader
+{
+    public:
+        TIFFReader()
+         : _big( false ), _motorola( false ),
+           _spp( 1 ), _comp( TIFF_COMP_NONE ), _photo( 1 ), _pred( 1 ),
+           _rps( 0 ), _tilew( 0 ), _tileh( 0 ), _tiled( false ),
+           _bufrow0( 0 ), _bufrows( 0 )
+        {
+        }
+
+    public:
+        bool open( FILE* fp );
+        bool readRow( unsigned char* row );
+
+    private:
+        bool     rd( void* p, size_t sz );
+        uint64_t get( const unsigned char* p, unsigned sz );
+        bool     values( unsigned type, uint64_t count, const unsigned char* inl,
+                         vector<uint64_t>& out );
+        bool     readChunk( size_t index, unsigned char* dst, size_t dstsz );
+        bool     loadRows( unsigned row );
+
+    private:
+        bool                    _big;
+        bool                    _motorola;
+        unsigned                _spp;
+        unsigned                _comp;
+        unsigned                _photo;
+        unsigned                _pred;
+        unsigned                _rps;
+        unsigned                _tilew;
+        unsigned                _tileh;
+        bool                    _tiled;
+        vector<uint64_t>        _offsets;
+        vector<uint64_t>        _counts;
+        vector<unsigned char>   _cdata;     /// compressed chunk.
+        vector<unsigned char>   _chunk;     /// a decoded tile.
+        vector<unsigned char>   _buff;      /// decoded rows of a strip or tile row.
+        unsigned                _bufrow0;
+        unsigned                _bufrows;
+};
+
+bool TIFFReader::rd( void* p, size_t sz )
+{
+    return fread( p, 1, sz, _fp ) == sz;
+}
+
+uint64_t TIFFReader::get( const unsigned char* p, unsigned sz )
+{
+    uint64_t v = 0;
+
+    for ( unsigned cnt = 0; cnt < sz; cnt++ )
+    {
+        unsigned idx = _motorola == true ? cnt : ( sz - 1 - cnt );
+        v = ( v << 8 ) | p[ idx ];
+    }
+
+    return v;
+}
+
+bool TIFFReader::values( unsigned type, uint64_t count, const unsigned char* inl,
+                         vector<uint64_t>& out )
+{
+    unsigned tsz = 0;
+
+    switch( type )
+    {
+        case TIFF_TYPE_BYTE:    tsz = 1; break;
+        case TIFF_TYPE_SHORT:   tsz = 2; break;
+        case TIFF_TYPE_LONG:    tsz = 4; break;
+        case TIFF_TYPE_LONG8:   tsz = 8; break;
+        default:
+            return false;
+    }
+
+    // offsets of an image never exceed its rows or tiles.
+    if ( count > ( 1ull << 28 ) )
+        return false;
+
+    unsigned inlsz = _big == true ? 8 : 4;
+    size_t   total = (size_t)count * tsz;
+
+    vector<unsigned char> data( total );
+
+    if ( total <= inlsz )
+    {
+        memcpy( data.data(), inl, total );
+    }
+    else
+    {
+        off_t savepos = ftell64( _fp );
+
+        if ( ( fseek64( _fp, (off_t)get( inl, inlsz ), SEEK_SET ) != 0 ) ||
+             ( rd( data.data(), total ) == false ) )
+            return false;
+
+        fseek64( _fp, savepos, SEEK_SET );
+    }
+
+    out.resize( count );
+
+    for ( uint64_t cnt = 0; cnt < count; cnt++ )
+    {
+        out[cnt] = get( &data[ cnt * tsz ], tsz );
+    }
+
+    return true;
+}
+
+bool TIFFReader::open( FILE* fp )
+{
+    unsigned char hdr[16] = {0};
+
+    _fp = fp;
+
+    if ( rd( hdr, 8 ) == false )
+        return false;
+
+    _motorola = ( hdr[0] == 'M' );
+
+    unsigned ver = (unsigned)get( hdr + 2, 2 );
+    uint64_t ifd = 0;
+
+    if ( ver == TIFF_BIGTIFF )
+    {
+        if ( ( get( hdr + 4, 2 ) != 8 ) || ( rd( hdr + 8, 8 ) == false ) )
+            return false;
+
+        _big = true;
+        ifd  = get( hdr + 8, 8 );
+    }
+    else
+    if ( ver == TIFF_CLASSIC )
+    {
+        ifd = get( hdr + 4, 4 );
+    }
+    else
+        return false;
+
+    if ( fseek64( _fp, (off_t)ifd, SEEK_SET ) != 0 )
+        return false;
+
+    unsigned char nb[8];
+    unsigned      cntsz = _big == true ? 8 : 2;
+    unsigned      entsz = _big == true ? 20 : 12;
+
+    if ( rd( nb, cntsz ) == false )
+        return false;
+
+    uint64_t entries = get( nb, cntsz );
+    unsigned bits    = 1;
+    unsigned planar  = 1;
+
+    for ( uint64_t cnt = 0; cnt < entries; cnt++ )
+    {
+        unsigned char ent[20];
+
+        if ( rd( ent, entsz ) == false )
+            return false;
+
+        unsigned tag   = (unsigned)get( ent, 2 );
+        unsigned type  = (unsigned)get( ent + 2, 2 );
+        uint64_t count = _big == true ? get( ent + 4, 8 ) : get( ent + 4, 4 );
+
+        const unsigned char* inl = ent + ( _big == true ? 12 : 8 );
+
+        vector<uint64_t> v;
+
+        switch( tag )
+        {
+            case TIFF_TAG_STRIPOFFSETS:
+            case TIFF_TAG_TILEOFFSETS:
+                if ( values( type, count, inl, _offsets ) == false )
+                    return false;
+                _tiled = ( tag == TIFF_TAG_TILEOFFSETS );
+                continue;
+
+            case TIFF_TAG_STRIPBYTES:
+            case TIFF_TAG_TILEBYTES:
+                if ( values( type, count, inl, _counts ) == false )
+                    return false;
+                continue;
+
+            case TIFF_TAG_WIDTH:
+            case TIFF_TAG_HEIGHT:
+            case TIFF_TAG_BITS:
+            case TIFF_TAG_COMPRESSION:
+            case TIFF_TAG_PHOTOMETRIC:
+            case TIFF_TAG_SAMPLES:
+            case TIFF_TAG_ROWSPERSTRIP:
+            case TIFF_TAG_PLANAR:
+            case TIFF_TAG_PREDICTOR:
+            case TIFF_TAG_TILEWIDTH:
+            case TIFF_TAG_TILELENGTH:
+                break;
+
+            default:
+                continue;
+        }
+
+        if ( ( count == 0 ) || ( values( type, count, inl, v ) == false ) )
+            return false;
+
+        // bits of every sample must be same, first one is enough.
+        unsigned val = (unsigned)v[0];
+
+        switch( tag )
+        {
+            case TIFF_TAG_WIDTH:        _info.width  = val; break;
+            case TIFF_TAG_HEIGHT:       _info.height = val; break;
+            case TIFF_TAG_BITS:         bits         = val; break;
+            case TIFF_TAG_COMPRESSION:  _comp        = val; break;
+            case TIFF_TAG_PHOTOMETRIC:  _photo       = val; break;
+            case TIFF_TAG_SAMPLES:      _spp         = val; break;
+            case TIFF_TAG_ROWSPERSTRIP: _rps         = val; break;
+            case TIFF_TAG_PLANAR:       planar       = val; break;
+            case TIFF_TAG_PREDICTOR:    _pred        = val; break;
+            case TIFF_TAG_TILEWIDTH:    _tilew       = val; break;
+            case TIFF_TAG_TILELENGTH:   _tileh       = val; break;
+        }
+    }
+
+    if ( ( _info.width == 0 ) || ( _info.height == 0 ) || ( bits != 8 ) ||
+         ( planar != 1 ) || ( _offsets.size() == 0 ) ||
+         ( _offsets.size() != _counts.size() ) )
+        return false;
+
+    if ( ( _comp != TIFF_COMP_NONE ) && ( _comp != TIFF_COMP_LZW ) &&
+         ( _comp != TIFF_COMP_DEFLATE ) && ( _comp != TIFF_COMP_ADOBEDEFLATE ) &&
+         ( _comp != TIFF_COMP_PACKBITS ) )
+        return false;
+
+    if ( ( _pred != 1 ) && ( _pred != 2 ) )
+        return false;
+
+    // gray ( white or black is zero ), RGB and RGBA.
+    if ( ( _photo <= 1 ) && ( _spp == 1 ) )
+        _info.depth = 1;
+    else
+    if ( ( _photo == 2 ) && ( ( _spp == 3 ) || ( _spp == 4 ) ) )
+        _info.depth = _spp;
+    else
+        return false;
+
+    size_t rowsz = (size_t)_info.width * _spp;
+
+    if ( _tiled == true )
+    {
+        if ( ( _tilew == 0 ) || ( _tileh == 0 ) )
+            return false;
+
+        size_t across = ( _info.width + _tilew - 1 ) / _tilew;
+        size_t down   = ( _info.height + _tileh - 1 ) / _tileh;
+
+        if ( _offsets.size() < across * down )
+            return false;
+
+        _chunk.resize( (size_t)_tilew * _tileh * _spp );
+        _buff.resize( rowsz * _tileh );
+    }
+    else
+    {
+        if ( ( _rps == 0 ) || ( _rps > _info.height ) )
+            _rps = _info.height;
+
+        if ( _offsets.size() < ( _info.height + _rps - 1 ) / _rps )
+            return false;
+
+        _buff.resize( rowsz * _rps );
+    }
+
+    return true;
+}
+
+bool TIFFReader::readChunk( size_t index, unsigned char* dst, size_t dstsz )
+{
+    uint64_t csz = _counts[ index ];
+
+    memset( dst, 0, dstsz );
+
+    // sparse, not written chunk.
+    if ( ( _offsets[ index ] == 0 ) || ( csz == 0 ) )
+        return true;
+
+    if ( ( _comp == TIFF_COMP_NONE ) && ( csz > dstsz ) )
+        csz = dstsz;
+
+    if ( csz > (uint64_t)dstsz * 2 + 1024 * 1024 )
+        return false;
+
+    _cdata.resize( (size_t)csz );
+
+    if ( ( fseek64( _fp, (off_t)_offsets[ index ], SEEK_SET ) != 0 ) ||
+         ( rd( _cdata.data(), (size_t)csz ) == false ) )
+        return false;
+
+    switch( _comp )
+    {
+        case TIFF_COMP_NONE:
+            memcpy( dst, _cdata.data(), (size_t)csz );
+            return true;
+
+        case TIFF_COMP_LZW:
+            return decodeLZW( _cdata.data(), (size_t)csz, dst, dstsz );
+
+        case TIFF_COMP_DEFLATE:
+        case TIFF_COMP_ADOBEDEFLATE:
+            return decodeDeflate( _cdata.data(), (size_t)csz, dst, dstsz );
+
+        case TIFF_COMP_PACKBITS:
+            return decodePackBits( _cdata.data(), (size_t)csz, dst, dstsz );
+    }
+
+    return false;
+}
+
+// Decodes strip or tile row holding row into _buff.
+bool TIFFReader::loadRows( unsigned row )
+{
+    size_t rowsz = (size_t)_info.width * _spp;
+
+    if ( _tiled == false )
+    {
+        size_t strip = row / _rps;
+
+        _bufrow0 = (unsigned)( strip * _rps );
+        _bufrows = _info.height - _bufrow0;
+
+        if ( _bufrows > _rps )
+            _bufrows = _rps;
+
+        if ( readChunk( strip, _buff.data(), rowsz * _bufrows ) == false )
+            return false;
+
+        if ( _pred == 2 )
+            undoPredictor( _buff.data(), _info.width, _bufrows, _spp );
+
+        return true;
+    }
+
+    size_t across = ( _info.width + _tilew - 1 ) / _tilew;
+    size_t trow   = row / _tileh;
+
+    _bufrow0 = (unsigned)( trow * _tileh );
+    _bufrows = _info.height - _bufrow0;
+
+    if ( _bufrows > _tileh )
+        _bufrows = _tileh;
+
+    for ( size_t tx = 0; tx < across; tx++ )
+    {
+        if ( readChunk( trow * across + tx, _chunk.data(), _chunk.size() ) == false )
+            return false;
+
+        if ( _pred == 2 )
+            undoPredictor( _chunk.data(), _tilew, _tileh, _spp );
+
+        unsigned x0   = (unsigned)( tx * _tilew );
+        unsigned cols = _info.width - x0;
+
+        if ( cols > _tilew )
+            cols = _tilew;
+
+        for ( unsigned cnt = 0; cnt < _bufrows; cnt++ )
+        {
+            memcpy( &_buff[ cnt * rowsz + (size_t)x0 * _spp ],
+                    &_chunk[ (size_t)cnt * _tilew * _spp ],
+                    (size_t)cols * _spp );
+        }
+    }
+
+    return true;
+}
+
+bool TIFFReader::readRow( unsigned char* row )
+{
+    if ( _rows >= _info.height )
+        return false;
+
+    if ( ( _bufrows == 0 ) || ( _rows >= _bufrow0 + _bufrows ) )
+    {
+        if ( loadRows( _rows ) == false )
+            return false;
+    }
+
+    size_t rowsz = (size_t)_info.width * _spp;
+
+    memcpy( row, &_buff[ ( _rows - _bufrow0 ) * rowsz ], rowsz );
+
+    if ( _photo == 0 )
+    {
+        for ( size_t cnt = 0; cnt < rowsz; cnt++ )
+            row[cnt] = 255 - row[cnt];
+    }
+
+    _rows++;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// TIFF writer, uncompressed strips, IFD goes after pixel data.
+
+class TIFFWriter : public StripWriter
+{
+    public:
+        bool open( const char* path, const StripImageInfo& info );
+        bool writeRows( const unsigned char* rows, unsigned count, size_t stride );
+        bool close();
+
+    private:
+        void put( vector<unsigned char>& out, uint64_t v, unsigned sz );
+        void entry( unsigned tag, unsigned type, const vector<uint64_t>& vals );
+
+    private:
+        typedef struct
+        {
+            unsigned                tag;
+            unsigned                type;
+            uint64_t                count;
+            vector<unsigned char>   data;
+        }Entry;
+
+        bool            _big;
+        unsigned        _rps;
+        vector<Entry>   _entries;
+};
+
+bool TIFFWriter::open( const char* path, const StripImageInfo& info )
+{
+    _info = info;
+
+    uint64_t datasz = (uint64_t)info.width * info.height * info.depth;
+    size_t   rowsz  = (size_t)info.width * info.depth;
+
+    _big = ( datasz > TIFF_CLASSIC_LIMIT );
+    _rps = (unsigned)( TIFF_WRITE_STRIP_BYTES / rowsz );
+
+    if ( _rps == 0 )
+        _rps = 1;
+
+    if ( _rps > info.height )
+        _rps = info.height;
+
+    _fp = fopen( path, "wb" );
+
+    if ( _fp == NULL )
+        return false;
+
+    // IFD offset is written at close.
+    unsigned char hdr[16] = { 'I', 'I', 0 };
+
+    if ( _big == true )
+    {
+        hdr[2] = TIFF_BIGTIFF;
+        hdr[4] = 8;
+        return fwrite( hdr, 1, 16, _fp ) == 16;
+    }
+
+    hdr[2] = TIFF_CLASSIC;
+
+    return fwrite( hdr, 1, 8, _fp ) == 8;
+}
+
+bool TIFFWriter::writeRows( const unsigned char* rows, unsigned count, size_t stride )
+{
+    size_t rowsz = (size_t)_info.width * _info.depth;
+
+    if ( stride == 0 )
+        stride = rowsz;
+
+    if ( _rows + count > _info.height )
+        return false;
+
+    if ( stride == rowsz )
+    {
+        if ( fwrite( rows, 1, rowsz * count, _fp ) != rowsz * count )
+            return false;
+    }
+    else
+    {
+        for ( unsigned cnt = 0; cnt < count; cnt++ )
+        {
+            if ( fwrite( rows + cnt * stride, 1, rowsz, _fp ) != rowsz )
+                return false;
+        }
+    }
+
+    _rows += count;
+
+    return true;
+}
+
+void TIFFWriter::put( vector<unsigned char>& out, uint64_t v, unsigned sz )
+{
+    for ( unsigned cnt = 0; cnt < sz; cnt++ )
+    {
+        out.push_back( (unsigned char)( v >> ( cnt * 8 ) ) );
+    }
+}
+
+void TIFFWriter::entry( unsigned tag, unsigned type, const vector<uint64_t>& vals )
+{
+    Entry e;
+
+    e.tag   = tag;
+    e.type  = type;
+    e.count = vals.size();
+
+    for ( size_t cnt = 0; cnt < vals.size(); cnt++ )
+    {
+        switch( type )
+        {
+            case TIFF_TYPE_SHORT:    put( e.data, vals[cnt], 2 ); break;
+            case TIFF_TYPE_LONG:     put( e.data, vals[cnt], 4 ); break;
+            case TIFF_TYPE_LONG8:    put( e.data, vals[cnt], 8 ); break;
+            // numerator and denominator pair given as one value each.
+            case TIFF_TYPE_RATIONAL: put( e.data, vals[cnt], 4 ); break;
+        }
+    }
+
+    if ( type == TIFF_TYPE_RATIONAL )
+        e.count /= 2;
+
+    _entries.push_back( e );
+}
+
+bool TIFFWriter::close()
+{
+    if ( _fp == NULL )
+        return false;
+
+    if ( _rows != _info.height )
+    {
+        StripWriter::close();
+        return false;
+    }
+
+    size_t   rowsz   = (size_t)_info.width * _info.depth;
+    uint64_t dataoff = _big == true ? 16 : 8;
+    size_t   strips  = ( _info.height + _rps - 1 ) / _rps;
+    unsigned offtype = _big == true ? TIFF_TYPE_LONG8 : TIFF_TYPE_LONG;
+
+    vector<uint64_t> offs( strips );
+    vector<uint64_t> cnts( strips );
+
+    for ( size_t cnt = 0; cnt < strips; cnt++ )
+    {
+        unsigned r0 = (unsigned)( cnt * _rps );
+        unsigned rn = _info.height - r0 < _rps ? _info.height - r0 : _rps;
+
+        offs[cnt] = dataoff + (uint64_t)r0 * rowsz;
+        cnts[cnt] = (uint64_t)rn * rowsz;
+    }
+
+    vector<uint64_t> bits( _info.depth, 8 );
+    vector<uint64_t> res( 2 );
+
+    res[0] = 72;
+    res[1] = 1;
+
+    // tags must be ascending.
+    entry( TIFF_TAG_WIDTH,        TIFF_TYPE_LONG,  vector<uint64_t>( 1, _info.width ) );
+    entry( TIFF_TAG_HEIGHT,       TIFF_TYPE_LONG,  vector<uint64_t>( 1, _info.height ) );
+    entry( TIFF_TAG_BITS,         TIFF_TYPE_SHORT, bits );
+    entry( TIFF_TAG_COMPRESSION,  TIFF_TYPE_SHORT, vector<uint64_t>( 1, TIFF_COMP_NONE ) );
+    entry( TIFF_TAG_PHOTOMETRIC,  TIFF_TYPE_SHORT, vector<uint64_t>( 1, _info.depth == 1 ? 1 : 2 ) );
+    entry( TIFF_TAG_STRIPOFFSETS, offtype,         offs );
+    entry( TIFF_TAG_SAMPLES,      TIFF_TYPE_SHORT, vector<uint64_t>( 1, _info.depth ) );
+    entry( TIFF_TAG_ROWSPERSTRIP, TIFF_TYPE_LONG,  vector<uint64_t>( 1, _rps ) );
+    entry( TIFF_TAG_STRIPBYTES,   offtype,         cnts );
+    entry( TIFF_TAG_XRESOLUTION,  TIFF_TYPE_RATIONAL, res );
+    entry( TIFF_TAG_YRESOLUTION,  TIFF_TYPE_RATIONAL, res );
+    entry( TIFF_TAG_PLANAR,       TIFF_TYPE_SHORT, vector<uint64_t>( 1, 1 ) );
+    entry( TIFF_TAG_RESUNIT,      TIFF_TYPE_SHORT, vector<uint64_t>( 1, 2 ) );
+
+    // unassociated alpha.
+    if ( _info.depth == 4 )
+        entry( TIFF_TAG_EXTRASAMPLES, TIFF_TYPE_SHORT, vector<uint64_t>( 1, 2 ) );
+
+    unsigned inlsz = _big == true ? 8 : 4;
+    unsigned cntsz = _big == true ? 8 : 2;
+    unsigned entsz = _big == true ? 20 : 12;
+    uint64_t ifdoff = dataoff + (uint64_t)rowsz * _info.height;
+
+    ifdoff += ifdoff & 1;
+
+    // values not fitting in entries follow IFD.
+    uint64_t extoff = ifdoff + cntsz + (uint64_t)entsz * _entries.size() + inlsz;
+
+    vector<unsigned char> ifd;
+    vector<unsigned char> ext;
+
+    put( ifd, _entries.size(), cntsz );
+
+    for ( size_t cnt = 0; cnt < _entries.size(); cnt++ )
+    {
+        Entry& e = _entries[cnt];
+
+        put( ifd, e.tag, 2 );
+        put( ifd, e.type, 2 );
+        put( ifd, e.count, _big == true ? 8 : 4 );
+
+        if ( e.data.size() <= inlsz )
+        {
+            e.data.resize( inlsz, 0 );
+            ifd.insert( ifd.end(), e.data.begin(), e.data.end() );
+        }
+        else
+        {
+            put( ifd, extoff + ext.size(), inlsz );
+            ext.insert( ext.end(), e.data.begin(), e.data.end() );
+
+            if ( ext.size() & 1 )
+                ext.push_back( 0 );
+        }
+    }
+
+    // no next IFD.
+    put( ifd, 0, inlsz );
+
+    vector<unsigned char> ptr;
+    put( ptr, ifdoff, inlsz );
+
+    bool retb = true;
+
+    if ( ( dataoff + (uint64_t)rowsz * _info.height ) & 1 )
+        retb = ( fputc( 0, _fp ) != EOF );
+
+    if ( ( retb == false ) ||
+         ( fwrite( ifd.data(), 1, ifd.size(), _fp ) != ifd.size() ) ||
+         ( fwrite( ext.data(), 1, ext.size(), _fp ) != ext.size() ) ||
+         ( fseek64( _fp, _big == true ? 8 : 4, SEEK_SET ) != 0 ) ||
+         ( fwrite( ptr.data(), 1, ptr.size(), _fp ) != ptr.size() ) )
+    {
+        retb = false;
+    }
+
+    return StripWriter::close() && retb;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PNG by libpng rows.
+
+class PNGWriter : public StripWriter
+{
+    public:
+        PNGWriter()
+         : _png( NULL ), _pinfo( NULL )
+        {
+        }
+
+        ~PNGWriter()
+        {
+            if ( _png != NULL )
+            {
+                png_destroy_write_struct( &_png, &_pinfo );
+            }
+        }
+
+    public:
+        bool open( const char* path, const StripImageInfo& info, const StripWriterOptions& opts );
+        bool writeRows( const unsigned char* rows, unsigned count, size_t stride );
+        bool close();
+
+    private:
+        png_structp     _png;
+        png_infop       _pinfo;
+};
+
+static int pngColorType( unsigned depth )
+{
+    switch( depth )
+    {
+        case 1:  return PNG_COLOR_TYPE_GRAY;
+        case 4:  return PNG_COLOR_TYPE_RGB_ALPHA;
+    }
+
+    return PNG_COLOR_TYPE_RGB;
+}
+
+bool PNGWriter::open( const char* path, const StripImageInfo& info, const StripWriterOptions& opts )
+{
+    _info = info;
+
+    _fp = fopen( path, "wb" );
+
+    if ( _fp == NULL )
+        return false;
+
+    _png = png_create_write_struct( PNG_LIBPNG_VER_STRING, NULL, NULL, NULL );
+
+    if ( _png == NULL )
+        return false;
+
+    _pinfo = png_create_info_struct( _png );
+
+    if ( _pinfo == NULL )
+        return false;
+
+    if ( setjmp( png_jmpbuf( _png ) ) != 0 )
+        return false;
+
+    png_init_io( _png, _fp );
+    png_set_IHDR( _png, _pinfo, info.width, info.height, 8,
+                  pngColorType( info.depth ), PNG_INTERLACE_NONE,
+                  PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT );
+
+    if ( opts.pnglevel < 0 )
+    {
+        png_set_filter( _png, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB );
+        png_set_compression_level( _png, Z_BEST_SPEED );
+        png_set_compression_strategy( _png, Z_RLE );
+    }
+    else
+    {
+        png_set_compression_level( _png, opts.pnglevel );
+    }
+
+    png_write_info( _png, _pinfo );
+
+    return true;
+}
+
+bool PNGWriter::writeRows( const unsigned char* rows, unsigned count, size_t stride )
+{
+    size_t rowstep = stride > 0 ? stride : (size_t)_info.width * _info.depth;
+
+    if ( _rows + count > _info.height )
+        return false;
+
+    if ( setjmp( png_jmpbuf( _png ) ) != 0 )
+        return false;
+
+    for ( unsigned cnt = 0; cnt < count; cnt++ )
+    {
+        png_write_row( _png, (png_const_bytep)( rows + cnt * rowstep ) );
+        _rows++;
+    }
+
+    return true;
+}
+
+bool PNGWriter::close()
+{
+    if ( _fp == NULL )
+        return false;
+
+    if ( ( _rows == _info.height ) && ( setjmp( png_jmpbuf( _png ) ) == 0 ) )
+    {
+        png_write_end( _png, NULL );
+    }
+    else
+    {
+        _rows = 0;
+    }
+
+    return StripWriter::close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PNG by strips deflated in parallel, pigz style : each strip is a raw
+// deflate ending by sync flush, primed with 32KB before it, then streams
+// are written in order and their adler32 are combined.
+
+#define PNG_STRIP_BYTES         ( 256u * 1024u )
+#define PNG_BATCH_STRIPS        16      /// strips deflated at once.
+#define PNG_DICT_BYTES          32768
+
+typedef struct
+{
+    const unsigned char*    rows;       /// source rows of strip.
+    const unsigned char*    prev;       /// row above, NULL for first row.
+    unsigned                count;
+    vector<unsigned char>   filtered;   /// filter byte and row, each row.
+    vector<unsigned char>   out;
+    uLong                   adler;
+    bool                    last;       /// ends zlib stream.
+}PNGStrip;
+
+typedef struct
+{
+    vector<PNGStrip>*       strips;
+    const unsigned char*    dict;       /// tail of stream before first strip.
+    unsigned                dictsz;
+    size_t                  rowsz;
+    unsigned                bpp;
+    int                     level;
+    bool                    fast;       /// Sub filter and RLE.
+}PNGBatch;
+
+static inline unsigned char paeth( int a, int b, int c )
+{
+    int p  = a + b - c;
+    int pa = abs( p - a );
+    int pb = abs( p - b );
+    int pc = abs( p - c );
+
+    if ( ( pa <= pb ) && ( pa <= pc ) )
+        return (unsigned char)a;
+
+    if ( pb <= pc )
+        return (unsigned char)b;
+
+    return (unsigned char)c;
+}
+
+// Filters a row by type, returns sum of residuals as signed bytes.
+static unsigned filterRow( int type, const unsigned char* row, const unsigned char* prev,
+                           size_t rowsz, unsigned bpp, unsigned char* out )
+{
+    unsigned sum = 0;
+
+    for ( size_t cnt = 0; cnt < rowsz; cnt++ )
+    {
+        int a = cnt >= bpp ? row[ cnt - bpp ] : 0;
+        int b = prev != NULL ? prev[cnt] : 0;
+        int c = ( prev != NULL ) && ( cnt >= bpp ) ? prev[ cnt - bpp ] : 0;
+        int p = 0;
+
+        switch( type )
+        {
+            case 1: p = a; break;
+            case 2: p = b; break;
+            case 3: p = ( a + b ) >> 1; break;
+            case 4: p = paeth( a, b, c ); break;
+        }
+
+        unsigned char r = (unsigned char)( row[cnt] - p );
+
+        out[cnt] = r;
+        sum += r < 128 ? r : 256 - r;
+    }
+
+    return sum;
+}
+
+static void filterStrips( void* arg, size_t begin, size_t end )
+{
+    const PNGBatch* pb = (const PNGBatch*)arg;
+
+    vector<unsigned char> trial( pb->rowsz );
+
+    for ( size_t n = begin; n < end; n++ )
+    {
+        PNGStrip& ps = (*pb->strips)[n];
+
+        ps.filtered.resize( ( pb->rowsz + 1 ) * ps.count );
+
+        for ( unsigned row = 0; row < ps.count; row++ )
+        {
+            const unsigned char* src  = ps.rows + row * pb->rowsz;
+            const unsigned char* prev = row > 0 ? src - pb->rowsz : ps.prev;
+            unsigned char*       dst  = &ps.filtered[ row * ( pb->rowsz + 1 ) ];
+
+            if ( pb->fast == true )
+            {
+                dst[0] = 1;
+                filterRow( 1, src, prev, pb->rowsz, pb->bpp, dst + 1 );
+                continue;
+            }
+
+            // least sum of residuals, same heuristic to libpng.
+            unsigned best = 0xFFFFFFFF;
+
+            for ( int type = 0; type < 5; type++ )
+            {
+                unsigned sum = filterRow( type, src, prev, pb->rowsz, pb->bpp, trial.data() );
+
+                if ( sum < best )
+                {
+                    best   = sum;
+                    dst[0] = (unsigned char)type;
+                    memcpy( dst + 1, trial.data(), pb->rowsz );
+                }
+            }
+        }
+
+        ps.adler = adler32( adler32( 0, NULL, 0 ), ps.filtered.data(), (uInt)ps.filtered.size() );
+    }
+}
+
+static void deflateStrips( void* arg, size_t begin, size_t end )
+{
+    const PNGBatch* pb = (const PNGBatch*)arg;
+
+    for ( size_t n = begin; n < end; n++ )
+    {
+        PNGStrip& ps = (*pb->strips)[n];
+
+        z_stream zs;
+        memset( &zs, 0, sizeof( zs ) );
+
+        ps.out.clear();
+
+        if ( deflateInit2( &zs, pb->level, Z_DEFLATED, -MAX_WBITS, 8,
+                           pb->fast == true ? Z_RLE : Z_DEFAULT_STRATEGY ) != Z_OK )
+            continue;
+
+        // window of previous strip, so strips compress as one stream.
+        const unsigned char* dict   = pb->dict;
+        size_t               dictsz = pb->dictsz;
+
+        if ( n > 0 )
+        {
+            const PNGStrip& pp = (*pb->strips)[ n - 1 ];
+
+            dictsz = pp.filtered.size() < PNG_DICT_BYTES ? pp.filtered.size() : PNG_DICT_BYTES;
+            dict   = pp.filtered.data() + pp.filtered.size() - dictsz;
+        }
+
+        if ( dictsz > 0 )
+            deflateSetDictionary( &zs, dict, (uInt)dictsz );
+
+        ps.out.resize( deflateBound( &zs, ps.filtered.size() ) + 64 );
+
+        zs.next_in   = ps.filtered.data();
+        zs.avail_in  = (uInt)ps.filtered.size();
+        zs.next_out  = ps.out.data();
+        zs.avail_out = (uInt)ps.out.size();
+
+        deflate( &zs, ps.last == true ? Z_FINISH : Z_SYNC_FLUSH );
+
+        ps.out.resize( zs.total_out );
+
+        deflateEnd( &zs );
+    }
+}
+
+class PNGParallelWriter : public StripWriter
+{
+    public:
+        bool open( const char* path, const StripImageInfo& info, const StripWriterOptions& opts );
+        bool writeRows( const unsigned char* rows, unsigned count, size_t stride );
+        bool close();
+
+    private:
+        bool chunk( const char* type, const unsigned char* data, size_t size,
+                    const unsigned char* more = NULL, size_t moresz = 0 );
+        bool flush();
+
+    private:
+        const srcnn_executor*   _exec;
+        PNGBatch                _pb;
+        unsigned                _striprows;
+        vector<unsigned char>   _batch;     /// rows waiting for deflate.
+        unsigned                _batchrows;
+        vector<unsigned char>   _prev;      /// last row of previous batch.
+        vector<unsigned char>   _dict;      /// filtered tail of previous batch.
+        vector<PNGStrip>        _strips;
+        uLong                   _adler;
+        bool                    _started;   /// zlib header written.
+        bool                    _failed;
+};
+
+static void putBE32( unsigned char* p, uint32_t v )
+{
+    p[0] = (unsigned char)( v >> 24 );
+    p[1] = (unsigned char)( v >> 16 );
+    p[2] = (unsigned char)( v >> 8 );
+    p[3] = (unsigned char)v;
+}
+
+bool PNGParallelWriter::chunk( const char* type, const unsigned char* data, size_t size,
+                               const unsigned char* more, size_t moresz )
+{
+    unsigned char hdr[8];
+    unsigned char tail[4];
+
+    putBE32( hdr, (uint32_t)( size + moresz ) );
+    memcpy( hdr + 4, type, 4 );
+
+    uLong crc = crc32( 0, hdr + 4, 4 );
+
+    if ( size > 0 )
+        crc = crc32( crc, data, (uInt)size );
+
+    if ( moresz > 0 )
+        crc = crc32( crc, more, (uInt)moresz );
+
+    putBE32( tail, (uint32_t)crc );
+
+    return ( fwrite( hdr, 1, 8, _fp ) == 8 ) &&
+           ( ( size == 0 ) || ( fwrite( data, 1, size, _fp ) == size ) ) &&
+           ( ( moresz == 0 ) || ( fwrite( more, 1, moresz, _fp ) == moresz ) ) &&
+           ( fwrite( tail, 1, 4, _fp ) == 4 );
+}
+
+bool PNGParallelWriter::open( const char* path, const StripImageInfo& info,
+                              const StripWriterOptions& opts )
+{
+    static const unsigned char sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    _info      = info;
+    _exec      = opts.exec;
+    _batchrows = 0;
+    _adler     = adler32( 0, NULL, 0 );
+    _started   = false;
+    _failed    = false;
+
+    _pb.strips = &_strips;
+    _pb.dict   = NULL;
+    _pb.dictsz = 0;
+    _pb.rowsz  = (size_t)info.width * info.depth;
+    _pb.bpp    = info.depth;
+    _pb.fast   = ( opts.pnglevel < 0 );
+    _pb.level  = opts.pnglevel < 0 ? Z_BEST_SPEED : opts.pnglevel;
+
+    _striprows = (unsigned)( PNG_STRIP_BYTES / ( _pb.rowsz + 1 ) );
+
+    if ( _striprows == 0 )
+        _striprows = 1;
+
+    _batch.resize( (size_t)_striprows * PNG_BATCH_STRIPS * _pb.rowsz );
+
+    _fp = fopen( path, "wb" );
+
+    if ( _fp == NULL )
+        return false;
+
+    unsigned char ihdr[13];
+
+    putBE32( ihdr, info.width );
+    putBE32( ihdr + 4, info.height );
+    ihdr[8]  = 8;
+    ihdr[9]  = (unsigned char)pngColorType( info.depth );
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+
+    return ( fwrite( sig, 1, 8, _fp ) == 8 ) && chunk( "IHDR", ihdr, 13 );
+}
+
+bool PNGParallelWriter::writeRows( const unsigned char* rows, unsigned count, size_t stride )
+{
+    if ( stride == 0 )
+        stride = _pb.rowsz;
+
+    if ( ( _failed == true ) || ( _rows + count > _info.height ) )
+        return false;
+
+    unsigned batchmax = _striprows * PNG_BATCH_STRIPS;
+
+    for ( unsigned cnt = 0; cnt < count; cnt++ )
+    {
+        memcpy( &_batch[ _batchrows * _pb.rowsz ], rows + cnt * stride, _pb.rowsz );
+
+        _batchrows++;
+        _rows++;
+
+        if ( ( _batchrows == batchmax ) || ( _rows == _info.height ) )
+        {
+            if ( flush() == false )
+            {
+                _failed = true;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool PNGParallelWriter::flush()
+{
+    unsigned nstrips = ( _batchrows + _striprows - 1 ) / _striprows;
+
+    _strips.resize( nstrips );
+
+    for ( unsigned n = 0; n < nstrips; n++ )
+    {
+        PNGStrip& ps = _strips[n];
+        unsigned  r0 = n * _striprows;
+
+        ps.rows  = &_batch[ r0 * _pb.rowsz ];
+        ps.count = _batchrows - r0 < _striprows ? _batchrows - r0 : _striprows;
+        ps.last  = ( _rows == _info.height ) && ( n + 1 == nstrips );
+
+        if ( r0 > 0 )
+            ps.prev = ps.rows - _pb.rowsz;
+        else
+            ps.prev = _prev.size() > 0 ? _prev.data() : NULL;
+    }
+
+    _pb.dict   = _dict.data();
+    _pb.dictsz = (unsigned)_dict.size();
+
+    // every strip needs filtered tail of one before it as dictionary.
+    _exec->parallel_for( _exec->user, nstrips, 1, filterStrips, &_pb );
+    _exec->parallel_for( _exec->user, nstrips, 1, deflateStrips, &_pb );
+
+    for ( unsigned n = 0; n < nstrips; n++ )
+    {
+        PNGStrip& ps = _strips[n];
+
+        if ( ps.out.size() == 0 )
+            return false;
+
+        unsigned char zhdr[2] = { 0x78, 0x01 };
+        unsigned char ztail[4];
+
+        // FLEVEL of header is informative only.
+        if ( _pb.level >= 6 )
+            zhdr[1] = _pb.level > 6 ? 0xDA : 0x9C;
+        else
+        if ( _pb.level >= 2 )
+            zhdr[1] = 0x5E;
+
+        _adler = adler32_combine( _adler, ps.adler, (z_off_t)ps.filtered.size() );
+        putBE32( ztail, (uint32_t)_adler );
+
+        bool retb;
+
+        if ( _started == false )
+        {
+            // zlib header goes in front of first IDAT.
+            vector<unsigned char> first( zhdr, zhdr + 2 );
+
+            first.insert( first.end(), ps.out.begin(), ps.out.end() );
+
+            retb = chunk( "IDAT", first.data(), first.size(),
+                          ps.last == true ? ztail : NULL, ps.last == true ? 4 : 0 );
+
+            _started = true;
+        }
+        else
+        {
+            retb = chunk( "IDAT", ps.out.data(), ps.out.size(),
+                          ps.last == true ? ztail : NULL, ps.last == true ? 4 : 0 );
+        }
+
+        if ( retb == false )
+            return false;
+    }
+
+    PNGStrip& tail   = _strips[ nstrips - 1 ];
+    size_t    dictsz = tail.filtered.size() < PNG_DICT_BYTES ? tail.filtered.size() : PNG_DICT_BYTES;
+
+    _dict.assign( tail.filtered.end() - dictsz, tail.filtered.end() );
+    _prev.assign( tail.rows + ( tail.count - 1 ) * _pb.rowsz, tail.rows + tail.count * _pb.rowsz );
+
+    _batchrows = 0;
+
+    return true;
+}
+
+bool PNGParallelWriter::close()
+{
+    if ( _fp == NULL )
+        return false;
+
+    if ( ( _failed == true ) || ( chunk( "IEND", NULL, 0 ) == false ) )
+        _rows = 0;
+
+    _strips.clear();
+
+    return StripWriter::close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// JPEG by libjpeg scanlines.
+
+typedef struct
+{
+    struct jpeg_error_mgr   mgr;
+    jmp_buf                 jmp;
+}JPEGError;
+
+static void jpegErrorExit( j_common_ptr cinfo )
+{
+    JPEGError* je = (JPEGError*)cinfo->err;
+
+    (*cinfo->err->output_message)( cinfo );
+    longjmp( je->jmp, 1 );
+}
+
+class JPEGWriter : public StripWriter
+{
+    public:
+        JPEGWriter()
+         : _created( false )
+        {
+        }
+
+        ~JPEGWriter()
+        {
+            if ( _created == true )
+            {
+                jpeg_destroy_compress( &_cinfo );
+            }
+        }
+
+    public:
+        bool open( const char* path, const StripImageInfo& info, const StripWriterOptions& opts );
+        bool writeRows( const unsigned char* rows, unsigned count, size_t stride );
+        bool close();
+
+    private:
+        struct jpeg_compress_struct _cinfo;
+        JPEGError                   _jerr;
+        bool                        _created;
+        vector<unsigned char>       _line;
+};
+
+bool JPEGWriter::open( const char* path, const StripImageInfo& info, const StripWriterOptions& opts )
+{
+    _info = info;
+
+    _fp = fopen( path, "wb" );
+
+    if ( _fp == NULL )
+        return false;
+
+    _cinfo.err = jpeg_std_error( &_jerr.mgr );
+    _jerr.mgr.error_exit = jpegErrorExit;
+
+    if ( setjmp( _jerr.jmp ) != 0 )
+        return false;
+
+    jpeg_create_compress( &_cinfo );
+    _created = true;
+
+    jpeg_stdio_dest( &_cinfo, _fp );
+
+    _cinfo.image_width      = info.width;
+    _cinfo.image_height     = info.height;
+    _cinfo.input_components = info.depth == 1 ? 1 : 3;
+    _cinfo.in_color_space   = info.depth == 1 ? JCS_GRAYSCALE : JCS_RGB;
+
+    jpeg_set_defaults( &_cinfo );
+    jpeg_set_quality( &_cinfo, opts.jpegquality, TRUE );
+    jpeg_start_compress( &_cinfo, TRUE );
+
+    if ( info.depth == 4 )
+        _line.resize( (size_t)info.width * 3 );
+
+    return true;
+}
+
+bool JPEGWriter::writeRows( const unsigned char* rows, unsigned count, size_t stride )
+{
+    size_t rowstep = stride > 0 ? stride : (size_t)_info.width * _info.depth;
+
+    if ( _rows + count > _info.height )
+        return false;
+
+    if ( setjmp( _jerr.jmp ) != 0 )
+        return false;
+
+    for ( unsigned cnt = 0; cnt < count; cnt++ )
+    {
+        JSAMPROW row = (JSAMPROW)( rows + cnt * rowstep );
+
+        if ( _line.size() > 0 )
+        {
+            for ( unsigned x = 0; x < _info.width; x++ )
+            {
+                memcpy( &_line[ x * 3 ], row + x * 4, 3 );
+            }
+
+            row = _line.data();
+        }
+
+        jpeg_write_scanlines( &_cinfo, &row, 1 );
+        _rows++;
+    }
+
+    return true;
+}
+
+bool JPEGWriter::close()
+{
+    if ( _fp == NULL )
+        return false;
+
+    if ( ( _rows == _info.height ) && ( setjmp( _jerr.jmp ) == 0 ) )
+    {
+        jpeg_finish_compress( &_cinfo );
+    }
+    else
+    {
+        _rows = 0;
+    }
+
+    return StripWriter::close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static string lowerExtension( const char* path )
+{
+    string      name = path;
+    size_t      pos  = name.find_last_of( '.' );
+    size_t      sep  = name.find_last_of( "/\\" );
+
+    if ( ( pos == string::npos ) || ( ( sep != string::npos ) && ( sep > pos ) ) )
+        return "";
+
+    string ext = name.substr( pos + 1 );
+
+    for ( size_t cnt = 0; cnt < ext.size(); cnt++ )
+    {
+        ext[cnt] = tolower( ext[cnt] );
+    }
+
+    return ext;
+}
+
+StripReader* OpenStripReader( const char* path, const StripImageInfo* rawinfo )
+{
+    if ( path == NULL )
+        return NULL;
+
+    FILE* fp = fopen( path, "rb" );
+
+    if ( fp == NULL )
+        return NULL;
+
+    if ( rawinfo != NULL )
+    {
+        RawReader* rr = new RawReader();
+
+        if ( ( rr->open( fp, *rawinfo ) == false ) ||
+             ( rawinfo->width == 0 ) || ( rawinfo->height == 0 ) ||
+             ( ( rawinfo->depth != 1 ) && ( rawinfo->depth != 3 ) && ( rawinfo->depth != 4 ) ) )
+        {
+            delete rr;
+            return NULL;
+        }
+
+        return rr;
+    }
+
+    unsigned char magic[4] = {0};
+
+    if ( fread( magic, 1, 4, fp ) != 4 )
+    {
+        fclose( fp );
+        return NULL;
+    }
+
+    if ( ( magic[0] == 'P' ) && ( ( magic[1] == '5' ) || ( magic[1] == '6' ) ) )
+    {
+        PNMReader* pr = new PNMReader();
+
+        fseek( fp, 2, SEEK_SET );
+
+        if ( pr->open( fp, magic[1] == '5' ? 1 : 3 ) == false )
+        {
+            delete pr;
+            return NULL;
+        }
+
+        return pr;
+    }
+
+    if ( ( ( magic[0] == 'I' ) && ( magic[1] == 'I' ) ) ||
+         ( ( magic[0] == 'M' ) && ( magic[1] == 'M' ) ) )
+    {
+        TIFFReader* tr = new TIFFReader();
+
+        fseek( fp, 0, SEEK_SET );
+
+        if ( tr->open( fp ) == false )
+        {
+            delete tr;
+            return NULL;
+        }
+
+        return tr;
+    }
+
+    fclose( fp );
+
+    return NULL;
+}
+
+// PNG IHDR, first chunk after signature.
+static bool probePNG( FILE* fp, StripImageInfo& info )
+{
+    static const unsigned char sig[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+
+    unsigned char hdr[26] = {0};
+
+    if ( ( fread( hdr, 1, 26, fp ) != 26 ) || ( memcmp( hdr, sig, 8 ) != 0 ) ||
+         ( memcmp( hdr + 12, "IHDR", 4 ) != 0 ) )
+        return false;
+
+    info.width  = ( (unsigned)hdr[16] << 24 ) | ( hdr[17] << 16 ) | ( hdr[18] << 8 ) | hdr[19];
+    info.height = ( (unsigned)hdr[20] << 24 ) | ( hdr[21] << 16 ) | ( hdr[22] << 8 ) | hdr[23];
+
+    switch( hdr[25] )
+    {
+        case 0: info.depth = 1; break;  /// gray.
+        case 4: info.depth = 2; break;  /// gray and alpha.
+        case 6: info.depth = 4; break;  /// RGBA.
+        default: info.depth = 3; break; /// RGB or palette.
+    }
+
+    return true;
+}
+
+// JPEG frame header ( SOFn ), markers before it are skipped by length.
+static bool probeJPEG( FILE* fp, StripImageInfo& info )
+{
+    unsigned char mk[2] = {0};
+
+    if ( ( fread( mk, 1, 2, fp ) != 2 ) || ( mk[0] != 0xFF ) || ( mk[1] != 0xD8 ) )
+        return false;
+
+    while( true )
+    {
+        int c = fgetc( fp );
+
+        if ( c == EOF )
+            return false;
+
+        if ( c != 0xFF )
+            continue;
+
+        // fill bytes.
+        while( c == 0xFF )
+            c = fgetc( fp );
+
+        if ( ( c == EOF ) || ( c == 0xD9 ) || ( c == 0xDA ) )
+            return false;
+
+        // standalone markers.
+        if ( ( c == 0x01 ) || ( ( c >= 0xD0 ) && ( c <= 0xD7 ) ) )
+            continue;
+
+        unsigned char seg[8] = {0};
+
+        if ( fread( seg, 1, 2, fp ) != 2 )
+            return false;
+
+        unsigned len = ( seg[0] << 8 ) | seg[1];
+
+        if ( len < 2 )
+            return false;
+
+        bool sof = ( c >= 0xC0 ) && ( c <= 0xCF ) &&
+                   ( c != 0xC4 ) && ( c != 0xC8 ) && ( c != 0xCC );
+
+        if ( sof == false )
+        {
+            if ( fseek( fp, len - 2, SEEK_CUR ) != 0 )
+                return false;
+
+            continue;
+        }
+
+        if ( ( len < 8 ) || ( fread( seg, 1, 6, fp ) != 6 ) )
+            return false;
+
+        info.height = ( seg[1] << 8 ) | seg[2];
+        info.width  = ( seg[3] << 8 ) | seg[4];
+        info.depth  = seg[5] == 1 ? 1 : 3;
+
+        return ( info.width > 0 ) && ( info.height > 0 );
+    }
+}
+
+bool ProbeImageInfo( const char* path, const StripImageInfo* rawinfo, StripImageInfo& info )
+{
+    StripReader* reader = OpenStripReader( path, rawinfo );
+
+    if ( reader != NULL )
+    {
+        info = reader->info();
+        delete reader;
+
+        return true;
+    }
+
+    if ( ( path == NULL ) || ( rawinfo != NULL ) )
+        return false;
+
+    FILE* fp = fopen( path, "rb" );
+
+    if ( fp == NULL )
+        return false;
+
+    bool retb = probePNG( fp, info );
+
+    if ( retb == false )
+    {
+        fseek( fp, 0, SEEK_SET );
+        retb = probeJPEG( fp, info );
+    }
+
+    fclose( fp );
+
+    return retb;
+}
+
+bool IsStripWriterPath( const char* path )
+{
+    if ( path == NULL )
+        return false;
+
+    string ext = lowerExtension( path );
+
+    return ( ext == "pgm" ) || ( ext == "ppm" ) || ( ext == "pnm" ) ||
+           ( ext == "tif" ) || ( ext == "tiff" ) || ( ext == "raw" ) ||
+           ( ext == "png" ) || ( ext == "jpg" ) || ( ext == "jpeg" );
+}
+
+void DefaultStripWriterOptions( StripWriterOptions& opts )
+{
+    opts.jpegquality = 95;
+    opts.pnglevel    = -1;
+    opts.exec        = NULL;
+}
+
+StripWriter* OpenStripWriter( const char* path, const StripImageInfo& info,
+                              const StripWriterOptions* opts )
+{
+    StripWriterOptions defopts;
+
+    if ( opts == NULL )
+    {
+        DefaultStripWriterOptions( defopts );
+        opts = &defopts;
+    }
+
+    if ( ( IsStripWriterPath( path ) == false ) ||
+         ( info.width == 0 ) || ( info.height == 0 ) ||
+         ( ( info.depth != 1 ) && ( info.depth != 3 ) && ( info.depth != 4 ) ) )
+        return NULL;
+
+    string ext = lowerExtension( path );
+
+    if ( ( ext == "tif" ) || ( ext == "tiff" ) )
+    {
+        TIFFWriter* tw = new TIFFWriter();
+
+        if ( tw->open( path, info ) == false )
+        {
+            delete tw;
+            return NULL;
+        }
+
+        return tw;
+    }
+
+    if ( ( ext == "png" ) && ( opts->exec != NULL ) )
+    {
+        PNGParallelWriter* ppw = new PNGParallelWriter();
+
+        if ( ppw->open( path, info, *opts ) == false )
+        {
+            delete ppw;
+            return NULL;
+        }
+
+        return ppw;
+    }
+
+    if ( ext == "png" )
+    {
+        PNGWriter* pngw = new PNGWriter();
+
+        if ( pngw->open( path, info, *opts ) == false )
+        {
+            delete pngw;
+            return NULL;
+        }
+
+        return pngw;
+    }
+
+    if ( ( ext == "jpg" ) || ( ext == "jpeg" ) )
+    {
+        JPEGWriter* jw = new JPEGWriter();
+
+        if ( jw->open( path, info, *opts ) == false )
+        {
+            delete jw;
+            return NULL;
+        }
+
+        return jw;
+    }
+
+    PNMWriter* pw = new PNMWriter();
+
+    if ( pw->open( path, info, ext != "raw" ) == false )
+    {
+        delete pw;
+        return NULL;
+    }
+
+    return pw;
+}
@@ -0,0 +1,96 @@
+#ifndef __STRIPIO_H__
+#define __STRIPIO_H__
+
+#include <cstdio>
+#include <vector>
+#include "libsrcnn.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Row by row image readers and writers for out-of-core processing,
+// whole image never stays in memory.
+// - PNM  : P5 ( gray ) and P6 ( RGB ), 8bit.
+// - raw  : interleaved 8bit rows, geometry given by caller.
+// - TIFF : classic and BigTIFF, 8bit gray, RGB or RGBA, chunky, strips or
+//          tiles, none, LZW, Deflate or PackBits with horizontal predictor.
+// - PNG  : written by libpng rows, or strips deflated in parallel through
+//          an executor and stitched to one zlib stream.
+// - JPEG : written by libjpeg scanlines, alpha is dropped.
+// Rows are RGB order, depth is 1, 3 or 4.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+    unsigned    width;
+    unsigned    height;
+    unsigned    depth;
+}StripImageInfo;
+
+class StripReader
+{
+    public:
+        StripReader();
+        virtual ~StripReader();
+
+    public:
+        // Rows come from top in order, width * depth bytes each.
+        virtual bool readRow( unsigned char* row ) = 0;
+
+    public:
+        const StripImageInfo& info()    { return _info; }
+        unsigned rowsRead()             { return _rows; }
+
+    protected:
+        FILE*           _fp;
+        StripImageInfo  _info;
+        unsigned        _rows;
+};
+
+class StripWriter
+{
+    public:
+        StripWriter();
+        virtual ~StripWriter();
+
+    public:
+        // Rows go from top in order, stride 0 for width * depth.
+        virtual bool writeRows( const unsigned char* rows, unsigned count, size_t stride ) = 0;
+        // Completes file, false when not all rows were written.
+        virtual bool close();
+
+    public:
+        const StripImageInfo& info()    { return _info; }
+        unsigned rowsWritten()          { return _rows; }
+
+    protected:
+        FILE*           _fp;
+        StripImageInfo  _info;
+        unsigned        _rows;
+};
+
+typedef struct
+{
+    int                     jpegquality;    /// 1 to 100.
+    int                     pnglevel;       /// zlib level 0 to 9, -1 for fast.
+    const srcnn_executor*   exec;           /// parallel PNG, NULL for libpng.
+}StripWriterOptions;
+
+// Same to OpenCV imwrite() : JPEG quality 95, PNG level 1 with Sub filter.
+void DefaultStripWriterOptions( StripWriterOptions& opts );
+
+// Format by magic of file, raw needs geometry in rawinfo.
+StripReader* OpenStripReader( const char* path, const StripImageInfo* rawinfo = NULL );
+
+// Geometry from header without reading rows : formats of OpenStripReader(),
+// then PNG and JPEG. depth is channels stored, 2 for PNG gray with alpha.
+bool ProbeImageInfo( const char* path, const StripImageInfo* rawinfo, StripImageInfo& info );
+
+// Format by extension : .pgm .ppm .pnm .tif .tiff .raw .png .jpg .jpeg
+StripWriter* OpenStripWriter( const char* path, const StripImageInfo& info,
+                              const StripWriterOptions* opts = NULL );
+
+// True when OpenStripWriter() knows extension of path.
+bool IsStripWriterPath( const char* path );
+
+#endif /// of __STRIPIO_H__
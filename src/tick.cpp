@@ -1,6 +1,6 @@
 #ifndef _MSC_VER
 
-#include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #include <iostream>
 #include "tick.h"
@@ -12,11 +12,11 @@ namespace
 		public:
 			__GET_TICK_COUNT()
 			{
-				if (gettimeofday(&tv_, NULL) != 0)
+				if (clock_gettime(CLOCK_MONOTONIC, &ts_) != 0)
 					throw 0;
 			}
 
-			timeval tv_;
+			timespec ts_;
 	};
 
 	__GET_TICK_COUNT timeStart;
@@ -27,13 +27,14 @@ namespace tick
 	
 unsigned long getTickCount()
 {
-	static time_t	secStart	= timeStart.tv_.tv_sec;
-	static time_t	usecStart	= timeStart.tv_.tv_usec;
-								
-	timeval tv;
-	gettimeofday(&tv, NULL);
+	static time_t	secStart	= timeStart.ts_.tv_sec;
+	static long		nsecStart	= timeStart.ts_.tv_nsec;
+
+	// monotonic, wall clock steps do not break spans.
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
 	
-	return (tv.tv_sec - secStart) * 1000 + (tv.tv_usec - usecStart) / 1000;
+	return (ts.tv_sec - secStart) * 1000 + (ts.tv_nsec - nsecStart) / 1000000;
 }
 
 };
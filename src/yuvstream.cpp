@@ -0,0 +1,409 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+#endif
+
+#include "yuvstream.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define Y4M_MAGIC           "YUV4MPEG2"
+#define Y4M_FRAME_MAGIC     "FRAME"
+#define Y4M_MAX_LINE        1024
+
+////////////////////////////////////////////////////////////////////////////////
+
+static bool readLine( FILE* fp, char* buff, size_t buffsz )
+{
+    size_t que = 0;
+
+    while( que < ( buffsz - 1 ) )
+    {
+        int ch = fgetc( fp );
+
+        if ( ch == EOF )
+        {
+            return false;
+        }
+
+        if ( ch == '\n' )
+        {
+            buff[ que ] = 0;
+            return true;
+        }
+
+        buff[ que++ ] = (char)ch;
+    }
+
+    // too long line, not a sane Y4M.
+    return false;
+}
+
+static bool parseRatio( const char* str, unsigned& num, unsigned& den )
+{
+    unsigned n = 0;
+    unsigned d = 0;
+
+    if ( sscanf( str, "%u:%u", &n, &d ) == 2 )
+    {
+        num = n;
+        den = d;
+        return true;
+    }
+
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+YUVStream::YUVStream()
+ : _fp( NULL ),
+   _y4m( false ),
+   _owned( false ),
+   _writing( false ),
+   _frames( 0 )
+{
+    memset( &_info, 0, sizeof( YUVStreamInfo ) );
+}
+
+YUVStream::~YUVStream()
+{
+    close();
+}
+
+bool YUVStream::openRead( const char* path, bool y4m, const YUVStreamInfo* raw )
+{
+    close();
+
+    if ( path == NULL )
+        return false;
+
+    if ( strcmp( path, "-" ) == 0 )
+    {
+        _fp    = stdin;
+        _owned = false;
+#ifdef _WIN32
+        _setmode( _fileno( stdin ), _O_BINARY );
+#endif
+    }
+    else
+    {
+        _fp    = fopen( path, "rb" );
+        _owned = true;
+    }
+
+    if ( _fp == NULL )
+        return false;
+
+    _y4m     = y4m;
+    _writing = false;
+    _frames  = 0;
+
+    if ( _y4m == true )
+    {
+        if ( readHeader() == false )
+        {
+            close();
+            return false;
+        }
+    }
+    else
+    {
+        if ( raw == NULL )
+        {
+            close();
+            return false;
+        }
+
+        _info = *raw;
+
+        if ( _info.fps_num == 0 )
+        {
+            _info.fps_num = 25;
+            _info.fps_den = 1;
+        }
+
+        if ( _info.interlace == 0 )
+        {
+            _info.interlace = 'p';
+        }
+    }
+
+    if ( ( _info.width == 0 ) || ( _info.height == 0 ) )
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+bool YUVStream::openWrite( const char* path, bool y4m, const YUVStreamInfo& info )
+{
+    close();
+
+    if ( path == NULL )
+        return false;
+
+    if ( strcmp( path, "-" ) == 0 )
+    {
+        _fp    = stdout;
+        _owned = false;
+#ifdef _WIN32
+        _setmode( _fileno( stdout ), _O_BINARY );
+#endif
+    }
+    else
+    {
+        _fp    = fopen( path, "wb" );
+        _owned = true;
+    }
+
+    if ( _fp == NULL )
+        return false;
+
+    _y4m     = y4m;
+    _writing = true;
+    _frames  = 0;
+    _info    = info;
+
+    if ( _y4m == true )
+    {
+        if ( writeHeader() == false )
+        {
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void YUVStream::close()
+{
+    if ( _fp != NULL )
+    {
+        if ( _writing == true )
+        {
+            fflush( _fp );
+        }
+
+        if ( _owned == true )
+        {
+            fclose( _fp );
+        }
+
+        _fp = NULL;
+    }
+}
+
+bool YUVStream::readFrame( unsigned char* y, unsigned char* u, unsigned char* v )
+{
+    if ( ( _fp == NULL ) || ( _writing == true ) )
+        return false;
+
+    if ( _y4m == true )
+    {
+        if ( readFrameHeader() == false )
+            return false;
+    }
+
+    unsigned char* planes[3] = { y, u, v };
+    unsigned       pcnt      = planeCount( _info );
+
+    for( unsigned cnt=0; cnt<pcnt; cnt++ )
+    {
+        size_t psz = (size_t)planeWidth( _info, cnt ) * planeHeight( _info, cnt );
+
+        if ( planes[cnt] == NULL )
+            return false;
+
+        if ( fread( planes[cnt], 1, psz, _fp ) != psz )
+            return false;
+    }
+
+    _frames++;
+
+    return true;
+}
+
+bool YUVStream::writeFrame( const unsigned char* y, const unsigned char* u, const unsigned char* v )
+{
+    if ( ( _fp == NULL ) || ( _writing == false ) )
+        return false;
+
+    if ( _y4m == true )
+    {
+        if ( fprintf( _fp, "%s\n", Y4M_FRAME_MAGIC ) < 0 )
+            return false;
+    }
+
+    const unsigned char* planes[3] = { y, u, v };
+    unsigned             pcnt      = planeCount( _info );
+
+    for( unsigned cnt=0; cnt<pcnt; cnt++ )
+    {
+        size_t psz = (size_t)planeWidth( _info, cnt ) * planeHeight( _info, cnt );
+
+        if ( planes[cnt] == NULL )
+            return false;
+
+        if ( fwrite( planes[cnt], 1, psz, _fp ) != psz )
+            return false;
+    }
+
+    _frames++;
+
+    return true;
+}
+
+unsigned YUVStream::planeWidth( const YUVStreamInfo& info, unsigned plane )
+{
+    if ( ( plane > 0 ) && ( info.chroma == YUVSTREAM_CHROMA_420 ) )
+    {
+        return ( info.width + 1 ) / 2;
+    }
+
+    return info.width;
+}
+
+unsigned YUVStream::planeHeight( const YUVStreamInfo& info, unsigned plane )
+{
+    if ( ( plane > 0 ) && ( info.chroma == YUVSTREAM_CHROMA_420 ) )
+    {
+        return ( info.height + 1 ) / 2;
+    }
+
+    return info.height;
+}
+
+unsigned YUVStream::planeCount( const YUVStreamInfo& info )
+{
+    if ( info.chroma == YUVSTREAM_CHROMA_MONO )
+        return 1;
+
+    return 3;
+}
+
+bool YUVStream::readHeader()
+{
+    char line[ Y4M_MAX_LINE ] = {0};
+
+    if ( readLine( _fp, line, Y4M_MAX_LINE ) == false )
+        return false;
+
+    if ( strncmp( line, Y4M_MAGIC, strlen( Y4M_MAGIC ) ) != 0 )
+        return false;
+
+    memset( &_info, 0, sizeof( YUVStreamInfo ) );
+    _info.chroma    = YUVSTREAM_CHROMA_420;
+    _info.fps_num   = 25;
+    _info.fps_den   = 1;
+    _info.interlace = 'p';
+
+    char* saveptr = NULL;
+    char* token   = strtok_r( line + strlen( Y4M_MAGIC ), " ", &saveptr );
+
+    while( token != NULL )
+    {
+        switch( token[0] )
+        {
+            case 'W':
+                _info.width = atoi( &token[1] );
+                break;
+
+            case 'H':
+                _info.height = atoi( &token[1] );
+                break;
+
+            case 'F':
+                parseRatio( &token[1], _info.fps_num, _info.fps_den );
+                break;
+
+            case 'A':
+                parseRatio( &token[1], _info.aspect_num, _info.aspect_den );
+                break;
+
+            case 'I':
+                _info.interlace = token[1];
+                break;
+
+            case 'C':
+                // 8bit 4:2:0 sitings only, "420p10" and others are not.
+                if ( ( strcmp( &token[1], "420" ) == 0 ) ||
+                     ( strcmp( &token[1], "420jpeg" ) == 0 ) ||
+                     ( strcmp( &token[1], "420mpeg2" ) == 0 ) ||
+                     ( strcmp( &token[1], "420paldv" ) == 0 ) )
+                {
+                    _info.chroma = YUVSTREAM_CHROMA_420;
+                    snprintf( _info.siting, sizeof( _info.siting ), "%s", &token[1] );
+                }
+                else
+                if ( strcmp( &token[1], "444" ) == 0 )
+                {
+                    _info.chroma = YUVSTREAM_CHROMA_444;
+                }
+                else
+                if ( strcmp( &token[1], "mono" ) == 0 )
+                {
+                    _info.chroma = YUVSTREAM_CHROMA_MONO;
+                }
+                else
+                {
+                    // 4:2:2, 4:1:1, high bit depth and alpha not supported.
+                    return false;
+                }
+                break;
+
+            default: /// 'X' comments and unknowns are ignored.
+                break;
+        }
+
+        token = strtok_r( NULL, " ", &saveptr );
+    }
+
+    return true;
+}
+
+bool YUVStream::readFrameHeader()
+{
+    char line[ Y4M_MAX_LINE ] = {0};
+
+    if ( readLine( _fp, line, Y4M_MAX_LINE ) == false )
+        return false;
+
+    if ( strncmp( line, Y4M_FRAME_MAGIC, strlen( Y4M_FRAME_MAGIC ) ) != 0 )
+        return false;
+
+    return true;
+}
+
+bool YUVStream::writeHeader()
+{
+    const char* ctag = _info.siting[0] != 0 ? _info.siting : "420jpeg";
+
+    switch( _info.chroma )
+    {
+        case YUVSTREAM_CHROMA_444:
+            ctag = "444";
+            break;
+
+        case YUVSTREAM_CHROMA_MONO:
+            ctag = "mono";
+            break;
+    }
+
+    int reti = fprintf( _fp, "%s W%u H%u F%u:%u I%c A%u:%u C%s\n",
+                        Y4M_MAGIC,
+                        _info.width, _info.height,
+                        _info.fps_num, _info.fps_den,
+                        _info.interlace != 0 ? _info.interlace : 'p',
+                        _info.aspect_num, _info.aspect_den,
+                        ctag );
+
+    return ( reti > 0 );
+}
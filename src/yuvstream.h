@@ -0,0 +1,71 @@
+#ifndef __YUVSTREAM_H__
+#define __YUVSTREAM_H__
+
+#include <cstdio>
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Planar YUV / YUV4MPEG2 ( Y4M ) frame stream reader and writer.
+// - 8bit planar only : 4:2:0, 4:4:4 and mono ( Y only ).
+// - "-" as path means stdin for reading, stdout for writing.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define YUVSTREAM_CHROMA_MONO   0
+#define YUVSTREAM_CHROMA_420    420
+#define YUVSTREAM_CHROMA_444    444
+
+typedef struct
+{
+    unsigned    width;
+    unsigned    height;
+    unsigned    chroma;     /// one of YUVSTREAM_CHROMA_*
+    unsigned    fps_num;
+    unsigned    fps_den;
+    unsigned    aspect_num;
+    unsigned    aspect_den;
+    char        interlace;  /// Y4M 'I' tag, 'p' for progressive.
+    char        siting[12]; /// Y4M 4:2:0 'C' tag as read, empty for "420jpeg".
+}YUVStreamInfo;
+
+class YUVStream
+{
+    public:
+        YUVStream();
+        ~YUVStream();
+
+    public:
+        // Y4M reads geometry from stream header, raw needs info filled.
+        bool openRead( const char* path, bool y4m, const YUVStreamInfo* raw = NULL );
+        bool openWrite( const char* path, bool y4m, const YUVStreamInfo& info );
+        void close();
+
+    public:
+        // Planes must be sized by planeWidth()/planeHeight() of this info.
+        bool readFrame( unsigned char* y, unsigned char* u, unsigned char* v );
+        bool writeFrame( const unsigned char* y, const unsigned char* u, const unsigned char* v );
+
+    public:
+        const YUVStreamInfo& info()     { return _info; }
+        unsigned frames()               { return _frames; }
+
+    public:
+        static unsigned planeWidth( const YUVStreamInfo& info, unsigned plane );
+        static unsigned planeHeight( const YUVStreamInfo& info, unsigned plane );
+        static unsigned planeCount( const YUVStreamInfo& info );
+
+    private:
+        bool readHeader();
+        bool readFrameHeader();
+        bool writeHeader();
+
+    private:
+        FILE*           _fp;
+        bool            _y4m;
+        bool            _owned;
+        bool            _writing;
+        unsigned        _frames;
+        YUVStreamInfo   _info;
+};
+
+#endif /// of __YUVSTREAM_H__